@@ -1646,13 +1646,16 @@ deparseRangeTblRef(StringInfo buf, PlannerInfo *root, RelOptInfo *foreignrel,
  *
  * The statement text is appended to buf, and we also create an integer List
  * of the columns being retrieved by RETURNING (if any), which is returned
- * to *retrieved_attrs.
+ * to *retrieved_attrs.  The length of the statement up to the end of the
+ * VALUES clause is returned to *values_end_len, so that the statement can be
+ * rebuilt by rebuildInsertSql to insert several rows at once.
  */
 void
 deparseInsertSql(StringInfo buf, PlannerInfo *root,
 				 Index rtindex, Relation rel,
 				 List *targetAttrs, bool doNothing,
-				 List *returningList, List **retrieved_attrs)
+				 List *returningList, List **retrieved_attrs,
+				 int *values_end_len)
 {
 	AttrNumber	pindex;
 	bool		first;
@@ -1695,6 +1698,7 @@ deparseInsertSql(StringInfo buf, PlannerInfo *root,
 	}
 	else
 		appendStringInfoString(buf, " DEFAULT VALUES");
+	*values_end_len = buf->len;
 
 	if (doNothing)
 		appendStringInfoString(buf, " ON CONFLICT DO NOTHING");
@@ -1704,6 +1708,47 @@ deparseInsertSql(StringInfo buf, PlannerInfo *root,
 						 returningList, retrieved_attrs);
 }
 
+/*
+ * rebuild remote INSERT statement for inserting num_rows rows at once
+ *
+ * orig_query is a statement built by deparseInsertSql with num_cols columns
+ * and values_end_len as its returned VALUES clause length.  The rebuilt
+ * statement, with parameters for the extra rows added to the VALUES clause,
+ * is appended to buf.
+ */
+void
+rebuildInsertSql(StringInfo buf, char *orig_query,
+				 int values_end_len, int num_cols, int num_rows)
+{
+	int			pindex;
+	int			i;
+	int			j;
+
+	Assert(num_cols > 0 && num_rows > 0);
+	Assert(values_end_len > 0 && values_end_len <= strlen(orig_query));
+
+	/* Copy up to the end of the first row's VALUES list */
+	appendBinaryStringInfo(buf, orig_query, values_end_len);
+
+	/* Add the other rows, numbering their parameters after the first row's */
+	pindex = num_cols + 1;
+	for (i = 1; i < num_rows; i++)
+	{
+		appendStringInfoString(buf, ", (");
+		for (j = 0; j < num_cols; j++)
+		{
+			if (j > 0)
+				appendStringInfoString(buf, ", ");
+			appendStringInfo(buf, "$%d", pindex);
+			pindex++;
+		}
+		appendStringInfoChar(buf, ')');
+	}
+
+	/* Copy whatever follows the VALUES clause */
+	appendStringInfoString(buf, orig_query + values_end_len);
+}
+
 /*
  * deparse remote UPDATE statement
  *
@@ -2220,3 +2220,130 @@ SELECT b, avg(a), max(a), count(*) FROM pagg_tab GROUP BY b HAVING sum(a) < 700
 
 -- Clean-up
 RESET enable_partitionwise_aggregate;
+
+-- ===================================================================
+-- test asynchronous execution
+-- ===================================================================
+
+ALTER SERVER loopback OPTIONS (ADD async_capable 'true');
+ALTER SERVER loopback2 OPTIONS (ADD async_capable 'true');
+
+CREATE TABLE async_pt (a int, b int, c text) PARTITION BY RANGE (a);
+CREATE TABLE base_tbl1 (a int, b int, c text);
+CREATE TABLE base_tbl2 (a int, b int, c text);
+CREATE FOREIGN TABLE async_p1 PARTITION OF async_pt FOR VALUES FROM (1000) TO (2000)
+  SERVER loopback OPTIONS (table_name 'base_tbl1');
+CREATE FOREIGN TABLE async_p2 PARTITION OF async_pt FOR VALUES FROM (2000) TO (3000)
+  SERVER loopback2 OPTIONS (table_name 'base_tbl2');
+INSERT INTO async_p1 SELECT 1000 + i, i, to_char(i, 'FM0000') FROM generate_series(0, 999, 5) i;
+INSERT INTO async_p2 SELECT 2000 + i, i, to_char(i, 'FM0000') FROM generate_series(0, 999, 5) i;
+
+-- simple queries
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT * FROM async_pt WHERE b % 100 = 0;
+SELECT count(*), sum(a), min(c), max(c) FROM async_pt WHERE b % 100 = 0;
+
+-- asynchronous execution can be disabled
+SET enable_async_append TO false;
+EXPLAIN (COSTS OFF)
+SELECT * FROM async_pt WHERE b % 100 = 0;
+RESET enable_async_append;
+
+-- Clean-up
+DROP TABLE async_pt;
+DROP TABLE base_tbl1;
+DROP TABLE base_tbl2;
+ALTER SERVER loopback OPTIONS (DROP async_capable);
+ALTER SERVER loopback2 OPTIONS (DROP async_capable);
+
+-- ===================================================================
+-- test batch insert
+-- ===================================================================
+CREATE SERVER batch0 FOREIGN DATA WRAPPER postgres_fdw OPTIONS (batch_size '0');
+
+BEGIN;
+
+CREATE SERVER batch10 FOREIGN DATA WRAPPER postgres_fdw OPTIONS (batch_size '10');
+
+SELECT count(*)
+FROM pg_foreign_server
+WHERE srvname = 'batch10'
+AND srvoptions @> array['batch_size=10'];
+
+ALTER SERVER batch10 OPTIONS (SET batch_size '20');
+
+SELECT count(*)
+FROM pg_foreign_server
+WHERE srvname = 'batch10'
+AND srvoptions @> array['batch_size=20'];
+
+CREATE FOREIGN TABLE table30 (x int) SERVER batch10 OPTIONS (batch_size '30');
+
+SELECT count(*)
+FROM pg_foreign_table
+WHERE ftrelid = 'table30'::regclass
+AND ftoptions @> array['batch_size=30'];
+
+ROLLBACK;
+
+CREATE TABLE batch_table (x int);
+
+CREATE FOREIGN TABLE ftable (x int) SERVER loopback
+  OPTIONS (table_name 'batch_table', batch_size '10');
+EXPLAIN (VERBOSE, COSTS OFF) INSERT INTO ftable SELECT * FROM generate_series(1, 10) i;
+INSERT INTO ftable SELECT * FROM generate_series(1, 10) i;
+INSERT INTO ftable SELECT * FROM generate_series(11, 31) i;
+INSERT INTO ftable VALUES (32);
+INSERT INTO ftable VALUES (33), (34);
+SELECT count(*), min(x), max(x), count(DISTINCT x) FROM ftable;
+-- batching is not used with RETURNING
+INSERT INTO ftable VALUES (35), (36) RETURNING x;
+-- COPY FROM uses batching too
+COPY ftable FROM stdin;
+37
+38
+39
+\.
+SELECT count(*), min(x), max(x), count(DISTINCT x) FROM ftable;
+TRUNCATE batch_table;
+DROP FOREIGN TABLE ftable;
+
+-- batch size 1 disables batching
+CREATE FOREIGN TABLE ftable (x int) SERVER loopback
+  OPTIONS (table_name 'batch_table', batch_size '1');
+EXPLAIN (VERBOSE, COSTS OFF) INSERT INTO ftable VALUES (1), (2);
+INSERT INTO ftable VALUES (1), (2);
+SELECT count(*) FROM ftable;
+DROP FOREIGN TABLE ftable;
+DROP TABLE batch_table;
+
+-- batching when tuples are routed to foreign partitions
+CREATE TABLE batch_table (x int) PARTITION BY HASH (x);
+CREATE TABLE batch_table_p0 (LIKE batch_table);
+CREATE FOREIGN TABLE batch_table_p0f
+  PARTITION OF batch_table
+  FOR VALUES WITH (MODULUS 3, REMAINDER 0)
+  SERVER loopback
+  OPTIONS (table_name 'batch_table_p0', batch_size '10');
+CREATE TABLE batch_table_p1 (LIKE batch_table);
+CREATE FOREIGN TABLE batch_table_p1f
+  PARTITION OF batch_table
+  FOR VALUES WITH (MODULUS 3, REMAINDER 1)
+  SERVER loopback
+  OPTIONS (table_name 'batch_table_p1', batch_size '1');
+CREATE TABLE batch_table_p2
+  PARTITION OF batch_table
+  FOR VALUES WITH (MODULUS 3, REMAINDER 2);
+INSERT INTO batch_table SELECT * FROM generate_series(1, 66) i;
+COPY batch_table FROM stdin;
+67
+68
+69
+70
+\.
+SELECT count(*), min(x), max(x), count(DISTINCT x) FROM batch_table;
+
+-- Clean-up
+DROP TABLE batch_table;
+DROP TABLE batch_table_p0;
+DROP TABLE batch_table_p1;
@@ -12,6 +12,14 @@
  * Currently this infrastructure is used to share:
  * - typemod registry for ephemeral row-types, i.e. BlessTupleDesc etc.
  *
+ * It also provides for moving a pooled client session from one backend to
+ * another: the state a session keeps outside of any transaction (the
+ * settings it has made, its prepared statements, and its currval() and
+ * lastval() state) is serialized into a DSA area shared by all backends, and
+ * rebuilt from there by the backend that takes the session over.  State
+ * that cannot be moved, such as temporary tables, ties the session to its
+ * backend.
+ *
  * Portions Copyright (c) 2017-2018, PostgreSQL Global Development Group
  *
  * src/backend/access/common/session.c
@@ -20,10 +28,28 @@
  */
 #include "postgres.h"
 
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/htup_details.h"
 #include "access/session.h"
+#include "access/xact.h"
+#include "catalog/indexing.h"
+#include "catalog/namespace.h"
+#include "catalog/pg_depend.h"
+#include "catalog/pg_namespace.h"
+#include "commands/async.h"
+#include "commands/prepare.h"
+#include "commands/sequence.h"
+#include "postmaster/sessionpool.h"
+#include "storage/ipc.h"
+#include "storage/lock.h"
 #include "storage/lwlock.h"
 #include "storage/shm_toc.h"
+#include "storage/shmem.h"
+#include "utils/fmgroids.h"
+#include "utils/guc.h"
 #include "utils/memutils.h"
+#include "utils/portal.h"
 #include "utils/typcache.h"
 
 /* Magic number for per-session DSM TOC. */
@@ -44,9 +70,44 @@
 #define SESSION_KEY_DSA						UINT64CONST(0xFFFFFFFFFFFF0001)
 #define SESSION_KEY_RECORD_TYPMOD_REGISTRY	UINT64CONST(0xFFFFFFFFFFFF0002)
 
+/*
+ * Space in the main shared memory segment for the DSA area that holds
+ * serialized session state.  The area is extended with DSM segments if this
+ * fills up.
+ */
+#define SESSION_STATE_AREA_SIZE				0x40000
+
+/*
+ * Serialized state of a session: its sequence state as saved by
+ * SaveSequenceSessionState, then its settings, each as a
+ * SerializedSessionSetting followed by the null-terminated name and value,
+ * and finally its prepared statements as serialized by
+ * SerializePreparedStatements.
+ */
+typedef struct SerializedSessionState
+{
+	Size		sequences_size; /* bytes of sequence state */
+	Size		settings_size;	/* bytes of settings */
+	Size		statements_size;	/* bytes of prepared statements */
+	char		data[FLEXIBLE_ARRAY_MEMBER];
+} SerializedSessionState;
+
+typedef struct SerializedSessionSetting
+{
+	GucContext	context;
+	GucSource	source;
+} SerializedSessionSetting;
+
 /* This backend's current session. */
 Session    *CurrentSession = NULL;
 
+/* The session state area, and this backend's attachment to it */
+static void *SessionStatePlace = NULL;
+static dsa_area *SessionStateArea = NULL;
+
+static dsa_area *GetSessionStateArea(void);
+static bool TempNamespaceIsEmpty(Oid namespaceId);
+
 /*
  * Set up CurrentSession to point to an empty Session object.
  */
@@ -206,3 +267,279 @@ DetachSession(void)
 	dsa_detach(CurrentSession->area);
 	CurrentSession->area = NULL;
 }
+
+/*
+ * Report shared memory space needed by SessionStateShmemInit.
+ */
+Size
+SessionStateShmemSize(void)
+{
+	/* Sessions only move between backends with session pooling */
+	if (SessionPoolSize == 0)
+		return 0;
+
+	return SESSION_STATE_AREA_SIZE;
+}
+
+/*
+ * Create the session state area in shared memory.
+ *
+ * The area is pinned, so that it lives on while no backend is attached to
+ * it; the postmaster itself lets go of it right away.
+ */
+void
+SessionStateShmemInit(void)
+{
+	bool		found;
+
+	if (SessionPoolSize == 0)
+		return;
+
+	SessionStatePlace = ShmemInitStruct("Session State Area",
+										SESSION_STATE_AREA_SIZE, &found);
+	if (!found)
+	{
+		dsa_area   *area;
+
+		area = dsa_create_in_place(SessionStatePlace, SESSION_STATE_AREA_SIZE,
+								   LWTRANCHE_SESSION_STATE_DSA, NULL);
+		dsa_pin(area);
+		dsa_release_in_place(SessionStatePlace);
+		dsa_detach(area);
+	}
+}
+
+/*
+ * Attach to the session state area, if we haven't already.
+ */
+static dsa_area *
+GetSessionStateArea(void)
+{
+	if (SessionStateArea == NULL)
+	{
+		MemoryContext old_context;
+
+		Assert(SessionStatePlace != NULL);
+
+		old_context = MemoryContextSwitchTo(TopMemoryContext);
+		SessionStateArea = dsa_attach_in_place(SessionStatePlace, NULL);
+		dsa_pin_mapping(SessionStateArea);
+		on_shmem_exit(dsa_on_shmem_exit_release_in_place,
+					  PointerGetDatum(SessionStatePlace));
+		MemoryContextSwitchTo(old_context);
+	}
+
+	return SessionStateArea;
+}
+
+/*
+ * Check whether this backend holds state that a client session it serves
+ * may depend on, but that cannot be moved to another backend.
+ *
+ * Returns a description of the first such state found, or NULL if there is
+ * none.  The caller must not be inside a transaction.  The checks are for
+ * the backend as a whole, since we can't tell which of the sessions it has
+ * served the state belongs to.
+ */
+const char *
+GetSessionMigrationBlocker(void)
+{
+	Oid			tempNamespaceId;
+	Oid			tempToastNamespaceId;
+
+	Assert(!IsTransactionOrTransactionBlock());
+
+	if (!ThereAreNoReadyPortals())
+		return gettext_noop("open WITH HOLD cursors");
+
+	if (LockMethodHeldByMe(USER_LOCKMETHOD))
+		return gettext_noop("session-level advisory locks");
+
+	if (Async_IsListening())
+		return gettext_noop("LISTEN registrations");
+
+	/*
+	 * Our temporary namespace stays around once it has been set up, so check
+	 * whether there's anything left in it.
+	 */
+	GetTempNamespaceState(&tempNamespaceId, &tempToastNamespaceId);
+	if (OidIsValid(tempNamespaceId) &&
+		!TempNamespaceIsEmpty(tempNamespaceId))
+		return gettext_noop("temporary objects");
+
+	return NULL;
+}
+
+/*
+ * Check whether there are any objects in the given temporary namespace.
+ *
+ * Every object in a namespace has a dependency on it, except for the ones
+ * that belong to another object in the namespace (such as indexes and row
+ * types), so a look at pg_depend suffices.  We must not be inside a
+ * transaction; this runs one of its own.
+ */
+static bool
+TempNamespaceIsEmpty(Oid namespaceId)
+{
+	Relation	depRel;
+	ScanKeyData key[2];
+	SysScanDesc scan;
+	bool		empty;
+
+	StartTransactionCommand();
+
+	depRel = heap_open(DependRelationId, AccessShareLock);
+
+	ScanKeyInit(&key[0],
+				Anum_pg_depend_refclassid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(NamespaceRelationId));
+	ScanKeyInit(&key[1],
+				Anum_pg_depend_refobjid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(namespaceId));
+
+	scan = systable_beginscan(depRel, DependReferenceIndexId, true,
+							  NULL, 2, key);
+	empty = !HeapTupleIsValid(systable_getnext(scan));
+	systable_endscan(scan);
+
+	heap_close(depRel, AccessShareLock);
+
+	CommitTransactionCommand();
+
+	return empty;
+}
+
+/*
+ * Serialize a client session's settings, given as a list of SessionSettings,
+ * its table of prepared statements (as returned by SavePreparedStatements)
+ * and its sequence state into the session state area.
+ *
+ * Returns InvalidDsaPointer if the area is out of space.
+ */
+dsa_pointer
+SerializeSessionState(List *settings, HTAB *prepared_queries,
+					  SequenceSessionState *sequences)
+{
+	dsa_area   *area = GetSessionStateArea();
+	SerializedSessionState *state;
+	Size		sequences_size;
+	Size		settings_size = 0;
+	Size		statements_size;
+	Size		size;
+	dsa_pointer dp;
+	ListCell   *lc;
+	char	   *ptr;
+
+	sequences_size = SequenceSessionStateSize(sequences->nvalues);
+	foreach(lc, settings)
+	{
+		SessionSetting *setting = (SessionSetting *) lfirst(lc);
+
+		settings_size = add_size(settings_size,
+								 sizeof(SerializedSessionSetting) +
+								 strlen(setting->name) + 1 +
+								 strlen(setting->value) + 1);
+	}
+	statements_size = EstimatePreparedStatementsSpace(prepared_queries);
+	size = add_size(offsetof(SerializedSessionState, data),
+					add_size(sequences_size,
+							 add_size(settings_size, statements_size)));
+
+	dp = dsa_allocate_extended(area, size, DSA_ALLOC_HUGE | DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(dp))
+		return InvalidDsaPointer;
+
+	state = (SerializedSessionState *) dsa_get_address(area, dp);
+	state->sequences_size = sequences_size;
+	state->settings_size = settings_size;
+	state->statements_size = statements_size;
+
+	ptr = state->data;
+	memcpy(ptr, sequences, sequences_size);
+	ptr += sequences_size;
+	foreach(lc, settings)
+	{
+		SessionSetting *setting = (SessionSetting *) lfirst(lc);
+		SerializedSessionSetting hdr;
+
+		hdr.context = setting->context;
+		hdr.source = setting->source;
+		memcpy(ptr, &hdr, sizeof(hdr));
+		ptr += sizeof(hdr);
+		strcpy(ptr, setting->name);
+		ptr += strlen(setting->name) + 1;
+		strcpy(ptr, setting->value);
+		ptr += strlen(setting->value) + 1;
+	}
+	SerializePreparedStatements(prepared_queries, statements_size, ptr);
+
+	return dp;
+}
+
+/*
+ * Rebuild a client session's state serialized by SerializeSessionState in
+ * this backend, making it the current state, and free the serialized copy.
+ *
+ * Each setting is made in the context and with the source it was originally
+ * made with, so that it is subject to the same checks.  The settings are
+ * applied before the statements are prepared, since they may affect how
+ * that is done.  This must be called inside a transaction, with no prepared
+ * statements in place.
+ */
+void
+RestoreSessionState(dsa_pointer state)
+{
+	dsa_area   *area = GetSessionStateArea();
+	SerializedSessionState *shared;
+	SequenceSessionState *sequences;
+	Size		size;
+	char	   *data;
+	char	   *ptr;
+	char	   *end;
+
+	/*
+	 * Take a local copy, so that the shared one can be freed right away.  The
+	 * sequence state goes first, where it is suitably aligned.
+	 */
+	shared = (SerializedSessionState *) dsa_get_address(area, state);
+	size = shared->sequences_size + shared->settings_size +
+		shared->statements_size;
+	data = palloc(size);
+	memcpy(data, shared->data, size);
+	sequences = (SequenceSessionState *) data;
+	ptr = data + shared->sequences_size;
+	end = ptr + shared->settings_size;
+	dsa_free(area, state);
+
+	RestoreSequenceSessionState(sequences);
+
+	while (ptr < end)
+	{
+		SerializedSessionSetting hdr;
+		char	   *name;
+		char	   *value;
+
+		memcpy(&hdr, ptr, sizeof(hdr));
+		name = ptr + sizeof(hdr);
+		value = name + strlen(name) + 1;
+		ptr = value + strlen(value) + 1;
+
+		(void) set_config_option(name, value, hdr.context, hdr.source,
+								 GUC_ACTION_SET, true, WARNING, false);
+	}
+
+	RecreatePreparedStatements(end, size - (end - data));
+
+	pfree(data);
+}
+
+/*
+ * Free serialized session state that will not be restored.
+ */
+void
+DiscardSessionState(dsa_pointer state)
+{
+	dsa_free(GetSessionStateArea(), state);
+}
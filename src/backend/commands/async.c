@@ -679,6 +679,17 @@ Async_UnlistenAll(void)
 	queue_listen(LISTEN_UNLISTEN_ALL, "");
 }
 
+/*
+ * Async_IsListening
+ *
+ *		Is this backend listening on any channel?
+ */
+bool
+Async_IsListening(void)
+{
+	return listenChannels != NIL;
+}
+
 /*
  * SQL function: return a set of the channel names this backend is actively
  * listening to.
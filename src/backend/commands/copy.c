@@ -309,6 +309,8 @@ static void CopyFromInsertBatch(CopyState cstate, EState *estate,
 					BulkInsertState bistate,
 					int nBufferedTuples, HeapTuple *bufferedTuples,
 					int firstBufferedLineNo);
+static uint64 CopyFromForeignBatch(CopyState cstate, EState *estate,
+					 ResultRelInfo *resultRelInfo);
 static bool CopyReadLine(CopyState cstate);
 static bool CopyReadLineText(CopyState cstate);
 static int	CopyReadAttributesText(CopyState cstate);
@@ -2515,6 +2517,26 @@ CopyFrom(CopyState cstate)
 			ExecSetupChildParentMapForLeaf(proute);
 	}
 
+	/*
+	 * If the FDW of a foreign table can insert tuples in batches, find out
+	 * the batch size to use.  Like for INSERT, that's not done when capturing
+	 * transition tuples.  ExecInitPartitionInfo does the same for foreign
+	 * partitions, and needs the ModifyTableState to know about the transition
+	 * capture state for that.
+	 */
+	mtstate->mt_transition_capture = cstate->transition_capture;
+	if (cstate->transition_capture == NULL &&
+		resultRelInfo->ri_FdwRoutine != NULL &&
+		resultRelInfo->ri_FdwRoutine->GetForeignModifyBatchSize != NULL &&
+		resultRelInfo->ri_FdwRoutine->ExecForeignBatchInsert != NULL)
+	{
+		resultRelInfo->ri_BatchSize =
+			resultRelInfo->ri_FdwRoutine->GetForeignModifyBatchSize(resultRelInfo);
+		Assert(resultRelInfo->ri_BatchSize >= 1);
+	}
+	else
+		resultRelInfo->ri_BatchSize = 1;
+
 	/*
 	 * It's more efficient to prepare a bunch of tuples for insertion, and
 	 * insert them in one heap_multi_insert() call, than call heap_insert()
@@ -2771,6 +2793,38 @@ CopyFrom(CopyState cstate)
 						bufferedTuplesSize = 0;
 					}
 				}
+				else if (resultRelInfo->ri_FdwRoutine != NULL &&
+						 resultRelInfo->ri_BatchSize > 1)
+				{
+					int			n = resultRelInfo->ri_NumSlots;
+					MemoryContext batchcontext;
+
+					/*
+					 * Add this tuple to the foreign table's batch, making
+					 * the slots to hold the batch on first use.
+					 */
+					batchcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+					if (resultRelInfo->ri_Slots == NULL)
+						resultRelInfo->ri_Slots = (TupleTableSlot **)
+							palloc0(sizeof(TupleTableSlot *) *
+									resultRelInfo->ri_BatchSize);
+					if (resultRelInfo->ri_Slots[n] == NULL)
+						resultRelInfo->ri_Slots[n] =
+							ExecInitExtraTupleSlot(estate,
+												   slot->tts_tupleDescriptor);
+					ExecCopySlot(resultRelInfo->ri_Slots[n], slot);
+					resultRelInfo->ri_NumSlots++;
+					MemoryContextSwitchTo(batchcontext);
+
+					/*
+					 * If the batch filled up, insert it.  The tuples are
+					 * counted once the FDW has inserted them.
+					 */
+					if (resultRelInfo->ri_NumSlots == resultRelInfo->ri_BatchSize)
+						processed += CopyFromForeignBatch(cstate, estate,
+														  resultRelInfo);
+					goto next_tuple;
+				}
 				else
 				{
 					List	   *recheckIndexes = NIL;
@@ -2841,6 +2895,24 @@ next_tuple:
 							nBufferedTuples, bufferedTuples,
 							firstBufferedLineNo);
 
+	/* Likewise for the batches of foreign tables */
+	if (resultRelInfo->ri_NumSlots > 0)
+		processed += CopyFromForeignBatch(cstate, estate, resultRelInfo);
+	if (cstate->partition_tuple_routing)
+	{
+		PartitionTupleRouting *proute = cstate->partition_tuple_routing;
+		int			i;
+
+		for (i = 0; i < proute->num_partitions; i++)
+		{
+			ResultRelInfo *partRelInfo = proute->partitions[i];
+
+			if (partRelInfo != NULL && partRelInfo->ri_NumSlots > 0)
+				processed += CopyFromForeignBatch(cstate, estate,
+												  partRelInfo);
+		}
+	}
+
 	/* Done, clean up */
 	error_context_stack = errcallback.previous;
 
@@ -2893,6 +2965,50 @@ next_tuple:
 	return processed;
 }
 
+/*
+ * A subroutine of CopyFrom, to insert the batch of tuples accumulated for a
+ * foreign table using the FDW's batch insert routine.  Also runs AFTER ROW
+ * INSERT triggers.  Returns the number of tuples the FDW inserted.
+ */
+static uint64
+CopyFromForeignBatch(CopyState cstate, EState *estate,
+					 ResultRelInfo *resultRelInfo)
+{
+	TupleTableSlot **rslots;
+	int			numInserted = resultRelInfo->ri_NumSlots;
+	int			i;
+
+	/*
+	 * Print error context information correctly, if one of the operations
+	 * below fail.
+	 */
+	cstate->line_buf_valid = false;
+
+	rslots = resultRelInfo->ri_FdwRoutine->ExecForeignBatchInsert(estate,
+																  resultRelInfo,
+																  resultRelInfo->ri_Slots,
+																  NULL,
+																  &numInserted);
+
+	for (i = 0; i < numInserted; i++)
+	{
+		HeapTuple	tuple;
+
+		/* FDW might have changed tuple */
+		tuple = ExecMaterializeSlot(rslots[i]);
+		tuple->t_tableOid = RelationGetRelid(resultRelInfo->ri_RelationDesc);
+
+		/* AFTER ROW INSERT Triggers */
+		ExecARInsertTriggers(estate, resultRelInfo, tuple, NIL, NULL);
+	}
+
+	for (i = 0; i < resultRelInfo->ri_NumSlots; i++)
+		ExecClearTuple(resultRelInfo->ri_Slots[i]);
+	resultRelInfo->ri_NumSlots = 0;
+
+	return numInserted;
+}
+
 /*
  * A subroutine of CopyFrom, to write the current batch of buffered heap
  * tuples to the heap. Also updates indexes and runs AFTER ROW INSERT
@@ -59,6 +59,8 @@
 #include "utils/builtins.h"
 #include "utils/fmgroids.h"
 #include "utils/pg_locale.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 #include "utils/tqual.h"
@@ -929,6 +931,13 @@ dropdb(const char *dbname, bool missing_ok)
 	 */
 	DropDatabaseBuffers(db_id);
 
+	/*
+	 * Likewise for its catalog tuples and plans in the shared catalog and
+	 * plan caches, since the database's OID could be assigned again later.
+	 */
+	SharedCatCacheForgetDatabase(db_id);
+	SharedPlanCacheForgetDatabase(db_id);
+
 	/*
 	 * Tell the stats collector to forget it immediately, too.
 	 */
@@ -2147,6 +2156,10 @@ dbase_redo(XLogReaderState *record)
 		/* Drop pages for this database that are in the shared buffer cache */
 		DropDatabaseBuffers(xlrec->db_id);
 
+		/* Likewise for the shared catalog and plan caches */
+		SharedCatCacheForgetDatabase(xlrec->db_id);
+		SharedPlanCacheForgetDatabase(xlrec->db_id);
+
 		/* Also, clean out any fsync requests that might be pending in md.c */
 		ForgetDatabaseFsyncRequests(xlrec->db_id);
 
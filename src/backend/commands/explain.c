@@ -19,6 +19,7 @@
 #include "commands/createas.h"
 #include "commands/defrem.h"
 #include "commands/prepare.h"
+#include "executor/nodeAgg.h"
 #include "executor/nodeHash.h"
 #include "foreign/fdwapi.h"
 #include "jit/jit.h"
@@ -81,6 +82,8 @@ static void show_upper_qual(List *qual, const char *qlabel,
 				ExplainState *es);
 static void show_sort_keys(SortState *sortstate, List *ancestors,
 			   ExplainState *es);
+static void show_incremental_sort_keys(IncrementalSortState *incrsortstate,
+						   List *ancestors, ExplainState *es);
 static void show_merge_append_keys(MergeAppendState *mstate, List *ancestors,
 					   ExplainState *es);
 static void show_agg_keys(AggState *astate, List *ancestors,
@@ -102,7 +105,15 @@ static void show_sortorder_options(StringInfo buf, Node *sortexpr,
 static void show_tablesample(TableSampleClause *tsc, PlanState *planstate,
 				 List *ancestors, ExplainState *es);
 static void show_sort_info(SortState *sortstate, ExplainState *es);
+static void show_incremental_sort_info(IncrementalSortState *incrsortstate,
+						   ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
+static void show_runtime_filter(SeqScanState *scanstate, List *ancestors,
+					ExplainState *es);
+static void show_resultcache_info(ResultCacheState *rcstate, List *ancestors,
+					  ExplainState *es);
+static void show_hashagg_info(AggState *aggstate, ExplainState *es);
+static void show_agg_batch_info(AggState *aggstate, ExplainState *es);
 static void show_tidbitmap_info(BitmapHeapScanState *planstate,
 					ExplainState *es);
 static void show_instrumentation_count(const char *qlabel, int which,
@@ -1064,9 +1075,15 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Material:
 			pname = sname = "Materialize";
 			break;
+		case T_ResultCache:
+			pname = sname = "Result Cache";
+			break;
 		case T_Sort:
 			pname = sname = "Sort";
 			break;
+		case T_IncrementalSort:
+			pname = sname = "Incremental Sort";
+			break;
 		case T_Group:
 			pname = sname = "Group";
 			break;
@@ -1171,6 +1188,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		}
 		if (plan->parallel_aware)
 			appendStringInfoString(es->str, "Parallel ");
+		if (plan->async_capable)
+			appendStringInfoString(es->str, "Async ");
 		appendStringInfoString(es->str, pname);
 		es->indent++;
 	}
@@ -1190,6 +1209,7 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		if (custom_name)
 			ExplainPropertyText("Custom Plan Provider", custom_name, es);
 		ExplainPropertyBool("Parallel Aware", plan->parallel_aware, es);
+		ExplainPropertyBool("Async Capable", plan->async_capable, es);
 	}
 
 	switch (nodeTag(plan))
@@ -1497,6 +1517,9 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			if (IsA(plan, SeqScan) && ((SeqScan *) plan)->filterParam >= 0)
+				show_runtime_filter(castNode(SeqScanState, planstate),
+									ancestors, es);
 			break;
 		case T_Gather:
 			{
@@ -1665,6 +1688,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			show_hashagg_info(castNode(AggState, planstate), es);
+			show_agg_batch_info(castNode(AggState, planstate), es);
 			break;
 		case T_Group:
 			show_group_keys(castNode(GroupState, planstate), ancestors, es);
@@ -1677,6 +1702,16 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			show_sort_keys(castNode(SortState, planstate), ancestors, es);
 			show_sort_info(castNode(SortState, planstate), es);
 			break;
+		case T_ResultCache:
+			show_resultcache_info(castNode(ResultCacheState, planstate),
+								  ancestors, es);
+			break;
+		case T_IncrementalSort:
+			show_incremental_sort_keys(castNode(IncrementalSortState, planstate),
+									   ancestors, es);
+			show_incremental_sort_info(castNode(IncrementalSortState, planstate),
+									   es);
+			break;
 		case T_MergeAppend:
 			show_merge_append_keys(castNode(MergeAppendState, planstate),
 								   ancestors, es);
@@ -2017,6 +2052,27 @@ show_sort_keys(SortState *sortstate, List *ancestors, ExplainState *es)
 						 ancestors, es);
 }
 
+/*
+ * Show the sort keys for an Incremental Sort node, and the leading ones the
+ * input is already sorted by.
+ */
+static void
+show_incremental_sort_keys(IncrementalSortState *incrsortstate,
+						   List *ancestors, ExplainState *es)
+{
+	IncrementalSort *plan = (IncrementalSort *) incrsortstate->ss.ps.plan;
+
+	show_sort_group_keys((PlanState *) incrsortstate, "Sort Key",
+						 plan->sort.numCols, plan->sort.sortColIdx,
+						 plan->sort.sortOperators, plan->sort.collations,
+						 plan->sort.nullsFirst,
+						 ancestors, es);
+	show_sort_group_keys((PlanState *) incrsortstate, "Presorted Key",
+						 plan->presortedCols, plan->sort.sortColIdx,
+						 NULL, NULL, NULL,
+						 ancestors, es);
+}
+
 /*
  * Likewise, for a MergeAppend node.
  */
@@ -2446,6 +2502,189 @@ show_sort_info(SortState *sortstate, ExplainState *es)
 	}
 }
 
+/*
+ * If it's EXPLAIN ANALYZE, show the number of batches an incremental sort
+ * node sorted, and the tuplesort stats of the batch that used the most space.
+ */
+static void
+show_incremental_sort_info(IncrementalSortState *incrsortstate,
+						   ExplainState *es)
+{
+	TuplesortInstrumentation *stats = &incrsortstate->sinstrument;
+	const char *sortMethod;
+	const char *spaceType;
+
+	if (!es->analyze || stats->sortMethod == SORT_TYPE_STILL_IN_PROGRESS)
+		return;
+
+	sortMethod = tuplesort_method_name(stats->sortMethod);
+	spaceType = tuplesort_space_type_name(stats->spaceType);
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str,
+						 "Sort Batches: " INT64_FORMAT "  Sort Method: %s  Peak %s: %ldkB\n",
+						 incrsortstate->nbatches, sortMethod, spaceType,
+						 stats->spaceUsed);
+	}
+	else
+	{
+		ExplainPropertyInteger("Sort Batches", NULL,
+							   incrsortstate->nbatches, es);
+		ExplainPropertyText("Sort Method", sortMethod, es);
+		ExplainPropertyInteger("Peak Sort Space Used", "kB",
+							   stats->spaceUsed, es);
+		ExplainPropertyText("Sort Space Type", spaceType, es);
+	}
+}
+
+/*
+ * Show the join keys a SeqScan tests against a runtime filter, and with
+ * ANALYZE, how many tuples the filter removed.
+ */
+static void
+show_runtime_filter(SeqScanState *scanstate, List *ancestors,
+					ExplainState *es)
+{
+	SeqScan    *plan = (SeqScan *) scanstate->ss.ps.plan;
+	List	   *context;
+	List	   *result = NIL;
+	ListCell   *lc;
+
+	/* Set up deparsing context */
+	context = set_deparse_context_planstate(es->deparse_cxt,
+											(Node *) scanstate,
+											ancestors);
+
+	foreach(lc, plan->filterKeys)
+		result = lappend(result,
+						 deparse_expression((Node *) lfirst(lc), context,
+											es->verbose, false));
+
+	ExplainPropertyList("Runtime Filter", result, es);
+	show_instrumentation_count("Rows Removed by Runtime Filter", 2,
+							   (PlanState *) scanstate, es);
+}
+
+/*
+ * Show the cache keys of a Result Cache node, and with ANALYZE, how well the
+ * cache worked.
+ */
+static void
+show_resultcache_info(ResultCacheState *rcstate, List *ancestors,
+					  ExplainState *es)
+{
+	ResultCache *plan = (ResultCache *) rcstate->ss.ps.plan;
+	ResultCacheInstrumentation *stats = &rcstate->stats;
+	List	   *context;
+	List	   *result = NIL;
+	bool		useprefix;
+	ListCell   *lc;
+	long		memPeakKb;
+
+	/* Set up deparsing context */
+	context = set_deparse_context_planstate(es->deparse_cxt,
+											(Node *) rcstate,
+											ancestors);
+	useprefix = (list_length(es->rtable) > 1 || es->verbose);
+
+	foreach(lc, plan->param_exprs)
+		result = lappend(result,
+						 deparse_expression((Node *) lfirst(lc), context,
+											useprefix, false));
+
+	ExplainPropertyList("Cache Key", result, es);
+
+	/* Nothing more to show if the node was never executed */
+	if (!es->analyze || stats->cache_hits + stats->cache_misses == 0)
+		return;
+
+	/* The peak is only updated when entries are evicted */
+	memPeakKb = (Max(stats->mem_peak, rcstate->mem_used) + 1023) / 1024;
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str,
+						 "Hits: " UINT64_FORMAT "  Misses: " UINT64_FORMAT
+						 "  Evictions: " UINT64_FORMAT "  Overflows: " UINT64_FORMAT
+						 "  Memory Usage: %ldkB\n",
+						 stats->cache_hits, stats->cache_misses,
+						 stats->cache_evictions, stats->cache_overflows,
+						 memPeakKb);
+	}
+	else
+	{
+		ExplainPropertyInteger("Cache Hits", NULL, stats->cache_hits, es);
+		ExplainPropertyInteger("Cache Misses", NULL, stats->cache_misses, es);
+		ExplainPropertyInteger("Cache Evictions", NULL,
+							   stats->cache_evictions, es);
+		ExplainPropertyInteger("Cache Overflows", NULL,
+							   stats->cache_overflows, es);
+		ExplainPropertyInteger("Peak Memory Usage", "kB", memPeakKb, es);
+	}
+}
+
+/*
+ * Show information on hash aggregate memory usage and spilling.
+ *
+ * In text format, this is only shown if the hash tables had to be spilled to
+ * disk.  The number of batches includes the initial pass over the input.
+ */
+static void
+show_hashagg_info(AggState *aggstate, ExplainState *es)
+{
+	Agg		   *agg = (Agg *) aggstate->ss.ps.plan;
+	long		memPeakKb = (aggstate->hash_mem_peak + 1023) / 1024;
+	long		diskKb = (aggstate->hash_disk_used + 1023) / 1024;
+
+	if (!es->analyze ||
+		(agg->aggstrategy != AGG_HASHED && agg->aggstrategy != AGG_MIXED))
+		return;
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyInteger("HashAgg Batches", NULL,
+							   aggstate->hash_batches_used + 1, es);
+		ExplainPropertyInteger("Peak Memory Usage", "kB", memPeakKb, es);
+		ExplainPropertyInteger("Disk Usage", "kB", diskKb, es);
+	}
+	else if (aggstate->hash_disk_used > 0)
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str,
+						 "Batches: %d  Memory Usage: %ldkB  Disk Usage: %ldkB\n",
+						 aggstate->hash_batches_used + 1, memPeakKb, diskKb);
+	}
+}
+
+/*
+ * If the Agg node read its input in batch mode, show the batch size and how
+ * many batches were read.
+ */
+static void
+show_agg_batch_info(AggState *aggstate, ExplainState *es)
+{
+	BatchScanState *bscan;
+
+	if (!es->analyze || aggstate->batch == NULL)
+		return;
+	bscan = aggstate->batch->scan;
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyInteger("Batch Size", NULL, bscan->batch_size, es);
+		ExplainPropertyInteger("Batches", NULL, bscan->nbatches, es);
+	}
+	else
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str, "Batch Size: %d  Batches: %ld\n",
+						 bscan->batch_size, bscan->nbatches);
+	}
+}
+
 /*
  * Show information on hash buckets/batches.
  */
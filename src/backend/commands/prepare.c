@@ -30,9 +30,13 @@
 #include "parser/parse_expr.h"
 #include "parser/parse_type.h"
 #include "rewrite/rewriteHandler.h"
+#include "storage/shmem.h"
 #include "tcop/pquery.h"
+#include "tcop/tcopprot.h"
 #include "tcop/utility.h"
 #include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/resowner.h"
 #include "utils/snapmgr.h"
 #include "utils/timestamp.h"
 
@@ -45,10 +49,25 @@
  */
 static HTAB *prepared_queries = NULL;
 
+/*
+ * Fixed-size part of a serialized prepared statement (see
+ * SerializePreparedStatements).  It is followed by the parameter type OIDs,
+ * and the null-terminated statement name and source text.
+ */
+typedef struct SerializedPreparedStatement
+{
+	int			num_params;		/* number of parameter types */
+	int			stmt_location;	/* location of the statement in its text */
+	bool		from_sql;		/* prepared via SQL, not FE/BE protocol? */
+} SerializedPreparedStatement;
+
 static void InitQueryHashTable(void);
 static ParamListInfo EvaluateParams(PreparedStatement *pstmt, List *params,
 			   const char *queryString, EState *estate);
 static Datum build_regtype_array(Oid *param_types, int num_params);
+static void RecreatePreparedStatement(const char *stmt_name,
+						  const char *query_string, int stmt_location,
+						  Oid *param_types, int num_params, bool from_sql);
 
 /*
  * Implements the 'PREPARE' utility statement.
@@ -620,6 +639,284 @@ DropAllPreparedStatements(void)
 	}
 }
 
+/*
+ * Detach and return the table of prepared statements (NULL if there is
+ * none), leaving this backend with no prepared statements.
+ *
+ * This lets a backend that serves several client sessions keep each
+ * session's statements apart; the table is reinstalled with
+ * RestorePreparedStatements when the session becomes active again.
+ */
+HTAB *
+SavePreparedStatements(void)
+{
+	HTAB	   *queries = prepared_queries;
+
+	prepared_queries = NULL;
+	return queries;
+}
+
+/*
+ * Reinstall a table of prepared statements saved by SavePreparedStatements.
+ * Any current prepared statements must have been saved or dropped first.
+ */
+void
+RestorePreparedStatements(HTAB *queries)
+{
+	Assert(prepared_queries == NULL);
+	prepared_queries = queries;
+}
+
+/*
+ * Drop all the statements in a table saved by SavePreparedStatements, and
+ * the table itself.
+ */
+void
+DiscardPreparedStatements(HTAB *queries)
+{
+	HASH_SEQ_STATUS seq;
+	PreparedStatement *entry;
+
+	if (queries == NULL)
+		return;
+
+	hash_seq_init(&seq, queries);
+	while ((entry = hash_seq_search(&seq)) != NULL)
+		DropCachedPlan(entry->plansource);
+
+	hash_destroy(queries);
+}
+
+/*
+ * Estimate the space needed to serialize a table of prepared statements
+ * saved by SavePreparedStatements.
+ */
+Size
+EstimatePreparedStatementsSpace(HTAB *queries)
+{
+	HASH_SEQ_STATUS seq;
+	PreparedStatement *entry;
+	Size		size = 0;
+
+	if (queries == NULL)
+		return 0;
+
+	hash_seq_init(&seq, queries);
+	while ((entry = hash_seq_search(&seq)) != NULL)
+	{
+		CachedPlanSource *plansource = entry->plansource;
+
+		size = add_size(size, sizeof(SerializedPreparedStatement));
+		size = add_size(size, mul_size(plansource->num_params, sizeof(Oid)));
+		size = add_size(size, strlen(entry->stmt_name) + 1);
+		size = add_size(size, strlen(plansource->query_string) + 1);
+	}
+
+	return size;
+}
+
+/*
+ * Serialize a table of prepared statements, so that another backend can
+ * recreate them with RecreatePreparedStatements.
+ *
+ * Plans cannot be moved between backends, so we only keep what is needed to
+ * prepare each statement again: its name, source text and parameter types.
+ * The types are the ones parse analysis ended up with, so that statements
+ * whose parameter types were left for the server to deduce come out the
+ * same.
+ */
+void
+SerializePreparedStatements(HTAB *queries, Size maxsize, char *start_address)
+{
+	HASH_SEQ_STATUS seq;
+	PreparedStatement *entry;
+	char	   *ptr = start_address;
+
+	if (queries == NULL)
+		return;
+
+	hash_seq_init(&seq, queries);
+	while ((entry = hash_seq_search(&seq)) != NULL)
+	{
+		CachedPlanSource *plansource = entry->plansource;
+		SerializedPreparedStatement hdr;
+		Size		len;
+
+		hdr.num_params = plansource->num_params;
+		hdr.stmt_location = plansource->raw_parse_tree ?
+			plansource->raw_parse_tree->stmt_location : -1;
+		hdr.from_sql = entry->from_sql;
+
+		len = sizeof(hdr) + hdr.num_params * sizeof(Oid) +
+			strlen(entry->stmt_name) + 1 +
+			strlen(plansource->query_string) + 1;
+		if (ptr + len > start_address + maxsize)
+			elog(ERROR, "not enough space to serialize prepared statements");
+
+		memcpy(ptr, &hdr, sizeof(hdr));
+		ptr += sizeof(hdr);
+		if (hdr.num_params > 0)
+		{
+			memcpy(ptr, plansource->param_types, hdr.num_params * sizeof(Oid));
+			ptr += hdr.num_params * sizeof(Oid);
+		}
+		strcpy(ptr, entry->stmt_name);
+		ptr += strlen(entry->stmt_name) + 1;
+		strcpy(ptr, plansource->query_string);
+		ptr += strlen(plansource->query_string) + 1;
+	}
+}
+
+/*
+ * Prepare again the statements serialized by SerializePreparedStatements.
+ *
+ * The statements are added to the current ones; this must be called inside
+ * a transaction.  A statement that fails to prepare, say because a table it
+ * refers to has been dropped in the meantime, is skipped with a warning.
+ */
+void
+RecreatePreparedStatements(const char *start_address, Size size)
+{
+	const char *ptr = start_address;
+	const char *end = start_address + size;
+
+	while (ptr < end)
+	{
+		SerializedPreparedStatement hdr;
+		Oid		   *param_types = NULL;
+		const char *stmt_name;
+		const char *query_string;
+		MemoryContext oldcontext = CurrentMemoryContext;
+		ResourceOwner oldowner = CurrentResourceOwner;
+
+		memcpy(&hdr, ptr, sizeof(hdr));
+		ptr += sizeof(hdr);
+		if (hdr.num_params > 0)
+		{
+			param_types = (Oid *) palloc(hdr.num_params * sizeof(Oid));
+			memcpy(param_types, ptr, hdr.num_params * sizeof(Oid));
+			ptr += hdr.num_params * sizeof(Oid);
+		}
+		stmt_name = ptr;
+		ptr += strlen(ptr) + 1;
+		query_string = ptr;
+		ptr += strlen(ptr) + 1;
+
+		BeginInternalSubTransaction(NULL);
+		MemoryContextSwitchTo(oldcontext);
+
+		PG_TRY();
+		{
+			RecreatePreparedStatement(stmt_name, query_string,
+									  hdr.stmt_location,
+									  param_types, hdr.num_params,
+									  hdr.from_sql);
+
+			ReleaseCurrentSubTransaction();
+			MemoryContextSwitchTo(oldcontext);
+			CurrentResourceOwner = oldowner;
+		}
+		PG_CATCH();
+		{
+			ErrorData  *edata;
+
+			MemoryContextSwitchTo(oldcontext);
+			edata = CopyErrorData();
+			FlushErrorState();
+
+			RollbackAndReleaseCurrentSubTransaction();
+			MemoryContextSwitchTo(oldcontext);
+			CurrentResourceOwner = oldowner;
+
+			ereport(WARNING,
+					(errcode(edata->sqlerrcode),
+					 errmsg("could not recreate prepared statement \"%s\": %s",
+							stmt_name, edata->message)));
+			FreeErrorData(edata);
+		}
+		PG_END_TRY();
+
+		if (param_types)
+			pfree(param_types);
+	}
+}
+
+/*
+ * Prepare one statement for RecreatePreparedStatements, the same way it was
+ * originally prepared by PrepareQuery or exec_parse_message.
+ */
+static void
+RecreatePreparedStatement(const char *stmt_name, const char *query_string,
+						  int stmt_location, Oid *param_types, int num_params,
+						  bool from_sql)
+{
+	RawStmt    *rawstmt = NULL;
+	CachedPlanSource *plansource;
+	List	   *query_list = NIL;
+	const char *commandTag = NULL;
+	bool		snapshot_set = false;
+
+	/*
+	 * The source text may hold several statements, as when PREPARE was sent
+	 * in a multi-statement simple query; find ours by its location.
+	 */
+	if (stmt_location >= 0)
+	{
+		ListCell   *lc;
+
+		foreach(lc, pg_parse_query(query_string))
+		{
+			RawStmt    *parsetree = lfirst_node(RawStmt, lc);
+
+			if (parsetree->stmt_location == stmt_location)
+			{
+				rawstmt = parsetree;
+				break;
+			}
+		}
+		if (rawstmt == NULL)
+			elog(ERROR, "statement not found in its source text");
+
+		/* PrepareQuery keeps only the statement being prepared */
+		if (from_sql)
+		{
+			PrepareStmt *stmt = castNode(PrepareStmt, rawstmt->stmt);
+
+			rawstmt->stmt = stmt->query;
+		}
+		commandTag = CreateCommandTag(rawstmt->stmt);
+	}
+
+	plansource = CreateCachedPlan(rawstmt, query_string, commandTag);
+
+	if (rawstmt != NULL)
+	{
+		if (analyze_requires_snapshot(rawstmt))
+		{
+			PushActiveSnapshot(GetTransactionSnapshot());
+			snapshot_set = true;
+		}
+
+		query_list = pg_analyze_and_rewrite(rawstmt, query_string,
+											param_types, num_params, NULL);
+
+		if (snapshot_set)
+			PopActiveSnapshot();
+	}
+
+	CompleteCachedPlan(plansource,
+					   query_list,
+					   NULL,
+					   param_types,
+					   num_params,
+					   NULL,
+					   NULL,
+					   CURSOR_OPT_PARALLEL_OK,	/* allow parallel mode */
+					   true);	/* fixed result */
+
+	StorePreparedStatement(stmt_name, plansource, from_sql);
+}
+
 /*
  * Implements the 'EXPLAIN EXECUTE' utility statement.
  *
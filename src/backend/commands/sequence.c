@@ -1933,6 +1933,86 @@ ResetSequenceCaches(void)
 	last_used_seq = NULL;
 }
 
+/*
+ * Save the currval() and lastval() state of the client session being served,
+ * and forget it, so that the next session a pool worker serves doesn't see
+ * it.  Values cached for nextval() stay with the backend.
+ *
+ * The result is palloc'd in the current memory context.
+ */
+SequenceSessionState *
+SaveSequenceSessionState(void)
+{
+	SequenceSessionState *state;
+	HASH_SEQ_STATUS status;
+	SeqTable	elm;
+	int			nvalues = 0;
+
+	if (seqhashtab != NULL)
+		nvalues = hash_get_num_entries(seqhashtab);
+	state = palloc(SequenceSessionStateSize(nvalues));
+	state->lastval_relid = InvalidOid;
+	state->nvalues = 0;
+
+	if (seqhashtab == NULL)
+		return state;
+
+	if (last_used_seq != NULL && last_used_seq->last_valid)
+		state->lastval_relid = last_used_seq->relid;
+	last_used_seq = NULL;
+
+	hash_seq_init(&status, seqhashtab);
+	while ((elm = (SeqTable) hash_seq_search(&status)) != NULL)
+	{
+		if (!elm->last_valid)
+			continue;
+		state->values[state->nvalues].relid = elm->relid;
+		state->values[state->nvalues].last = elm->last;
+		state->nvalues++;
+		elm->last_valid = false;
+	}
+
+	return state;
+}
+
+/*
+ * Make the currval() and lastval() state saved by SaveSequenceSessionState
+ * the current one, in the same or another backend.
+ *
+ * currval() reports the value nextval() last returned, which is also where
+ * the backend's cache for the sequence stands, so any values the backend
+ * has cached for these sequences are discarded.
+ */
+void
+RestoreSequenceSessionState(const SequenceSessionState *state)
+{
+	int			i;
+
+	for (i = 0; i < state->nvalues; i++)
+	{
+		SeqTable	elm;
+		bool		found;
+
+		if (seqhashtab == NULL)
+			create_seq_hashtable();
+
+		elm = (SeqTable) hash_search(seqhashtab, &state->values[i].relid,
+									 HASH_ENTER, &found);
+		if (!found)
+		{
+			/* as in init_sequence */
+			elm->filenode = InvalidOid;
+			elm->lxid = InvalidLocalTransactionId;
+			elm->increment = 0;
+		}
+		elm->last = elm->cached = state->values[i].last;
+		elm->last_valid = true;
+
+		if (elm->relid == state->lastval_relid)
+			last_used_seq = elm;
+	}
+}
+
 /*
  * Mask a Sequence page before performing consistency checks on it.
  */
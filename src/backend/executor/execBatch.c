@@ -0,0 +1,947 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.c
+ *	  Batch-mode evaluation of scans and expressions.
+ *
+ * Instead of producing one tuple per call, a batch scan reads up to
+ * executor_batch_size rows from a sequential scan, extracts the columns that
+ * are needed into arrays, and evaluates the scan's quals over all of them at
+ * once.  Expressions over those columns are compiled into BatchExprs, which
+ * are likewise evaluated for a whole batch per call, over a "selection" of
+ * the rows that are still of interest.  This amortizes the per-tuple
+ * overhead of the executor, and lets the common comparison and arithmetic
+ * operators run as tight loops.
+ *
+ * Only a subset of expressions and of pass-by-value types is supported;
+ * callers use ExecBuildBatchExpr to find out whether their expressions
+ * qualify, and fall back to row-at-a-time execution if not.  A caller
+ * currently has to own the scan node, that is, it reads the scan's tuples
+ * instead of calling ExecProcNode on it.
+ *
+ * Evaluation is done in CurrentMemoryContext, which the caller should reset
+ * between batches.
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execBatch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/relscan.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_proc.h"
+#include "common/int.h"
+#include "executor/execBatch.h"
+#include "executor/executor.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "parser/parsetree.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+
+
+int			executor_batch_size = 1024;
+
+/*
+ * Built-in functions that are evaluated inline rather than through fmgr.
+ * They are identified by their C function, so that aliases such as the
+ * timestamptz operators, which share the timestamp implementations, are
+ * recognized as well.
+ */
+typedef struct BatchBuiltin
+{
+	PGFunction	fn;
+	BatchExprKind kind;
+	BatchType	type;
+	BatchOp		op;
+} BatchBuiltin;
+
+static const BatchBuiltin batch_builtins[] = {
+	{int4lt, BATCH_EXPR_CMP, BATCH_TYPE_INT4, BATCH_OP_LT},
+	{int4le, BATCH_EXPR_CMP, BATCH_TYPE_INT4, BATCH_OP_LE},
+	{int4eq, BATCH_EXPR_CMP, BATCH_TYPE_INT4, BATCH_OP_EQ},
+	{int4ne, BATCH_EXPR_CMP, BATCH_TYPE_INT4, BATCH_OP_NE},
+	{int4ge, BATCH_EXPR_CMP, BATCH_TYPE_INT4, BATCH_OP_GE},
+	{int4gt, BATCH_EXPR_CMP, BATCH_TYPE_INT4, BATCH_OP_GT},
+	{date_lt, BATCH_EXPR_CMP, BATCH_TYPE_INT4, BATCH_OP_LT},
+	{date_le, BATCH_EXPR_CMP, BATCH_TYPE_INT4, BATCH_OP_LE},
+	{date_eq, BATCH_EXPR_CMP, BATCH_TYPE_INT4, BATCH_OP_EQ},
+	{date_ne, BATCH_EXPR_CMP, BATCH_TYPE_INT4, BATCH_OP_NE},
+	{date_ge, BATCH_EXPR_CMP, BATCH_TYPE_INT4, BATCH_OP_GE},
+	{date_gt, BATCH_EXPR_CMP, BATCH_TYPE_INT4, BATCH_OP_GT},
+	{int8lt, BATCH_EXPR_CMP, BATCH_TYPE_INT8, BATCH_OP_LT},
+	{int8le, BATCH_EXPR_CMP, BATCH_TYPE_INT8, BATCH_OP_LE},
+	{int8eq, BATCH_EXPR_CMP, BATCH_TYPE_INT8, BATCH_OP_EQ},
+	{int8ne, BATCH_EXPR_CMP, BATCH_TYPE_INT8, BATCH_OP_NE},
+	{int8ge, BATCH_EXPR_CMP, BATCH_TYPE_INT8, BATCH_OP_GE},
+	{int8gt, BATCH_EXPR_CMP, BATCH_TYPE_INT8, BATCH_OP_GT},
+	{timestamp_lt, BATCH_EXPR_CMP, BATCH_TYPE_INT8, BATCH_OP_LT},
+	{timestamp_le, BATCH_EXPR_CMP, BATCH_TYPE_INT8, BATCH_OP_LE},
+	{timestamp_eq, BATCH_EXPR_CMP, BATCH_TYPE_INT8, BATCH_OP_EQ},
+	{timestamp_ne, BATCH_EXPR_CMP, BATCH_TYPE_INT8, BATCH_OP_NE},
+	{timestamp_ge, BATCH_EXPR_CMP, BATCH_TYPE_INT8, BATCH_OP_GE},
+	{timestamp_gt, BATCH_EXPR_CMP, BATCH_TYPE_INT8, BATCH_OP_GT},
+	{float8lt, BATCH_EXPR_CMP, BATCH_TYPE_FLOAT8, BATCH_OP_LT},
+	{float8le, BATCH_EXPR_CMP, BATCH_TYPE_FLOAT8, BATCH_OP_LE},
+	{float8eq, BATCH_EXPR_CMP, BATCH_TYPE_FLOAT8, BATCH_OP_EQ},
+	{float8ne, BATCH_EXPR_CMP, BATCH_TYPE_FLOAT8, BATCH_OP_NE},
+	{float8ge, BATCH_EXPR_CMP, BATCH_TYPE_FLOAT8, BATCH_OP_GE},
+	{float8gt, BATCH_EXPR_CMP, BATCH_TYPE_FLOAT8, BATCH_OP_GT},
+	{int4pl, BATCH_EXPR_ARITH, BATCH_TYPE_INT4, BATCH_OP_ADD},
+	{int4mi, BATCH_EXPR_ARITH, BATCH_TYPE_INT4, BATCH_OP_SUB},
+	{int4mul, BATCH_EXPR_ARITH, BATCH_TYPE_INT4, BATCH_OP_MUL},
+	{int8pl, BATCH_EXPR_ARITH, BATCH_TYPE_INT8, BATCH_OP_ADD},
+	{int8mi, BATCH_EXPR_ARITH, BATCH_TYPE_INT8, BATCH_OP_SUB},
+	{int8mul, BATCH_EXPR_ARITH, BATCH_TYPE_INT8, BATCH_OP_MUL},
+	{float8pl, BATCH_EXPR_ARITH, BATCH_TYPE_FLOAT8, BATCH_OP_ADD},
+	{float8mi, BATCH_EXPR_ARITH, BATCH_TYPE_FLOAT8, BATCH_OP_SUB},
+	{float8mul, BATCH_EXPR_ARITH, BATCH_TYPE_FLOAT8, BATCH_OP_MUL}
+};
+
+static BatchExpr *make_batch_expr(BatchScanState *bscan, BatchExprKind kind);
+static BatchExpr *build_batch_var(BatchScanState *bscan, Var *var);
+static BatchExpr *build_batch_func(BatchScanState *bscan, Expr *expr,
+				 Oid funcid, Oid rettype, Oid inputcollid, List *args);
+static void eval_batch_cmp(BatchExpr *bexpr, const int *sel, int nsel);
+static void eval_batch_arith(BatchExpr *bexpr, const int *sel, int nsel);
+static void eval_batch_func(BatchExpr *bexpr, const int *sel, int nsel);
+static void eval_batch_bool(BatchExpr *bexpr, const int *sel, int nsel);
+
+
+/*
+ * ExecInitBatchScan
+ *
+ * Set up batch-mode reading of the given scan node.  Returns NULL if it is
+ * not a sequential scan that can be read in batch mode, or if its quals
+ * cannot be evaluated in batch mode.
+ *
+ * The caller then compiles the expressions it wants to evaluate over the
+ * scan with ExecBuildBatchExpr, before the first batch is read.
+ */
+BatchScanState *
+ExecInitBatchScan(PlanState *planstate, int batch_size)
+{
+	SeqScanState *scanstate;
+	BatchScanState *bscan;
+	char		relkind;
+	ListCell   *lc;
+
+	if (!IsA(planstate, SeqScanState) || batch_size <= 0)
+		return NULL;
+	scanstate = (SeqScanState *) planstate;
+
+	/*
+	 * Batches are read from the heap directly, bypassing ExecScan.  A
+	 * parallel-aware scan shares its position with the other participants
+	 * and must be read the way the plan set it up; and an EvalPlanQual
+	 * recheck must return the test tuple rather than read the relation.
+	 */
+	if (planstate->plan->parallel_aware ||
+		planstate->state->es_epqTuple != NULL)
+		return NULL;
+
+	/* Only plain heaps are read with heap_getnext() by SeqNext, too */
+	relkind = scanstate->ss.ss_currentRelation->rd_rel->relkind;
+	if (relkind != RELKIND_RELATION &&
+		relkind != RELKIND_MATVIEW &&
+		relkind != RELKIND_TOASTVALUE)
+		return NULL;
+
+	bscan = (BatchScanState *) palloc0(sizeof(BatchScanState));
+	bscan->scanstate = scanstate;
+	bscan->batch_size = batch_size;
+	bscan->natts = RelationGetDescr(scanstate->ss.ss_currentRelation)->natts;
+	bscan->cols = (AttrNumber *) palloc(bscan->natts * sizeof(AttrNumber));
+	bscan->colvalues = (Datum **) palloc0(bscan->natts * sizeof(Datum *));
+	bscan->colnulls = (bool **) palloc0(bscan->natts * sizeof(bool *));
+	bscan->sel = (int *) palloc(batch_size * sizeof(int));
+
+	foreach(lc, planstate->plan->qual)
+	{
+		BatchExpr  *qual = ExecBuildBatchExpr(bscan, (Expr *) lfirst(lc));
+
+		if (qual == NULL)
+			return NULL;
+		bscan->quals = lappend(bscan->quals, qual);
+	}
+
+	return bscan;
+}
+
+/*
+ * ExecBuildBatchExpr
+ *
+ * Compile an expression for batch-mode evaluation over the rows of the scan.
+ * The expression may refer to the scan's columns directly, or to its output
+ * through OUTER_VAR Vars, as the expressions of a parent node do.
+ *
+ * Returns NULL if the expression cannot be evaluated in batch mode.
+ *
+ * The functions involved must have been through ExecInitExpr (or similar)
+ * already, which checked the permissions to call them.
+ */
+BatchExpr *
+ExecBuildBatchExpr(BatchScanState *bscan, Expr *expr)
+{
+	BatchExpr  *bexpr;
+
+	check_stack_depth();
+
+	switch (nodeTag(expr))
+	{
+		case T_Var:
+			return build_batch_var(bscan, (Var *) expr);
+
+		case T_Const:
+			{
+				Const	   *con = (Const *) expr;
+				int			i;
+
+				if (!con->constbyval)
+					return NULL;
+
+				bexpr = make_batch_expr(bscan, BATCH_EXPR_CONST);
+				for (i = 0; i < bscan->batch_size; i++)
+				{
+					bexpr->values[i] = con->constvalue;
+					bexpr->isnull[i] = con->constisnull;
+				}
+				return bexpr;
+			}
+
+		case T_RelabelType:
+			/* binary-compatible, so nothing to do at runtime */
+			return ExecBuildBatchExpr(bscan, ((RelabelType *) expr)->arg);
+
+		case T_FuncExpr:
+			{
+				FuncExpr   *func = (FuncExpr *) expr;
+
+				if (func->funcretset)
+					return NULL;
+				return build_batch_func(bscan, expr, func->funcid,
+										func->funcresulttype,
+										func->inputcollid, func->args);
+			}
+
+		case T_OpExpr:
+			{
+				OpExpr	   *op = (OpExpr *) expr;
+
+				if (op->opretset)
+					return NULL;
+				set_opfuncid(op);
+				return build_batch_func(bscan, expr, op->opfuncid,
+										op->opresulttype,
+										op->inputcollid, op->args);
+			}
+
+		case T_BoolExpr:
+			{
+				BoolExpr   *boolexpr = (BoolExpr *) expr;
+				ListCell   *lc;
+				int			i = 0;
+
+				switch (boolexpr->boolop)
+				{
+					case AND_EXPR:
+						bexpr = make_batch_expr(bscan, BATCH_EXPR_AND);
+						break;
+					case OR_EXPR:
+						bexpr = make_batch_expr(bscan, BATCH_EXPR_OR);
+						break;
+					case NOT_EXPR:
+						bexpr = make_batch_expr(bscan, BATCH_EXPR_NOT);
+						break;
+					default:
+						elog(ERROR, "unrecognized boolop: %d",
+							 (int) boolexpr->boolop);
+						return NULL;	/* keep compiler quiet */
+				}
+
+				bexpr->nargs = list_length(boolexpr->args);
+				bexpr->args = (BatchExpr **)
+					palloc(bexpr->nargs * sizeof(BatchExpr *));
+				foreach(lc, boolexpr->args)
+				{
+					bexpr->args[i] = ExecBuildBatchExpr(bscan,
+														(Expr *) lfirst(lc));
+					if (bexpr->args[i] == NULL)
+						return NULL;
+					i++;
+				}
+				if (bexpr->kind != BATCH_EXPR_NOT)
+					bexpr->sel = (int *) palloc(bscan->batch_size * sizeof(int));
+				return bexpr;
+			}
+
+		case T_NullTest:
+			{
+				NullTest   *ntest = (NullTest *) expr;
+				BatchExpr  *arg;
+
+				if (ntest->argisrow)
+					return NULL;
+				arg = ExecBuildBatchExpr(bscan, ntest->arg);
+				if (arg == NULL)
+					return NULL;
+
+				bexpr = make_batch_expr(bscan, BATCH_EXPR_NULLTEST);
+				bexpr->nulltesttype = ntest->nulltesttype;
+				bexpr->nargs = 1;
+				bexpr->args = (BatchExpr **) palloc(sizeof(BatchExpr *));
+				bexpr->args[0] = arg;
+				return bexpr;
+			}
+
+		default:
+			return NULL;
+	}
+}
+
+/*
+ * Allocate a BatchExpr, with result arrays for a whole batch.
+ */
+static BatchExpr *
+make_batch_expr(BatchScanState *bscan, BatchExprKind kind)
+{
+	BatchExpr  *bexpr = (BatchExpr *) palloc0(sizeof(BatchExpr));
+
+	bexpr->kind = kind;
+	bexpr->values = (Datum *) palloc(bscan->batch_size * sizeof(Datum));
+	bexpr->isnull = (bool *) palloc(bscan->batch_size * sizeof(bool));
+
+	return bexpr;
+}
+
+/*
+ * Compile a Var.  Its "results" are the column arrays the scan fills in.
+ */
+static BatchExpr *
+build_batch_var(BatchScanState *bscan, Var *var)
+{
+	BatchExpr  *bexpr;
+	AttrNumber	attno = var->varattno;
+
+	if (var->varno == OUTER_VAR)
+	{
+		TargetEntry *tle;
+
+		/* Look through to the scan's output expression */
+		tle = get_tle_by_resno(bscan->scanstate->ss.ps.plan->targetlist,
+							   attno);
+		if (tle == NULL)
+			return NULL;
+		return ExecBuildBatchExpr(bscan, tle->expr);
+	}
+
+	/* No system columns or whole-row references */
+	if (IS_SPECIAL_VARNO(var->varno) ||
+		attno <= 0 || attno > bscan->natts ||
+		!get_typbyval(var->vartype))
+		return NULL;
+
+	if (bscan->colvalues[attno - 1] == NULL)
+	{
+		bscan->colvalues[attno - 1] = (Datum *)
+			palloc(bscan->batch_size * sizeof(Datum));
+		bscan->colnulls[attno - 1] = (bool *)
+			palloc(bscan->batch_size * sizeof(bool));
+		bscan->cols[bscan->ncols++] = attno;
+		bscan->maxattno = Max(bscan->maxattno, attno);
+	}
+
+	bexpr = (BatchExpr *) palloc0(sizeof(BatchExpr));
+	bexpr->kind = BATCH_EXPR_VAR;
+	bexpr->values = bscan->colvalues[attno - 1];
+	bexpr->isnull = bscan->colnulls[attno - 1];
+
+	return bexpr;
+}
+
+/*
+ * Compile a function or operator call.
+ *
+ * Volatile functions are not supported, because evaluating one expression
+ * for a whole batch before moving on to the next changes the order of the
+ * calls, which such a function might notice.
+ */
+static BatchExpr *
+build_batch_func(BatchScanState *bscan, Expr *expr,
+				 Oid funcid, Oid rettype, Oid inputcollid, List *args)
+{
+	BatchExpr  *bexpr;
+	BatchExpr **bargs;
+	FmgrInfo   *flinfo;
+	ListCell   *lc;
+	int			nargs = list_length(args);
+	int			i;
+
+	if (!get_typbyval(rettype) ||
+		func_volatile(funcid) == PROVOLATILE_VOLATILE)
+		return NULL;
+
+	bargs = (BatchExpr **) palloc(nargs * sizeof(BatchExpr *));
+	i = 0;
+	foreach(lc, args)
+	{
+		bargs[i] = ExecBuildBatchExpr(bscan, (Expr *) lfirst(lc));
+		if (bargs[i] == NULL)
+			return NULL;
+		i++;
+	}
+
+	flinfo = (FmgrInfo *) palloc0(sizeof(FmgrInfo));
+	fmgr_info(funcid, flinfo);
+	fmgr_info_set_expr((Node *) expr, flinfo);
+
+	if (nargs == 2)
+	{
+		for (i = 0; i < lengthof(batch_builtins); i++)
+		{
+			if (batch_builtins[i].fn == flinfo->fn_addr)
+			{
+				bexpr = make_batch_expr(bscan, batch_builtins[i].kind);
+				bexpr->type = batch_builtins[i].type;
+				bexpr->op = batch_builtins[i].op;
+				bexpr->nargs = nargs;
+				bexpr->args = bargs;
+				return bexpr;
+			}
+		}
+	}
+
+	bexpr = make_batch_expr(bscan, BATCH_EXPR_FUNC);
+	bexpr->nargs = nargs;
+	bexpr->args = bargs;
+	bexpr->strict = flinfo->fn_strict;
+	bexpr->fcinfo = (FunctionCallInfo) palloc(sizeof(FunctionCallInfoData));
+	InitFunctionCallInfoData(*bexpr->fcinfo, flinfo, nargs, inputcollid,
+							 NULL, NULL);
+
+	return bexpr;
+}
+
+/*
+ * ExecBatchScanBegin
+ *
+ * Get ready to read the scan from the start.  This must be called before
+ * the first ExecBatchScanNext call, and again after the scan is rescanned.
+ */
+void
+ExecBatchScanBegin(BatchScanState *bscan)
+{
+	PlanState  *planstate = &bscan->scanstate->ss.ps;
+
+	/* Do what ExecProcNode would do for a change of parameters */
+	if (planstate->chgParam != NULL)
+		ExecReScan(planstate);
+
+	bscan->nrows = 0;
+	bscan->nsel = 0;
+	bscan->done = false;
+}
+
+/*
+ * ExecBatchScanNext
+ *
+ * Read the next batch of rows and apply the scan's quals to it.  The rows
+ * that pass them are left in bscan->sel.  Note that this can be none of them
+ * even if the scan isn't over yet.
+ *
+ * Returns false at the end of the scan.
+ */
+bool
+ExecBatchScanNext(BatchScanState *bscan)
+{
+	SeqScanState *node = bscan->scanstate;
+	EState	   *estate = node->ss.ps.state;
+	HeapScanDesc scandesc = node->ss.ss_currentScanDesc;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	Instrumentation *instr = node->ss.ps.instrument;
+	int			nrows = 0;
+	int			nsel;
+	ListCell   *lc;
+	int			i;
+
+	if (bscan->done)
+		return false;
+
+	CHECK_FOR_INTERRUPTS();
+
+	if (instr)
+		InstrStartNode(instr);
+
+	if (scandesc == NULL)
+	{
+		/* As in SeqNext */
+		scandesc = heap_beginscan(node->ss.ss_currentRelation,
+								  estate->es_snapshot,
+								  0, NULL);
+		node->ss.ss_currentScanDesc = scandesc;
+	}
+
+	while (nrows < bscan->batch_size)
+	{
+		HeapTuple	tuple = heap_getnext(scandesc, estate->es_direction);
+
+		if (tuple == NULL)
+		{
+			bscan->done = true;
+			break;
+		}
+
+		ExecStoreTuple(tuple, slot, scandesc->rs_cbuf, false);
+		slot_getsomeattrs(slot, bscan->maxattno);
+
+		for (i = 0; i < bscan->ncols; i++)
+		{
+			AttrNumber	attno = bscan->cols[i];
+
+			bscan->colvalues[attno - 1][nrows] = slot->tts_values[attno - 1];
+			bscan->colnulls[attno - 1][nrows] = slot->tts_isnull[attno - 1];
+		}
+		nrows++;
+	}
+
+	/* Only pass-by-value columns were extracted, so let go of the page */
+	ExecClearTuple(slot);
+
+	for (i = 0; i < nrows; i++)
+		bscan->sel[i] = i;
+	nsel = nrows;
+
+	foreach(lc, bscan->quals)
+	{
+		if (nsel == 0)
+			break;
+		nsel = ExecBatchQual((BatchExpr *) lfirst(lc),
+							 bscan->sel, nsel, bscan->sel);
+	}
+
+	bscan->nrows = nrows;
+	bscan->nsel = nsel;
+	if (nrows > 0)
+		bscan->nbatches++;
+
+	if (instr)
+	{
+		InstrCountFiltered1(node, nrows - nsel);
+		InstrStopNode(instr, nsel);
+	}
+
+	return nrows > 0;
+}
+
+/*
+ * ExecBatchQual
+ *
+ * Evaluate a boolean expression over the selected rows, and store the rows
+ * for which it is true in result[].  Returns the number of those rows.
+ *
+ * result may be the same array as sel.
+ */
+int
+ExecBatchQual(BatchExpr *bexpr, const int *sel, int nsel, int *result)
+{
+	int			nresult = 0;
+	int			i;
+
+	ExecEvalBatchExpr(bexpr, sel, nsel);
+
+	for (i = 0; i < nsel; i++)
+	{
+		int			row = sel[i];
+
+		if (!bexpr->isnull[row] && DatumGetBool(bexpr->values[row]))
+			result[nresult++] = row;
+	}
+
+	return nresult;
+}
+
+/*
+ * ExecEvalBatchExpr
+ *
+ * Evaluate an expression over the selected rows of the current batch.
+ */
+void
+ExecEvalBatchExpr(BatchExpr *bexpr, const int *sel, int nsel)
+{
+	int			i;
+
+	switch (bexpr->kind)
+	{
+		case BATCH_EXPR_VAR:
+		case BATCH_EXPR_CONST:
+			/* the values are in place already */
+			break;
+
+		case BATCH_EXPR_CMP:
+			eval_batch_cmp(bexpr, sel, nsel);
+			break;
+
+		case BATCH_EXPR_ARITH:
+			eval_batch_arith(bexpr, sel, nsel);
+			break;
+
+		case BATCH_EXPR_FUNC:
+			eval_batch_func(bexpr, sel, nsel);
+			break;
+
+		case BATCH_EXPR_AND:
+		case BATCH_EXPR_OR:
+			eval_batch_bool(bexpr, sel, nsel);
+			break;
+
+		case BATCH_EXPR_NOT:
+			{
+				BatchExpr  *arg = bexpr->args[0];
+
+				ExecEvalBatchExpr(arg, sel, nsel);
+				for (i = 0; i < nsel; i++)
+				{
+					int			row = sel[i];
+
+					bexpr->isnull[row] = arg->isnull[row];
+					bexpr->values[row] =
+						BoolGetDatum(!DatumGetBool(arg->values[row]));
+				}
+			}
+			break;
+
+		case BATCH_EXPR_NULLTEST:
+			{
+				BatchExpr  *arg = bexpr->args[0];
+				bool		want_null = (bexpr->nulltesttype == IS_NULL);
+
+				ExecEvalBatchExpr(arg, sel, nsel);
+				for (i = 0; i < nsel; i++)
+				{
+					int			row = sel[i];
+
+					bexpr->isnull[row] = false;
+					bexpr->values[row] =
+						BoolGetDatum(arg->isnull[row] == want_null);
+				}
+			}
+			break;
+	}
+}
+
+/*
+ * Loop over the selected rows applying a strict binary operation; "op" is
+ * a statement computing "result" from "a" and "b", of C type "ctype".
+ */
+#define BATCH_BINARY_LOOP(ctype, getdatum, op) \
+	do { \
+		for (i = 0; i < nsel; i++) \
+		{ \
+			int			row = sel[i]; \
+			ctype		a; \
+			ctype		b; \
+			\
+			if (lnull[row] || rnull[row]) \
+			{ \
+				bexpr->isnull[row] = true; \
+				continue; \
+			} \
+			a = getdatum(lval[row]); \
+			b = getdatum(rval[row]); \
+			bexpr->isnull[row] = false; \
+			op; \
+		} \
+	} while (0)
+
+#define BATCH_CMP_LOOP(ctype, getdatum, cmpop) \
+	BATCH_BINARY_LOOP(ctype, getdatum, \
+					  bexpr->values[row] = BoolGetDatum(a cmpop b))
+
+#define BATCH_FLOAT8_CMP_LOOP(cmpop) \
+	BATCH_BINARY_LOOP(float8, DatumGetFloat8, \
+					  bexpr->values[row] = \
+					  BoolGetDatum(batch_float8_cmp(a, b) cmpop 0))
+
+#define BATCH_CMP_CASES(LOOP) \
+	case BATCH_OP_LT: LOOP(<); break; \
+	case BATCH_OP_LE: LOOP(<=); break; \
+	case BATCH_OP_EQ: LOOP(==); break; \
+	case BATCH_OP_NE: LOOP(!=); break; \
+	case BATCH_OP_GE: LOOP(>=); break; \
+	case BATCH_OP_GT: LOOP(>); break; \
+	default: elog(ERROR, "unrecognized batch comparison: %d", (int) bexpr->op)
+
+#define BATCH_INT4_CMP_LOOP(cmpop) BATCH_CMP_LOOP(int32, DatumGetInt32, cmpop)
+#define BATCH_INT8_CMP_LOOP(cmpop) BATCH_CMP_LOOP(int64, DatumGetInt64, cmpop)
+
+/*
+ * Evaluate a comparison, with the same results as the built-in comparison
+ * functions of its type.
+ */
+static void
+eval_batch_cmp(BatchExpr *bexpr, const int *sel, int nsel)
+{
+	BatchExpr  *left = bexpr->args[0];
+	BatchExpr  *right = bexpr->args[1];
+	Datum	   *lval = left->values;
+	Datum	   *rval = right->values;
+	bool	   *lnull = left->isnull;
+	bool	   *rnull = right->isnull;
+	int			i;
+
+	ExecEvalBatchExpr(left, sel, nsel);
+	ExecEvalBatchExpr(right, sel, nsel);
+
+	switch (bexpr->type)
+	{
+		case BATCH_TYPE_INT4:
+			switch (bexpr->op)
+			{
+					BATCH_CMP_CASES(BATCH_INT4_CMP_LOOP);
+			}
+			break;
+		case BATCH_TYPE_INT8:
+			switch (bexpr->op)
+			{
+					BATCH_CMP_CASES(BATCH_INT8_CMP_LOOP);
+			}
+			break;
+		case BATCH_TYPE_FLOAT8:
+			switch (bexpr->op)
+			{
+					BATCH_CMP_CASES(BATCH_FLOAT8_CMP_LOOP);
+			}
+			break;
+	}
+}
+
+/*
+ * Evaluate an arithmetic operator, raising the same errors as the built-in
+ * functions of its type on overflow.
+ */
+static void
+eval_batch_arith(BatchExpr *bexpr, const int *sel, int nsel)
+{
+	BatchExpr  *left = bexpr->args[0];
+	BatchExpr  *right = bexpr->args[1];
+	Datum	   *lval = left->values;
+	Datum	   *rval = right->values;
+	bool	   *lnull = left->isnull;
+	bool	   *rnull = right->isnull;
+	int			i;
+
+	ExecEvalBatchExpr(left, sel, nsel);
+	ExecEvalBatchExpr(right, sel, nsel);
+
+	switch (bexpr->type)
+	{
+		case BATCH_TYPE_INT4:
+			{
+				bool		overflow = false;
+				int32		result;
+
+				switch (bexpr->op)
+				{
+					case BATCH_OP_ADD:
+						BATCH_BINARY_LOOP(int32, DatumGetInt32,
+										  overflow |= pg_add_s32_overflow(a, b, &result);
+										  bexpr->values[row] = Int32GetDatum(result));
+						break;
+					case BATCH_OP_SUB:
+						BATCH_BINARY_LOOP(int32, DatumGetInt32,
+										  overflow |= pg_sub_s32_overflow(a, b, &result);
+										  bexpr->values[row] = Int32GetDatum(result));
+						break;
+					case BATCH_OP_MUL:
+						BATCH_BINARY_LOOP(int32, DatumGetInt32,
+										  overflow |= pg_mul_s32_overflow(a, b, &result);
+										  bexpr->values[row] = Int32GetDatum(result));
+						break;
+					default:
+						elog(ERROR, "unrecognized batch operator: %d",
+							 (int) bexpr->op);
+				}
+				if (unlikely(overflow))
+					ereport(ERROR,
+							(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+							 errmsg("integer out of range")));
+			}
+			break;
+
+		case BATCH_TYPE_INT8:
+			{
+				bool		overflow = false;
+				int64		result;
+
+				switch (bexpr->op)
+				{
+					case BATCH_OP_ADD:
+						BATCH_BINARY_LOOP(int64, DatumGetInt64,
+										  overflow |= pg_add_s64_overflow(a, b, &result);
+										  bexpr->values[row] = Int64GetDatum(result));
+						break;
+					case BATCH_OP_SUB:
+						BATCH_BINARY_LOOP(int64, DatumGetInt64,
+										  overflow |= pg_sub_s64_overflow(a, b, &result);
+										  bexpr->values[row] = Int64GetDatum(result));
+						break;
+					case BATCH_OP_MUL:
+						BATCH_BINARY_LOOP(int64, DatumGetInt64,
+										  overflow |= pg_mul_s64_overflow(a, b, &result);
+										  bexpr->values[row] = Int64GetDatum(result));
+						break;
+					default:
+						elog(ERROR, "unrecognized batch operator: %d",
+							 (int) bexpr->op);
+				}
+				if (unlikely(overflow))
+					ereport(ERROR,
+							(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+							 errmsg("bigint out of range")));
+			}
+			break;
+
+		case BATCH_TYPE_FLOAT8:
+			{
+				/* as CHECKFLOATVAL in float.c */
+				bool		overflow = false;
+				bool		underflow = false;
+				float8		result;
+
+				switch (bexpr->op)
+				{
+					case BATCH_OP_ADD:
+						BATCH_BINARY_LOOP(float8, DatumGetFloat8,
+										  result = a + b;
+										  overflow |= isinf(result) && !isinf(a) && !isinf(b);
+										  bexpr->values[row] = Float8GetDatum(result));
+						break;
+					case BATCH_OP_SUB:
+						BATCH_BINARY_LOOP(float8, DatumGetFloat8,
+										  result = a - b;
+										  overflow |= isinf(result) && !isinf(a) && !isinf(b);
+										  bexpr->values[row] = Float8GetDatum(result));
+						break;
+					case BATCH_OP_MUL:
+						BATCH_BINARY_LOOP(float8, DatumGetFloat8,
+										  result = a * b;
+										  overflow |= isinf(result) && !isinf(a) && !isinf(b);
+										  underflow |= result == 0.0 && a != 0.0 && b != 0.0;
+										  bexpr->values[row] = Float8GetDatum(result));
+						break;
+					default:
+						elog(ERROR, "unrecognized batch operator: %d",
+							 (int) bexpr->op);
+				}
+				if (unlikely(overflow))
+					ereport(ERROR,
+							(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+							 errmsg("value out of range: overflow")));
+				if (unlikely(underflow))
+					ereport(ERROR,
+							(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+							 errmsg("value out of range: underflow")));
+			}
+			break;
+	}
+}
+
+/*
+ * Evaluate any other function, through fmgr.
+ */
+static void
+eval_batch_func(BatchExpr *bexpr, const int *sel, int nsel)
+{
+	FunctionCallInfo fcinfo = bexpr->fcinfo;
+	int			nargs = bexpr->nargs;
+	int			argno;
+	int			i;
+
+	for (argno = 0; argno < nargs; argno++)
+		ExecEvalBatchExpr(bexpr->args[argno], sel, nsel);
+
+	for (i = 0; i < nsel; i++)
+	{
+		int			row = sel[i];
+		bool		hasnull = false;
+
+		for (argno = 0; argno < nargs; argno++)
+		{
+			BatchExpr  *arg = bexpr->args[argno];
+
+			fcinfo->arg[argno] = arg->values[row];
+			fcinfo->argnull[argno] = arg->isnull[row];
+			hasnull |= arg->isnull[row];
+		}
+
+		if (bexpr->strict && hasnull)
+		{
+			bexpr->isnull[row] = true;
+			continue;
+		}
+
+		fcinfo->isnull = false;
+		bexpr->values[row] = FunctionCallInvoke(fcinfo);
+		bexpr->isnull[row] = fcinfo->isnull;
+	}
+}
+
+/*
+ * Evaluate AND or OR.
+ *
+ * Like ExecInterpExpr, each argument is only evaluated for the rows whose
+ * result is not decided by the earlier arguments yet.
+ */
+static void
+eval_batch_bool(BatchExpr *bexpr, const int *sel, int nsel)
+{
+	bool		isor = (bexpr->kind == BATCH_EXPR_OR);
+	int		   *todo = bexpr->sel;
+	int			ntodo = nsel;
+	int			argno;
+	int			i;
+
+	/* Start with the result we get if no argument decides it */
+	for (i = 0; i < nsel; i++)
+	{
+		int			row = sel[i];
+
+		bexpr->values[row] = BoolGetDatum(!isor);
+		bexpr->isnull[row] = false;
+		todo[i] = row;
+	}
+
+	for (argno = 0; argno < bexpr->nargs && ntodo > 0; argno++)
+	{
+		BatchExpr  *arg = bexpr->args[argno];
+		int			nremain = 0;
+
+		ExecEvalBatchExpr(arg, todo, ntodo);
+
+		for (i = 0; i < ntodo; i++)
+		{
+			int			row = todo[i];
+
+			if (arg->isnull[row])
+			{
+				/* the result is null unless a later argument decides it */
+				bexpr->isnull[row] = true;
+			}
+			else if (DatumGetBool(arg->values[row]) == isor)
+			{
+				/* decided */
+				bexpr->values[row] = BoolGetDatum(isor);
+				bexpr->isnull[row] = false;
+				continue;
+			}
+			todo[nremain++] = row;
+		}
+		ntodo = nremain;
+	}
+}
@@ -3115,6 +3115,7 @@ ExecBuildAggTransCall(ExprState *state, AggState *aggstate,
 {
 	int			adjust_init_jumpnull = -1;
 	int			adjust_strict_jumpnull = -1;
+	int			adjust_pergroup_jumpnull = -1;
 	ExprContext *aggcontext;
 
 	if (ishash)
@@ -3122,6 +3123,22 @@ ExecBuildAggTransCall(ExprState *state, AggState *aggstate,
 	else
 		aggcontext = aggstate->aggcontexts[setno];
 
+	/*
+	 * A hashed grouping set may have no group for the current input tuple,
+	 * if the hash table was full and the tuple has been spilled to disk.
+	 * Skip the transition in that case.
+	 */
+	if (ishash)
+	{
+		scratch->opcode = EEOP_AGG_PLAIN_PERGROUP_NULLCHECK;
+		scratch->d.agg_plain_pergroup_nullcheck.aggstate = aggstate;
+		scratch->d.agg_plain_pergroup_nullcheck.setoff = setoff;
+		scratch->d.agg_plain_pergroup_nullcheck.jumpnull = -1;	/* adjust later */
+		ExprEvalPushStep(state, scratch);
+
+		adjust_pergroup_jumpnull = state->steps_len - 1;
+	}
+
 	/*
 	 * If the initial value for the transition state doesn't exist in the
 	 * pg_aggregate table then we will let the first non-NULL value returned
@@ -3185,6 +3202,13 @@ ExecBuildAggTransCall(ExprState *state, AggState *aggstate,
 	ExprEvalPushStep(state, scratch);
 
 	/* adjust jumps so they jump till after transition invocation */
+	if (adjust_pergroup_jumpnull != -1)
+	{
+		ExprEvalStep *as = &state->steps[adjust_pergroup_jumpnull];
+
+		Assert(as->d.agg_plain_pergroup_nullcheck.jumpnull == -1);
+		as->d.agg_plain_pergroup_nullcheck.jumpnull = state->steps_len;
+	}
 	if (adjust_init_jumpnull != -1)
 	{
 		ExprEvalStep *as = &state->steps[adjust_init_jumpnull];
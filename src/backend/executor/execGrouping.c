@@ -312,6 +312,29 @@ FindTupleHashEntry(TupleHashTable hashtable, TupleTableSlot *slot,
 	return entry;
 }
 
+/*
+ * Compute the hash value that LookupTupleHashEntry would use for the given
+ * tuple.  The tuple must be the same type as the hashtable entries.
+ */
+uint32
+TupleHashTableHashSlot(TupleHashTable hashtable, TupleTableSlot *slot)
+{
+	MemoryContext oldContext;
+	uint32		hash;
+
+	/* Need to run the hash functions in short-lived context */
+	oldContext = MemoryContextSwitchTo(hashtable->tempcxt);
+
+	hashtable->inputslot = slot;
+	hashtable->in_hash_funcs = hashtable->tab_hash_funcs;
+
+	hash = TupleHashTableHash(hashtable->hashtab, NULL);
+
+	MemoryContextSwitchTo(oldContext);
+
+	return hash;
+}
+
 /*
  * Compute the hash value for a tuple
  *
@@ -1345,6 +1345,10 @@ InitResultRelInfo(ResultRelInfo *resultRelInfo,
 	/* The following fields are set later if needed */
 	resultRelInfo->ri_FdwState = NULL;
 	resultRelInfo->ri_usesFdwDirectModify = false;
+	resultRelInfo->ri_NumSlots = 0;
+	resultRelInfo->ri_BatchSize = 0;
+	resultRelInfo->ri_Slots = NULL;
+	resultRelInfo->ri_PlanSlots = NULL;
 	resultRelInfo->ri_ConstraintExprs = NULL;
 	resultRelInfo->ri_junkFilter = NULL;
 	resultRelInfo->ri_projectReturning = NULL;
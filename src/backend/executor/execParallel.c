@@ -26,6 +26,7 @@
 #include "executor/execExpr.h"
 #include "executor/execParallel.h"
 #include "executor/executor.h"
+#include "executor/nodeAgg.h"
 #include "executor/nodeAppend.h"
 #include "executor/nodeBitmapHeapscan.h"
 #include "executor/nodeCustom.h"
@@ -273,6 +274,10 @@ ExecParallelEstimate(PlanState *planstate, ExecParallelEstimateContext *e)
 				ExecHashJoinEstimate((HashJoinState *) planstate,
 									 e->pcxt);
 			break;
+		case T_AggState:
+			if (planstate->plan->parallel_aware)
+				ExecAggEstimate((AggState *) planstate, e->pcxt);
+			break;
 		case T_HashState:
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecHashEstimate((HashState *) planstate, e->pcxt);
@@ -486,6 +491,10 @@ ExecParallelInitializeDSM(PlanState *planstate,
 				ExecHashJoinInitializeDSM((HashJoinState *) planstate,
 										  d->pcxt);
 			break;
+		case T_AggState:
+			if (planstate->plan->parallel_aware)
+				ExecAggInitializeDSM((AggState *) planstate, d->pcxt);
+			break;
 		case T_HashState:
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecHashInitializeDSM((HashState *) planstate, d->pcxt);
@@ -916,9 +925,16 @@ ExecParallelReInitializeDSM(PlanState *planstate,
 				ExecHashJoinReInitializeDSM((HashJoinState *) planstate,
 											pcxt);
 			break;
-		case T_HashState:
+		case T_AggState:
+			if (planstate->plan->parallel_aware)
+				ExecAggReInitializeDSM((AggState *) planstate, pcxt);
+			break;
 		case T_SortState:
-			/* these nodes have DSM state, but no reinitialization is required */
+			if (planstate->plan->parallel_aware)
+				ExecSortReInitializeDSM((SortState *) planstate, pcxt);
+			break;
+		case T_HashState:
+			/* this node has DSM state, but no reinitialization is required */
 			break;
 
 		default:
@@ -1219,6 +1235,10 @@ ExecParallelInitializeWorker(PlanState *planstate, ParallelWorkerContext *pwcxt)
 				ExecHashJoinInitializeWorker((HashJoinState *) planstate,
 											 pwcxt);
 			break;
+		case T_AggState:
+			if (planstate->plan->parallel_aware)
+				ExecAggInitializeWorker((AggState *) planstate, pwcxt);
+			break;
 		case T_HashState:
 			/* even when not parallel-aware, for EXPLAIN ANALYZE */
 			ExecHashInitializeWorker((HashState *) planstate, pwcxt);
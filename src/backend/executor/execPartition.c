@@ -719,6 +719,26 @@ ExecInitPartitionInfo(ModifyTableState *mtstate,
 		leaf_part_rri->ri_mergeTargetRTI = node->mergeTargetRelation +
 			partidx + 1;
 	}
+
+	/*
+	 * Determine the batch size to use if the FDW can insert tuples in
+	 * batches.  That's only done for INSERT, including COPY FROM, and not
+	 * when transition tuples are captured.  The FDW may look at the WITH
+	 * CHECK OPTIONs and RETURNING list set up above.
+	 */
+	if (mtstate->operation == CMD_INSERT &&
+		mtstate->mt_transition_capture == NULL &&
+		leaf_part_rri->ri_FdwRoutine != NULL &&
+		leaf_part_rri->ri_FdwRoutine->GetForeignModifyBatchSize != NULL &&
+		leaf_part_rri->ri_FdwRoutine->ExecForeignBatchInsert != NULL)
+	{
+		leaf_part_rri->ri_BatchSize =
+			leaf_part_rri->ri_FdwRoutine->GetForeignModifyBatchSize(leaf_part_rri);
+		Assert(leaf_part_rri->ri_BatchSize >= 1);
+	}
+	else
+		leaf_part_rri->ri_BatchSize = 1;
+
 	MemoryContextSwitchTo(oldContext);
 
 	return leaf_part_rri;
@@ -194,6 +194,32 @@
  *	  transition values.  hashcontext is the single context created to support
  *	  all hash tables.
  *
+ *	  Spilling hash tables to disk:
+ *
+ *	  The planner's estimate of the number of groups can be far off, so the
+ *	  memory used by the hash tables is checked whenever a group is added.
+ *	  Once it exceeds work_mem, no more groups are created; input tuples that
+ *	  belong to a group already in memory are aggregated as usual, the others
+ *	  are written to a temporary file, partitioned by their hash value, and
+ *	  their transitions are skipped for that grouping set.  When the groups in
+ *	  memory have been returned, the hash tables are emptied, and the spilled
+ *	  partitions are aggregated one at a time as if they were the input.  A
+ *	  partition that still has too many groups is partitioned again using
+ *	  further bits of the hash value.
+ *
+ *	  Parallel hashed aggregation:
+ *
+ *	  Ordinarily, parallel aggregation is done by a Partial Aggregate in each
+ *	  worker, whose results are combined by a Finalize Aggregate above the
+ *	  Gather.  With many groups, that builds a nearly complete hash table in
+ *	  every worker, and then once more in the leader.  A parallel-aware
+ *	  AGG_HASHED node instead has all participants add their input to one
+ *	  hash table in dynamic shared memory, and once all the input is in,
+ *	  finalize the groups, each participant taking its share of the table.
+ *	  Only simple pass-by-value grouping columns and transition states are
+ *	  supported; see AggStateSharedData in nodeAgg.h.  The shared hash table
+ *	  is not spilled to disk.
+ *
  *    Transition / Combine function invocation:
  *
  *    For performance reasons transition functions, including combine
@@ -216,14 +242,18 @@
 
 #include "postgres.h"
 
+#include <math.h>
+
 #include "access/htup_details.h"
 #include "catalog/objectaccess.h"
 #include "catalog/pg_aggregate.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
+#include "common/int.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
 #include "miscadmin.h"
+#include "pgstat.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
@@ -237,6 +267,16 @@
 #include "utils/syscache.h"
 #include "utils/tuplesort.h"
 #include "utils/datum.h"
+#include "utils/dynahash.h"
+
+
+/*
+ * Limits on the number of partitions a grouping set's spilled tuples are
+ * divided into, and how many more partitions than would just fit are made.
+ */
+#define HASHAGG_MIN_PARTITIONS 4
+#define HASHAGG_MAX_PARTITIONS 256
+#define HASHAGG_PARTITION_FACTOR 1.5
 
 
 static void select_current_set(AggState *aggstate, int setno, bool is_hash);
@@ -273,11 +313,33 @@ static TupleTableSlot *project_aggregates(AggState *aggstate);
 static Bitmapset *find_unaggregated_cols(AggState *aggstate);
 static bool find_unaggregated_cols_walker(Node *node, Bitmapset **colnos);
 static void build_hash_table(AggState *aggstate);
+static void build_hash_table_for_set(AggState *aggstate, int setno,
+						 long nbuckets);
 static TupleHashEntryData *lookup_hash_entry(AggState *aggstate);
 static void lookup_hash_entries(AggState *aggstate);
+static void hash_agg_check_limits(AggState *aggstate);
+static void hash_spill_init(AggState *aggstate, AggStatePerHash perhash,
+				double input_groups);
+static void hash_spill_tuple(AggState *aggstate, AggStatePerHash perhash,
+				 TupleTableSlot *slot, uint32 hash);
+static TupleTableSlot *hash_read_spilled_tuple(BufFile *file, uint32 *hash,
+						TupleTableSlot *slot);
+static void hash_spill_finish(AggState *aggstate);
+static void hash_spill_reset(AggState *aggstate);
+static bool agg_refill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
+static void agg_fill_batch(AggState *aggstate);
+static void advance_batch_transition(AggState *aggstate,
+						 AggStatePerTrans pertrans,
+						 AggStatePerTransBatchData *pertransbatch,
+						 AggStatePerGroup pergroupstate,
+						 const int *sel, int nsel);
 static void agg_fill_hash_table(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
+static void agg_fill_shared_hash_table(AggState *aggstate);
+static TupleTableSlot *agg_retrieve_shared_hash_table(AggState *aggstate);
+static void shared_hash_table_setup(AggState *aggstate,
+						ParallelAggState *pstate);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
 static void build_pertrans_for_aggref(AggStatePerTrans pertrans,
 						  AggState *aggstate, EState *estate,
@@ -287,6 +349,7 @@ static void build_pertrans_for_aggref(AggStatePerTrans pertrans,
 						  Oid *inputTypes, int numArguments);
 static int find_compatible_peragg(Aggref *newagg, AggState *aggstate,
 					   int lastaggno, List **same_input_transnos);
+static AggStateBatch build_batch_state(AggState *aggstate);
 static int find_compatible_pertrans(AggState *aggstate, Aggref *newagg,
 						 bool sharable,
 						 Oid aggtransfn, Oid aggtranstype,
@@ -1263,32 +1326,46 @@ find_unaggregated_cols_walker(Node *node, Bitmapset **colnos)
 static void
 build_hash_table(AggState *aggstate)
 {
-	MemoryContext tmpmem = aggstate->tmpcontext->ecxt_per_tuple_memory;
-	Size		additionalsize;
 	int			i;
 
 	Assert(aggstate->aggstrategy == AGG_HASHED || aggstate->aggstrategy == AGG_MIXED);
 
-	additionalsize = aggstate->numtrans * sizeof(AggStatePerGroupData);
-
 	for (i = 0; i < aggstate->num_hashes; ++i)
 	{
 		AggStatePerHash perhash = &aggstate->perhash[i];
 
 		Assert(perhash->aggnode->numGroups > 0);
 
-		perhash->hashtable = BuildTupleHashTable(&aggstate->ss.ps,
-												 perhash->hashslot->tts_tupleDescriptor,
-												 perhash->numCols,
-												 perhash->hashGrpColIdxHash,
-												 perhash->eqfuncoids,
-												 perhash->hashfunctions,
-												 perhash->aggnode->numGroups,
-												 additionalsize,
-												 aggstate->hashcontext->ecxt_per_tuple_memory,
-												 tmpmem,
-												 DO_AGGSPLIT_SKIPFINAL(aggstate->aggsplit));
+		build_hash_table_for_set(aggstate, i, perhash->aggnode->numGroups);
 	}
+
+	aggstate->hash_ngroups_current = 0;
+}
+
+/*
+ * Initialize the hash table of one grouping set to empty, sized for nbuckets
+ * groups.
+ */
+static void
+build_hash_table_for_set(AggState *aggstate, int setno, long nbuckets)
+{
+	AggStatePerHash perhash = &aggstate->perhash[setno];
+	MemoryContext tmpmem = aggstate->tmpcontext->ecxt_per_tuple_memory;
+	Size		additionalsize;
+
+	additionalsize = aggstate->numtrans * sizeof(AggStatePerGroupData);
+
+	perhash->hashtable = BuildTupleHashTable(&aggstate->ss.ps,
+											 perhash->hashslot->tts_tupleDescriptor,
+											 perhash->numCols,
+											 perhash->hashGrpColIdxHash,
+											 perhash->eqfuncoids,
+											 perhash->hashfunctions,
+											 nbuckets,
+											 additionalsize,
+											 aggstate->hashcontext->ecxt_per_tuple_memory,
+											 tmpmem,
+											 DO_AGGSPLIT_SKIPFINAL(aggstate->aggsplit));
 }
 
 /*
@@ -1439,6 +1516,10 @@ hash_agg_entry_size(int numAggs)
  * set (which the caller must have selected - note that initialize_aggregate
  * depends on this).
  *
+ * In spill mode, no entry is created, and NULL is returned if the group is
+ * not in the hash table yet.  The grouping columns of the tuple are left in
+ * the set's hashslot, for the caller to compute the hash value.
+ *
  * When called, CurrentMemoryContext should be the per-query context.
  */
 static TupleHashEntryData *
@@ -1465,7 +1546,13 @@ lookup_hash_entry(AggState *aggstate)
 	ExecStoreVirtualTuple(hashslot);
 
 	/* find or create the hashtable entry using the filtered tuple */
-	entry = LookupTupleHashEntry(perhash->hashtable, hashslot, &isnew);
+	if (aggstate->hash_spill_mode)
+	{
+		entry = LookupTupleHashEntry(perhash->hashtable, hashslot, NULL);
+		isnew = false;
+	}
+	else
+		entry = LookupTupleHashEntry(perhash->hashtable, hashslot, &isnew);
 
 	if (isnew)
 	{
@@ -1488,6 +1575,9 @@ lookup_hash_entry(AggState *aggstate)
 
 			initialize_aggregate(aggstate, pertrans, pergroupstate);
 		}
+
+		aggstate->hash_ngroups_current++;
+		hash_agg_check_limits(aggstate);
 	}
 
 	return entry;
@@ -1497,6 +1587,10 @@ lookup_hash_entry(AggState *aggstate)
  * Look up hash entries for the current tuple in all hashed grouping sets,
  * returning an array of pergroup pointers suitable for advance_aggregates.
  *
+ * If a set has no entry for the tuple because we are in spill mode, the
+ * tuple is spilled for that set, and its pergroup pointer is set to NULL so
+ * that advance_aggregates skips the set.
+ *
  * Be aware that lookup_hash_entry can reset the tmpcontext.
  */
 static void
@@ -1508,9 +1602,310 @@ lookup_hash_entries(AggState *aggstate)
 
 	for (setno = 0; setno < numHashes; setno++)
 	{
+		AggStatePerHash perhash = &aggstate->perhash[setno];
+		TupleHashEntryData *entry;
+
 		select_current_set(aggstate, setno, true);
-		pergroup[setno] = lookup_hash_entry(aggstate)->additional;
+		entry = lookup_hash_entry(aggstate);
+
+		if (entry != NULL)
+			pergroup[setno] = entry->additional;
+		else
+		{
+			uint32		hash;
+
+			if (perhash->spill_npartitions == 0)
+				hash_spill_init(aggstate, perhash, perhash->aggnode->numGroups);
+
+			hash = TupleHashTableHashSlot(perhash->hashtable, perhash->hashslot);
+			hash_spill_tuple(aggstate, perhash,
+							 aggstate->tmpcontext->ecxt_outertuple, hash);
+			pergroup[setno] = NULL;
+		}
+	}
+}
+
+/*
+ * Enter spill mode if the hash tables have outgrown their memory limit.
+ *
+ * At least one group is always kept in memory, so that progress is made
+ * however large a single group is.  Nor do we spill once all the bits of
+ * the hash value have been used for partitioning; that only happens if a
+ * great many groups have the same hash value, and partitioning them again
+ * would not separate them.
+ */
+static void
+hash_agg_check_limits(AggState *aggstate)
+{
+	Size		mem_used;
+
+	mem_used = MemoryContextMemAllocated(aggstate->hashcontext->ecxt_per_tuple_memory,
+										 true);
+	if (mem_used > aggstate->hash_mem_peak)
+		aggstate->hash_mem_peak = mem_used;
+
+	if (mem_used > aggstate->hash_mem_limit &&
+		aggstate->hash_ngroups_current > 1 &&
+		aggstate->hash_used_bits < 32)
+		aggstate->hash_spill_mode = true;
+}
+
+/*
+ * Maximum number of partitions to spill a grouping set into.
+ *
+ * Each partition file has a buffer of BLCKSZ bytes, and those buffers are
+ * allowed to take up a quarter of work_mem.  This is also used by the planner
+ * to estimate how many times the input has to be partitioned.
+ */
+int
+hash_agg_max_partitions(void)
+{
+	long		max_partitions;
+
+	max_partitions = (work_mem * 1024L / 4) / BLCKSZ;
+	max_partitions = Min(max_partitions, HASHAGG_MAX_PARTITIONS);
+	max_partitions = Max(max_partitions, HASHAGG_MIN_PARTITIONS);
+
+	return (int) max_partitions;
+}
+
+/*
+ * Start spilling the tuples of a grouping set that don't fit in memory.
+ *
+ * input_groups is the estimated number of groups in the input being
+ * aggregated.  The number of partitions is chosen so that the groups that
+ * don't fit in memory this time around will, with some margin for error,
+ * fit in memory when a partition is aggregated.
+ */
+static void
+hash_spill_init(AggState *aggstate, AggStatePerHash perhash,
+				double input_groups)
+{
+	MemoryContext oldcontext;
+	double		mem_groups = Max(aggstate->hash_ngroups_current, 1);
+	double		npartitions;
+	int			partition_bits;
+
+	npartitions = ceil(HASHAGG_PARTITION_FACTOR * input_groups / mem_groups);
+	npartitions = Min(npartitions, hash_agg_max_partitions());
+	npartitions = Max(npartitions, HASHAGG_MIN_PARTITIONS);
+
+	/* round up to a power of 2, but don't use more bits than there are */
+	partition_bits = my_log2((long) npartitions);
+	partition_bits = Min(partition_bits, 32 - aggstate->hash_used_bits);
+
+	Assert(partition_bits > 0);
+
+	perhash->spill_npartitions = 1 << partition_bits;
+	perhash->spill_used_bits = aggstate->hash_used_bits + partition_bits;
+
+	oldcontext = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+	perhash->spill_files = (BufFile **)
+		palloc0(sizeof(BufFile *) * perhash->spill_npartitions);
+	perhash->spill_ntuples = (double *)
+		palloc0(sizeof(double) * perhash->spill_npartitions);
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Write a tuple to the spill partition of its grouping set that its hash
+ * value selects.
+ *
+ * The data recorded in the file for each tuple is its hash value, then the
+ * tuple in MinimalTuple format, like in hash join batch files.
+ */
+static void
+hash_spill_tuple(AggState *aggstate, AggStatePerHash perhash,
+				 TupleTableSlot *slot, uint32 hash)
+{
+	MinimalTuple tuple;
+	int			partition;
+	BufFile    *file;
+	size_t		written;
+
+	Assert(perhash->spill_npartitions > 0);
+
+	/* take the highest bits not used by earlier partitioning */
+	partition = (hash >> (32 - perhash->spill_used_bits)) &
+		(perhash->spill_npartitions - 1);
+
+	file = perhash->spill_files[partition];
+	if (file == NULL)
+	{
+		MemoryContext oldcontext;
+
+		/* the file's buffer must live as long as the file */
+		oldcontext = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+		file = BufFileCreateTemp(false);
+		MemoryContextSwitchTo(oldcontext);
+
+		perhash->spill_files[partition] = file;
+	}
+
+	tuple = ExecFetchSlotMinimalTuple(slot);
+
+	written = BufFileWrite(file, (void *) &hash, sizeof(uint32));
+	if (written != sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to hash-aggregate temporary file: %m")));
+
+	written = BufFileWrite(file, (void *) tuple, tuple->t_len);
+	if (written != tuple->t_len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to hash-aggregate temporary file: %m")));
+
+	perhash->spill_ntuples[partition]++;
+	aggstate->hash_disk_used += sizeof(uint32) + tuple->t_len;
+}
+
+/*
+ * Read the next tuple from a spill file into the given slot.  Returns NULL
+ * at the end of the file.
+ */
+static TupleTableSlot *
+hash_read_spilled_tuple(BufFile *file, uint32 *hash, TupleTableSlot *slot)
+{
+	uint32		header[2];
+	size_t		nread;
+	MinimalTuple tuple;
+
+	CHECK_FOR_INTERRUPTS();
+
+	/*
+	 * Since both the hash value and the MinimalTuple length word are uint32,
+	 * we can read them both in one BufFileRead() call.
+	 */
+	nread = BufFileRead(file, (void *) header, sizeof(header));
+	if (nread == 0)				/* end of file */
+	{
+		ExecClearTuple(slot);
+		return NULL;
+	}
+	if (nread != sizeof(header))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from hash-aggregate temporary file: %m")));
+	*hash = header[0];
+	tuple = (MinimalTuple) palloc(header[1]);
+	tuple->t_len = header[1];
+	nread = BufFileRead(file,
+						(void *) ((char *) tuple + sizeof(uint32)),
+						header[1] - sizeof(uint32));
+	if (nread != header[1] - sizeof(uint32))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from hash-aggregate temporary file: %m")));
+	return ExecStoreMinimalTuple(tuple, slot, true);
+}
+
+/*
+ * Called once all the input has been aggregated or spilled: turn the spill
+ * partitions into batches to be aggregated later.
+ *
+ * New batches go to the front of the list, so that a batch that had to be
+ * partitioned again is finished before we go on with the others.  That keeps
+ * down the amount of disk space in use at any one time.
+ */
+static void
+hash_spill_finish(AggState *aggstate)
+{
+	MemoryContext oldcontext;
+	Size		mem_used;
+	int			setno;
+
+	/* transition values may have grown since the last group was added */
+	mem_used = MemoryContextMemAllocated(aggstate->hashcontext->ecxt_per_tuple_memory,
+										 true);
+	if (mem_used > aggstate->hash_mem_peak)
+		aggstate->hash_mem_peak = mem_used;
+
+	oldcontext = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+
+	for (setno = 0; setno < aggstate->num_hashes; setno++)
+	{
+		AggStatePerHash perhash = &aggstate->perhash[setno];
+		int			i;
+
+		if (perhash->spill_npartitions == 0)
+			continue;
+
+		for (i = 0; i < perhash->spill_npartitions; i++)
+		{
+			BufFile    *file = perhash->spill_files[i];
+			AggStateSpillBatchData *batch;
+
+			if (file == NULL)
+				continue;
+
+			if (BufFileSeek(file, 0, 0L, SEEK_SET))
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not rewind hash-aggregate temporary file: %m")));
+
+			batch = palloc(sizeof(AggStateSpillBatchData));
+			batch->setno = setno;
+			batch->used_bits = perhash->spill_used_bits;
+			batch->file = file;
+			batch->ntuples = perhash->spill_ntuples[i];
+
+			aggstate->hash_spill_batches =
+				lcons(batch, aggstate->hash_spill_batches);
+		}
+
+		pfree(perhash->spill_files);
+		pfree(perhash->spill_ntuples);
+		perhash->spill_files = NULL;
+		perhash->spill_ntuples = NULL;
+		perhash->spill_npartitions = 0;
 	}
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Close all spill files, and forget about the batches not yet aggregated.
+ */
+static void
+hash_spill_reset(AggState *aggstate)
+{
+	ListCell   *lc;
+	int			setno;
+
+	for (setno = 0; setno < aggstate->num_hashes; setno++)
+	{
+		AggStatePerHash perhash = &aggstate->perhash[setno];
+		int			i;
+
+		if (perhash->spill_npartitions == 0)
+			continue;
+
+		for (i = 0; i < perhash->spill_npartitions; i++)
+		{
+			if (perhash->spill_files[i] != NULL)
+				BufFileClose(perhash->spill_files[i]);
+		}
+
+		pfree(perhash->spill_files);
+		pfree(perhash->spill_ntuples);
+		perhash->spill_files = NULL;
+		perhash->spill_ntuples = NULL;
+		perhash->spill_npartitions = 0;
+	}
+
+	foreach(lc, aggstate->hash_spill_batches)
+	{
+		AggStateSpillBatchData *batch = (AggStateSpillBatchData *) lfirst(lc);
+
+		BufFileClose(batch->file);
+	}
+	list_free_deep(aggstate->hash_spill_batches);
+	aggstate->hash_spill_batches = NIL;
+
+	aggstate->hash_spill_mode = false;
+	aggstate->hash_used_bits = 0;
+	aggstate->hash_batches_used = 0;
 }
 
 /*
@@ -1540,6 +1935,14 @@ ExecAgg(PlanState *pstate)
 		switch (node->phase->aggstrategy)
 		{
 			case AGG_HASHED:
+				if (node->shared != NULL)
+				{
+					/* Parallel HashAggregate */
+					if (!node->table_filled)
+						agg_fill_shared_hash_table(node);
+					result = agg_retrieve_shared_hash_table(node);
+					break;
+				}
 				if (!node->table_filled)
 					agg_fill_hash_table(node);
 				/* FALLTHROUGH */
@@ -1664,6 +2067,7 @@ agg_retrieve_direct(AggState *aggstate)
 				 */
 				initialize_phase(aggstate, 0);
 				aggstate->table_filled = true;
+				hash_spill_finish(aggstate);
 				ResetTupleHashIterator(aggstate->perhash[0].hashtable,
 									   &aggstate->perhash[0].hashiter);
 				select_current_set(aggstate, 0, true);
@@ -1729,9 +2133,10 @@ agg_retrieve_direct(AggState *aggstate)
 
 			/*
 			 * If we don't already have the first tuple of the new group,
-			 * fetch it from the outer plan.
+			 * fetch it from the outer plan.  (In batch mode, we don't need
+			 * it.)
 			 */
-			if (aggstate->grp_firstTuple == NULL)
+			if (aggstate->grp_firstTuple == NULL && aggstate->batch == NULL)
 			{
 				outerslot = fetch_input_tuple(aggstate);
 				if (!TupIsNull(outerslot))
@@ -1792,7 +2197,16 @@ agg_retrieve_direct(AggState *aggstate)
 			 */
 			initialize_aggregates(aggstate, pergroups, numReset);
 
-			if (aggstate->grp_firstTuple != NULL)
+			if (aggstate->batch != NULL)
+			{
+				/*
+				 * Batch mode is only used for plain aggregation, so all the
+				 * input goes into the one group.
+				 */
+				agg_fill_batch(aggstate);
+				aggstate->agg_done = true;
+			}
+			else if (aggstate->grp_firstTuple != NULL)
 			{
 				/*
 				 * Store the copied first input tuple in the tuple table slot
@@ -1901,6 +2315,244 @@ agg_retrieve_direct(AggState *aggstate)
 	return NULL;
 }
 
+/*
+ * Aggregate all the input in batch mode.
+ *
+ * The outer plan's rows are fetched from the scan underneath it a batch at a
+ * time, and each aggregate's inputs, FILTER clause and transition function
+ * are applied to the whole batch before moving on to the next aggregate.
+ * The results are the same as if each row had been passed through
+ * advance_aggregates().
+ */
+static void
+agg_fill_batch(AggState *aggstate)
+{
+	AggStateBatch batch = aggstate->batch;
+	BatchScanState *bscan = batch->scan;
+	AggStatePerGroup pergroup = aggstate->pergroups[0];
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+	MemoryContext oldContext;
+	int			transno;
+
+	select_current_set(aggstate, 0, false);
+
+	ExecBatchScanBegin(bscan);
+
+	/* Expressions are evaluated in per-batch memory */
+	oldContext = MemoryContextSwitchTo(tmpcontext->ecxt_per_tuple_memory);
+
+	while (ExecBatchScanNext(bscan))
+	{
+		for (transno = 0; transno < aggstate->numtrans; transno++)
+		{
+			advance_batch_transition(aggstate,
+									 &aggstate->pertrans[transno],
+									 &batch->pertrans[transno],
+									 &pergroup[transno],
+									 bscan->sel, bscan->nsel);
+		}
+
+		/* Reset per-batch context after each batch */
+		ResetExprContext(tmpcontext);
+	}
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+/*
+ * Apply the transition function of one aggregate to the selected rows of
+ * the current batch.
+ *
+ * The specialized cases must have the same effect as the transition
+ * functions they stand in for would have when called through
+ * advance_transition_function().  All of those functions are strict, except
+ * int4_sum, which is handled separately.
+ */
+#define AGG_BATCH_STRICT_LOOP(ctype, getdatum, makedatum, step) \
+	do { \
+		ctype		state = isnull ? 0 : getdatum(value); \
+		\
+		for (i = 0; i < nsel; i++) \
+		{ \
+			int			row = sel[i]; \
+			ctype		input; \
+			\
+			if (arg->isnull[row]) \
+				continue; \
+			input = getdatum(arg->values[row]); \
+			if (notrans) \
+			{ \
+				state = input; \
+				isnull = notrans = false; \
+				continue; \
+			} \
+			if (isnull) \
+				continue; \
+			step; \
+		} \
+		if (!isnull) \
+			value = makedatum(state); \
+	} while (0)
+
+static void
+advance_batch_transition(AggState *aggstate,
+						 AggStatePerTrans pertrans,
+						 AggStatePerTransBatchData *pertransbatch,
+						 AggStatePerGroup pergroupstate,
+						 const int *sel, int nsel)
+{
+	int			numTransInputs = pertrans->numTransInputs;
+	BatchExpr  *arg = numTransInputs > 0 ? pertransbatch->args[0] : NULL;
+	Datum		value = pergroupstate->transValue;
+	bool		isnull = pergroupstate->transValueIsNull;
+	bool		notrans = pergroupstate->noTransValue;
+	int			argno;
+	int			i;
+
+	/* Skip the rows that the FILTER clause rejects */
+	if (pertransbatch->filter != NULL)
+	{
+		nsel = ExecBatchQual(pertransbatch->filter, sel, nsel,
+							 aggstate->batch->sel);
+		sel = aggstate->batch->sel;
+	}
+
+	if (nsel == 0)
+		return;
+
+	for (argno = 0; argno < numTransInputs; argno++)
+		ExecEvalBatchExpr(pertransbatch->args[argno], sel, nsel);
+
+	switch (pertransbatch->kind)
+	{
+		case AGG_BATCH_TRANS_GENERIC:
+			{
+				FunctionCallInfo fcinfo = &pertrans->transfn_fcinfo;
+
+				for (i = 0; i < nsel; i++)
+				{
+					int			row = sel[i];
+
+					for (argno = 0; argno < numTransInputs; argno++)
+					{
+						BatchExpr  *input = pertransbatch->args[argno];
+
+						fcinfo->arg[argno + 1] = input->values[row];
+						fcinfo->argnull[argno + 1] = input->isnull[row];
+					}
+					advance_transition_function(aggstate, pertrans,
+												pergroupstate);
+				}
+			}
+			/* pergroupstate is up to date already */
+			return;
+
+		case AGG_BATCH_TRANS_COUNT_STAR:
+		case AGG_BATCH_TRANS_COUNT:
+			{
+				int64		count = 0;
+				int64		newcount;
+
+				/* only used with a non-null initial value */
+				Assert(!notrans);
+				if (isnull)
+					break;
+
+				if (pertransbatch->kind == AGG_BATCH_TRANS_COUNT_STAR)
+					count = nsel;
+				else
+				{
+					for (i = 0; i < nsel; i++)
+						count += !arg->isnull[sel[i]];
+				}
+
+				if (unlikely(pg_add_s64_overflow(DatumGetInt64(value), count,
+												 &newcount)))
+					ereport(ERROR,
+							(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+							 errmsg("bigint out of range")));
+				value = Int64GetDatum(newcount);
+			}
+			break;
+
+		case AGG_BATCH_TRANS_INT4_SUM:
+			{
+				/* int4_sum isn't strict: a null state means no input yet */
+				int64		sum = isnull ? 0 : DatumGetInt64(value);
+				bool		found = !isnull;
+
+				for (i = 0; i < nsel; i++)
+				{
+					int			row = sel[i];
+
+					if (arg->isnull[row])
+						continue;
+					sum += (int64) DatumGetInt32(arg->values[row]);
+					found = true;
+				}
+				if (found)
+				{
+					value = Int64GetDatum(sum);
+					isnull = false;
+				}
+			}
+			break;
+
+		case AGG_BATCH_TRANS_FLOAT8_SUM:
+			AGG_BATCH_STRICT_LOOP(float8, DatumGetFloat8, Float8GetDatum,
+								  {
+									  float8 result = state + input;
+
+									  /* as CHECKFLOATVAL in float8pl */
+									  if (isinf(result) && !isinf(state) &&
+										  !isinf(input))
+										  ereport(ERROR,
+												  (errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+												   errmsg("value out of range: overflow")));
+									  state = result;
+								  });
+			break;
+
+		case AGG_BATCH_TRANS_INT4_MIN:
+			AGG_BATCH_STRICT_LOOP(int32, DatumGetInt32, Int32GetDatum,
+								  if (input < state) state = input);
+			break;
+
+		case AGG_BATCH_TRANS_INT4_MAX:
+			AGG_BATCH_STRICT_LOOP(int32, DatumGetInt32, Int32GetDatum,
+								  if (input > state) state = input);
+			break;
+
+		case AGG_BATCH_TRANS_INT8_MIN:
+			AGG_BATCH_STRICT_LOOP(int64, DatumGetInt64, Int64GetDatum,
+								  if (input < state) state = input);
+			break;
+
+		case AGG_BATCH_TRANS_INT8_MAX:
+			AGG_BATCH_STRICT_LOOP(int64, DatumGetInt64, Int64GetDatum,
+								  if (input > state) state = input);
+			break;
+
+		case AGG_BATCH_TRANS_FLOAT8_MIN:
+			/* float8smaller keeps the state only if it sorts lower */
+			AGG_BATCH_STRICT_LOOP(float8, DatumGetFloat8, Float8GetDatum,
+								  if (batch_float8_cmp(state, input) >= 0)
+								  state = input);
+			break;
+
+		case AGG_BATCH_TRANS_FLOAT8_MAX:
+			/* float8larger keeps the state only if it sorts higher */
+			AGG_BATCH_STRICT_LOOP(float8, DatumGetFloat8, Float8GetDatum,
+								  if (batch_float8_cmp(state, input) <= 0)
+								  state = input);
+			break;
+	}
+
+	pergroupstate->transValue = value;
+	pergroupstate->transValueIsNull = isnull;
+	pergroupstate->noTransValue = notrans;
+}
+
 /*
  * ExecAgg for hashed case: read input and build hash table
  */
@@ -1937,12 +2589,92 @@ agg_fill_hash_table(AggState *aggstate)
 	}
 
 	aggstate->table_filled = true;
+	hash_spill_finish(aggstate);
 	/* Initialize to walk the first hash table */
 	select_current_set(aggstate, 0, true);
 	ResetTupleHashIterator(aggstate->perhash[0].hashtable,
 						   &aggstate->perhash[0].hashiter);
 }
 
+/*
+ * Aggregate the next batch of spilled tuples into an empty hash table, and
+ * set up to walk it.  Returns false if there are no more batches.
+ *
+ * Only the batch's grouping set is advanced; the others' pergroup pointers
+ * are left NULL.  Tuples of groups that don't fit in memory this time around
+ * are partitioned into new batches, using the next bits of their hash value.
+ */
+static bool
+agg_refill_hash_table(AggState *aggstate)
+{
+	AggStateSpillBatchData *batch;
+	AggStatePerHash perhash;
+	TupleTableSlot *slot = aggstate->hash_spill_slot;
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+	uint32		hash;
+	int			setno;
+
+	if (aggstate->hash_spill_batches == NIL)
+		return false;
+
+	batch = (AggStateSpillBatchData *) linitial(aggstate->hash_spill_batches);
+	aggstate->hash_spill_batches =
+		list_delete_first(aggstate->hash_spill_batches);
+	perhash = &aggstate->perhash[batch->setno];
+
+	/*
+	 * All groups in memory have been returned, so free them and start over
+	 * with an empty hash table for the batch's set.  The other sets' tables
+	 * are gone, but they're not looked at again until rescan.
+	 */
+	ReScanExprContext(aggstate->hashcontext);
+	build_hash_table_for_set(aggstate, batch->setno,
+							 (long) Min(batch->ntuples,
+										perhash->aggnode->numGroups));
+	aggstate->hash_ngroups_current = 0;
+	aggstate->hash_spill_mode = false;
+	aggstate->hash_used_bits = batch->used_bits;
+
+	for (setno = 0; setno < aggstate->num_hashes; setno++)
+		aggstate->hash_pergroup[setno] = NULL;
+
+	/* phase 0 advances just the hashed grouping sets */
+	Assert(aggstate->current_phase == 0);
+	select_current_set(aggstate, batch->setno, true);
+
+	while (hash_read_spilled_tuple(batch->file, &hash, slot) != NULL)
+	{
+		TupleHashEntryData *entry;
+
+		tmpcontext->ecxt_outertuple = slot;
+
+		entry = lookup_hash_entry(aggstate);
+		if (entry != NULL)
+		{
+			aggstate->hash_pergroup[batch->setno] = entry->additional;
+			advance_aggregates(aggstate);
+		}
+		else
+		{
+			if (perhash->spill_npartitions == 0)
+				hash_spill_init(aggstate, perhash, batch->ntuples);
+			hash_spill_tuple(aggstate, perhash, slot, hash);
+		}
+
+		ResetExprContext(tmpcontext);
+	}
+
+	BufFileClose(batch->file);
+	pfree(batch);
+
+	hash_spill_finish(aggstate);
+	aggstate->hash_batches_used++;
+
+	ResetTupleHashIterator(perhash->hashtable, &perhash->hashiter);
+
+	return true;
+}
+
 /*
  * ExecAgg for hashed case: retrieving groups from hash table
  */
@@ -1991,7 +2723,9 @@ agg_retrieve_hash_table(AggState *aggstate)
 		{
 			int			nextset = aggstate->current_set + 1;
 
-			if (nextset < aggstate->num_hashes)
+			/* when aggregating a spilled batch, there's just the one set */
+			if (aggstate->hash_batches_used == 0 &&
+				nextset < aggstate->num_hashes)
 			{
 				/*
 				 * Switch to next grouping set, reinitialize, and restart the
@@ -2005,9 +2739,15 @@ agg_retrieve_hash_table(AggState *aggstate)
 
 				continue;
 			}
+			else if (agg_refill_hash_table(aggstate))
+			{
+				/* Aggregated the next spilled batch, so return its groups */
+				perhash = &aggstate->perhash[aggstate->current_set];
+				continue;
+			}
 			else
 			{
-				/* No more hashtables, so done */
+				/* No more hashtables or batches, so done */
 				aggstate->agg_done = true;
 				return NULL;
 			}
@@ -2065,6 +2805,222 @@ agg_retrieve_hash_table(AggState *aggstate)
 	return NULL;
 }
 
+/*
+ * ExecAgg for Parallel HashAggregate: add this participant's input to the
+ * shared hash table, and wait until all the other participants have done the
+ * same
+ *
+ * The transitions of a group are advanced while holding the lock on its
+ * entry's dshash partition, which serializes the participants' updates to
+ * the group's transition states.  To keep that short, and free of anything
+ * that could wait or run user code, the aggregates' FILTER clauses and
+ * arguments are evaluated before the lock is taken; the planner has made sure
+ * that the transition functions themselves are harmless built-ins.
+ */
+static void
+agg_fill_shared_hash_table(AggState *aggstate)
+{
+	AggStateShared shared = aggstate->shared;
+	ParallelAggState *pstate = shared->pstate;
+	AggStatePerHash perhash = &aggstate->perhash[0];
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+	dsa_area   *area = aggstate->ss.ps.state->es_query_dsa;
+	Datum	   *keyvalues = (Datum *) shared->key;
+	bool	   *keynulls = (bool *) (shared->key +
+									 perhash->numhashGrpCols * sizeof(Datum));
+
+	Assert(shared->hashtable == NULL);
+
+	/* Attach to the shared hash table, or create it if we're first. */
+	LWLockAcquire(&pstate->lock, LW_EXCLUSIVE);
+	if (DsaPointerIsValid(pstate->hashtable))
+		shared->hashtable = dshash_attach(area, &shared->params,
+										  pstate->hashtable, NULL);
+	else
+	{
+		shared->hashtable = dshash_create(area, &shared->params, NULL);
+		pstate->hashtable = dshash_get_hash_table_handle(shared->hashtable);
+	}
+	LWLockRelease(&pstate->lock);
+
+	/*
+	 * If the others have already finished adding their input, then they have
+	 * read all of the (partial) input plan's output, and there's nothing left
+	 * for us to add.
+	 */
+	if (BarrierAttach(&pstate->barrier) == 0)
+	{
+		select_current_set(aggstate, 0, true);
+
+		for (;;)
+		{
+			TupleTableSlot *outerslot;
+			char	   *entry;
+			AggStatePerGroup pergroup;
+			bool		found;
+			int			transno;
+			int			i;
+
+			outerslot = fetch_input_tuple(aggstate);
+			if (TupIsNull(outerslot))
+				break;
+
+			/* set up for evaluating the aggregates' inputs */
+			tmpcontext->ecxt_outertuple = outerslot;
+
+			/* build the key, zeroing the values of any null columns */
+			slot_getsomeattrs(outerslot, perhash->largestGrpColIdx);
+			for (i = 0; i < perhash->numhashGrpCols; i++)
+			{
+				int			varNumber = perhash->hashGrpColIdxInput[i] - 1;
+
+				keynulls[i] = outerslot->tts_isnull[varNumber];
+				keyvalues[i] = keynulls[i] ? (Datum) 0 :
+					outerslot->tts_values[varNumber];
+			}
+
+			/*
+			 * Evaluate the FILTER clauses, and load the transition functions'
+			 * arguments into their fcinfos, in the per-tuple context.
+			 */
+			for (transno = 0; transno < aggstate->numtrans; transno++)
+			{
+				AggStatePerTrans pertrans = &aggstate->pertrans[transno];
+				FunctionCallInfo fcinfo = &pertrans->transfn_fcinfo;
+				ExprState  *filter = shared->transfilters[transno];
+				int			argno;
+
+				if (filter != NULL)
+				{
+					Datum		res;
+					bool		isnull;
+
+					res = ExecEvalExprSwitchContext(filter, tmpcontext,
+													&isnull);
+					shared->transskip[transno] = isnull || !DatumGetBool(res);
+					if (shared->transskip[transno])
+						continue;
+				}
+
+				for (argno = 0; argno < pertrans->numTransInputs; argno++)
+					fcinfo->arg[argno + 1] =
+						ExecEvalExprSwitchContext(shared->transargs[transno][argno],
+												  tmpcontext,
+												  &fcinfo->argnull[argno + 1]);
+			}
+
+			/* find or create the group's entry, and lock it */
+			entry = dshash_find_or_insert(shared->hashtable, shared->key,
+										  &found);
+			pergroup = (AggStatePerGroup) (entry + shared->pergroup_offset);
+
+			for (transno = 0; transno < aggstate->numtrans; transno++)
+			{
+				AggStatePerTrans pertrans = &aggstate->pertrans[transno];
+
+				if (!found)
+					initialize_aggregate(aggstate, pertrans,
+										 &pergroup[transno]);
+				if (!shared->transskip[transno])
+					advance_transition_function(aggstate, pertrans,
+												&pergroup[transno]);
+			}
+
+			dshash_release_lock(shared->hashtable, entry);
+
+			ResetExprContext(tmpcontext);
+		}
+
+		BarrierArriveAndWait(&pstate->barrier, WAIT_EVENT_HASHAGG_FILLING);
+	}
+	BarrierDetach(&pstate->barrier);
+
+	aggstate->table_filled = true;
+	shared->partition = -1;
+}
+
+/*
+ * ExecAgg for Parallel HashAggregate: return groups from the partitions of
+ * the shared hash table that this participant claims
+ */
+static TupleTableSlot *
+agg_retrieve_shared_hash_table(AggState *aggstate)
+{
+	AggStateShared shared = aggstate->shared;
+	AggStatePerHash perhash = &aggstate->perhash[0];
+	ExprContext *econtext = aggstate->ss.ps.ps_ExprContext;
+	AggStatePerAgg peragg = aggstate->peragg;
+	TupleTableSlot *firstSlot = aggstate->ss.ss_ScanTupleSlot;
+	TupleTableSlot *result;
+
+	while (!aggstate->agg_done)
+	{
+		char	   *entry = NULL;
+		Datum	   *keyvalues;
+		bool	   *keynulls;
+		int			i;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (shared->partition >= 0)
+			entry = dshash_partition_iterate_next(&shared->iter);
+
+		if (entry == NULL)
+		{
+			uint32		partition;
+
+			/* Claim the next partition nobody has returned yet, if any */
+			partition = pg_atomic_fetch_add_u32(&shared->pstate->next_partition,
+												1);
+			if (partition >= DSHASH_NUM_PARTITIONS)
+			{
+				shared->partition = -1;
+				aggstate->agg_done = true;
+				return NULL;
+			}
+			shared->partition = (int) partition;
+			dshash_partition_iterate_begin(shared->hashtable,
+										   shared->partition,
+										   &shared->iter);
+			continue;
+		}
+
+		/* Clear the per-output-tuple context for each group */
+		ResetExprContext(econtext);
+
+		/* Make a representative input tuple from the key */
+		keyvalues = (Datum *) entry;
+		keynulls = (bool *) (entry + perhash->numhashGrpCols * sizeof(Datum));
+
+		ExecClearTuple(firstSlot);
+		memset(firstSlot->tts_isnull, true,
+			   firstSlot->tts_tupleDescriptor->natts * sizeof(bool));
+
+		for (i = 0; i < perhash->numhashGrpCols; i++)
+		{
+			int			varNumber = perhash->hashGrpColIdxInput[i] - 1;
+
+			firstSlot->tts_values[varNumber] = keyvalues[i];
+			firstSlot->tts_isnull[varNumber] = keynulls[i];
+		}
+		ExecStoreVirtualTuple(firstSlot);
+
+		econtext->ecxt_outertuple = firstSlot;
+
+		prepare_projection_slot(aggstate, firstSlot, 0);
+
+		finalize_aggregates(aggstate, peragg,
+							(AggStatePerGroup) (entry + shared->pergroup_offset));
+
+		result = project_aggregates(aggstate);
+		if (result)
+			return result;
+	}
+
+	/* No more groups */
+	return NULL;
+}
+
 /* -----------------
  * ExecInitAgg
  *
@@ -2446,6 +3402,10 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		find_hash_columns(aggstate);
 		build_hash_table(aggstate);
 		aggstate->table_filled = false;
+
+		/* set up for spilling the hash tables to disk */
+		aggstate->hash_mem_limit = work_mem * 1024L;
+		aggstate->hash_spill_slot = ExecInitExtraTupleSlot(estate, scanDesc);
 	}
 
 	/*
@@ -2830,11 +3790,12 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		else if (aggstate->aggstrategy == AGG_MIXED && phaseidx == 0)
 		{
 			/*
-			 * No need to compute a transition function for an AGG_MIXED phase
-			 * 0 - the contents of the hashtables will have been computed
-			 * during phase 1.
+			 * The contents of the hashtables of an AGG_MIXED agg are computed
+			 * during phase 1; phase 0 only aggregates tuples that were
+			 * spilled to disk meanwhile.
 			 */
-			continue;
+			dohash = true;
+			dosort = false;
 		}
 		else if (phase->aggstrategy == AGG_PLAIN ||
 				 phase->aggstrategy == AGG_SORTED)
@@ -2854,6 +3815,11 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 
 	}
 
+	/*
+	 * Finally, see whether the input can be aggregated in batch mode.
+	 */
+	aggstate->batch = build_batch_state(aggstate);
+
 	return aggstate;
 }
 
@@ -3245,6 +4211,117 @@ find_compatible_peragg(Aggref *newagg, AggState *aggstate,
 	return -1;
 }
 
+/*
+ * build_batch_state - set up batch-mode execution, if possible
+ *
+ * Batch mode is used for plain aggregation (without grouping sets, ORDER BY
+ * or DISTINCT aggregates, or combine functions) directly over a sequential
+ * scan, if the scan's quals and all the aggregates' arguments and FILTER
+ * clauses can be evaluated in batch mode.  Returns NULL otherwise.
+ *
+ * The pertrans data must have been set up already.
+ */
+static AggStateBatch
+build_batch_state(AggState *aggstate)
+{
+	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
+	AggStateBatch batch;
+	BatchScanState *bscan;
+	int			transno;
+
+	if (executor_batch_size <= 0 ||
+		node->aggstrategy != AGG_PLAIN ||
+		node->groupingSets != NIL ||
+		DO_AGGSPLIT_COMBINE(aggstate->aggsplit))
+		return NULL;
+
+	/*
+	 * The representative input tuple isn't kept in batch mode, so there must
+	 * not be any references to input columns outside aggregates.  (Without
+	 * grouping, there aren't normally.)
+	 */
+	if (!bms_is_empty(find_unaggregated_cols(aggstate)))
+		return NULL;
+
+	bscan = ExecInitBatchScan(outerPlanState(aggstate), executor_batch_size);
+	if (bscan == NULL)
+		return NULL;
+
+	batch = (AggStateBatch) palloc0(sizeof(AggStateBatchData));
+	batch->scan = bscan;
+	batch->pertrans = (AggStatePerTransBatchData *)
+		palloc0(sizeof(AggStatePerTransBatchData) * Max(aggstate->numtrans, 1));
+	batch->sel = (int *) palloc(executor_batch_size * sizeof(int));
+
+	for (transno = 0; transno < aggstate->numtrans; transno++)
+	{
+		AggStatePerTrans pertrans = &aggstate->pertrans[transno];
+		AggStatePerTransBatchData *pertransbatch = &batch->pertrans[transno];
+		Aggref	   *aggref = pertrans->aggref;
+		PGFunction	transfn = pertrans->transfn.fn_addr;
+		ListCell   *lc;
+		int			argno = 0;
+
+		if (aggref->aggkind != AGGKIND_NORMAL || pertrans->numSortCols > 0)
+			return NULL;
+
+		Assert(pertrans->numTransInputs == list_length(aggref->args));
+		pertransbatch->args = (BatchExpr **)
+			palloc(sizeof(BatchExpr *) * Max(pertrans->numTransInputs, 1));
+		foreach(lc, aggref->args)
+		{
+			TargetEntry *tle = (TargetEntry *) lfirst(lc);
+
+			pertransbatch->args[argno] = ExecBuildBatchExpr(bscan, tle->expr);
+			if (pertransbatch->args[argno] == NULL)
+				return NULL;
+			argno++;
+		}
+
+		if (aggref->aggfilter)
+		{
+			pertransbatch->filter = ExecBuildBatchExpr(bscan,
+													   aggref->aggfilter);
+			if (pertransbatch->filter == NULL)
+				return NULL;
+		}
+
+		/*
+		 * Use an inline version of the transition function if there is one.
+		 * Those all work on pass-by-value states.
+		 */
+		pertransbatch->kind = AGG_BATCH_TRANS_GENERIC;
+		if (!pertrans->transtypeByVal)
+			continue;
+
+		if (transfn == int8inc && pertrans->numTransInputs == 0 &&
+			!pertrans->initValueIsNull)
+			pertransbatch->kind = AGG_BATCH_TRANS_COUNT_STAR;
+		else if (pertrans->numTransInputs != 1)
+			continue;
+		else if (transfn == int8inc_any && !pertrans->initValueIsNull)
+			pertransbatch->kind = AGG_BATCH_TRANS_COUNT;
+		else if (transfn == int4_sum)
+			pertransbatch->kind = AGG_BATCH_TRANS_INT4_SUM;
+		else if (transfn == float8pl)
+			pertransbatch->kind = AGG_BATCH_TRANS_FLOAT8_SUM;
+		else if (transfn == int4smaller || transfn == date_smaller)
+			pertransbatch->kind = AGG_BATCH_TRANS_INT4_MIN;
+		else if (transfn == int4larger || transfn == date_larger)
+			pertransbatch->kind = AGG_BATCH_TRANS_INT4_MAX;
+		else if (transfn == int8smaller || transfn == timestamp_smaller)
+			pertransbatch->kind = AGG_BATCH_TRANS_INT8_MIN;
+		else if (transfn == int8larger || transfn == timestamp_larger)
+			pertransbatch->kind = AGG_BATCH_TRANS_INT8_MAX;
+		else if (transfn == float8smaller)
+			pertransbatch->kind = AGG_BATCH_TRANS_FLOAT8_MIN;
+		else if (transfn == float8larger)
+			pertransbatch->kind = AGG_BATCH_TRANS_FLOAT8_MAX;
+	}
+
+	return batch;
+}
+
 /*
  * find_compatible_pertrans - search for a previously initialized per-Trans
  * struct
@@ -3330,6 +4407,10 @@ ExecEndAgg(AggState *node)
 		}
 	}
 
+	/* Release any hash table spill files */
+	if (node->hashcontext)
+		hash_spill_reset(node);
+
 	/* And ensure any agg shutdown callbacks have been called */
 	for (setno = 0; setno < numGroupingSets; setno++)
 		ReScanExprContext(node->aggcontexts[setno]);
@@ -3377,10 +4458,16 @@ ExecReScanAgg(AggState *node)
 		 * If we do have the hash table, and the subplan does not have any
 		 * parameter changes, and none of our own parameter changes affect
 		 * input expressions of the aggregated functions, then we can just
-		 * rescan the existing hash table; no need to build it again.
+		 * rescan the existing hash table; no need to build it again.  That
+		 * doesn't work if the hash table had to be spilled to disk, since
+		 * it then doesn't hold all the groups, nor for a shared hash table,
+		 * which is freed by ExecAggReInitializeDSM.
 		 */
 		if (outerPlan->chgParam == NULL &&
-			!bms_overlap(node->ss.ps.chgParam, aggnode->aggParams))
+			!bms_overlap(node->ss.ps.chgParam, aggnode->aggParams) &&
+			node->hash_spill_batches == NIL &&
+			node->hash_batches_used == 0 &&
+			node->shared == NULL)
 		{
 			ResetTupleHashIterator(node->perhash[0].hashtable,
 								   &node->perhash[0].hashiter);
@@ -3436,6 +4523,7 @@ ExecReScanAgg(AggState *node)
 	 */
 	if (node->aggstrategy == AGG_HASHED || node->aggstrategy == AGG_MIXED)
 	{
+		hash_spill_reset(node);
 		ReScanExprContext(node->hashcontext);
 		/* Rebuild an empty hash table */
 		build_hash_table(node);
@@ -3466,6 +4554,193 @@ ExecReScanAgg(AggState *node)
 }
 
 
+/* ----------------------------------------------------------------
+ *						Parallel Query Support
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Set up this backend's state for running a Parallel HashAggregate with the
+ * given shared state.
+ */
+static void
+shared_hash_table_setup(AggState *aggstate, ParallelAggState *pstate)
+{
+	AggStatePerHash perhash = &aggstate->perhash[0];
+	TupleDesc	hashDesc PG_USED_FOR_ASSERTS_ONLY =
+		perhash->hashslot->tts_tupleDescriptor;
+	AggStateShared shared;
+	Size		key_size;
+	int			transno;
+	int			i PG_USED_FOR_ASSERTS_ONLY;
+
+	/*
+	 * The planner only chooses a Parallel HashAggregate when all of this
+	 * holds, and when all the transition functions are safe to call while
+	 * holding an LWLock; see can_parallel_hash_agg().
+	 */
+	Assert(aggstate->aggstrategy == AGG_HASHED);
+	Assert(aggstate->num_hashes == 1);
+	Assert(aggstate->aggsplit == AGGSPLIT_SIMPLE);
+#ifdef USE_ASSERT_CHECKING
+	for (i = 0; i < perhash->numhashGrpCols; i++)
+		Assert(TupleDescAttr(hashDesc, i)->attbyval);
+	for (transno = 0; transno < aggstate->numtrans; transno++)
+	{
+		AggStatePerTrans pertrans = &aggstate->pertrans[transno];
+
+		Assert(pertrans->transtypeByVal);
+		Assert(pertrans->aggtranstype != INTERNALOID);
+		Assert(pertrans->numSortCols == 0);
+	}
+#endif
+
+	shared = (AggStateShared) palloc0(sizeof(AggStateSharedData));
+	shared->pstate = pstate;
+
+	/* an entry is the key, followed by the group's transition states */
+	key_size = perhash->numhashGrpCols * (sizeof(Datum) + sizeof(bool));
+	shared->pergroup_offset = MAXALIGN(key_size);
+	shared->params.key_size = key_size;
+	shared->params.entry_size = shared->pergroup_offset +
+		aggstate->numtrans * sizeof(AggStatePerGroupData);
+	shared->params.compare_function = dshash_memcmp;
+	shared->params.hash_function = dshash_memhash;
+	shared->params.tranche_id = LWTRANCHE_PARALLEL_HASH_AGG;
+
+	/* zeroed, so that any padding is too */
+	shared->key = palloc0(key_size);
+	shared->partition = -1;
+
+	/* expressions for evaluating the aggregates' inputs outside the lock */
+	shared->transfilters = (ExprState **)
+		palloc0(sizeof(ExprState *) * aggstate->numtrans);
+	shared->transargs = (ExprState ***)
+		palloc0(sizeof(ExprState **) * aggstate->numtrans);
+	shared->transskip = (bool *) palloc0(sizeof(bool) * aggstate->numtrans);
+	for (transno = 0; transno < aggstate->numtrans; transno++)
+	{
+		AggStatePerTrans pertrans = &aggstate->pertrans[transno];
+		Aggref	   *aggref = pertrans->aggref;
+		ListCell   *arg;
+		int			argno = 0;
+
+		if (aggref->aggfilter)
+			shared->transfilters[transno] =
+				ExecInitExpr(aggref->aggfilter, &aggstate->ss.ps);
+
+		Assert(list_length(aggref->args) == pertrans->numTransInputs);
+		shared->transargs[transno] = (ExprState **)
+			palloc(sizeof(ExprState *) * Max(pertrans->numTransInputs, 1));
+		foreach(arg, aggref->args)
+		{
+			TargetEntry *tle = lfirst_node(TargetEntry, arg);
+
+			shared->transargs[transno][argno++] =
+				ExecInitExpr(tle->expr, &aggstate->ss.ps);
+		}
+	}
+
+	aggstate->shared = shared;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAggEstimate
+ *
+ *		Estimate space required for the shared state of a Parallel
+ *		HashAggregate.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAggEstimate(AggState *node, ParallelContext *pcxt)
+{
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelAggState));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAggInitializeDSM
+ *
+ *		Set up the shared state of a Parallel HashAggregate.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAggInitializeDSM(AggState *node, ParallelContext *pcxt)
+{
+	int			plan_node_id = node->ss.ps.plan->plan_node_id;
+	ParallelAggState *pstate;
+
+	/*
+	 * Without a real DSM segment there is no DSA area for the shared hash
+	 * table, but then there are no workers either, so just aggregate
+	 * locally.
+	 */
+	if (pcxt->seg == NULL)
+		return;
+
+	pstate = shm_toc_allocate(pcxt->toc, sizeof(ParallelAggState));
+	shm_toc_insert(pcxt->toc, plan_node_id, pstate);
+
+	LWLockInitialize(&pstate->lock, LWTRANCHE_PARALLEL_HASH_AGG);
+	pstate->hashtable = InvalidDsaPointer;
+	BarrierInit(&pstate->barrier, 0);
+	pg_atomic_init_u32(&pstate->next_partition, 0);
+
+	shared_hash_table_setup(node, pstate);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAggReInitializeDSM
+ *
+ *		Reset shared state before beginning a fresh scan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAggReInitializeDSM(AggState *node, ParallelContext *pcxt)
+{
+	AggStateShared shared = node->shared;
+	ParallelAggState *pstate;
+
+	if (shared == NULL)
+		return;
+	pstate = shared->pstate;
+
+	/*
+	 * The workers of the previous scan are gone, so nobody else can be using
+	 * its hash table any more.  Free it, attaching to it first if only the
+	 * workers did.
+	 */
+	if (DsaPointerIsValid(pstate->hashtable))
+	{
+		if (shared->hashtable == NULL)
+			shared->hashtable = dshash_attach(node->ss.ps.state->es_query_dsa,
+											  &shared->params,
+											  pstate->hashtable, NULL);
+		dshash_destroy(shared->hashtable);
+		pstate->hashtable = InvalidDsaPointer;
+	}
+	shared->hashtable = NULL;
+
+	BarrierInit(&pstate->barrier, 0);
+	pg_atomic_write_u32(&pstate->next_partition, 0);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAggInitializeWorker
+ *
+ *		Attach to the shared state of a Parallel HashAggregate.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAggInitializeWorker(AggState *node, ParallelWorkerContext *pwcxt)
+{
+	ParallelAggState *pstate;
+
+	pstate = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, false);
+	shared_hash_table_setup(node, pstate);
+}
+
+
 /***********************************************************************
  * API exposed to aggregate functions
  ***********************************************************************/
@@ -228,8 +228,13 @@ ExecGatherMerge(PlanState *pstate)
 			}
 		}
 
-		/* allow leader to participate if enabled or no choice */
-		if (parallel_leader_participation || node->nreaders == 0)
+		/*
+		 * allow leader to participate if enabled or no choice; below a
+		 * parallel-aware Sort, all the output comes from the leader
+		 */
+		if (parallel_leader_participation || node->nreaders == 0 ||
+			(IsA(outerPlan(node->ps.plan), Sort) &&
+			 outerPlan(node->ps.plan)->parallel_aware))
 			node->need_to_scan_locally = true;
 		node->initialized = true;
 	}
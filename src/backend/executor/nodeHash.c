@@ -42,6 +42,12 @@
 #include "utils/lsyscache.h"
 #include "utils/syscache.h"
 
+/*
+ * A runtime filter with a larger fraction of its bits set than this rejects
+ * too few tuples to be worth testing.
+ */
+#define RUNTIME_FILTER_MAX_FILL		0.75
+
 
 static void ExecHashIncreaseNumBatches(HashJoinTable hashtable);
 static void ExecHashIncreaseNumBuckets(HashJoinTable hashtable);
@@ -60,6 +66,7 @@ static HashJoinTuple ExecParallelHashTupleAlloc(HashJoinTable hashtable,
 						   size_t size,
 						   dsa_pointer *shared);
 static void MultiExecPrivateHash(HashState *node);
+static void publish_runtime_filter(HashState *node, bloom_filter *filter);
 static void MultiExecParallelHash(HashState *node);
 static inline HashJoinTuple ExecParallelHashFirstTuple(HashJoinTable table,
 						   int bucketno);
@@ -137,12 +144,14 @@ MultiExecHash(HashState *node)
 static void
 MultiExecPrivateHash(HashState *node)
 {
+	Hash	   *plan = (Hash *) node->ps.plan;
 	PlanState  *outerNode;
 	List	   *hashkeys;
 	HashJoinTable hashtable;
 	TupleTableSlot *slot;
 	ExprContext *econtext;
 	uint32		hashvalue;
+	bloom_filter *filter = NULL;
 
 	/*
 	 * get state info from node
@@ -156,6 +165,14 @@ MultiExecPrivateHash(HashState *node)
 	hashkeys = node->hashkeys;
 	econtext = node->ps.ps_ExprContext;
 
+	/*
+	 * If a runtime filter was pushed down into the outer side, build it from
+	 * the hash values of the inner tuples.
+	 */
+	if (plan->filterParam >= 0)
+		filter = bloom_create((int64) Max(plan->plan.plan_rows, 1.0),
+							  work_mem, 0);
+
 	/*
 	 * get all inner tuples and insert into the hash table (or temp files)
 	 */
@@ -172,6 +189,10 @@ MultiExecPrivateHash(HashState *node)
 		{
 			int			bucketNumber;
 
+			if (filter != NULL)
+				bloom_add_element(filter, (unsigned char *) &hashvalue,
+								  sizeof(hashvalue));
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -199,6 +220,50 @@ MultiExecPrivateHash(HashState *node)
 		hashtable->spacePeak = hashtable->spaceUsed;
 
 	hashtable->partialTuples = hashtable->totalTuples;
+
+	if (filter != NULL)
+	{
+		publish_runtime_filter(node, filter);
+		bloom_free(filter);
+	}
+}
+
+/*
+ * Pass a copy of the runtime filter built along with the hash table to the
+ * scan it was pushed down into, by setting the Param the planner assigned.
+ */
+static void
+publish_runtime_filter(HashState *node, bloom_filter *filter)
+{
+	EState	   *estate = node->ps.state;
+	ParamExecData *prm;
+	Size		size;
+	char	   *value;
+
+	prm = &(estate->es_param_exec_vals[((Hash *) node->ps.plan)->filterParam]);
+
+	/* Forget the filter of an earlier scan */
+	if (!prm->isnull)
+		pfree(DatumGetPointer(prm->value));
+	prm->value = (Datum) 0;
+	prm->isnull = true;
+
+	/*
+	 * If there were many more inner tuples than expected, the filter would
+	 * hardly reject anything.  Leaving the Param null tells the scan not to
+	 * bother.
+	 */
+	if (bloom_prop_bits_set(filter) > RUNTIME_FILTER_MAX_FILL)
+		return;
+
+	size = bloom_total_size(filter);
+	value = MemoryContextAllocZero(estate->es_query_cxt,
+								   RUNTIME_FILTER_OFFSET + size);
+	SET_VARSIZE(value, RUNTIME_FILTER_OFFSET + size);
+	memcpy(value + RUNTIME_FILTER_OFFSET, filter, size);
+
+	prm->value = PointerGetDatum(value);
+	prm->isnull = false;
 }
 
 /* ----------------------------------------------------------------
@@ -366,6 +431,15 @@ ExecInitHash(Hash *node, EState *estate, int eflags)
 	hashstate->hashtable = NULL;
 	hashstate->hashkeys = NIL;	/* will be set by parent HashJoin */
 
+	/* There is no runtime filter until the hash table has been built */
+	if (node->filterParam >= 0)
+	{
+		ParamExecData *prm = &(estate->es_param_exec_vals[node->filterParam]);
+
+		prm->value = (Datum) 0;
+		prm->isnull = true;
+	}
+
 	/*
 	 * Miscellaneous initialization
 	 *
@@ -1699,6 +1773,7 @@ retry:
 		/* Store the hash value in the HashJoinTuple header. */
 		hashTuple->hashvalue = hashvalue;
 		memcpy(HJTUPLE_MINTUPLE(hashTuple), tuple, tuple->t_len);
+		HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
 
 		/* Push it onto the front of the bucket's list */
 		ExecParallelHashPushTuple(&hashtable->buckets.shared[bucketno],
@@ -2031,6 +2106,66 @@ ExecPrepHashTableForUnmatched(HashJoinState *hjstate)
 	hjstate->hj_CurTuple = NULL;
 }
 
+/*
+ * ExecParallelPrepHashTableForUnmatched
+ *		set up for a series of ExecParallelScanHashTableForUnmatched calls
+ *
+ * Returns false if the caller isn't the one to do the scan, in which case
+ * it has been detached from the current batch.
+ */
+bool
+ExecParallelPrepHashTableForUnmatched(HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	int			curbatch = hashtable->curbatch;
+	ParallelHashJoinBatch *batch = hashtable->batches[curbatch].shared;
+
+	Assert(BarrierPhase(&batch->batch_barrier) == PHJ_BATCH_PROBING);
+
+	/*
+	 * The unmatched tuples can't be found until every participant has
+	 * finished probing, but it wouldn't be deadlock-free to wait for that,
+	 * since participants attached to the batch have been emitting tuples.
+	 * So instead of waiting, all but the last participant to get here
+	 * detach, and the last one goes on to scan the batch alone.  The others
+	 * are free to help with other batches meanwhile.
+	 */
+	if (!BarrierArriveAndDetachExceptLast(&batch->batch_barrier))
+	{
+		/* Make sure any temporary files are closed. */
+		sts_end_parallel_scan(hashtable->batches[curbatch].inner_tuples);
+		sts_end_parallel_scan(hashtable->batches[curbatch].outer_tuples);
+
+		/* As in ExecHashTableDetachBatch() */
+		hashtable->spacePeak =
+			Max(hashtable->spacePeak,
+				batch->size + sizeof(dsa_pointer_atomic) * hashtable->nbuckets);
+
+		hashtable->batches[curbatch].done = true;
+		hashtable->curbatch = -1;
+		return false;
+	}
+
+	/* Now we are alone with this batch. */
+	Assert(BarrierPhase(&batch->batch_barrier) == PHJ_BATCH_SCANNING);
+
+	/*
+	 * If some participant stopped probing before it ran out of outer tuples,
+	 * the match bits are incomplete, so no scan can be done.
+	 */
+	if (batch->skip_unmatched)
+	{
+		hashtable->batches[curbatch].done = true;
+		ExecHashTableDetachBatch(hashtable);
+		return false;
+	}
+
+	/* From here on it's just like the non-parallel case. */
+	ExecPrepHashTableForUnmatched(hjstate);
+
+	return true;
+}
+
 /*
  * ExecScanHashTableForUnmatched
  *		scan the hash table for unmatched inner tuples
@@ -2135,6 +2270,68 @@ ExecHashTableReset(HashJoinTable hashtable)
 	hashtable->chunks = NULL;
 }
 
+/*
+ * ExecParallelScanHashTableForUnmatched
+ *		scan the current batch's shared hash table for unmatched inner tuples
+ *
+ * Works like ExecScanHashTableForUnmatched, for the one participant that
+ * ExecParallelPrepHashTableForUnmatched picked.  There are no skew buckets
+ * in a shared hash table.
+ */
+bool
+ExecParallelScanHashTableForUnmatched(HashJoinState *hjstate,
+									  ExprContext *econtext)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	HashJoinTuple hashTuple = hjstate->hj_CurTuple;
+
+	for (;;)
+	{
+		/*
+		 * hj_CurTuple is the address of the tuple last returned from the
+		 * current bucket, or NULL if it's time to start scanning a new
+		 * bucket.
+		 */
+		if (hashTuple != NULL)
+			hashTuple = ExecParallelHashNextTuple(hashtable, hashTuple);
+		else if (hjstate->hj_CurBucketNo < hashtable->nbuckets)
+			hashTuple = ExecParallelHashFirstTuple(hashtable,
+												   hjstate->hj_CurBucketNo++);
+		else
+			break;				/* finished all buckets */
+
+		while (hashTuple != NULL)
+		{
+			if (!HeapTupleHeaderHasMatch(HJTUPLE_MINTUPLE(hashTuple)))
+			{
+				TupleTableSlot *inntuple;
+
+				/* insert hashtable's tuple into exec slot */
+				inntuple = ExecStoreMinimalTuple(HJTUPLE_MINTUPLE(hashTuple),
+												 hjstate->hj_HashTupleSlot,
+												 false);	/* do not pfree */
+				econtext->ecxt_innertuple = inntuple;
+
+				/* Reset temp memory each time, as in the serial version */
+				ResetExprContext(econtext);
+
+				hjstate->hj_CurTuple = hashTuple;
+				return true;
+			}
+
+			hashTuple = ExecParallelHashNextTuple(hashtable, hashTuple);
+		}
+
+		/* allow this loop to be cancellable */
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	/*
+	 * no more unmatched tuples
+	 */
+	return false;
+}
+
 /*
  * ExecHashTableResetMatchFlags
  *		Clear all the HeapTupleHeaderHasMatch flags in the table
@@ -3060,13 +3257,33 @@ ExecHashTableDetachBatch(HashJoinTable hashtable)
 	{
 		int			curbatch = hashtable->curbatch;
 		ParallelHashJoinBatch *batch = hashtable->batches[curbatch].shared;
+		bool		attached = true;
 
 		/* Make sure any temporary files are closed. */
 		sts_end_parallel_scan(hashtable->batches[curbatch].inner_tuples);
 		sts_end_parallel_scan(hashtable->batches[curbatch].outer_tuples);
 
+		if (BarrierPhase(&batch->batch_barrier) == PHJ_BATCH_PROBING)
+		{
+			/*
+			 * If we're leaving before having probed with all of our outer
+			 * tuples, the plan above doesn't want any more tuples, so the
+			 * match bits will never be complete.  Make sure no one scans for
+			 * unmatched tuples in that case.  The flag is only read after
+			 * PHJ_BATCH_PROBING is over, so it needs no locking.
+			 */
+			if (!hashtable->batches[curbatch].outer_eof)
+				batch->skip_unmatched = true;
+
+			/*
+			 * Step through PHJ_BATCH_SCANNING even if there is nothing to
+			 * scan, so that the hash table is always freed in PHJ_BATCH_DONE.
+			 */
+			attached = BarrierArriveAndDetachExceptLast(&batch->batch_barrier);
+		}
+
 		/* Detach from the batch we were last working on. */
-		if (BarrierArriveAndDetach(&batch->batch_barrier))
+		if (attached && BarrierArriveAndDetach(&batch->batch_barrier))
 		{
 			/*
 			 * Technically we shouldn't access the barrier because we're no
@@ -82,12 +82,21 @@
  *  PHJ_BATCH_ALLOCATING     -- one allocates buckets
  *  PHJ_BATCH_LOADING        -- all load the hash table from disk
  *  PHJ_BATCH_PROBING        -- all probe
+ *  PHJ_BATCH_SCANNING       -- one scans for unmatched inner tuples
  *  PHJ_BATCH_DONE           -- end
  *
  * Batch 0 is a special case, because it starts out in phase
  * PHJ_BATCH_PROBING; populating batch 0's hash table is done during
  * PHJ_BUILD_HASHING_INNER so we can skip loading.
  *
+ * Right and full joins need to emit the inner tuples that found no match,
+ * which can only be done once every participant has finished probing.
+ * Participants that have been emitting tuples can't wait for that, so
+ * instead the last participant to finish probing a batch moves it on to
+ * PHJ_BATCH_SCANNING and does the scan alone, while the others detach and
+ * go on to other batches.  Other joins pass through PHJ_BATCH_SCANNING
+ * without doing anything there.
+ *
  * Initially we try to plan for a single-batch hash join using the combined
  * work_mem of all participants to create a large shared hash table.  If that
  * turns out either at planning or execution time to be impossible then we
@@ -133,12 +142,28 @@
 /* Returns true if doing null-fill on inner relation */
 #define HJ_FILL_INNER(hjstate)	((hjstate)->hj_NullOuterTupleSlot != NULL)
 
+/*
+ * Outer tuples are read ahead in groups of this many, so that the hash
+ * buckets they probe can be prefetched; see ExecHashJoinNextOuter.  That is
+ * only done if the hash table has at least HJ_PREFETCH_MIN_BUCKETS buckets,
+ * as smaller tables are likely to stay in CPU caches anyway.
+ *
+ * Both values come from timing a standalone model of the probe loop, not
+ * the executor itself, and may want tuning against real joins.
+ */
+#define HJ_PREFETCH_TUPLES		16
+#define HJ_PREFETCH_MIN_BUCKETS	65536
+
 static TupleTableSlot *ExecHashJoinOuterGetTuple(PlanState *outerNode,
 						  HashJoinState *hjstate,
 						  uint32 *hashvalue);
 static TupleTableSlot *ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
 								  HashJoinState *hjstate,
 								  uint32 *hashvalue);
+static pg_attribute_always_inline TupleTableSlot *ExecHashJoinNextOuter(PlanState *outerNode,
+					  HashJoinState *hjstate,
+					  uint32 *hashvalue,
+					  bool parallel);
 static TupleTableSlot *ExecHashJoinGetSavedTuple(HashJoinState *hjstate,
 						  BufFile *file,
 						  uint32 *hashvalue,
@@ -255,6 +280,15 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 					 */
 					node->hj_FirstOuterTupleSlot = NULL;
 				}
+				else if (((Hash *) hashNode->ps.plan)->filterParam >= 0)
+				{
+					/*
+					 * A scan on the outer side is to be given a runtime
+					 * filter built along with the hash table, so it mustn't
+					 * be started before that.
+					 */
+					node->hj_FirstOuterTupleSlot = NULL;
+				}
 				else if (HJ_FILL_OUTER(node) ||
 						 (outerNode->plan->startup_cost < hashNode->ps.plan->total_cost &&
 						  !node->hj_OuterNotEmpty))
@@ -346,18 +380,28 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				/*
 				 * We don't have an outer tuple, try to get the next one
 				 */
-				if (parallel)
-					outerTupleSlot =
-						ExecParallelHashJoinOuterGetTuple(outerNode, node,
-														  &hashvalue);
-				else
-					outerTupleSlot =
-						ExecHashJoinOuterGetTuple(outerNode, node, &hashvalue);
+				outerTupleSlot = ExecHashJoinNextOuter(outerNode, node,
+													   &hashvalue, parallel);
 
 				if (TupIsNull(outerTupleSlot))
 				{
 					/* end of batch, or maybe whole join */
-					if (HJ_FILL_INNER(node))
+					if (parallel)
+					{
+						/* remember we probed with all our outer tuples */
+						hashtable->batches[hashtable->curbatch].outer_eof = true;
+
+						/*
+						 * Only one participant scans for unmatched inner
+						 * tuples; the others are detached from the batch.
+						 */
+						if (HJ_FILL_INNER(node) &&
+							ExecParallelPrepHashTableForUnmatched(node))
+							node->hj_JoinState = HJ_FILL_INNER_TUPLES;
+						else
+							node->hj_JoinState = HJ_NEED_NEW_BATCH;
+					}
+					else if (HJ_FILL_INNER(node))
 					{
 						/* set up to scan for unmatched inner tuples */
 						ExecPrepHashTableForUnmatched(node);
@@ -447,6 +491,13 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				if (joinqual == NULL || ExecQual(joinqual, econtext))
 				{
 					node->hj_MatchedOuter = true;
+
+					/*
+					 * With Parallel Hash, other participants may be setting
+					 * this flag on the same tuple concurrently, but as the
+					 * flag word isn't otherwise modified while probing, they
+					 * can only ever store the same value.
+					 */
 					HeapTupleHeaderSetMatch(HJTUPLE_MINTUPLE(node->hj_CurTuple));
 
 					/* In an antijoin, we never return a matched tuple */
@@ -505,7 +556,9 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				 * so any unmatched inner tuples in the hashtable have to be
 				 * emitted before we continue to the next batch.
 				 */
-				if (!ExecScanHashTableForUnmatched(node, econtext))
+				if (parallel ?
+					!ExecParallelScanHashTableForUnmatched(node, econtext) :
+					!ExecScanHashTableForUnmatched(node, econtext))
 				{
 					/* no more unmatched tuples */
 					node->hj_JoinState = HJ_NEED_NEW_BATCH;
@@ -598,6 +651,7 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	List	   *hoperators;
 	TupleDesc	outerDesc, innerDesc;
 	ListCell   *l;
+	int			i;
 
 	/* check for unsupported flags */
 	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
@@ -649,6 +703,17 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	 * tuple table initialization
 	 */
 	hjstate->hj_OuterTupleSlot = ExecInitExtraTupleSlot(estate, outerDesc);
+	hjstate->hj_OuterQueue = (TupleTableSlot **)
+		palloc(HJ_PREFETCH_TUPLES * sizeof(TupleTableSlot *));
+	for (i = 0; i < HJ_PREFETCH_TUPLES; i++)
+		hjstate->hj_OuterQueue[i] = ExecInitExtraTupleSlot(estate, outerDesc);
+	hjstate->hj_OuterQueueHash = (uint32 *)
+		palloc(HJ_PREFETCH_TUPLES * sizeof(uint32));
+	hjstate->hj_OuterQueueBucket = (int *)
+		palloc(HJ_PREFETCH_TUPLES * sizeof(int));
+	hjstate->hj_OuterQueueCount = 0;
+	hjstate->hj_OuterQueueNext = 0;
+	hjstate->hj_OuterQueueDone = false;
 
 	/*
 	 * detect whether we need only consider the first matching inner tuple
@@ -930,6 +995,145 @@ ExecParallelHashJoinOuterGetTuple(PlanState *outerNode,
 	return NULL;
 }
 
+/*
+ * ExecHashJoinNextOuter
+ *
+ *		get the next outer tuple to probe the hash table with.
+ *
+ * Once the hash table is too big to stay in CPU caches, probing it costs a
+ * cache miss on the bucket header and another on the first tuple in the
+ * bucket, and the CPU can do little else meanwhile, since which bucket the
+ * next probe goes to isn't known until the current one is done.  So for a
+ * big table we read HJ_PREFETCH_TUPLES outer tuples ahead, prefetching the
+ * bucket header of each as it is hashed.  Then, as the buffered tuples are
+ * returned one by one, the first tuple in the bucket of the next one is
+ * prefetched too, by which time its bucket header should be in cache.
+ *
+ * Read-ahead tuples have to be kept in slots of their own, because the outer
+ * plan and the batch files reuse their slots for the next tuple.  A tuple
+ * read back from a serial batch file is palloc'd for the slot it's stored
+ * in, so we just trade hj_OuterTupleSlot for a queue slot then.  Others are
+ * copied, as minimal tuples like those in the batch files.
+ *
+ * Like the functions it calls, this returns a null slot at the end of the
+ * current batch.
+ */
+static pg_attribute_always_inline TupleTableSlot *
+ExecHashJoinNextOuter(PlanState *outerNode,
+					  HashJoinState *hjstate,
+					  uint32 *hashvalue,
+					  bool parallel)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	int			next;
+
+	if (hjstate->hj_OuterQueueNext >= hjstate->hj_OuterQueueCount)
+	{
+		hjstate->hj_OuterQueueCount = 0;
+		hjstate->hj_OuterQueueNext = 0;
+
+		/*
+		 * If read-ahead already hit the end of the batch, report that now
+		 * rather than asking for more tuples; the outer plan might not like
+		 * being run again after returning its last tuple.
+		 */
+		if (hjstate->hj_OuterQueueDone)
+		{
+			hjstate->hj_OuterQueueDone = false;
+			return NULL;
+		}
+
+		if (hashtable->nbuckets < HJ_PREFETCH_MIN_BUCKETS)
+		{
+			if (parallel)
+				return ExecParallelHashJoinOuterGetTuple(outerNode, hjstate,
+														 hashvalue);
+			else
+				return ExecHashJoinOuterGetTuple(outerNode, hjstate,
+												 hashvalue);
+		}
+
+		while (hjstate->hj_OuterQueueCount < HJ_PREFETCH_TUPLES)
+		{
+			TupleTableSlot *slot;
+			uint32		hv;
+			int			bucketno;
+			int			batchno;
+			int			n = hjstate->hj_OuterQueueCount;
+
+			if (parallel)
+				slot = ExecParallelHashJoinOuterGetTuple(outerNode, hjstate,
+														 &hv);
+			else
+				slot = ExecHashJoinOuterGetTuple(outerNode, hjstate, &hv);
+
+			if (TupIsNull(slot))
+			{
+				hjstate->hj_OuterQueueDone = true;
+				break;
+			}
+
+			if (slot == hjstate->hj_OuterTupleSlot && slot->tts_shouldFreeMin)
+			{
+				hjstate->hj_OuterTupleSlot = hjstate->hj_OuterQueue[n];
+				hjstate->hj_OuterQueue[n] = slot;
+			}
+			else
+				ExecStoreMinimalTuple(ExecCopySlotMinimalTuple(slot),
+									  hjstate->hj_OuterQueue[n],
+									  true);
+			hjstate->hj_OuterQueueHash[n] = hv;
+
+			/*
+			 * Tuples for later batches or for skew buckets aren't going to
+			 * be looked up in the main table now, so don't prefetch for them.
+			 */
+			ExecHashGetBucketAndBatch(hashtable, hv, &bucketno, &batchno);
+			if (batchno == hashtable->curbatch &&
+				ExecHashGetSkewBucket(hashtable, hv) == INVALID_SKEW_BUCKET_NO)
+			{
+				if (parallel)
+					pg_prefetch_mem(&hashtable->buckets.shared[bucketno]);
+				else
+					pg_prefetch_mem(&hashtable->buckets.unshared[bucketno]);
+			}
+			else
+				bucketno = -1;
+			hjstate->hj_OuterQueueBucket[n] = bucketno;
+
+			hjstate->hj_OuterQueueCount++;
+		}
+
+		if (hjstate->hj_OuterQueueCount == 0)
+		{
+			hjstate->hj_OuterQueueDone = false;
+			return NULL;
+		}
+	}
+
+	/* Prefetch the first inner tuple that the following probe will visit */
+	next = hjstate->hj_OuterQueueNext + 1;
+	if (next < hjstate->hj_OuterQueueCount &&
+		hjstate->hj_OuterQueueBucket[next] >= 0)
+	{
+		int			bucketno = hjstate->hj_OuterQueueBucket[next];
+
+		if (parallel)
+		{
+			dsa_pointer p;
+
+			p = dsa_pointer_atomic_read(&hashtable->buckets.shared[bucketno]);
+			if (DsaPointerIsValid(p))
+				pg_prefetch_mem(dsa_get_address(hashtable->area, p));
+		}
+		else
+			pg_prefetch_mem(hashtable->buckets.unshared[bucketno]);
+	}
+
+	*hashvalue = hjstate->hj_OuterQueueHash[hjstate->hj_OuterQueueNext];
+	return hjstate->hj_OuterQueue[hjstate->hj_OuterQueueNext++];
+}
+
 /*
  * ExecHashJoinNewBatch
  *		switch to a new hashjoin batch
@@ -1173,6 +1377,20 @@ ExecParallelHashJoinNewBatch(HashJoinState *hjstate)
 					sts_begin_parallel_scan(hashtable->batches[batchno].outer_tuples);
 					return true;
 
+				case PHJ_BATCH_SCANNING:
+
+					/*
+					 * Another participant is scanning for unmatched tuples,
+					 * and there's nothing left to help with.  Detach and go
+					 * around again.  We might turn out to be the last to
+					 * detach, if the scan just finished, so we have to let
+					 * ExecHashTableDetachBatch() free the hash table then.
+					 */
+					ExecParallelHashTableSetCurrentBatch(hashtable, batchno);
+					hashtable->batches[batchno].done = true;
+					ExecHashTableDetachBatch(hashtable);
+					break;
+
 				case PHJ_BATCH_DONE:
 
 					/*
@@ -1349,6 +1567,11 @@ ExecReScanHashJoin(HashJoinState *node)
 	node->hj_MatchedOuter = false;
 	node->hj_FirstOuterTupleSlot = NULL;
 
+	/* Forget any outer tuples read ahead */
+	node->hj_OuterQueueCount = 0;
+	node->hj_OuterQueueNext = 0;
+	node->hj_OuterQueueDone = false;
+
 	/*
 	 * if chgParam of subnode is not null then plan will be re-scanned by
 	 * first ExecProcNode.
@@ -0,0 +1,354 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeIncrementalSort.c
+ *	  Routines to handle incremental sorting of relations.
+ *
+ * Incremental sort is used when the input is already sorted by a prefix of
+ * the required sort keys.  Rather than reading and sorting the whole input
+ * at once, as Sort does, the input is split into batches that begin and end
+ * at changes in the values of the presorted columns, and each batch is
+ * sorted separately by the full set of keys.  Concatenating the sorted
+ * batches gives the same result as sorting everything, but the first tuples
+ * come out much sooner, and only one batch at a time needs to be held.
+ * That is especially useful under a LIMIT.
+ *
+ * Tuples having the same values in the presorted columns make up a group.
+ * Sorting each group separately would be costly if groups are small, so a
+ * batch consists of at least INCRSORT_MIN_BATCH_SIZE tuples, plus the rest
+ * of the group that the last of those belongs to.  To find where that group ends,
+ * that tuple is saved as the "pivot", and the following tuples are compared
+ * to it.  The first tuple that differs begins the next batch.
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeIncrementalSort.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "executor/execdebug.h"
+#include "executor/nodeIncrementalSort.h"
+#include "miscadmin.h"
+#include "utils/lsyscache.h"
+#include "utils/tuplesort.h"
+
+/*
+ * Read the next batch of tuples from the outer plan and sort it.
+ */
+static void
+incremental_sort_batch(IncrementalSortState *node)
+{
+	IncrementalSort *plannode = (IncrementalSort *) node->ss.ps.plan;
+	PlanState  *outerNode = outerPlanState(node);
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	Tuplesortstate *tuplesortstate;
+	TupleTableSlot *slot;
+	int64		ntuples = 0;
+
+	SO1_printf("ExecIncrementalSort: %s\n",
+			   "calling tuplesort_begin");
+
+	tuplesortstate = tuplesort_begin_heap(ExecGetResultType(outerNode),
+										  plannode->sort.numCols,
+										  plannode->sort.sortColIdx,
+										  plannode->sort.sortOperators,
+										  plannode->sort.collations,
+										  plannode->sort.nullsFirst,
+										  work_mem,
+										  NULL, false);
+	if (node->bounded)
+		tuplesort_set_bound(tuplesortstate, node->bound - node->bound_Done);
+	node->tuplesortstate = (void *) tuplesortstate;
+
+	/* The tuple that ended the previous batch begins this one */
+	if (!TupIsNull(node->transfer_tuple))
+	{
+		tuplesort_puttupleslot(tuplesortstate, node->transfer_tuple);
+		ExecClearTuple(node->transfer_tuple);
+		ntuples++;
+	}
+
+	for (;;)
+	{
+		slot = ExecProcNode(outerNode);
+
+		if (TupIsNull(slot))
+		{
+			node->outerNodeDone = true;
+			break;
+		}
+
+		if (ntuples >= INCRSORT_MIN_BATCH_SIZE)
+		{
+			/*
+			 * Past the minimum batch size, stop at the first tuple that is
+			 * not in the same group as the pivot.
+			 */
+			econtext->ecxt_innertuple = node->group_pivot;
+			econtext->ecxt_outertuple = slot;
+			if (!ExecQualAndReset(node->presortedEq, econtext))
+			{
+				ExecCopySlot(node->transfer_tuple, slot);
+				break;
+			}
+		}
+
+		tuplesort_puttupleslot(tuplesortstate, slot);
+		ntuples++;
+
+		if (ntuples == INCRSORT_MIN_BATCH_SIZE)
+			ExecCopySlot(node->group_pivot, slot);
+	}
+
+	tuplesort_performsort(tuplesortstate);
+
+	node->sort_Done = true;
+	node->nbatches++;
+	node->bound_Done += ntuples;
+
+	/* Remember the statistics of the batch that needed the most space */
+	if (node->ss.ps.instrument != NULL)
+	{
+		TuplesortInstrumentation stats;
+
+		tuplesort_get_stats(tuplesortstate, &stats);
+		if (stats.spaceUsed > node->sinstrument.spaceUsed ||
+			node->sinstrument.sortMethod == SORT_TYPE_STILL_IN_PROGRESS)
+			node->sinstrument = stats;
+	}
+
+	SO1_printf("ExecIncrementalSort: %s\n", "sorting batch done");
+}
+
+/* ----------------------------------------------------------------
+ *		ExecIncrementalSort
+ *
+ *		Returns the next tuple of the current sorted batch, sorting
+ *		the next batch first when the current one runs out.
+ *
+ *		Conditions:
+ *		  -- none.
+ *
+ *		Initial States:
+ *		  -- the outer child is prepared to return the first tuple.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecIncrementalSort(PlanState *pstate)
+{
+	IncrementalSortState *node = castNode(IncrementalSortState, pstate);
+	EState	   *estate = node->ss.ps.state;
+	ScanDirection dir = estate->es_direction;
+	TupleTableSlot *slot = node->ss.ps.ps_ResultTupleSlot;
+
+	CHECK_FOR_INTERRUPTS();
+
+	/* Backward scans are not supported, see ExecSupportsBackwardScan */
+	Assert(ScanDirectionIsForward(dir));
+
+	for (;;)
+	{
+		if (!node->sort_Done)
+		{
+			/*
+			 * Want to scan subplan in the forward direction while creating
+			 * the sorted data.
+			 */
+			estate->es_direction = ForwardScanDirection;
+			incremental_sort_batch(node);
+			estate->es_direction = dir;
+		}
+
+		/*
+		 * Note that we only rely on slot tuple remaining valid until the next
+		 * fetch from the tuplesort.
+		 */
+		if (tuplesort_gettupleslot((Tuplesortstate *) node->tuplesortstate,
+								   true, false, slot, NULL))
+			return slot;
+
+		/* The batch is exhausted; is there another one? */
+		if (node->outerNodeDone ||
+			(node->bounded && node->bound_Done >= node->bound))
+			return slot;
+
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+		node->tuplesortstate = NULL;
+		node->sort_Done = false;
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitIncrementalSort
+ *
+ *		Creates the run-time state information for the incremental
+ *		sort node produced by the planner and initializes its outer
+ *		subtree.
+ * ----------------------------------------------------------------
+ */
+IncrementalSortState *
+ExecInitIncrementalSort(IncrementalSort *node, EState *estate, int eflags)
+{
+	IncrementalSortState *incrsortstate;
+	TupleDesc	outerDesc;
+	Oid		   *eqOperators;
+	int			i;
+
+	SO1_printf("ExecInitIncrementalSort: %s\n",
+			   "initializing sort node");
+
+	/*
+	 * Incremental sort supports neither EXEC_FLAG_BACKWARD nor
+	 * EXEC_FLAG_MARK, because only one batch of the sorted output is kept at
+	 * a time.  Rewinding is done by re-reading the input.
+	 */
+	Assert((eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)) == 0);
+
+	/*
+	 * create state structure
+	 */
+	incrsortstate = makeNode(IncrementalSortState);
+	incrsortstate->ss.ps.plan = (Plan *) node;
+	incrsortstate->ss.ps.state = estate;
+	incrsortstate->ss.ps.ExecProcNode = ExecIncrementalSort;
+
+	incrsortstate->bounded = false;
+	incrsortstate->bound_Done = 0;
+	incrsortstate->sort_Done = false;
+	incrsortstate->outerNodeDone = false;
+	incrsortstate->tuplesortstate = NULL;
+	incrsortstate->nbatches = 0;
+	incrsortstate->sinstrument.sortMethod = SORT_TYPE_STILL_IN_PROGRESS;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * The expression context is used to compare tuples to the group pivot.
+	 */
+	ExecAssignExprContext(estate, &incrsortstate->ss.ps);
+
+	/*
+	 * initialize child nodes
+	 *
+	 * We shield the child node from the need to support REWIND, BACKWARD, or
+	 * MARK/RESTORE.
+	 */
+	eflags &= ~(EXEC_FLAG_REWIND | EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK);
+
+	outerPlanState(incrsortstate) = ExecInitNode(outerPlan(node), estate, eflags);
+
+	/*
+	 * Initialize scan slot and type.
+	 */
+	ExecCreateScanSlotFromOuterPlan(estate, &incrsortstate->ss);
+
+	/*
+	 * Initialize return slot and type. No need to initialize projection info
+	 * because this node doesn't do projections.
+	 */
+	ExecInitResultTupleSlotTL(estate, &incrsortstate->ss.ps);
+	incrsortstate->ss.ps.ps_ProjInfo = NULL;
+
+	/*
+	 * Initialize the slots for the group pivot and for the tuple carried
+	 * over to the next batch, and the comparison of the presorted columns.
+	 */
+	outerDesc = ExecGetResultType(outerPlanState(incrsortstate));
+	incrsortstate->group_pivot = ExecInitExtraTupleSlot(estate, outerDesc);
+	incrsortstate->transfer_tuple = ExecInitExtraTupleSlot(estate, outerDesc);
+
+	eqOperators = (Oid *) palloc(node->presortedCols * sizeof(Oid));
+	for (i = 0; i < node->presortedCols; i++)
+	{
+		eqOperators[i] = get_equality_op_for_ordering_op(node->sort.sortOperators[i],
+														 NULL);
+		if (!OidIsValid(eqOperators[i]))
+			elog(ERROR, "missing equality operator for ordering operator %u",
+				 node->sort.sortOperators[i]);
+	}
+	incrsortstate->presortedEq =
+		execTuplesMatchPrepare(outerDesc,
+							   node->presortedCols,
+							   node->sort.sortColIdx,
+							   eqOperators,
+							   &incrsortstate->ss.ps);
+
+	SO1_printf("ExecInitIncrementalSort: %s\n",
+			   "sort node initialized");
+
+	return incrsortstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndIncrementalSort(node)
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndIncrementalSort(IncrementalSortState *node)
+{
+	SO1_printf("ExecEndIncrementalSort: %s\n",
+			   "shutting down sort node");
+
+	/*
+	 * Free the exprcontext
+	 */
+	ExecFreeExprContext(&node->ss.ps);
+
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	/* must drop pointer to sort result tuple */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot);
+	ExecClearTuple(node->transfer_tuple);
+
+	/*
+	 * Release tuplesort resources
+	 */
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+	node->tuplesortstate = NULL;
+
+	/*
+	 * shut down the subplan
+	 */
+	ExecEndNode(outerPlanState(node));
+
+	SO1_printf("ExecEndIncrementalSort: %s\n",
+			   "sort node shutdown");
+}
+
+void
+ExecReScanIncrementalSort(IncrementalSortState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+
+	/*
+	 * Only the current batch is kept, so there is nothing to rewind to: we
+	 * always have to re-read the subplan and start over.
+	 */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot);
+	ExecClearTuple(node->transfer_tuple);
+
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+	node->tuplesortstate = NULL;
+
+	node->sort_Done = false;
+	node->outerNodeDone = false;
+	node->bound_Done = 0;
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (outerPlan->chgParam == NULL)
+		ExecReScan(outerPlan);
+}
@@ -63,6 +63,10 @@ static bool ExecOnConflictUpdate(ModifyTableState *mtstate,
 					 EState *estate,
 					 bool canSetTag,
 					 TupleTableSlot **returning);
+static void ExecBatchInsert(ModifyTableState *mtstate,
+				ResultRelInfo *resultRelInfo,
+				EState *estate,
+				bool canSetTag);
 static ResultRelInfo *getTargetResultRelInfo(ModifyTableState *node);
 static void ExecSetupChildParentMapForTcs(ModifyTableState *mtstate);
 static void ExecSetupChildParentMapForSubplan(ModifyTableState *mtstate);
@@ -337,6 +341,48 @@ ExecInsert(ModifyTableState *mtstate,
 	}
 	else if (resultRelInfo->ri_FdwRoutine)
 	{
+		/*
+		 * If the FDW supports batching, and batching is enabled for this
+		 * relation, just add the tuple to the current batch, and send the
+		 * batch to the FDW once it is full.  Any batch that is not full when
+		 * the subplan runs out of tuples is sent by ExecModifyTable.
+		 */
+		if (resultRelInfo->ri_BatchSize > 1)
+		{
+			int			n = resultRelInfo->ri_NumSlots;
+			MemoryContext oldContext;
+
+			oldContext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+			if (resultRelInfo->ri_Slots == NULL)
+			{
+				resultRelInfo->ri_Slots = (TupleTableSlot **)
+					palloc0(sizeof(TupleTableSlot *) * resultRelInfo->ri_BatchSize);
+				resultRelInfo->ri_PlanSlots = (TupleTableSlot **)
+					palloc0(sizeof(TupleTableSlot *) * resultRelInfo->ri_BatchSize);
+			}
+
+			/* Slots are made on first use, and reused for later batches */
+			if (resultRelInfo->ri_Slots[n] == NULL)
+			{
+				resultRelInfo->ri_Slots[n] =
+					ExecInitExtraTupleSlot(estate, slot->tts_tupleDescriptor);
+				resultRelInfo->ri_PlanSlots[n] =
+					ExecInitExtraTupleSlot(estate, planSlot->tts_tupleDescriptor);
+			}
+
+			ExecCopySlot(resultRelInfo->ri_Slots[n], slot);
+			ExecCopySlot(resultRelInfo->ri_PlanSlots[n], planSlot);
+			resultRelInfo->ri_NumSlots++;
+
+			MemoryContextSwitchTo(oldContext);
+
+			if (resultRelInfo->ri_NumSlots == resultRelInfo->ri_BatchSize)
+				ExecBatchInsert(mtstate, resultRelInfo, estate, canSetTag);
+
+			return NULL;
+		}
+
 		/*
 		 * insert into foreign table: let the FDW do it
 		 */
@@ -607,6 +653,68 @@ ExecInsert(ModifyTableState *mtstate,
 	return result;
 }
 
+/* ----------------------------------------------------------------
+ *		ExecBatchInsert
+ *
+ *		Insert the tuples accumulated by ExecInsert for a foreign table
+ *		by passing them to the FDW all at once, then do the per-tuple
+ *		work that ExecInsert would otherwise do after each insertion.
+ *		Batching is not used when transition tuples are captured, since
+ *		the capture state is set up for one routed tuple at a time.
+ * ----------------------------------------------------------------
+ */
+static void
+ExecBatchInsert(ModifyTableState *mtstate,
+				ResultRelInfo *resultRelInfo,
+				EState *estate,
+				bool canSetTag)
+{
+	TupleTableSlot **rslots;
+	int			numInserted = resultRelInfo->ri_NumSlots;
+	int			i;
+
+	Assert(numInserted > 0);
+	Assert(mtstate->mt_transition_capture == NULL);
+
+	rslots = resultRelInfo->ri_FdwRoutine->ExecForeignBatchInsert(estate,
+																  resultRelInfo,
+																  resultRelInfo->ri_Slots,
+																  resultRelInfo->ri_PlanSlots,
+																  &numInserted);
+
+	for (i = 0; i < numInserted; i++)
+	{
+		TupleTableSlot *slot = rslots[i];
+		HeapTuple	tuple;
+
+		/* FDW might have changed tuple */
+		tuple = ExecMaterializeSlot(slot);
+
+		/*
+		 * AFTER ROW Triggers might reference the tableoid column, so
+		 * initialize t_tableOid before evaluating them.
+		 */
+		tuple->t_tableOid = RelationGetRelid(resultRelInfo->ri_RelationDesc);
+
+		/* AFTER ROW INSERT Triggers */
+		ExecARInsertTriggers(estate, resultRelInfo, tuple, NIL, NULL);
+
+		/* Check any WITH CHECK OPTION constraints from parent views */
+		if (resultRelInfo->ri_WithCheckOptions != NIL)
+			ExecWithCheckOptions(WCO_VIEW_CHECK, resultRelInfo, slot, estate);
+	}
+
+	if (canSetTag)
+		estate->es_processed += numInserted;
+
+	for (i = 0; i < resultRelInfo->ri_NumSlots; i++)
+	{
+		ExecClearTuple(resultRelInfo->ri_Slots[i]);
+		ExecClearTuple(resultRelInfo->ri_PlanSlots[i]);
+	}
+	resultRelInfo->ri_NumSlots = 0;
+}
+
 /* ----------------------------------------------------------------
  *		ExecDelete
  *
@@ -2314,6 +2422,30 @@ ExecModifyTable(PlanState *pstate)
 	/* Restore es_result_relation_info before exiting */
 	estate->es_result_relation_info = saved_resultRelInfo;
 
+	/* Insert any tuples still waiting in partially filled batches */
+	if (operation == CMD_INSERT)
+	{
+		int			i;
+
+		for (i = 0; i < node->mt_nplans; i++)
+		{
+			resultRelInfo = node->resultRelInfo + i;
+			if (resultRelInfo->ri_NumSlots > 0)
+				ExecBatchInsert(node, resultRelInfo, estate, node->canSetTag);
+		}
+
+		if (proute)
+		{
+			for (i = 0; i < proute->num_partitions; i++)
+			{
+				resultRelInfo = proute->partitions[i];
+				if (resultRelInfo != NULL && resultRelInfo->ri_NumSlots > 0)
+					ExecBatchInsert(node, resultRelInfo, estate,
+									node->canSetTag);
+			}
+		}
+	}
+
 	/*
 	 * We're done, but fire AFTER STATEMENT triggers before exiting.
 	 */
@@ -2579,6 +2711,36 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 		mtstate->ps.ps_ExprContext = NULL;
 	}
 
+	/*
+	 * Determine the batch size to use for each foreign-table result
+	 * relation whose FDW can insert tuples in batches.  (The FDW may still
+	 * choose a batch size of 1, ie. no batching.)  This must be done after
+	 * setting up WITH CHECK OPTIONs and RETURNING, which the FDW may need to
+	 * look at.  Partitions that tuples are routed to are handled likewise in
+	 * ExecInitPartitionInfo.
+	 */
+	if (operation == CMD_INSERT)
+	{
+		resultRelInfo = mtstate->resultRelInfo;
+		for (i = 0; i < nplans; i++)
+		{
+			if (!resultRelInfo->ri_usesFdwDirectModify &&
+				mtstate->mt_transition_capture == NULL &&
+				resultRelInfo->ri_FdwRoutine != NULL &&
+				resultRelInfo->ri_FdwRoutine->GetForeignModifyBatchSize != NULL &&
+				resultRelInfo->ri_FdwRoutine->ExecForeignBatchInsert != NULL)
+			{
+				resultRelInfo->ri_BatchSize =
+					resultRelInfo->ri_FdwRoutine->GetForeignModifyBatchSize(resultRelInfo);
+				Assert(resultRelInfo->ri_BatchSize >= 1);
+			}
+			else
+				resultRelInfo->ri_BatchSize = 1;
+
+			resultRelInfo++;
+		}
+	}
+
 	/* Set the list of arbiter indexes if needed for ON CONFLICT */
 	resultRelInfo = mtstate->resultRelInfo;
 	if (node->onConflictAction != ONCONFLICT_NONE)
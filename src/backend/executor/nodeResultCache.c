@@ -0,0 +1,716 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeResultCache.c
+ *	  Routines to handle caching of the results of parameterized subplans.
+ *
+ * A result cache sits on the inner side of a nestloop, above a subplan that
+ * depends on parameters supplied by the outer side.  Each time the nestloop
+ * rescans it with new parameter values, the cache is looked up for them.  If
+ * the subplan has been run to completion with the same values before, the
+ * tuples it returned then are returned again, without running the subplan.
+ * Otherwise the subplan is run, and its tuples are added to the cache as
+ * they are returned.  That pays off when the outer side supplies the same
+ * values many times, for example when joining a large table to a small one
+ * through a foreign key.
+ *
+ * The cache is a hash table keyed by the parameter values, which is kept
+ * within work_mem by evicting the least recently used entries.  If even the
+ * tuples for a single set of values don't fit, they are not cached, and the
+ * rest of the scan just returns the subplan's tuples.
+ *
+ * If the nestloop stops reading before the subplan has run out of tuples,
+ * for example because it only needs one match, the entry is left incomplete
+ * and filled again from scratch the next time.  When the planner can tell
+ * that there is at most one tuple per set of values, it sets "singlerow" to
+ * have entries marked complete as soon as they have a tuple.
+ *
+ * Parameter values are normally matched using the equality operators of
+ * their types.  But values that are equal by those operators can still give
+ * different results, for example when a lateral subquery displays them, so
+ * in "binary mode" they must instead be identical, datum for datum.
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeResultCache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+/*
+ * INTERFACE ROUTINES
+ *		ExecResultCache			- look up the cache, or run the subplan
+ *		ExecInitResultCache		- initialize node and subnodes
+ *		ExecEndResultCache		- shutdown node and subnodes
+ *		ExecReScanResultCache	- prepare for a lookup with new parameters
+ */
+#include "postgres.h"
+
+#include "access/hash.h"
+#include "access/htup_details.h"
+#include "executor/executor.h"
+#include "executor/nodeResultCache.h"
+#include "miscadmin.h"
+#include "utils/datum.h"
+#include "utils/hashutils.h"
+#include "utils/memutils.h"
+
+/* States of the ExecResultCache state machine */
+#define RC_CACHE_LOOKUP				1	/* look up the current parameters */
+#define RC_CACHE_FETCH_NEXT_TUPLE	2	/* return tuples of a cache hit */
+#define RC_FILLING_CACHE			3	/* add subplan tuples to an entry */
+#define RC_CACHE_BYPASS_MODE		4	/* return subplan tuples uncached */
+#define RC_END_OF_SCAN				5	/* no more tuples for this scan */
+
+/* A tuple stored in a cache entry */
+typedef struct ResultCacheTuple
+{
+	MinimalTuple mintuple;
+	struct ResultCacheTuple *next;	/* next tuple of the entry, or NULL */
+} ResultCacheTuple;
+
+/* The tuples the subplan returned for one set of parameter values */
+typedef struct ResultCacheEntry
+{
+	MinimalTuple params;		/* the parameter values */
+	uint32		hash;			/* hash value of params */
+	bool		complete;		/* did the subplan run to completion? */
+	ResultCacheTuple *tuplehead;	/* first tuple, or NULL */
+	ResultCacheTuple *tupletail;	/* last tuple, or NULL */
+	dlist_node	lru_node;		/* position in the LRU list */
+} ResultCacheEntry;
+
+/* A hash table bucket, pointing to the entry it belongs to */
+typedef struct ResultCacheBucket
+{
+	ResultCacheEntry *entry;
+	uint32		hash;
+	char		status;
+} ResultCacheBucket;
+
+/*
+ * Memory used by an entry without its tuples, and by a tuple.  These don't
+ * count palloc overhead or the hash table's buckets.
+ */
+#define EMPTY_ENTRY_MEMORY_BYTES(e) \
+	(sizeof(ResultCacheEntry) + (e)->params->t_len)
+#define CACHE_TUPLE_BYTES(t) \
+	(sizeof(ResultCacheTuple) + (t)->mintuple->t_len)
+
+static uint32 ResultCacheHash_hash(struct resultcache_hash *tb,
+					 const ResultCacheEntry *key);
+static bool ResultCacheHash_equal(struct resultcache_hash *tb,
+					  const ResultCacheEntry *entry,
+					  const ResultCacheEntry *key);
+
+#define SH_PREFIX resultcache
+#define SH_ELEMENT_TYPE ResultCacheBucket
+#define SH_KEY_TYPE ResultCacheEntry *
+#define SH_KEY entry
+#define SH_HASH_KEY(tb, key) ResultCacheHash_hash(tb, key)
+#define SH_EQUAL(tb, a, b) ResultCacheHash_equal(tb, a, b)
+#define SH_SCOPE static inline
+#define SH_STORE_HASH
+#define SH_GET_HASH(tb, a) a->hash
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
+/*
+ * Hash the parameter values in the probe slot, or, if key is not NULL,
+ * return the hash value of an existing entry.
+ */
+static uint32
+ResultCacheHash_hash(struct resultcache_hash *tb, const ResultCacheEntry *key)
+{
+	ResultCacheState *rcstate = (ResultCacheState *) tb->private_data;
+	TupleTableSlot *pslot = rcstate->probeslot;
+	uint32		hashkey = 0;
+	int			i;
+
+	if (key != NULL)
+		return key->hash;
+
+	for (i = 0; i < rcstate->nkeys; i++)
+	{
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		if (!pslot->tts_isnull[i])	/* treat nulls as having hash key 0 */
+		{
+			Datum		value = pslot->tts_values[i];
+			uint32		hkey;
+
+			if (rcstate->binary_mode)
+			{
+				Form_pg_attribute attr = TupleDescAttr(pslot->tts_tupleDescriptor,
+													   i);
+
+				if (attr->attbyval)
+					hkey = DatumGetUInt32(hash_any((unsigned char *) &value,
+												   sizeof(Datum)));
+				else
+					hkey = DatumGetUInt32(hash_any((unsigned char *) DatumGetPointer(value),
+												   datumGetSize(value, false,
+																attr->attlen)));
+			}
+			else
+				hkey = DatumGetUInt32(FunctionCall1(&rcstate->hashfunctions[i],
+													value));
+			hashkey ^= hkey;
+		}
+	}
+
+	return murmurhash32(hashkey);
+}
+
+/*
+ * Does the entry match the parameter values in the probe slot, or, if key
+ * is not NULL, is it that entry?
+ */
+static bool
+ResultCacheHash_equal(struct resultcache_hash *tb,
+					  const ResultCacheEntry *entry,
+					  const ResultCacheEntry *key)
+{
+	ResultCacheState *rcstate = (ResultCacheState *) tb->private_data;
+	TupleTableSlot *tslot = rcstate->tableslot;
+	TupleTableSlot *pslot = rcstate->probeslot;
+	ExprContext *econtext = rcstate->ss.ps.ps_ExprContext;
+
+	if (key != NULL)
+		return entry == key;
+
+	ExecStoreMinimalTuple(entry->params, tslot, false);
+
+	if (rcstate->binary_mode)
+	{
+		int			i;
+
+		slot_getallattrs(tslot);
+		for (i = 0; i < rcstate->nkeys; i++)
+		{
+			Form_pg_attribute attr = TupleDescAttr(tslot->tts_tupleDescriptor,
+												   i);
+
+			if (tslot->tts_isnull[i] != pslot->tts_isnull[i])
+				return false;
+			if (tslot->tts_isnull[i])
+				continue;
+			if (!datumIsEqual(tslot->tts_values[i], pslot->tts_values[i],
+							  attr->attbyval, attr->attlen))
+				return false;
+		}
+		return true;
+	}
+
+	econtext->ecxt_innertuple = tslot;
+	econtext->ecxt_outertuple = pslot;
+	return ExecQual(rcstate->cache_eq_expr, econtext);
+}
+
+/*
+ * Create an empty hash table in the node's table context.
+ */
+static void
+build_hash_table(ResultCacheState *rcstate)
+{
+	/* Make a guess if the planner didn't */
+	uint32		size = rcstate->est_entries > 0 ? rcstate->est_entries : 1024;
+
+	rcstate->hashtable = resultcache_create(rcstate->tableContext, size,
+											rcstate);
+}
+
+/*
+ * Evaluate the parameter values for the current scan into the probe slot.
+ */
+static void
+prepare_probe_slot(ResultCacheState *rcstate)
+{
+	TupleTableSlot *pslot = rcstate->probeslot;
+	ExprContext *econtext = rcstate->ss.ps.ps_ExprContext;
+	int			i;
+
+	ExecClearTuple(pslot);
+	for (i = 0; i < rcstate->nkeys; i++)
+		pslot->tts_values[i] = ExecEvalExpr(rcstate->param_exprs[i],
+											econtext,
+											&pslot->tts_isnull[i]);
+	ExecStoreVirtualTuple(pslot);
+}
+
+/*
+ * Free all the tuples of a cache entry, leaving it empty and incomplete.
+ */
+static void
+entry_purge_tuples(ResultCacheState *rcstate, ResultCacheEntry *entry)
+{
+	ResultCacheTuple *tuple = entry->tuplehead;
+
+	while (tuple != NULL)
+	{
+		ResultCacheTuple *next = tuple->next;
+
+		rcstate->mem_used -= CACHE_TUPLE_BYTES(tuple);
+		pfree(tuple->mintuple);
+		pfree(tuple);
+		tuple = next;
+	}
+
+	entry->tuplehead = NULL;
+	entry->tupletail = NULL;
+	entry->complete = false;
+}
+
+/*
+ * Remove an entry from the cache, and free it.
+ */
+static void
+remove_cache_entry(ResultCacheState *rcstate, ResultCacheEntry *entry)
+{
+	dlist_delete(&entry->lru_node);
+	entry_purge_tuples(rcstate, entry);
+	rcstate->mem_used -= EMPTY_ENTRY_MEMORY_BYTES(entry);
+
+	resultcache_delete(rcstate->hashtable, entry);
+
+	pfree(entry->params);
+	pfree(entry);
+}
+
+/*
+ * Forget all cache entries.
+ */
+static void
+cache_purge_all(ResultCacheState *rcstate)
+{
+	MemoryContextReset(rcstate->tableContext);
+	dlist_init(&rcstate->lru_list);
+	rcstate->mem_used = 0;
+	rcstate->entry = NULL;
+	rcstate->last_tuple = NULL;
+
+	build_hash_table(rcstate);
+}
+
+/*
+ * Evict the least recently used entries until the cache fits within its
+ * memory limit again.
+ *
+ * Returns false if that meant evicting 'specialentry' too.
+ */
+static bool
+cache_reduce_memory(ResultCacheState *rcstate, ResultCacheEntry *specialentry)
+{
+	bool		specialentry_intact = true;
+	dlist_mutable_iter iter;
+
+	Assert(rcstate->mem_used > rcstate->mem_limit);
+
+	if (rcstate->mem_used > rcstate->stats.mem_peak)
+		rcstate->stats.mem_peak = rcstate->mem_used;
+
+	dlist_foreach_modify(iter, &rcstate->lru_list)
+	{
+		ResultCacheEntry *entry = dlist_container(ResultCacheEntry, lru_node,
+												  iter.cur);
+
+		if (entry == specialentry)
+			specialentry_intact = false;
+
+		remove_cache_entry(rcstate, entry);
+		rcstate->stats.cache_evictions++;
+
+		if (rcstate->mem_used <= rcstate->mem_limit)
+			break;
+	}
+
+	return specialentry_intact;
+}
+
+/*
+ * Look up the cache entry for the current parameter values, adding an empty
+ * one if there is none.  *found tells which happened.
+ *
+ * Returns NULL if there's no room for a new entry.
+ */
+static ResultCacheEntry *
+cache_lookup(ResultCacheState *rcstate, bool *found)
+{
+	ExprContext *econtext = rcstate->ss.ps.ps_ExprContext;
+	ResultCacheBucket *bucket;
+	ResultCacheEntry *entry;
+	MemoryContext oldcontext;
+
+	/* Evaluate and hash the parameters in short-lived memory */
+	ResetExprContext(econtext);
+	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	prepare_probe_slot(rcstate);
+	bucket = resultcache_insert(rcstate->hashtable, NULL, found);
+
+	if (*found)
+	{
+		MemoryContextSwitchTo(oldcontext);
+
+		/* Make it the most recently used entry */
+		entry = bucket->entry;
+		dlist_delete(&entry->lru_node);
+		dlist_push_tail(&rcstate->lru_list, &entry->lru_node);
+		return entry;
+	}
+
+	MemoryContextSwitchTo(rcstate->tableContext);
+
+	entry = (ResultCacheEntry *) palloc(sizeof(ResultCacheEntry));
+	entry->params = ExecCopySlotMinimalTuple(rcstate->probeslot);
+	entry->hash = bucket->hash;
+	entry->complete = false;
+	entry->tuplehead = NULL;
+	entry->tupletail = NULL;
+	bucket->entry = entry;
+	dlist_push_tail(&rcstate->lru_list, &entry->lru_node);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	rcstate->mem_used += EMPTY_ENTRY_MEMORY_BYTES(entry);
+	if (rcstate->mem_used > rcstate->mem_limit &&
+		!cache_reduce_memory(rcstate, entry))
+		return NULL;
+
+	return entry;
+}
+
+/*
+ * Add a tuple to the entry being filled.
+ *
+ * Returns false if the entry had to be evicted to make room for it.
+ */
+static bool
+cache_store_tuple(ResultCacheState *rcstate, TupleTableSlot *slot)
+{
+	ResultCacheEntry *entry = rcstate->entry;
+	ResultCacheTuple *tuple;
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(rcstate->tableContext);
+
+	tuple = (ResultCacheTuple *) palloc(sizeof(ResultCacheTuple));
+	tuple->mintuple = ExecCopySlotMinimalTuple(slot);
+	tuple->next = NULL;
+
+	if (entry->tupletail == NULL)
+		entry->tuplehead = tuple;
+	else
+		entry->tupletail->next = tuple;
+	entry->tupletail = tuple;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	rcstate->mem_used += CACHE_TUPLE_BYTES(tuple);
+	if (rcstate->mem_used > rcstate->mem_limit &&
+		!cache_reduce_memory(rcstate, entry))
+	{
+		rcstate->entry = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecResultCache
+ *
+ *		Returns the next tuple for the current parameter values, from
+ *		the cache if they were seen before, else from the subplan.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecResultCache(PlanState *pstate)
+{
+	ResultCacheState *node = castNode(ResultCacheState, pstate);
+	PlanState  *outerNode = outerPlanState(node);
+	TupleTableSlot *slot;
+	bool		found;
+
+	CHECK_FOR_INTERRUPTS();
+
+	switch (node->rc_status)
+	{
+		case RC_CACHE_LOOKUP:
+			{
+				ResultCacheEntry *entry = cache_lookup(node, &found);
+
+				if (found && entry->complete)
+				{
+					node->stats.cache_hits++;
+
+					node->entry = entry;
+					node->last_tuple = entry->tuplehead;
+					if (entry->tuplehead == NULL)
+					{
+						node->rc_status = RC_END_OF_SCAN;
+						return NULL;
+					}
+
+					node->rc_status = RC_CACHE_FETCH_NEXT_TUPLE;
+					slot = node->ss.ps.ps_ResultTupleSlot;
+					ExecStoreMinimalTuple(entry->tuplehead->mintuple, slot,
+										  false);
+					return slot;
+				}
+
+				node->stats.cache_misses++;
+
+				if (entry == NULL)
+				{
+					/* No room for an entry; just return the subplan's tuples */
+					node->stats.cache_overflows++;
+					node->rc_status = RC_CACHE_BYPASS_MODE;
+					return ExecResultCache(pstate);
+				}
+
+				/*
+				 * An existing entry that is not complete was left behind by a
+				 * scan that was stopped early.  Fill it again from scratch.
+				 */
+				if (found)
+					entry_purge_tuples(node, entry);
+
+				node->entry = entry;
+				node->rc_status = RC_FILLING_CACHE;
+			}
+			/* FALLTHROUGH */
+
+		case RC_FILLING_CACHE:
+			{
+				ResultCacheEntry *entry = node->entry;
+
+				slot = ExecProcNode(outerNode);
+				if (TupIsNull(slot))
+				{
+					entry->complete = true;
+					node->rc_status = RC_END_OF_SCAN;
+					return NULL;
+				}
+
+				if (!cache_store_tuple(node, slot))
+				{
+					/* Evicted to make room; return the rest uncached */
+					node->stats.cache_overflows++;
+					node->rc_status = RC_CACHE_BYPASS_MODE;
+				}
+				else if (node->singlerow)
+				{
+					/* There are no more tuples to read */
+					entry->complete = true;
+					node->rc_status = RC_END_OF_SCAN;
+				}
+
+				return slot;
+			}
+
+		case RC_CACHE_FETCH_NEXT_TUPLE:
+			node->last_tuple = node->last_tuple->next;
+			if (node->last_tuple == NULL)
+			{
+				node->rc_status = RC_END_OF_SCAN;
+				return NULL;
+			}
+
+			slot = node->ss.ps.ps_ResultTupleSlot;
+			ExecStoreMinimalTuple(node->last_tuple->mintuple, slot, false);
+			return slot;
+
+		case RC_CACHE_BYPASS_MODE:
+			slot = ExecProcNode(outerNode);
+			if (TupIsNull(slot))
+			{
+				node->rc_status = RC_END_OF_SCAN;
+				return NULL;
+			}
+			return slot;
+
+		case RC_END_OF_SCAN:
+			return NULL;
+
+		default:
+			elog(ERROR, "unrecognized result cache state: %d",
+				 node->rc_status);
+			return NULL;		/* keep compiler quiet */
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitResultCache
+ * ----------------------------------------------------------------
+ */
+ResultCacheState *
+ExecInitResultCache(ResultCache *node, EState *estate, int eflags)
+{
+	ResultCacheState *rcstate;
+	TupleDesc	keydesc;
+	AttrNumber *keyColIdx;
+	Oid		   *eqfuncoids;
+	ListCell   *lc;
+	int			i;
+
+	/* The cache can't be read backwards, nor marked and restored */
+	Assert((eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)) == 0);
+
+	/*
+	 * create state structure
+	 */
+	rcstate = makeNode(ResultCacheState);
+	rcstate->ss.ps.plan = (Plan *) node;
+	rcstate->ss.ps.state = estate;
+	rcstate->ss.ps.ExecProcNode = ExecResultCache;
+
+	rcstate->rc_status = RC_CACHE_LOOKUP;
+	rcstate->singlerow = node->singlerow;
+	rcstate->binary_mode = node->binary_mode;
+	rcstate->keyparamids = node->keyparamids;
+	rcstate->est_entries = node->est_entries;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * The expression context is used to evaluate the cache keys and to
+	 * compare them with those of the cache entries.
+	 */
+	ExecAssignExprContext(estate, &rcstate->ss.ps);
+
+	/*
+	 * initialize child nodes
+	 *
+	 * The subplan is only rescanned for new parameter values, so it needn't
+	 * be able to REWIND.
+	 */
+	eflags &= ~EXEC_FLAG_REWIND;
+	outerPlanState(rcstate) = ExecInitNode(outerPlan(node), estate, eflags);
+
+	/*
+	 * Initialize result type and slot. No need to initialize projection info
+	 * because this node doesn't do projections.
+	 */
+	ExecInitResultTupleSlotTL(estate, &rcstate->ss.ps);
+	rcstate->ss.ps.ps_ProjInfo = NULL;
+
+	/*
+	 * Initialize the cache keys, with slots to compare the keys being looked
+	 * up with those of the cache entries.
+	 */
+	rcstate->nkeys = node->numKeys;
+	keydesc = ExecTypeFromExprList(node->param_exprs);
+	rcstate->tableslot = ExecInitExtraTupleSlot(estate, keydesc);
+	rcstate->probeslot = ExecInitExtraTupleSlot(estate, keydesc);
+
+	rcstate->param_exprs = (ExprState **)
+		palloc(node->numKeys * sizeof(ExprState *));
+	keyColIdx = (AttrNumber *) palloc(node->numKeys * sizeof(AttrNumber));
+	i = 0;
+	foreach(lc, node->param_exprs)
+	{
+		rcstate->param_exprs[i] = ExecInitExpr((Expr *) lfirst(lc),
+											   (PlanState *) rcstate);
+		keyColIdx[i] = i + 1;
+		i++;
+	}
+
+	/* In binary mode, the keys are hashed and compared as they are */
+	if (!node->binary_mode)
+	{
+		execTuplesHashPrepare(node->numKeys, node->eqOperators,
+							  &eqfuncoids, &rcstate->hashfunctions);
+		rcstate->cache_eq_expr = ExecBuildGroupingEqual(keydesc, keydesc,
+														node->numKeys,
+														keyColIdx,
+														eqfuncoids,
+														(PlanState *) rcstate);
+	}
+
+	/*
+	 * Set up the cache itself.
+	 */
+	rcstate->mem_limit = work_mem * 1024L;
+	rcstate->mem_used = 0;
+	rcstate->tableContext = AllocSetContextCreate(CurrentMemoryContext,
+												  "ResultCacheHashTable",
+												  ALLOCSET_DEFAULT_SIZES);
+	dlist_init(&rcstate->lru_list);
+	build_hash_table(rcstate);
+
+	rcstate->entry = NULL;
+	rcstate->last_tuple = NULL;
+
+	return rcstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndResultCache
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndResultCache(ResultCacheState *node)
+{
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->tableslot);
+	ExecClearTuple(node->probeslot);
+
+	/*
+	 * Release the cache
+	 */
+	MemoryContextDelete(node->tableContext);
+
+	/*
+	 * Free the exprcontext
+	 */
+	ExecFreeExprContext(&node->ss.ps);
+
+	/*
+	 * shut down the subplan
+	 */
+	ExecEndNode(outerPlanState(node));
+}
+
+void
+ExecReScanResultCache(ResultCacheState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+
+	/* Look up the cache for the new parameter values on the next fetch */
+	node->rc_status = RC_CACHE_LOOKUP;
+	node->entry = NULL;
+	node->last_tuple = NULL;
+
+	/*
+	 * If a parameter that is not a cache key has changed, the cached results
+	 * may no longer be right, so forget them all.
+	 */
+	if (bms_nonempty_difference(outerPlan->chgParam, node->keyparamids))
+		cache_purge_all(node);
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (outerPlan->chgParam == NULL)
+		ExecReScan(outerPlan);
+}
+
+/*
+ * ExecEstimateCacheEntryOverheadBytes
+ *		Estimate the memory a cache entry takes besides its tuples' data,
+ *		for the planner.
+ */
+Size
+ExecEstimateCacheEntryOverheadBytes(double ntuples)
+{
+	return sizeof(ResultCacheEntry) + sizeof(ResultCacheBucket) +
+		sizeof(ResultCacheTuple) * ntuples;
+}
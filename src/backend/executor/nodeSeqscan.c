@@ -29,10 +29,13 @@
 
 #include "access/relscan.h"
 #include "executor/execdebug.h"
+#include "executor/nodeHash.h"
 #include "executor/nodeSeqscan.h"
+#include "utils/lsyscache.h"
 #include "utils/rel.h"
 
 static TupleTableSlot *SeqNext(SeqScanState *node);
+static bool SeqRuntimeFilter(SeqScanState *node, TupleTableSlot *slot);
 
 /* ----------------------------------------------------------------
  *						Scan Support
@@ -74,31 +77,103 @@ SeqNext(SeqScanState *node)
 		node->ss.ss_currentScanDesc = scandesc;
 	}
 
-	/*
-	 * get the next tuple from the table
-	 */
-	tuple = heap_getnext(scandesc, direction);
+	for (;;)
+	{
+		/*
+		 * get the next tuple from the table
+		 */
+		tuple = heap_getnext(scandesc, direction);
 
-	/*
-	 * save the tuple and the buffer returned to us by the access methods in
-	 * our scan tuple slot and return the slot.  Note: we pass 'false' because
-	 * tuples returned by heap_getnext() are pointers onto disk pages and were
-	 * not created with palloc() and so should not be pfree()'d.  Note also
-	 * that ExecStoreTuple will increment the refcount of the buffer; the
-	 * refcount will not be dropped until the tuple table slot is cleared.
-	 */
-	if (tuple)
-		ExecStoreTuple(tuple,	/* tuple to store */
-					   slot,	/* slot to store in */
-					   scandesc->rs_cbuf,	/* buffer associated with this
-											 * tuple */
-					   false);	/* don't pfree this pointer */
-	else
-		ExecClearTuple(slot);
+		/*
+		 * save the tuple and the buffer returned to us by the access methods
+		 * in our scan tuple slot and return the slot.  Note: we pass 'false'
+		 * because tuples returned by heap_getnext() are pointers onto disk
+		 * pages and were not created with palloc() and so should not be
+		 * pfree()'d.  Note also that ExecStoreTuple will increment the
+		 * refcount of the buffer; the refcount will not be dropped until the
+		 * tuple table slot is cleared.
+		 */
+		if (tuple)
+			ExecStoreTuple(tuple,	/* tuple to store */
+						   slot,	/* slot to store in */
+						   scandesc->rs_cbuf,	/* buffer associated with
+												 * this tuple */
+						   false);	/* don't pfree this pointer */
+		else
+		{
+			ExecClearTuple(slot);
+			break;
+		}
+
+		/* Skip tuples that the runtime filter shows to have no join partner */
+		if (node->filterParam < 0 || SeqRuntimeFilter(node, slot))
+			break;
+		InstrCountFiltered2(node, 1);
+	}
 
 	return slot;
 }
 
+/*
+ * SeqRuntimeFilter -- test a tuple against the runtime filter
+ *
+ * Hashes the join keys of the tuple the same way the hash join does, and
+ * looks the hash value up in the Bloom filter built from the inner tuples.
+ * Returns false if the tuple can't have a join partner.
+ */
+static bool
+SeqRuntimeFilter(SeqScanState *node, TupleTableSlot *slot)
+{
+	ParamExecData *prm;
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	MemoryContext oldContext;
+	uint32		hashkey = 0;
+	ListCell   *lc;
+	int			i = 0;
+
+	/* Is there a filter (yet)? */
+	prm = &(node->ss.ps.state->es_param_exec_vals[node->filterParam]);
+	if (prm->isnull || prm->value == (Datum) 0)
+		return true;
+
+	ResetExprContext(econtext);
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+	econtext->ecxt_scantuple = slot;
+
+	foreach(lc, node->filterKeys)
+	{
+		ExprState  *keyexpr = (ExprState *) lfirst(lc);
+		Datum		keyval;
+		bool		isNull;
+
+		/* rotate hashkey left 1 bit at each step, like ExecHashGetHashValue */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		keyval = ExecEvalExpr(keyexpr, econtext, &isNull);
+
+		if (isNull)
+		{
+			/* A NULL can't match if the join operator is strict */
+			if (node->filterHashStrict[i])
+			{
+				MemoryContextSwitchTo(oldContext);
+				return false;
+			}
+			/* else, leave hashkey unmodified, equivalent to hashcode 0 */
+		}
+		else
+			hashkey ^= DatumGetUInt32(FunctionCall1(&node->filterHashFunctions[i],
+													keyval));
+
+		i++;
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	return !bloom_lacks_element(DatumGetRuntimeFilter(prm->value),
+								(unsigned char *) &hashkey, sizeof(hashkey));
+}
+
 /*
  * SeqRecheck -- access method routine to recheck a tuple in EvalPlanQual
  */
@@ -171,7 +246,7 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	 */
 	scanstate->ss.ss_currentRelation =
 		ExecOpenScanRelation(estate,
-							 node->scanrelid,
+							 node->scan.scanrelid,
 							 eflags);
 
 	/* and create slot with the appropriate rowtype */
@@ -188,7 +263,40 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	 * initialize child expressions
 	 */
 	scanstate->ss.ps.qual =
-		ExecInitQual(node->plan.qual, (PlanState *) scanstate);
+		ExecInitQual(node->scan.plan.qual, (PlanState *) scanstate);
+
+	/*
+	 * Set up testing tuples against the runtime filter, if any.  The keys are
+	 * hashed by the hash functions for the outer side of the join.
+	 */
+	scanstate->filterParam = node->filterParam;
+	if (node->filterParam >= 0)
+	{
+		int			nkeys = list_length(node->filterKeys);
+		ListCell   *lc;
+		int			i;
+
+		scanstate->filterKeys = ExecInitExprList(node->filterKeys,
+												 (PlanState *) scanstate);
+		scanstate->filterHashFunctions =
+			(FmgrInfo *) palloc(nkeys * sizeof(FmgrInfo));
+		scanstate->filterHashStrict = (bool *) palloc(nkeys * sizeof(bool));
+
+		i = 0;
+		foreach(lc, node->filterHashOps)
+		{
+			Oid			hashop = lfirst_oid(lc);
+			Oid			left_hashfn;
+			Oid			right_hashfn;
+
+			if (!get_op_hash_functions(hashop, &left_hashfn, &right_hashfn))
+				elog(ERROR, "could not find hash function for hash operator %u",
+					 hashop);
+			fmgr_info(left_hashfn, &scanstate->filterHashFunctions[i]);
+			scanstate->filterHashStrict[i] = op_strict(hashop);
+			i++;
+		}
+	}
 
 	return scanstate;
 }
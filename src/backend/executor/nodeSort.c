@@ -19,8 +19,141 @@
 #include "executor/execdebug.h"
 #include "executor/nodeSort.h"
 #include "miscadmin.h"
+#include "optimizer/planmain.h"
+#include "pgstat.h"
 #include "utils/tuplesort.h"
 
+/* The Sharedsort of a parallel sort follows its ParallelSortState */
+#define ParallelSortStateGetSharedsort(pstate) \
+	((Sharedsort *) ((char *) (pstate) + MAXALIGN(sizeof(ParallelSortState))))
+
+
+/*
+ * Begin a tuplesort of the node's input, as part of a parallel sort if
+ * coordinate is not NULL.
+ */
+static Tuplesortstate *
+sort_begin(SortState *node, SortCoordinate coordinate)
+{
+	Sort	   *plannode = (Sort *) node->ss.ps.plan;
+	TupleDesc	tupDesc = ExecGetResultType(outerPlanState(node));
+
+	SO1_printf("ExecSort: %s\n",
+			   "calling tuplesort_begin");
+
+	return tuplesort_begin_heap(tupDesc,
+								plannode->numCols,
+								plannode->sortColIdx,
+								plannode->sortOperators,
+								plannode->collations,
+								plannode->nullsFirst,
+								work_mem,
+								coordinate, node->randomAccess);
+}
+
+/*
+ * Scan the subplan and feed all the tuples to tuplesort.
+ */
+static void
+sort_fill(SortState *node, Tuplesortstate *tuplesortstate)
+{
+	PlanState  *outerNode = outerPlanState(node);
+	TupleTableSlot *slot;
+
+	for (;;)
+	{
+		slot = ExecProcNode(outerNode);
+
+		if (TupIsNull(slot))
+			break;
+
+		tuplesort_puttupleslot(tuplesortstate, slot);
+	}
+}
+
+/*
+ * Sort this participant's share of the input of a parallel sort into a run
+ * for the leader to merge, and tell the leader once that is done.
+ */
+static void
+sort_participate(SortState *node)
+{
+	ParallelSortState *pstate = node->pstate;
+	SortCoordinate coordinate;
+	Tuplesortstate *tuplesortstate;
+
+	coordinate = (SortCoordinate) palloc0(sizeof(SortCoordinateData));
+	coordinate->isWorker = true;
+	coordinate->nParticipants = -1;
+	coordinate->sharedsort = ParallelSortStateGetSharedsort(pstate);
+
+	tuplesortstate = sort_begin(node, coordinate);
+	sort_fill(node, tuplesortstate);
+	tuplesort_performsort(tuplesortstate);
+
+	if (node->shared_info && node->am_worker)
+	{
+		TuplesortInstrumentation *si;
+
+		Assert(IsParallelWorker());
+		Assert(ParallelWorkerNumber <= node->shared_info->num_workers);
+		si = &node->shared_info->sinstrument[ParallelWorkerNumber];
+		tuplesort_get_stats(tuplesortstate, si);
+	}
+
+	tuplesort_end(tuplesortstate);
+
+	SpinLockAcquire(&pstate->mutex);
+	pstate->nparticipantsdone++;
+	SpinLockRelease(&pstate->mutex);
+	ConditionVariableBroadcast(&pstate->cv);
+}
+
+/*
+ * In the leader of a parallel sort, wait for all participants to write
+ * their runs, and merge them.
+ */
+static Tuplesortstate *
+sort_leader_merge(SortState *node)
+{
+	ParallelSortState *pstate = node->pstate;
+	int			nparticipants = node->pcxt->nworkers_launched;
+	SortCoordinate coordinate;
+	Tuplesortstate *tuplesortstate;
+
+	/* The leader sorts a share of the input too, unless told not to */
+	if (parallel_leader_participation)
+	{
+		sort_participate(node);
+		nparticipants++;
+	}
+
+	/* Make sure that the failure-to-start case will not hang forever */
+	WaitForParallelWorkersToAttach(node->pcxt);
+
+	for (;;)
+	{
+		bool		done;
+
+		SpinLockAcquire(&pstate->mutex);
+		done = (pstate->nparticipantsdone == nparticipants);
+		SpinLockRelease(&pstate->mutex);
+		if (done)
+			break;
+		ConditionVariableSleep(&pstate->cv, WAIT_EVENT_PARALLEL_SORT);
+	}
+	ConditionVariableCancelSleep();
+
+	coordinate = (SortCoordinate) palloc0(sizeof(SortCoordinateData));
+	coordinate->isWorker = false;
+	coordinate->nParticipants = nparticipants;
+	coordinate->sharedsort = ParallelSortStateGetSharedsort(pstate);
+
+	tuplesortstate = sort_begin(node, coordinate);
+	tuplesort_performsort(tuplesortstate);
+
+	return tuplesortstate;
+}
 
 /* ----------------------------------------------------------------
  *		ExecSort
@@ -29,6 +162,10 @@
  *		which saves the results in a temporary file or memory. After the
  *		initial call, returns a tuple from the file with each call.
  *
+ *		If the node is parallel-aware, each participant sorts its share
+ *		of the input into a run instead, and only the leader returns
+ *		tuples, merging the runs of all participants.
+ *
  *		Conditions:
  *		  -- none.
  *
@@ -64,10 +201,6 @@ ExecSort(PlanState *pstate)
 
 	if (!node->sort_Done)
 	{
-		Sort	   *plannode = (Sort *) node->ss.ps.plan;
-		PlanState  *outerNode;
-		TupleDesc	tupDesc;
-
 		SO1_printf("ExecSort: %s\n",
 				   "sorting subplan");
 
@@ -77,45 +210,47 @@ ExecSort(PlanState *pstate)
 		 */
 		estate->es_direction = ForwardScanDirection;
 
-		/*
-		 * Initialize tuplesort module.
-		 */
-		SO1_printf("ExecSort: %s\n",
-				   "calling tuplesort_begin");
-
-		outerNode = outerPlanState(node);
-		tupDesc = ExecGetResultType(outerNode);
-
-		tuplesortstate = tuplesort_begin_heap(tupDesc,
-											  plannode->numCols,
-											  plannode->sortColIdx,
-											  plannode->sortOperators,
-											  plannode->collations,
-											  plannode->nullsFirst,
-											  work_mem,
-											  NULL, node->randomAccess);
-		if (node->bounded)
-			tuplesort_set_bound(tuplesortstate, node->bound);
-		node->tuplesortstate = (void *) tuplesortstate;
-
-		/*
-		 * Scan the subplan and feed all the tuples to tuplesort.
-		 */
-
-		for (;;)
+		if (node->pstate != NULL && node->am_worker)
 		{
-			slot = ExecProcNode(outerNode);
-
-			if (TupIsNull(slot))
-				break;
-
-			tuplesort_puttupleslot(tuplesortstate, slot);
+			/* A worker of a parallel sort just writes out its run */
+			sort_participate(node);
+			tuplesortstate = NULL;
 		}
-
-		/*
-		 * Complete the sort.
-		 */
-		tuplesort_performsort(tuplesortstate);
+		else if (node->pstate != NULL && node->pcxt->nworkers_launched > 0)
+		{
+			/* Parallel sort leader; bounds are not supported */
+			tuplesortstate = sort_leader_merge(node);
+		}
+		else
+		{
+			/*
+			 * Initialize tuplesort module.
+			 */
+			tuplesortstate = sort_begin(node, NULL);
+			if (node->bounded)
+				tuplesort_set_bound(tuplesortstate, node->bound);
+
+			/*
+			 * Scan the subplan and feed all the tuples to tuplesort.
+			 */
+			sort_fill(node, tuplesortstate);
+
+			/*
+			 * Complete the sort.
+			 */
+			tuplesort_performsort(tuplesortstate);
+
+			if (node->shared_info && node->am_worker)
+			{
+				TuplesortInstrumentation *si;
+
+				Assert(IsParallelWorker());
+				Assert(ParallelWorkerNumber <= node->shared_info->num_workers);
+				si = &node->shared_info->sinstrument[ParallelWorkerNumber];
+				tuplesort_get_stats(tuplesortstate, si);
+			}
+		}
+		node->tuplesortstate = (void *) tuplesortstate;
 
 		/*
 		 * restore to user specified direction
@@ -128,18 +263,14 @@ ExecSort(PlanState *pstate)
 		node->sort_Done = true;
 		node->bounded_Done = node->bounded;
 		node->bound_Done = node->bound;
-		if (node->shared_info && node->am_worker)
-		{
-			TuplesortInstrumentation *si;
-
-			Assert(IsParallelWorker());
-			Assert(ParallelWorkerNumber <= node->shared_info->num_workers);
-			si = &node->shared_info->sinstrument[ParallelWorkerNumber];
-			tuplesort_get_stats(tuplesortstate, si);
-		}
 		SO1_printf("ExecSort: %s\n", "sorting done");
 	}
 
+	/* Workers of a parallel sort return nothing */
+	slot = node->ss.ps.ps_ResultTupleSlot;
+	if (tuplesortstate == NULL)
+		return ExecClearTuple(slot);
+
 	SO1_printf("ExecSort: %s\n",
 			   "retrieving tuple from tuplesort");
 
@@ -148,7 +279,6 @@ ExecSort(PlanState *pstate)
 	 * tuples.  Note that we only rely on slot tuple remaining valid until the
 	 * next fetch from the tuplesort.
 	 */
-	slot = node->ss.ps.ps_ResultTupleSlot;
 	(void) tuplesort_gettupleslot(tuplesortstate,
 								  ScanDirectionIsForward(dir),
 								  false, slot, NULL);
@@ -187,6 +317,16 @@ ExecInitSort(Sort *node, EState *estate, int eflags)
 										 EXEC_FLAG_BACKWARD |
 										 EXEC_FLAG_MARK)) != 0;
 
+	/*
+	 * Parallel sorts don't support random access, so a parallel-aware Sort
+	 * has to sort again to rewind.  It can't be asked for the rest.
+	 */
+	if (node->plan.parallel_aware)
+	{
+		Assert((eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)) == 0);
+		sortstate->randomAccess = false;
+	}
+
 	sortstate->bounded = false;
 	sortstate->sort_Done = false;
 	sortstate->tuplesortstate = NULL;
@@ -349,20 +489,32 @@ ExecReScanSort(SortState *node)
 /* ----------------------------------------------------------------
  *		ExecSortEstimate
  *
- *		Estimate space required to propagate sort statistics.
+ *		Estimate space required for a parallel sort, and to propagate
+ *		sort statistics.
  * ----------------------------------------------------------------
  */
 void
 ExecSortEstimate(SortState *node, ParallelContext *pcxt)
 {
-	Size		size;
+	Size		size = 0;
 
 	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	if (node->ss.ps.instrument && pcxt->nworkers > 0)
+	{
+		size = mul_size(pcxt->nworkers, sizeof(TuplesortInstrumentation));
+		size = add_size(size, offsetof(SharedSortInfo, sinstrument));
+	}
+
+	/* the worker tuplesorts include one in the leader */
+	if (node->ss.ps.plan->parallel_aware && pcxt->nworkers > 0)
+	{
+		size = add_size(size, MAXALIGN(sizeof(ParallelSortState)));
+		size = add_size(size, tuplesort_estimate_shared(pcxt->nworkers + 1));
+	}
+
+	if (size == 0)
 		return;
 
-	size = mul_size(pcxt->nworkers, sizeof(TuplesortInstrumentation));
-	size = add_size(size, offsetof(SharedSortInfo, sinstrument));
 	shm_toc_estimate_chunk(&pcxt->estimator, size);
 	shm_toc_estimate_keys(&pcxt->estimator, 1);
 }
@@ -370,39 +522,114 @@ ExecSortEstimate(SortState *node, ParallelContext *pcxt)
 /* ----------------------------------------------------------------
  *		ExecSortInitializeDSM
  *
- *		Initialize DSM space for sort statistics.
+ *		Initialize DSM space for a parallel sort, and for sort statistics.
  * ----------------------------------------------------------------
  */
 void
 ExecSortInitializeDSM(SortState *node, ParallelContext *pcxt)
 {
-	Size		size;
+	ParallelSortState *pstate = NULL;
+	Size		size = 0;
+	Size		sharedsort_size = 0;
+	Size		info_size = 0;
+	char	   *chunk;
 
-	/* don't need this if not instrumenting or no workers */
-	if (!node->ss.ps.instrument || pcxt->nworkers == 0)
+	if (pcxt->nworkers == 0)
 		return;
 
-	size = offsetof(SharedSortInfo, sinstrument)
-		+ pcxt->nworkers * sizeof(TuplesortInstrumentation);
-	node->shared_info = shm_toc_allocate(pcxt->toc, size);
-	/* ensure any unfilled slots will contain zeroes */
-	memset(node->shared_info, 0, size);
-	node->shared_info->num_workers = pcxt->nworkers;
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		sharedsort_size = tuplesort_estimate_shared(pcxt->nworkers + 1);
+		size = MAXALIGN(sizeof(ParallelSortState)) + sharedsort_size;
+	}
+	if (node->ss.ps.instrument)
+	{
+		info_size = offsetof(SharedSortInfo, sinstrument)
+			+ pcxt->nworkers * sizeof(TuplesortInstrumentation);
+		size += info_size;
+	}
+
+	if (size == 0)
+		return;
+
+	chunk = shm_toc_allocate(pcxt->toc, size);
+
+	if (node->ss.ps.plan->parallel_aware)
+	{
+		pstate = (ParallelSortState *) chunk;
+		ConditionVariableInit(&pstate->cv);
+		SpinLockInit(&pstate->mutex);
+		pstate->nparticipantsdone = 0;
+		pstate->info_offset = 0;
+		tuplesort_initialize_shared(ParallelSortStateGetSharedsort(pstate),
+									pcxt->nworkers + 1,
+									pcxt->seg);
+		node->pstate = pstate;
+		node->pcxt = pcxt;
+		chunk += MAXALIGN(sizeof(ParallelSortState)) + sharedsort_size;
+	}
+
+	if (node->ss.ps.instrument)
+	{
+		node->shared_info = (SharedSortInfo *) chunk;
+		/* ensure any unfilled slots will contain zeroes */
+		memset(node->shared_info, 0, info_size);
+		node->shared_info->num_workers = pcxt->nworkers;
+		if (pstate)
+			pstate->info_offset = chunk - (char *) pstate;
+	}
+
 	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id,
-				   node->shared_info);
+				   pstate ? (void *) pstate : (void *) node->shared_info);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecSortReInitializeDSM
+ *
+ *		Reset shared state before beginning a fresh parallel sort.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSortReInitializeDSM(SortState *node, ParallelContext *pcxt)
+{
+	ParallelSortState *pstate = node->pstate;
+
+	if (pstate == NULL)
+		return;
+
+	/*
+	 * The leader may not have been rescanned yet, and still have the merge
+	 * of the previous sort open.  That's fine, since the files it has open
+	 * stay readable after being removed.
+	 */
+	pstate->nparticipantsdone = 0;
+	tuplesort_reset_shared(ParallelSortStateGetSharedsort(pstate));
 }
 
 /* ----------------------------------------------------------------
  *		ExecSortInitializeWorker
  *
- *		Attach worker to DSM space for sort statistics.
+ *		Attach worker to DSM space for a parallel sort, and for sort
+ *		statistics.
  * ----------------------------------------------------------------
  */
 void
 ExecSortInitializeWorker(SortState *node, ParallelWorkerContext *pwcxt)
 {
-	node->shared_info =
-		shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
+	void	   *chunk;
+
+	chunk = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, true);
+	if (chunk != NULL && node->ss.ps.plan->parallel_aware)
+	{
+		node->pstate = (ParallelSortState *) chunk;
+		tuplesort_attach_shared(ParallelSortStateGetSharedsort(node->pstate),
+								pwcxt->seg);
+		if (node->pstate->info_offset != 0)
+			node->shared_info = (SharedSortInfo *)
+				((char *) chunk + node->pstate->info_offset);
+	}
+	else
+		node->shared_info = chunk;
 	node->am_worker = true;
 }
 
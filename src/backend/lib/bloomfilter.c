@@ -128,6 +128,19 @@ bloom_free(bloom_filter *filter)
 	pfree(filter);
 }
 
+/*
+ * Total size of Bloom filter, in bytes
+ *
+ * The filter is a single chunk of memory, so this many bytes can be copied
+ * to pass it to other code, or even to another process.
+ */
+Size
+bloom_total_size(bloom_filter *filter)
+{
+	return offsetof(bloom_filter, bitset) +
+		sizeof(unsigned char) * (filter->m / BITS_PER_BYTE);
+}
+
 /*
  * Add element to Bloom filter
  */
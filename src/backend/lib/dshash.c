@@ -52,15 +52,6 @@ struct dshash_table_item
 	/* The user's entry object follows here.  See ENTRY_FROM_ITEM(item). */
 };
 
-/*
- * The number of partitions for locking purposes.  This is set to match
- * NUM_BUFFER_PARTITIONS for now, on the basis that whatever's good enough for
- * the buffer pool must be good enough for any other purpose.  This could
- * become a runtime parameter in future.
- */
-#define DSHASH_NUM_PARTITIONS_LOG2 7
-#define DSHASH_NUM_PARTITIONS (1 << DSHASH_NUM_PARTITIONS_LOG2)
-
 /* A magic value used to identify our hash tables. */
 #define DSHASH_MAGIC 0x75ff6a20
 
@@ -592,6 +583,59 @@ dshash_memhash(const void *v, size_t size, void *arg)
 	return tag_hash(v, size);
 }
 
+/*
+ * Begin iterating over the entries in one lock partition of the hash table.
+ *
+ * No lock is held during the iteration, so the caller must make sure that no
+ * entries are inserted or deleted by any backend until it is finished.  Under
+ * that rule, different partitions can be scanned concurrently by different
+ * backends, which is how a table that has been built in parallel can also be
+ * read in parallel.
+ */
+void
+dshash_partition_iterate_begin(dshash_table *hash_table, int partition,
+							   dshash_partition_iterator *iter)
+{
+	Assert(hash_table->control->magic == DSHASH_MAGIC);
+	Assert(partition >= 0 && partition < DSHASH_NUM_PARTITIONS);
+	Assert(!hash_table->find_locked);
+
+	/* Take the lock just long enough to see the current bucket array. */
+	LWLockAcquire(PARTITION_LOCK(hash_table, partition), LW_SHARED);
+	ensure_valid_bucket_pointers(hash_table);
+	LWLockRelease(PARTITION_LOCK(hash_table, partition));
+
+	iter->hash_table = hash_table;
+	iter->bucket = BUCKET_INDEX_FOR_PARTITION(partition,
+											  hash_table->size_log2);
+	iter->end_bucket = BUCKET_INDEX_FOR_PARTITION(partition + 1,
+												  hash_table->size_log2);
+	iter->item = InvalidDsaPointer;
+}
+
+/*
+ * Return the next entry of the partition being iterated over, or NULL if
+ * there are no more.
+ */
+void *
+dshash_partition_iterate_next(dshash_partition_iterator *iter)
+{
+	dshash_table *hash_table = iter->hash_table;
+	dshash_table_item *item;
+
+	while (!DsaPointerIsValid(iter->item))
+	{
+		if (iter->bucket >= iter->end_bucket)
+			return NULL;
+		iter->item = hash_table->buckets[iter->bucket++];
+	}
+
+	item = dsa_get_address(hash_table->area, iter->item);
+	iter->item = item->next;
+
+	return ENTRY_FROM_ITEM(item);
+}
+
 /*
  * Print debugging information about the internal state of the hash table to
  * stderr.  The caller must hold no partition locks.
@@ -32,6 +32,7 @@
 #include "libpq/libpq.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/pg_iovec.h"
 #include "tcop/tcopprot.h"
 #include "utils/memutils.h"
 #include "storage/ipc.h"
@@ -238,6 +239,42 @@ secure_raw_read(Port *port, void *ptr, size_t len)
 }
 
 
+/*
+ * Wait until the socket becomes ready for the operation a write on a secure
+ * connection needs to make progress, processing interrupts meanwhile.
+ */
+static void
+secure_wait_for_write(Port *port, int waitfor)
+{
+	WaitEvent	event;
+
+	Assert(waitfor);
+
+	ModifyWaitEvent(FeBeWaitSet, 0, waitfor, NULL);
+
+	WaitEventSetWait(FeBeWaitSet, -1 /* no timeout */ , &event, 1,
+					 WAIT_EVENT_CLIENT_WRITE);
+
+	/* See comments in secure_read. */
+	if (event.events & WL_POSTMASTER_DEATH)
+		ereport(FATAL,
+				(errcode(ERRCODE_ADMIN_SHUTDOWN),
+				 errmsg("terminating connection due to unexpected postmaster exit")));
+
+	/* Handle interrupt. */
+	if (event.events & WL_LATCH_SET)
+	{
+		ResetLatch(MyLatch);
+		ProcessClientWriteInterrupt(true);
+
+		/*
+		 * We'll retry the write. Most likely it will return immediately
+		 * because there's still no data available, and we'll wait for the
+		 * socket to become ready again.
+		 */
+	}
+}
+
 /*
  *	Write data to a secure connection.
  */
@@ -263,41 +300,50 @@ retry:
 
 	if (n < 0 && !port->noblock && (errno == EWOULDBLOCK || errno == EAGAIN))
 	{
-		WaitEvent	event;
+		secure_wait_for_write(port, waitfor);
+		goto retry;
+	}
 
-		Assert(waitfor);
+	/*
+	 * Process interrupts that happened while (or before) sending. Note that
+	 * we signal that we're not blocking, which will prevent some types of
+	 * interrupts from being processed.
+	 */
+	ProcessClientWriteInterrupt(false);
 
-		ModifyWaitEvent(FeBeWaitSet, 0, waitfor, NULL);
+	return n;
+}
 
-		WaitEventSetWait(FeBeWaitSet, -1 /* no timeout */ , &event, 1,
-						 WAIT_EVENT_CLIENT_WRITE);
+/*
+ *	Write a vector of buffers to a secure connection.
+ *
+ * Like secure_write, but gathers the data from iovcnt buffers, so that
+ * callers needn't copy them into one contiguous buffer first.  Like any
+ * write, this may send less than the total length.  TLS records are built
+ * from one buffer at a time, so with SSL only the first buffer is written.
+ */
+ssize_t
+secure_writev(Port *port, const struct iovec *iov, int iovcnt)
+{
+	ssize_t		n;
 
-		/* See comments in secure_read. */
-		if (event.events & WL_POSTMASTER_DEATH)
-			ereport(FATAL,
-					(errcode(ERRCODE_ADMIN_SHUTDOWN),
-					 errmsg("terminating connection due to unexpected postmaster exit")));
+	Assert(iovcnt > 0);
 
-		/* Handle interrupt. */
-		if (event.events & WL_LATCH_SET)
-		{
-			ResetLatch(MyLatch);
-			ProcessClientWriteInterrupt(true);
+#ifdef USE_SSL
+	if (port->ssl_in_use)
+		return secure_write(port, iov[0].iov_base, iov[0].iov_len);
+#endif
 
-			/*
-			 * We'll retry the write. Most likely it will return immediately
-			 * because there's still no data available, and we'll wait for the
-			 * socket to become ready again.
-			 */
-		}
+retry:
+	n = secure_raw_writev(port, iov, iovcnt);
+
+	if (n < 0 && !port->noblock && (errno == EWOULDBLOCK || errno == EAGAIN))
+	{
+		secure_wait_for_write(port, WL_SOCKET_WRITEABLE);
 		goto retry;
 	}
 
-	/*
-	 * Process interrupts that happened while (or before) sending. Note that
-	 * we signal that we're not blocking, which will prevent some types of
-	 * interrupts from being processed.
-	 */
+	/* See comments in secure_write. */
 	ProcessClientWriteInterrupt(false);
 
 	return n;
@@ -318,3 +364,20 @@ secure_raw_write(Port *port, const void *ptr, size_t len)
 
 	return n;
 }
+
+ssize_t
+secure_raw_writev(Port *port, const struct iovec *iov, int iovcnt)
+{
+#ifndef WIN32
+	struct msghdr msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = (struct iovec *) iov;
+	msg.msg_iovlen = iovcnt;
+
+	return sendmsg(port->sock, &msg, 0);
+#else
+	/* no gathering write for sockets here; send the first buffer only */
+	return secure_raw_write(port, iov[0].iov_base, iov[0].iov_len);
+#endif
+}
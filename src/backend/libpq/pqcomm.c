@@ -42,10 +42,13 @@
  *		StreamServerPort	- Open postmaster's server port
  *		StreamConnection	- Create new connection with client
  *		StreamClose			- Close a client/backend connection
+ *		StreamSendSocket	- Pass a client socket to another process
+ *		StreamReceiveSocket - Receive a client socket from another process
  *		TouchSocketFiles	- Protect socket files against /tmp cleaners
  *		pq_init			- initialize libpq at backend startup
  *		pq_comm_reset	- reset libpq during error recovery
  *		pq_close		- shutdown libpq at backend exit
+ *		pq_switch_port	- make another client connection the current one
  *
  * low-level I/O:
  *		pq_getbytes		- get a known number of bytes from connection
@@ -57,6 +60,8 @@
  *		pq_flush		- flush pending output
  *		pq_flush_if_writable - flush pending output if writable without blocking
  *		pq_getbyte_if_available - get a byte if available without blocking
+ *		pq_buffer_has_data	- is any buffered input available to read?
+ *		pq_enable_compression - compress all further traffic
  *
  * message-level I/O (and old-style-COPY-OUT cruft):
  *		pq_putmessage	- send a normal message (suppressed in COPY OUT mode)
@@ -89,9 +94,11 @@
 #endif
 
 #include "common/ip.h"
+#include "common/zpq_stream.h"
 #include "libpq/libpq.h"
 #include "miscadmin.h"
 #include "port/pg_bswap.h"
+#include "port/pg_iovec.h"
 #include "storage/ipc.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
@@ -120,6 +127,8 @@
  */
 int			Unix_socket_permissions;
 char	   *Unix_socket_group;
+bool		libpq_compression = true;
+bool		libpq_compression_over_ssl = false;
 
 /* Where the Unix socket files are (list of palloc'd strings) */
 static List *sock_paths = NIL;
@@ -127,13 +136,25 @@ static List *sock_paths = NIL;
 /*
  * Buffers for low-level I/O.
  *
- * The receive buffer is fixed size. Send buffer is usually 8k, but can be
- * enlarged by pq_putmessage_noblock() if the message doesn't fit otherwise.
+ * The receive buffer is fixed size.  The send buffer starts out at 8k.  When
+ * a connection sends large messages, such as DataRow messages of a wide
+ * result set, it grows so that a few such messages can be batched into one
+ * write, up to PQ_SEND_BUFFER_MAX_SIZE.  Message bodies too big to be worth
+ * copying are sent straight from the caller's memory instead, gathered with
+ * the buffered data in one vectored write.  pq_putmessage_noblock() can
+ * enlarge the buffer beyond the maximum if the message doesn't fit otherwise.
  */
 
 #define PQ_SEND_BUFFER_SIZE 8192
+#define PQ_SEND_BUFFER_MAX_SIZE (128 * 1024)
 #define PQ_RECV_BUFFER_SIZE 8192
 
+/*
+ * When a message takes more than 1/PQ_SEND_BUFFER_MESSAGES of the send
+ * buffer, the buffer is enlarged to hold that many messages of its size.
+ */
+#define PQ_SEND_BUFFER_MESSAGES 4
+
 static char *PqSendBuffer;
 static int	PqSendBufferSize;	/* Size send buffer */
 static int	PqSendPointer;		/* Next index to store a byte in PqSendBuffer */
@@ -149,6 +170,7 @@ static int	PqRecvLength;		/* End of data available in PqRecvBuffer */
 static bool PqCommBusy;			/* busy sending data to the client */
 static bool PqCommReadingMsg;	/* in the middle of reading a message */
 static bool DoingCopyOut;		/* in old-protocol COPY OUT processing */
+static int	LastReportedSendErrno;	/* to suppress duplicate send errors */
 
 
 /* Internal functions */
@@ -163,7 +185,12 @@ static void socket_putmessage_noblock(char msgtype, const char *s, size_t len);
 static void socket_startcopyout(void);
 static void socket_endcopyout(bool errorAbort);
 static int	internal_putbytes(const char *s, size_t len);
+static void internal_grow_send_buffer(size_t msglen);
 static int	internal_flush(void);
+static int	internal_flush_with_data(const char *s, size_t len);
+static ssize_t socket_read(void *ptr, size_t len);
+static ssize_t zpq_tx_port(void *arg, const void *data, size_t size);
+static ssize_t zpq_rx_port(void *arg, void *data, size_t size);
 
 #ifdef HAVE_UNIX_SOCKETS
 static int	Lock_AF_UNIX(char *unixSocketDir, char *unixSocketPath);
@@ -227,6 +254,95 @@ pq_init(void)
 	AddWaitEventToSet(FeBeWaitSet, WL_POSTMASTER_DEATH, -1, NULL, NULL);
 }
 
+/* --------------------------------
+ *		pq_switch_port - make another client connection the current one
+ *
+ * This is used by backends that serve several pooled client sessions.  Any
+ * data still buffered for the previous connection is discarded, so the
+ * caller should flush pending output first, as is a message we were in the
+ * middle of reading when that connection was lost.  port may be NULL, in
+ * which case there is no current connection until the next call.
+ * --------------------------------
+ */
+void
+pq_switch_port(Port *port)
+{
+	Assert(!PqCommBusy);
+
+	PqSendPointer = PqSendStart = PqRecvPointer = PqRecvLength = 0;
+	PqCommReadingMsg = false;
+	DoingCopyOut = false;
+	LastReportedSendErrno = 0;
+
+	/* Don't let the next client inherit a send buffer enlarged for this one */
+	if (PqSendBufferSize != PQ_SEND_BUFFER_SIZE)
+	{
+		pfree(PqSendBuffer);
+		PqSendBufferSize = PQ_SEND_BUFFER_SIZE;
+		PqSendBuffer = MemoryContextAlloc(TopMemoryContext, PqSendBufferSize);
+	}
+
+	if (FeBeWaitSet != NULL)
+	{
+		FreeWaitEventSet(FeBeWaitSet);
+		FeBeWaitSet = NULL;
+	}
+
+	MyProcPort = port;
+	if (port == NULL)
+		return;
+
+#ifndef WIN32
+	if (!pg_set_noblock(port->sock))
+		ereport(COMMERROR,
+				(errmsg("could not set socket to nonblocking mode: %m")));
+#endif
+
+	FeBeWaitSet = CreateWaitEventSet(TopMemoryContext, 3);
+	AddWaitEventToSet(FeBeWaitSet, WL_SOCKET_WRITEABLE, port->sock,
+					  NULL, NULL);
+	AddWaitEventToSet(FeBeWaitSet, WL_LATCH_SET, -1, MyLatch, NULL);
+	AddWaitEventToSet(FeBeWaitSet, WL_POSTMASTER_DEATH, -1, NULL, NULL);
+}
+
+/* --------------------------------
+ *		pq_enable_compression - compress all further traffic
+ *
+ * This is called right after a successful authentication exchange, if the
+ * client asked for compression with an algorithm we support.  The client is
+ * told so with a CompressionAck message, which follows AuthenticationOk and
+ * is the last thing sent uncompressed; it compresses everything it sends
+ * after receiving that.
+ * --------------------------------
+ */
+void
+pq_enable_compression(const char *algorithm)
+{
+	ZpqStream  *zs;
+
+	Assert(MyProcPort->zstream == NULL);
+
+	/*
+	 * Create the stream first, so that we can still report failure to the
+	 * client.  Any input already received must be compressed already.
+	 */
+	zs = zpq_create(zpq_tx_port, zpq_rx_port, MyProcPort,
+					PqRecvBuffer + PqRecvPointer, PqRecvLength - PqRecvPointer);
+	if (zs == NULL)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+	PqRecvPointer = PqRecvLength = 0;
+
+	(void) socket_putmessage('z', algorithm, strlen(algorithm) + 1);
+	(void) socket_flush();
+
+	MyProcPort->zstream = zs;
+
+	ereport(DEBUG1,
+			(errmsg("protocol compression enabled, using %s", algorithm)));
+}
+
 /* --------------------------------
  *		socket_comm_reset - reset libpq during error recovery
  *
@@ -846,6 +962,139 @@ StreamClose(pgsocket sock)
 	closesocket(sock);
 }
 
+/*
+ * StreamSendSocket -- pass a client socket to another process
+ *
+ * chan must be a Unix-domain datagram socket connected to the receiving
+ * process.  The socket is sent along with len bytes of data describing it,
+ * as a single datagram.  A datagram without a socket (sock is
+ * PGINVALID_SOCKET) can be used to send control messages.  If nowait is
+ * true, fail with EWOULDBLOCK rather than wait when the receiver's queue is
+ * full.
+ *
+ * RETURNS: STATUS_OK or STATUS_ERROR, with errno set
+ */
+int
+StreamSendSocket(pgsocket chan, pgsocket sock, const void *data, size_t len,
+				 bool nowait)
+{
+#ifndef WIN32
+	struct msghdr msg;
+	struct iovec iov;
+	union
+	{
+		struct cmsghdr cmsg;
+		char		buf[CMSG_SPACE(sizeof(int))];
+	}			control;
+	ssize_t		rc;
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = (void *) data;
+	iov.iov_len = len;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+
+	if (sock != PGINVALID_SOCKET)
+	{
+		struct cmsghdr *cmsg;
+
+		memset(&control, 0, sizeof(control));
+		msg.msg_control = control.buf;
+		msg.msg_controllen = sizeof(control.buf);
+
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &sock, sizeof(int));
+	}
+
+	do
+	{
+		rc = sendmsg(chan, &msg, nowait ? MSG_DONTWAIT : 0);
+	} while (rc < 0 && errno == EINTR);
+
+	if (rc < 0)
+		return STATUS_ERROR;
+	if (rc != len)
+	{
+		errno = EMSGSIZE;
+		return STATUS_ERROR;
+	}
+	return STATUS_OK;
+#else
+	errno = ENOSYS;
+	return STATUS_ERROR;
+#endif
+}
+
+/*
+ * StreamReceiveSocket -- receive a client socket sent by StreamSendSocket
+ *
+ * Up to *len bytes of the accompanying data are stored into data, and *len
+ * is set to the number of bytes received.  If nowait is true and no message
+ * is queued, fail with EWOULDBLOCK.
+ *
+ * RETURNS: the received socket, or PGINVALID_SOCKET if the message didn't
+ * carry one.  On failure, returns PGINVALID_SOCKET with *len set to -1 and
+ * errno set.
+ */
+pgsocket
+StreamReceiveSocket(pgsocket chan, void *data, ssize_t *len, bool nowait)
+{
+#ifndef WIN32
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	union
+	{
+		struct cmsghdr cmsg;
+		char		buf[CMSG_SPACE(sizeof(int))];
+	}			control;
+	pgsocket	sock = PGINVALID_SOCKET;
+	ssize_t		rc;
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = data;
+	iov.iov_len = *len;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buf;
+	msg.msg_controllen = sizeof(control.buf);
+
+	do
+	{
+		rc = recvmsg(chan, &msg, nowait ? MSG_DONTWAIT : 0);
+	} while (rc < 0 && errno == EINTR);
+
+	*len = rc;
+	if (rc < 0)
+		return PGINVALID_SOCKET;
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+	{
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+			memcpy(&sock, CMSG_DATA(cmsg), sizeof(int));
+	}
+
+	/* A truncated message is no use to anybody */
+	if (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))
+	{
+		if (sock != PGINVALID_SOCKET)
+			closesocket(sock);
+		*len = -1;
+		errno = EMSGSIZE;
+		return PGINVALID_SOCKET;
+	}
+
+	return sock;
+#else
+	*len = -1;
+	errno = ENOSYS;
+	return PGINVALID_SOCKET;
+#endif
+}
+
 /*
  * TouchSocketFiles -- mark socket files as recently accessed
  *
@@ -929,6 +1178,36 @@ socket_set_nonblocking(bool nonblocking)
 	MyProcPort->noblock = nonblocking;
 }
 
+/* --------------------------------
+ *		socket_read - read from the client, decompressing if need be
+ *
+ *		Returns like secure_read(), or ZPQ_STREAM_ERROR if the input
+ *		can't be decompressed.
+ * --------------------------------
+ */
+static ssize_t
+socket_read(void *ptr, size_t len)
+{
+	if (MyProcPort->zstream)
+		return zpq_read(MyProcPort->zstream, ptr, len);
+	return secure_read(MyProcPort, ptr, len);
+}
+
+/*
+ * Transmit and receive functions of the compression stream.
+ */
+static ssize_t
+zpq_tx_port(void *arg, const void *data, size_t size)
+{
+	return secure_write((Port *) arg, (void *) data, size);
+}
+
+static ssize_t
+zpq_rx_port(void *arg, void *data, size_t size)
+{
+	return secure_read((Port *) arg, data, size);
+}
+
 /* --------------------------------
  *		pq_recvbuf - load some bytes into the input buffer
  *
@@ -960,11 +1239,19 @@ pq_recvbuf(void)
 	{
 		int			r;
 
-		r = secure_read(MyProcPort, PqRecvBuffer + PqRecvLength,
+		r = socket_read(PqRecvBuffer + PqRecvLength,
 						PQ_RECV_BUFFER_SIZE - PqRecvLength);
 
 		if (r < 0)
 		{
+			if (r == ZPQ_STREAM_ERROR)
+			{
+				ereport(COMMERROR,
+						(errcode(ERRCODE_PROTOCOL_VIOLATION),
+						 errmsg("could not decompress data from client: %s",
+								zpq_error(MyProcPort->zstream))));
+				return EOF;
+			}
 			if (errno == EINTR)
 				continue;		/* Ok if interrupted */
 
@@ -1052,7 +1339,7 @@ pq_getbyte_if_available(unsigned char *c)
 	/* Put the socket into non-blocking mode */
 	socket_set_nonblocking(true);
 
-	r = secure_read(MyProcPort, c, 1);
+	r = socket_read(c, 1);
 	if (r < 0)
 	{
 		/*
@@ -1060,7 +1347,15 @@ pq_getbyte_if_available(unsigned char *c)
 		 * EINTR really shouldn't happen with a non-blocking socket). Report
 		 * other errors.
 		 */
-		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+		if (r == ZPQ_STREAM_ERROR)
+		{
+			ereport(COMMERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("could not decompress data from client: %s",
+							zpq_error(MyProcPort->zstream))));
+			r = EOF;
+		}
+		else if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
 			r = 0;
 		else
 		{
@@ -1084,6 +1379,18 @@ pq_getbyte_if_available(unsigned char *c)
 	return r;
 }
 
+/* --------------------------------
+ *		pq_buffer_has_data		- is any buffered input available to read?
+ *
+ * This will *not* attempt to read more data.
+ * --------------------------------
+ */
+bool
+pq_buffer_has_data(void)
+{
+	return (PqRecvPointer < PqRecvLength);
+}
+
 /* --------------------------------
  *		pq_getbytes		- get a known number of bytes from connection
  *
@@ -1390,6 +1697,33 @@ internal_putbytes(const char *s, size_t len)
 	return 0;
 }
 
+/* --------------------------------
+ *		internal_grow_send_buffer - adapt send buffer to the message size
+ *
+ * Called before a message of msglen bytes, header included, is buffered.
+ * If such messages are large compared to the send buffer, enlarge it so
+ * that several of them can be sent with one write.  Pending data is kept.
+ * --------------------------------
+ */
+static void
+internal_grow_send_buffer(size_t msglen)
+{
+	int			newsize;
+
+	if (PqSendBufferSize >= PQ_SEND_BUFFER_MAX_SIZE ||
+		msglen * PQ_SEND_BUFFER_MESSAGES <= (size_t) PqSendBufferSize)
+		return;
+
+	newsize = PqSendBufferSize;
+	while (newsize < PQ_SEND_BUFFER_MAX_SIZE &&
+		   msglen * PQ_SEND_BUFFER_MESSAGES > (size_t) newsize)
+		newsize *= 2;
+	newsize = Min(newsize, PQ_SEND_BUFFER_MAX_SIZE);
+
+	PqSendBuffer = repalloc(PqSendBuffer, newsize);
+	PqSendBufferSize = newsize;
+}
+
 /* --------------------------------
  *		socket_flush		- flush pending output
  *
@@ -1421,16 +1755,65 @@ socket_flush(void)
 static int
 internal_flush(void)
 {
-	static int	last_reported_send_errno = 0;
-
-	char	   *bufptr = PqSendBuffer + PqSendStart;
-	char	   *bufend = PqSendBuffer + PqSendPointer;
+	return internal_flush_with_data(NULL, 0);
+}
 
-	while (bufptr < bufend)
+/* --------------------------------
+ *		internal_flush_with_data - flush pending output, then len bytes at s
+ *
+ * The data at s is sent directly from the caller's memory, gathered with the
+ * buffered output into vectored writes, rather than copied into the send
+ * buffer first.  Callers passing data must have put the socket in blocking
+ * mode, since the data can't be left behind for a later flush.
+ *
+ * Returns 0 if OK (meaning everything was sent, or operation would block
+ * and the socket is in non-blocking mode), or EOF if trouble.
+ * --------------------------------
+ */
+static int
+internal_flush_with_data(const char *s, size_t len)
+{
+	while (PqSendStart < PqSendPointer || len > 0 ||
+		   (MyProcPort->zstream && zpq_buffered_tx(MyProcPort->zstream)))
 	{
-		int			r;
+		struct iovec iov[2];
+		int			iovcnt = 0;
+		ssize_t		r;
+
+		if (PqSendStart < PqSendPointer)
+		{
+			iov[iovcnt].iov_base = PqSendBuffer + PqSendStart;
+			iov[iovcnt].iov_len = PqSendPointer - PqSendStart;
+			iovcnt++;
+		}
+		if (len > 0)
+		{
+			iov[iovcnt].iov_base = (char *) s;
+			iov[iovcnt].iov_len = len;
+			iovcnt++;
+		}
 
-		r = secure_write(MyProcPort, bufptr, bufend - bufptr);
+		if (MyProcPort->zstream)
+		{
+			/*
+			 * Compress one piece at a time.  With nothing left to compress,
+			 * this just sends what the stream still holds, returning 0 once
+			 * that is all out.
+			 */
+			if (iovcnt == 0)
+			{
+				r = zpq_write(MyProcPort->zstream, NULL, 0);
+				if (r == 0)
+					continue;
+			}
+			else
+				r = zpq_write(MyProcPort->zstream, iov[0].iov_base,
+							  iov[0].iov_len);
+		}
+		else if (iovcnt == 1)
+			r = secure_write(MyProcPort, iov[0].iov_base, iov[0].iov_len);
+		else
+			r = secure_writev(MyProcPort, iov, iovcnt);
 
 		if (r <= 0)
 		{
@@ -1444,6 +1827,7 @@ internal_flush(void)
 			if (errno == EAGAIN ||
 				errno == EWOULDBLOCK)
 			{
+				Assert(len == 0);
 				return 0;
 			}
 
@@ -1456,9 +1840,9 @@ internal_flush(void)
 			 * might write quite a bit of data before we get to a safe query
 			 * abort point.  So, suppress duplicate log messages.
 			 */
-			if (errno != last_reported_send_errno)
+			if (errno != LastReportedSendErrno)
 			{
-				last_reported_send_errno = errno;
+				LastReportedSendErrno = errno;
 				ereport(COMMERROR,
 						(errcode_for_socket_access(),
 						 errmsg("could not send data to client: %m")));
@@ -1468,7 +1852,7 @@ internal_flush(void)
 			 * We drop the buffered data anyway so that processing can
 			 * continue, even though we'll probably quit soon. We also set a
 			 * flag that'll cause the next CHECK_FOR_INTERRUPTS to terminate
-			 * the connection.
+			 * the connection, or in a session pool worker, just the session.
 			 */
 			PqSendStart = PqSendPointer = 0;
 			ClientConnectionLost = 1;
@@ -1476,9 +1860,23 @@ internal_flush(void)
 			return EOF;
 		}
 
-		last_reported_send_errno = 0;	/* reset after any successful send */
-		bufptr += r;
-		PqSendStart += r;
+		LastReportedSendErrno = 0;	/* reset after any successful send */
+
+		/* Consume the buffered output first, then the caller's data */
+		if (PqSendStart < PqSendPointer)
+		{
+			int			pending = PqSendPointer - PqSendStart;
+
+			if (r < pending)
+			{
+				PqSendStart += r;
+				continue;
+			}
+			r -= pending;
+			PqSendStart = PqSendPointer = 0;
+		}
+		s += r;
+		len -= r;
 	}
 
 	PqSendStart = PqSendPointer = 0;
@@ -1497,7 +1895,7 @@ socket_flush_if_writable(void)
 	int			res;
 
 	/* Quick exit if nothing to do */
-	if (PqSendPointer == PqSendStart)
+	if (!socket_is_send_pending())
 		return 0;
 
 	/* No-op if reentrant call */
@@ -1520,6 +1918,8 @@ socket_flush_if_writable(void)
 static bool
 socket_is_send_pending(void)
 {
+	if (MyProcPort->zstream && zpq_buffered_tx(MyProcPort->zstream))
+		return true;
 	return (PqSendStart < PqSendPointer);
 }
 
@@ -1562,6 +1962,7 @@ socket_putmessage(char msgtype, const char *s, size_t len)
 	if (DoingCopyOut || PqCommBusy)
 		return 0;
 	PqCommBusy = true;
+	internal_grow_send_buffer(1 + 4 + len);
 	if (msgtype)
 		if (internal_putbytes(&msgtype, 1))
 			goto fail;
@@ -1573,7 +1974,20 @@ socket_putmessage(char msgtype, const char *s, size_t len)
 		if (internal_putbytes((char *) &n32, 4))
 			goto fail;
 	}
-	if (internal_putbytes(s, len))
+
+	/*
+	 * If the body doesn't fit in the buffer, and is too big to be worth
+	 * copying in pieces, send it together with the buffered output without
+	 * copying it at all.
+	 */
+	if (len >= PQ_SEND_BUFFER_SIZE &&
+		len > (size_t) (PqSendBufferSize - PqSendPointer))
+	{
+		socket_set_nonblocking(false);
+		if (internal_flush_with_data(s, len))
+			goto fail;
+	}
+	else if (internal_putbytes(s, len))
 		goto fail;
 	PqCommBusy = false;
 	return 0;
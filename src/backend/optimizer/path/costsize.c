@@ -80,7 +80,10 @@
 #include "access/htup_details.h"
 #include "access/tsmapi.h"
 #include "executor/executor.h"
+#include "executor/nodeAgg.h"
 #include "executor/nodeHash.h"
+#include "executor/nodeIncrementalSort.h"
+#include "executor/nodeResultCache.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
@@ -128,16 +131,22 @@ bool		enable_indexonlyscan = true;
 bool		enable_bitmapscan = true;
 bool		enable_tidscan = true;
 bool		enable_sort = true;
+bool		enable_incrementalsort = true;
 bool		enable_hashagg = true;
 bool		enable_nestloop = true;
 bool		enable_material = true;
+bool		enable_resultcache = true;
 bool		enable_mergejoin = true;
 bool		enable_hashjoin = true;
+bool		enable_runtime_filter = true;
 bool		enable_gathermerge = true;
 bool		enable_partitionwise_join = false;
 bool		enable_partitionwise_aggregate = false;
 bool		enable_parallel_append = true;
 bool		enable_parallel_hash = true;
+bool		enable_parallel_hashagg = true;
+bool		enable_parallel_sort = true;
+bool		enable_async_append = true;
 
 typedef struct
 {
@@ -151,6 +160,9 @@ static MergeScanSelCache *cached_scansel(PlannerInfo *root,
 			   PathKey *pathkey);
 static void cost_rescan(PlannerInfo *root, Path *path,
 			Cost *rescan_startup_cost, Cost *rescan_total_cost);
+static void cost_resultcache_rescan(PlannerInfo *root, ResultCachePath *rcpath,
+						Cost *rescan_startup_cost, Cost *rescan_total_cost);
+static bool has_default_ndistinct(PlannerInfo *root, List *exprs);
 static bool cost_qual_eval_walker(Node *node, cost_qual_eval_context *context);
 static void get_restriction_qual_cost(PlannerInfo *root, RelOptInfo *baserel,
 						  ParamPathInfo *param_info,
@@ -419,6 +431,19 @@ cost_gather_merge(GatherMergePath *path, PlannerInfo *root,
 	if (!enable_gathermerge)
 		startup_cost += disable_cost;
 
+	/*
+	 * Below a parallel-aware Sort, the workers send nothing: the leader
+	 * merges their runs and returns all the tuples itself, and
+	 * cost_parallel_sort has already charged for that merge.
+	 */
+	if (IsA(path->subpath, SortPath) && path->subpath->parallel_aware)
+	{
+		startup_cost += parallel_setup_cost;
+		path->path.startup_cost = startup_cost + input_startup_cost;
+		path->path.total_cost = startup_cost + input_total_cost;
+		return;
+	}
+
 	/*
 	 * Add one to the number of workers to account for the leader.  This might
 	 * be overgenerous since the leader will do less work than other workers
@@ -1755,6 +1780,143 @@ cost_sort(Path *path, PlannerInfo *root,
 	path->total_cost = startup_cost + run_cost;
 }
 
+/*
+ * cost_parallel_sort
+ *	  Determines and returns the cost of a parallel-aware Sort.
+ *
+ * Each participant sorts its share of the input, 'tuples' being the number
+ * of tuples per participant as usual for partial paths, and writes it out
+ * as a run.  The leader then reads back and merges the runs of all the
+ * participants, which it can only begin once they are all written.  That
+ * last step is not divided among the participants.
+ *
+ * The other parameters are as for cost_sort.
+ */
+void
+cost_parallel_sort(Path *path, PlannerInfo *root,
+				   List *pathkeys, Cost input_cost, double tuples, int width,
+				   int sort_mem)
+{
+	double		total_tuples = tuples * get_parallel_divisor(path);
+	double		nruns = path->parallel_workers +
+	(parallel_leader_participation ? 1 : 0);
+	Cost		comparison_cost = 2.0 * cpu_operator_cost;
+	Cost		run_cost;
+
+	/* Each participant sorts its share of the input ... */
+	cost_sort(path, root, pathkeys, input_cost, tuples, width,
+			  0.0, sort_mem, -1.0);
+
+	/* ... and writes it out */
+	path->startup_cost = path->total_cost +
+		seq_page_cost * page_size(tuples, width);
+
+	/*
+	 * The leader reads back the runs, and merges them with a heap of one
+	 * entry per run.
+	 */
+	run_cost = seq_page_cost * page_size(total_tuples, width);
+	run_cost += comparison_cost * total_tuples * LOG2(Max(nruns, 2.0));
+	run_cost += cpu_operator_cost * total_tuples;
+
+	path->total_cost = path->startup_cost + run_cost;
+}
+
+/*
+ * cost_incremental_sort
+ *	  Determines and returns the cost of sorting a relation that is already
+ *	  sorted by a prefix of the required pathkeys, with an Incremental Sort.
+ *
+ * The input is sorted one batch at a time.  A batch holds at least
+ * INCRSORT_MIN_BATCH_SIZE tuples and ends at the boundary of a group of
+ * tuples with equal presorted keys, so the cost is that of sorting an
+ * average batch, times the estimated number of batches.  Only the first
+ * batch has to be read and sorted before the first tuple can be returned,
+ * which is what makes this attractive under a LIMIT.
+ *
+ * 'presorted_keys' is the number of leading pathkeys the input is sorted by
+ * 'input_startup_cost' and 'input_total_cost' are the costs of the input
+ * The other parameters are as for cost_sort.
+ */
+void
+cost_incremental_sort(Path *path, PlannerInfo *root,
+					  List *pathkeys, int presorted_keys,
+					  Cost input_startup_cost, Cost input_total_cost,
+					  double input_tuples, int width,
+					  Cost comparison_cost, int sort_mem,
+					  double limit_tuples)
+{
+	Cost		startup_cost;
+	Cost		run_cost;
+	Cost		input_run_cost = input_total_cost - input_startup_cost;
+	Path		sort_path;		/* dummy for result of cost_sort */
+	List	   *presortedExprs = NIL;
+	ListCell   *l;
+	double		num_groups;
+	double		batch_tuples;
+	double		num_batches;
+	int			i = 0;
+
+	Assert(presorted_keys > 0 && presorted_keys < list_length(pathkeys));
+
+	if (input_tuples < 2.0)
+		input_tuples = 2.0;
+
+	/*
+	 * Estimate the number of groups from the first member of each presorted
+	 * key's equivalence class.
+	 */
+	foreach(l, pathkeys)
+	{
+		PathKey    *key = (PathKey *) lfirst(l);
+		EquivalenceMember *member;
+
+		if (i++ >= presorted_keys)
+			break;
+		member = (EquivalenceMember *) linitial(key->pk_eclass->ec_members);
+		presortedExprs = lappend(presortedExprs, member->em_expr);
+	}
+	num_groups = estimate_num_groups(root, presortedExprs, input_tuples, NULL);
+	list_free(presortedExprs);
+
+	/*
+	 * Groups are seldom all the same size, and the big ones cost the most to
+	 * sort, so be pessimistic and assume that a batch is half again as big as
+	 * an average group.  That also leaves a margin for underestimating the
+	 * group size, in which case a plain sort would have been cheaper.
+	 */
+	batch_tuples = 1.5 * input_tuples / num_groups;
+	batch_tuples = Max(batch_tuples, (double) INCRSORT_MIN_BATCH_SIZE);
+	batch_tuples = Min(batch_tuples, input_tuples);
+	num_batches = input_tuples / batch_tuples;
+
+	/* Cost of sorting one batch */
+	cost_sort(&sort_path, root, pathkeys, 0.0, batch_tuples, width,
+			  comparison_cost, sort_mem, limit_tuples);
+
+	/* The first batch has to be read and sorted before returning anything */
+	startup_cost = input_startup_cost + input_run_cost / num_batches +
+		sort_path.startup_cost;
+
+	/* Read the rest of the input and sort the remaining batches */
+	run_cost = input_run_cost * (1.0 - 1.0 / num_batches) +
+		sort_path.startup_cost * (num_batches - 1.0) +
+		(sort_path.total_cost - sort_path.startup_cost) * num_batches;
+
+	/*
+	 * Charge for copying each input tuple into the sort and comparing its
+	 * presorted keys to find the group boundaries, and for resetting the sort
+	 * for every batch.
+	 */
+	run_cost += (cpu_tuple_cost + cpu_operator_cost * presorted_keys) *
+		input_tuples;
+	run_cost += 2.0 * cpu_tuple_cost * num_batches;
+
+	path->rows = input_tuples;
+	path->startup_cost = startup_cost;
+	path->total_cost = startup_cost + run_cost;
+}
+
 /*
  * append_nonpartial_cost
  *	  Estimate the cost of the non-partial paths in a Parallel Append.
@@ -2053,6 +2215,9 @@ cost_material(Path *path,
  *
  * Note: when aggstrategy == AGG_SORTED, caller must ensure that input costs
  * are for appropriately-sorted input.
+ *
+ * input_width is the width of the input tuples, which matters when a hashed
+ * Agg is expected to spill to disk.
  */
 void
 cost_agg(Path *path, PlannerInfo *root,
@@ -2060,7 +2225,7 @@ cost_agg(Path *path, PlannerInfo *root,
 		 int numGroupCols, double numGroups,
 		 List *quals,
 		 Cost input_startup_cost, Cost input_total_cost,
-		 double input_tuples)
+		 double input_tuples, double input_width)
 {
 	double		output_tuples;
 	Cost		startup_cost;
@@ -2140,6 +2305,45 @@ cost_agg(Path *path, PlannerInfo *root,
 		output_tuples = numGroups;
 	}
 
+	/*
+	 * If the hash table is expected to exceed work_mem, charge for writing
+	 * the input out to disk and reading it back.  Each pass over it divides
+	 * the groups into up to hash_agg_max_partitions() partitions, and it
+	 * takes as many passes as are needed to make the partitions small enough
+	 * to fit in memory.  Like in cost_sort, assume that 3/4ths of the page
+	 * accesses are sequential.
+	 */
+	if (aggstrategy == AGG_HASHED || aggstrategy == AGG_MIXED)
+	{
+		double		hashentrysize;
+		double		hashtablesize;
+		double		mem_limit = work_mem * 1024.0;
+
+		hashentrysize = MAXALIGN(input_width) +
+			MAXALIGN(SizeofMinimalTupleHeader) +
+			aggcosts->transitionSpace +
+			hash_agg_entry_size(aggcosts->numAggs);
+		hashtablesize = hashentrysize * numGroups;
+
+		if (hashtablesize > mem_limit)
+		{
+			double		depth;
+			double		npages;
+			double		spill_cost;
+
+			depth = ceil(log(hashtablesize / mem_limit) /
+						 log(hash_agg_max_partitions()));
+			npages = page_size(input_tuples, (int) input_width);
+			spill_cost = 2.0 * npages * depth *
+				(seq_page_cost * 0.75 + random_page_cost * 0.25);
+			spill_cost += cpu_operator_cost * input_tuples * depth;
+
+			if (aggstrategy == AGG_HASHED)
+				startup_cost += spill_cost;
+			total_cost += spill_cost;
+		}
+	}
+
 	/*
 	 * If there are quals (HAVING quals), account for their cost and
 	 * selectivity.
@@ -3502,6 +3706,63 @@ final_cost_hashjoin(PlannerInfo *root, HashPath *path,
 	path->jpath.path.total_cost = startup_cost + run_cost;
 }
 
+/*
+ * runtime_filter_is_worthwhile
+ *	  Decide whether a scan on the outer side of a hash join should test its
+ *	  tuples against a Bloom filter of the inner side's join keys.
+ *
+ * 'outer_keys' and 'inner_keys' are the two sides of the hash clauses, and
+ * 'outer_rows' and 'inner_rows' the row counts of the scan and of the Hash
+ * node.  'below_gather' is true if the scan is below a Gather, whose tuple
+ * transfer costs are saved too for each tuple the filter removes.
+ *
+ * Every scanned tuple pays for hashing its keys and probing the filter, and
+ * the Hash node for adding each of its tuples and handing over the filter.
+ * That is only repaid if the inner side has fewer distinct keys than the
+ * outer side, so that many outer tuples are dropped early.  Without
+ * statistics for the keys we cannot tell, so we don't try.
+ */
+bool
+runtime_filter_is_worthwhile(PlannerInfo *root,
+							 List *outer_keys, List *inner_keys,
+							 double outer_rows, double inner_rows,
+							 bool below_gather)
+{
+	int			nkeys = list_length(outer_keys);
+	double		outer_ndistinct;
+	double		inner_ndistinct;
+	double		removed_rows;
+	double		filter_bytes;
+	Cost		benefit;
+	Cost		cost;
+
+	if (has_default_ndistinct(root, outer_keys) ||
+		has_default_ndistinct(root, inner_keys))
+		return false;
+
+	outer_ndistinct = estimate_num_groups(root, outer_keys, outer_rows, NULL);
+	inner_ndistinct = estimate_num_groups(root, inner_keys, inner_rows, NULL);
+
+	/* Assume that the inner keys are among the outer ones, where possible */
+	removed_rows = outer_rows *
+		(1.0 - Min(inner_ndistinct / outer_ndistinct, 1.0));
+
+	/* A removed tuple is neither returned nor hashed again by the join */
+	benefit = removed_rows * (cpu_tuple_cost + nkeys * cpu_operator_cost);
+	if (below_gather)
+		benefit += removed_rows * parallel_tuple_cost;
+
+	/* This is how bloom_create() sizes the filter */
+	filter_bytes = Max(1024.0 * 1024.0,
+					   Min(work_mem * 1024.0, inner_rows * 2.0));
+
+	cost = outer_rows * (nkeys + 1) * cpu_operator_cost +
+		inner_rows * cpu_operator_cost +
+		2.0 * cpu_tuple_cost * (filter_bytes / BLCKSZ);
+
+	return benefit > cost;
+}
+
 
 /*
  * cost_subplan
@@ -3693,6 +3954,10 @@ cost_rescan(PlannerInfo *root, Path *path,
 				*rescan_total_cost = run_cost;
 			}
 			break;
+		case T_ResultCache:
+			cost_resultcache_rescan(root, (ResultCachePath *) path,
+									rescan_startup_cost, rescan_total_cost);
+			break;
 		default:
 			*rescan_startup_cost = path->startup_cost;
 			*rescan_total_cost = path->total_cost;
@@ -3700,6 +3965,100 @@ cost_rescan(PlannerInfo *root, Path *path,
 	}
 }
 
+/*
+ * cost_resultcache_rescan
+ *		Estimate the average cost of a rescan of a ResultCache path.
+ *
+ * A rescan is cheap if it finds its parameter values in the cache.  The
+ * fraction of rescans that do depends on how many distinct values there
+ * are among the expected number of calls, and how many of them fit in the
+ * cache at once.
+ *
+ * As a side effect, this sets the path's est_entries.
+ */
+static void
+cost_resultcache_rescan(PlannerInfo *root, ResultCachePath *rcpath,
+						Cost *rescan_startup_cost, Cost *rescan_total_cost)
+{
+	Path	   *subpath = rcpath->subpath;
+	double		tuples = subpath->rows;
+	double		calls = rcpath->calls;
+	double		entry_bytes;
+	double		est_cache_entries;
+	double		ndistinct;
+	double		hit_ratio;
+	double		evict_ratio;
+
+	/* Estimate how many entries fit in work_mem */
+	entry_bytes = relation_byte_size(tuples, subpath->pathtarget->width) +
+		ExecEstimateCacheEntryOverheadBytes(tuples);
+	est_cache_entries = floor(work_mem * 1024.0 / entry_bytes);
+
+	/*
+	 * ... and how many distinct sets of parameter values will come.  If we
+	 * have no statistics for any of the parameters, estimate_num_groups()
+	 * would fall back on a guess that can make the cache look far more
+	 * useful than it is, so assume then that every call is for a new set.
+	 */
+	if (has_default_ndistinct(root, rcpath->param_exprs))
+		ndistinct = calls;
+	else
+		ndistinct = estimate_num_groups(root, rcpath->param_exprs, calls,
+										NULL);
+
+	/* Tell the executor how big to make its hash table */
+	rcpath->est_entries = (uint32) Min(Min(ndistinct, est_cache_entries),
+									   PG_UINT32_MAX);
+
+	/*
+	 * All but the first call for each distinct set of values would be a hit
+	 * if the cache was big enough for all of them.  If it is not, assume that
+	 * the hits are reduced in proportion, and that a matching fraction of the
+	 * misses need to evict an entry.
+	 */
+	hit_ratio = ((calls - ndistinct) / calls) *
+		(est_cache_entries / Max(ndistinct, est_cache_entries));
+	hit_ratio = Max(Min(hit_ratio, 1.0), 0.0);
+	evict_ratio = 1.0 - Min(est_cache_entries, ndistinct) / ndistinct;
+
+	/*
+	 * Misses pay for running the subpath.  Every call pays a cpu_tuple_cost
+	 * for the lookup, and cpu_operator_cost per tuple for storing it in or
+	 * fetching it from the cache.  An eviction costs another cpu_tuple_cost.
+	 */
+	*rescan_startup_cost = subpath->startup_cost * (1.0 - hit_ratio) +
+		cpu_tuple_cost;
+	*rescan_total_cost = subpath->total_cost * (1.0 - hit_ratio) +
+		cpu_tuple_cost + cpu_operator_cost * tuples +
+		cpu_tuple_cost * evict_ratio * (1.0 - hit_ratio);
+}
+
+/*
+ * has_default_ndistinct
+ *		Is the number of distinct values of any of the expressions only a
+ *		default guess, for want of statistics?
+ */
+static bool
+has_default_ndistinct(PlannerInfo *root, List *exprs)
+{
+	ListCell   *lc;
+
+	foreach(lc, exprs)
+	{
+		Node	   *expr = (Node *) lfirst(lc);
+		VariableStatData vardata;
+		bool		isdefault;
+
+		examine_variable(root, expr, 0, &vardata);
+		(void) get_variable_numdistinct(&vardata, &isdefault);
+		ReleaseVariableStats(vardata);
+
+		if (isdefault)
+			return true;
+	}
+	return false;
+}
+
 
 /*
  * cost_qual_eval
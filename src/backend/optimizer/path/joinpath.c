@@ -18,10 +18,15 @@
 
 #include "executor/executor.h"
 #include "foreign/fdwapi.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
 #include "optimizer/planmain.h"
+#include "parser/parsetree.h"
+#include "utils/lsyscache.h"
+#include "utils/typcache.h"
 
 /* Hook for plugins to get control in add_paths_to_joinrel() */
 set_join_pathlist_hook_type set_join_pathlist_hook = NULL;
@@ -352,6 +357,131 @@ allow_star_schema_join(PlannerInfo *root,
 			bms_nonempty_difference(inner_paramrels, outerrelids));
 }
 
+/*
+ * get_resultcache_path
+ *	  If possible, make a ResultCachePath to cache the results of the
+ *	  parameterized 'inner_path' for each set of parameter values supplied
+ *	  by 'outer_path'.  Returns NULL if that's not possible or not useful.
+ */
+static Path *
+get_resultcache_path(PlannerInfo *root, RelOptInfo *innerrel,
+					 RelOptInfo *outerrel, Path *inner_path,
+					 Path *outer_path, JoinType jointype,
+					 JoinPathExtraData *extra)
+{
+	RangeTblEntry *rte;
+	List	   *param_exprs = NIL;
+	List	   *eq_operators = NIL;
+	List	   *ppi_clauses;
+	ListCell   *lc;
+
+	/* Obviously not if it's disabled */
+	if (!enable_resultcache)
+		return NULL;
+
+	/*
+	 * We can safely only cache the results of scans of plain base relations,
+	 * whose parameters we can see all of.  And nothing can be gained unless
+	 * the outer side supplies them more than once.
+	 */
+	if (innerrel->reloptkind != RELOPT_BASEREL ||
+		inner_path->param_info == NULL ||
+		outer_path->parent->rows < 2)
+		return NULL;
+
+	/* All of the parameters must come from this outer rel */
+	if (!bms_is_subset(PATH_REQ_OUTER(inner_path), outerrel->relids))
+		return NULL;
+
+	ppi_clauses = inner_path->param_info->ppi_clauses;
+	if (ppi_clauses == NIL && innerrel->lateral_vars == NIL)
+		return NULL;
+
+	/*
+	 * When the join stops at the first match for each outer tuple, the
+	 * subplan is usually not run to completion, and the entries would never
+	 * be complete.  That's not so if all the join clauses are parameters,
+	 * because then every tuple of the subplan is a match, and there is at
+	 * most one.
+	 */
+	if ((jointype == JOIN_SEMI || jointype == JOIN_ANTI) &&
+		!extra->inner_unique)
+		return NULL;
+	if (extra->inner_unique &&
+		list_length(ppi_clauses) < list_length(extra->restrictlist))
+		return NULL;
+
+	/* Results involving volatile functions can't be reused */
+	if (contain_volatile_functions((Node *) innerrel->reltarget->exprs))
+		return NULL;
+	foreach(lc, innerrel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+
+		if (contain_volatile_functions((Node *) rinfo->clause))
+			return NULL;
+	}
+	rte = planner_rt_fetch(innerrel->relid, root);
+	if (rte->rtekind == RTE_FUNCTION &&
+		contain_volatile_functions((Node *) rte->functions))
+		return NULL;
+	if (rte->rtekind == RTE_SUBQUERY &&
+		contain_volatile_functions((Node *) rte->subquery))
+		return NULL;
+
+	/*
+	 * The cache keys are the outer sides of the parameterized join clauses,
+	 * which must be hashable equality clauses.
+	 */
+	foreach(lc, ppi_clauses)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+		OpExpr	   *opexpr;
+		Node	   *expr;
+		TypeCacheEntry *typentry;
+
+		if (!IsA(rinfo->clause, OpExpr) ||
+			!OidIsValid(rinfo->hashjoinoperator) ||
+			contain_volatile_functions((Node *) rinfo->clause))
+			return NULL;
+
+		opexpr = (OpExpr *) rinfo->clause;
+		if (bms_is_subset(rinfo->left_relids, outerrel->relids))
+			expr = (Node *) linitial(opexpr->args);
+		else if (bms_is_subset(rinfo->right_relids, outerrel->relids))
+			expr = (Node *) lsecond(opexpr->args);
+		else
+			return NULL;
+
+		typentry = lookup_type_cache(exprType(expr), TYPECACHE_EQ_OPR);
+		if (!OidIsValid(typentry->eq_opr) ||
+			!get_op_hash_functions(typentry->eq_opr, NULL, NULL))
+			return NULL;
+
+		param_exprs = lappend(param_exprs, expr);
+		eq_operators = lappend_oid(eq_operators, typentry->eq_opr);
+	}
+
+	/*
+	 * Lateral references are cache keys too.  As they can be used in any way
+	 * at all, equal values might not give the same results, so compare all
+	 * the keys datum for datum then.
+	 */
+	foreach(lc, innerrel->lateral_vars)
+	{
+		Node	   *expr = (Node *) lfirst(lc);
+
+		param_exprs = lappend(param_exprs, expr);
+		eq_operators = lappend_oid(eq_operators, InvalidOid);
+	}
+
+	return (Path *) create_resultcache_path(root, innerrel, inner_path,
+											param_exprs, eq_operators,
+											extra->inner_unique,
+											innerrel->lateral_vars != NIL,
+											outer_path->rows);
+}
+
 /*
  * try_nestloop_path
  *	  Consider a nestloop join path; if it appears useful, push it into
@@ -1469,6 +1599,7 @@ match_unsorted_outer(PlannerInfo *root,
 			foreach(lc2, innerrel->cheapest_parameterized_paths)
 			{
 				Path	   *innerpath = (Path *) lfirst(lc2);
+				Path	   *rcpath;
 
 				try_nestloop_path(root,
 								  joinrel,
@@ -1477,6 +1608,19 @@ match_unsorted_outer(PlannerInfo *root,
 								  merge_pathkeys,
 								  jointype,
 								  extra);
+
+				/* Also consider caching the results of a parameterized inner */
+				rcpath = get_resultcache_path(root, innerrel, outerrel,
+											  innerpath, outerpath, jointype,
+											  extra);
+				if (rcpath != NULL)
+					try_nestloop_path(root,
+									  joinrel,
+									  outerpath,
+									  rcpath,
+									  merge_pathkeys,
+									  jointype,
+									  extra);
 			}
 
 			/* Also consider materialized form of the cheapest inner path */
@@ -1656,6 +1800,19 @@ consider_parallel_nestloop(PlannerInfo *root,
 
 			try_partial_nestloop_path(root, joinrel, outerpath, innerpath,
 									  pathkeys, jointype, extra);
+
+			/* Also consider caching the results of a parameterized inner */
+			if (save_jointype != JOIN_UNIQUE_INNER)
+			{
+				Path	   *rcpath;
+
+				rcpath = get_resultcache_path(root, innerrel, outerrel,
+											  innerpath, outerpath, jointype,
+											  extra);
+				if (rcpath != NULL)
+					try_partial_nestloop_path(root, joinrel, outerpath, rcpath,
+											  pathkeys, jointype, extra);
+			}
 		}
 	}
 }
@@ -1841,18 +1998,11 @@ hash_inner_and_outer(PlannerInfo *root,
 		 * If the joinrel is parallel-safe, we may be able to consider a
 		 * partial hash join.  However, we can't handle JOIN_UNIQUE_OUTER,
 		 * because the outer path will be partial, and therefore we won't be
-		 * able to properly guarantee uniqueness.  Similarly, we can't handle
-		 * JOIN_FULL and JOIN_RIGHT, because they can produce false null
-		 * extended rows.  Also, the resulting path must not be parameterized.
-		 * We would be able to support JOIN_FULL and JOIN_RIGHT for Parallel
-		 * Hash, since in that case we're back to a single hash table with a
-		 * single set of match bits for each batch, but that will require
-		 * figuring out a deadlock-free way to wait for the probe to finish.
+		 * able to properly guarantee uniqueness.  Also, the resulting path
+		 * must not be parameterized.
 		 */
 		if (joinrel->consider_parallel &&
 			save_jointype != JOIN_UNIQUE_OUTER &&
-			save_jointype != JOIN_FULL &&
-			save_jointype != JOIN_RIGHT &&
 			outerrel->partial_pathlist != NIL &&
 			bms_is_empty(joinrel->lateral_relids))
 		{
@@ -1865,7 +2015,9 @@ hash_inner_and_outer(PlannerInfo *root,
 
 			/*
 			 * Can we use a partial inner plan too, so that we can build a
-			 * shared hash table in parallel?
+			 * shared hash table in parallel?  That works for JOIN_FULL and
+			 * JOIN_RIGHT too, since there's then a single set of match bits
+			 * for each batch.
 			 */
 			if (innerrel->partial_pathlist != NIL && enable_parallel_hash)
 			{
@@ -1883,9 +2035,13 @@ hash_inner_and_outer(PlannerInfo *root,
 			 * total inner path will also be parallel-safe, but if not, we'll
 			 * have to search for the cheapest safe, unparameterized inner
 			 * path.  If doing JOIN_UNIQUE_INNER, we can't use any alternative
-			 * inner path.
+			 * inner path.  We can't handle JOIN_FULL and JOIN_RIGHT with a
+			 * private hash table in each process, because they can produce
+			 * false null extended rows.
 			 */
-			if (cheapest_total_inner->parallel_safe)
+			if (save_jointype == JOIN_FULL || save_jointype == JOIN_RIGHT)
+				cheapest_safe_inner = NULL;
+			else if (cheapest_total_inner->parallel_safe)
 				cheapest_safe_inner = cheapest_total_inner;
 			else if (save_jointype != JOIN_UNIQUE_INNER)
 				cheapest_safe_inner =
@@ -327,6 +327,33 @@ pathkeys_contained_in(List *keys1, List *keys2)
 	return false;
 }
 
+/*
+ * pathkeys_count_contained_in
+ *    Same as pathkeys_contained_in, but also sets *n_common to the number
+ *    of leading keys the two lists have in common.  Incremental sort uses
+ *    that to find out how much of the required ordering the input has.
+ */
+bool
+pathkeys_count_contained_in(List *keys1, List *keys2, int *n_common)
+{
+	int			n = 0;
+	ListCell   *key1,
+			   *key2;
+
+	forboth(key1, keys1, key2, keys2)
+	{
+		if (lfirst(key1) != lfirst(key2))
+		{
+			*n_common = n;
+			return false;
+		}
+		n++;
+	}
+
+	*n_common = n;
+	return (key1 == NULL);
+}
+
 /*
  * get_cheapest_path_for_pathkeys
  *	  Find the cheapest path (according to the specified criterion) that
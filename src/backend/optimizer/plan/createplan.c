@@ -22,6 +22,7 @@
 #include "access/stratnum.h"
 #include "access/sysattr.h"
 #include "catalog/pg_class.h"
+#include "catalog/pg_type.h"
 #include "foreign/fdwapi.h"
 #include "miscadmin.h"
 #include "nodes/extensible.h"
@@ -84,19 +85,27 @@ static Plan *create_gating_plan(PlannerInfo *root, Path *path, Plan *plan,
 				   List *gating_quals);
 static Plan *create_join_plan(PlannerInfo *root, JoinPath *best_path);
 static Plan *create_append_plan(PlannerInfo *root, AppendPath *best_path);
+static bool mark_async_capable_plan(Plan *plan, Path *path);
 static Plan *create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_path);
 static Result *create_result_plan(PlannerInfo *root, ResultPath *best_path);
 static ProjectSet *create_project_set_plan(PlannerInfo *root, ProjectSetPath *best_path);
 static Material *create_material_plan(PlannerInfo *root, MaterialPath *best_path,
 					 int flags);
+static ResultCache *create_resultcache_plan(PlannerInfo *root,
+						ResultCachePath *best_path,
+						int flags);
 static Plan *create_unique_plan(PlannerInfo *root, UniquePath *best_path,
 				   int flags);
 static Gather *create_gather_plan(PlannerInfo *root, GatherPath *best_path);
+static void push_down_runtime_filter(PlannerInfo *root, Hash *hash_plan,
+						 Plan *outer_plan, List *hashclauses);
 static Plan *create_projection_plan(PlannerInfo *root,
 					   ProjectionPath *best_path,
 					   int flags);
 static Plan *inject_projection_plan(Plan *subplan, List *tlist, bool parallel_safe);
 static Sort *create_sort_plan(PlannerInfo *root, SortPath *best_path, int flags);
+static IncrementalSort *create_incrementalsort_plan(PlannerInfo *root,
+							IncrementalSortPath *best_path, int flags);
 static Group *create_group_plan(PlannerInfo *root, GroupPath *best_path);
 static Unique *create_upper_unique_plan(PlannerInfo *root, UpperUniquePath *best_path,
 						 int flags);
@@ -246,6 +255,10 @@ static MergeJoin *make_mergejoin(List *tlist,
 static Sort *make_sort(Plan *lefttree, int numCols,
 		  AttrNumber *sortColIdx, Oid *sortOperators,
 		  Oid *collations, bool *nullsFirst);
+static IncrementalSort *make_incrementalsort(Plan *lefttree,
+					 int numCols, int presortedCols,
+					 AttrNumber *sortColIdx, Oid *sortOperators,
+					 Oid *collations, bool *nullsFirst);
 static Plan *prepare_sort_from_pathkeys(Plan *lefttree, List *pathkeys,
 						   Relids relids,
 						   const AttrNumber *reqColIdx,
@@ -260,10 +273,16 @@ static EquivalenceMember *find_ec_member_for_tle(EquivalenceClass *ec,
 					   Relids relids);
 static Sort *make_sort_from_pathkeys(Plan *lefttree, List *pathkeys,
 						Relids relids);
+static IncrementalSort *make_incrementalsort_from_pathkeys(Plan *lefttree,
+								   List *pathkeys, Relids relids,
+								   int presortedCols);
 static Sort *make_sort_from_groupcols(List *groupcls,
 						 AttrNumber *grpColIdx,
 						 Plan *lefttree);
 static Material *make_material(Plan *lefttree);
+static ResultCache *make_resultcache(Plan *lefttree, Oid *eqoperators,
+				 List *param_exprs, bool singlerow, bool binary_mode,
+				 uint32 est_entries, Bitmapset *keyparamids);
 static WindowAgg *make_windowagg(List *tlist, Index winref,
 			   int partNumCols, AttrNumber *partColIdx, Oid *partOperators,
 			   int ordNumCols, AttrNumber *ordColIdx, Oid *ordOperators,
@@ -435,6 +454,11 @@ create_plan_recurse(PlannerInfo *root, Path *best_path, int flags)
 												 (MaterialPath *) best_path,
 												 flags);
 			break;
+		case T_ResultCache:
+			plan = (Plan *) create_resultcache_plan(root,
+													(ResultCachePath *) best_path,
+													flags);
+			break;
 		case T_Unique:
 			if (IsA(best_path, UpperUniquePath))
 			{
@@ -459,6 +483,11 @@ create_plan_recurse(PlannerInfo *root, Path *best_path, int flags)
 											 (SortPath *) best_path,
 											 flags);
 			break;
+		case T_IncrementalSort:
+			plan = (Plan *) create_incrementalsort_plan(root,
+														(IncrementalSortPath *) best_path,
+														flags);
+			break;
 		case T_Group:
 			plan = (Plan *) create_group_plan(root,
 											  (GroupPath *) best_path);
@@ -1044,6 +1073,7 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path)
 	ListCell   *subpaths;
 	RelOptInfo *rel = best_path->path.parent;
 	List	   *partpruneinfos = NIL;
+	bool		consider_async;
 
 	/*
 	 * The subpaths list could be empty, if every child was proven empty by
@@ -1069,6 +1099,15 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path)
 		return plan;
 	}
 
+	/*
+	 * If appropriate, consider async append.  Parallel-aware Appends hand out
+	 * subplans one at a time to the participants, so they can't do it; and
+	 * we don't bother if the Append could be run by parallel workers at all.
+	 */
+	consider_async = (enable_async_append &&
+					  !best_path->path.parallel_safe &&
+					  list_length(best_path->subpaths) > 1);
+
 	/* Build the plan for each child */
 	foreach(subpaths, best_path->subpaths)
 	{
@@ -1079,6 +1118,10 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path)
 		subplan = create_plan_recurse(root, subpath, CP_EXACT_TLIST);
 
 		subplans = lappend(subplans, subplan);
+
+		/* If needed, check to see if subplan can be executed asynchronously */
+		if (consider_async)
+			mark_async_capable_plan(subplan, subpath);
 	}
 
 	if (rel->reloptkind == RELOPT_BASEREL &&
@@ -1129,6 +1172,43 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path)
 	return (Plan *) plan;
 }
 
+/*
+ * mark_async_capable_plan
+ *		Check whether a given Path node is async-capable, and if so, mark the
+ *		Plan node created from it as such and return true, otherwise return
+ *		false.
+ */
+static bool
+mark_async_capable_plan(Plan *plan, Path *path)
+{
+	switch (nodeTag(path))
+	{
+		case T_ForeignPath:
+			{
+				FdwRoutine *fdwroutine = path->parent->fdwroutine;
+
+				/*
+				 * If the generated plan node includes a gating Result node,
+				 * we can't execute it asynchronously.
+				 */
+				if (IsA(plan, Result))
+					return false;
+
+				Assert(fdwroutine != NULL);
+				if (fdwroutine->IsForeignPathAsyncCapable != NULL &&
+					fdwroutine->IsForeignPathAsyncCapable((ForeignPath *) path))
+					break;
+				return false;
+			}
+		default:
+			return false;
+	}
+
+	plan->async_capable = true;
+
+	return true;
+}
+
 /*
  * create_merge_append_plan
  *	  Create a MergeAppend plan for 'best_path' and (recursively) plans
@@ -1316,6 +1396,55 @@ create_material_plan(PlannerInfo *root, MaterialPath *best_path, int flags)
 	return plan;
 }
 
+/*
+ * create_resultcache_plan
+ *	  Create a ResultCache plan for 'best_path' and (recursively) plans
+ *	  for its subpaths.
+ *
+ *	  Returns a Plan node.
+ */
+static ResultCache *
+create_resultcache_plan(PlannerInfo *root, ResultCachePath *best_path,
+						int flags)
+{
+	ResultCache *plan;
+	Plan	   *subplan;
+	Oid		   *operators;
+	List	   *param_exprs;
+	ListCell   *lc;
+	int			i;
+
+	/*
+	 * Like Material, we want no excess columns in the cached tuples, and we
+	 * don't project.
+	 */
+	subplan = create_plan_recurse(root, best_path->subpath,
+								  flags | CP_SMALL_TLIST);
+
+	/*
+	 * The cache keys refer to the outer rel, so they must be turned into
+	 * nestloop params, like the subplan's references to it.  That's done
+	 * after creating the subplan, so that they share the same params.
+	 */
+	param_exprs = (List *) replace_nestloop_params(root,
+												   (Node *) best_path->param_exprs);
+
+	operators = (Oid *) palloc(list_length(best_path->eq_operators) *
+							   sizeof(Oid));
+	i = 0;
+	foreach(lc, best_path->eq_operators)
+		operators[i++] = lfirst_oid(lc);
+
+	plan = make_resultcache(subplan, operators, param_exprs,
+							best_path->singlerow, best_path->binary_mode,
+							best_path->est_entries,
+							pull_paramids((Node *) param_exprs));
+
+	copy_generic_path_info(&plan->plan, (Path *) best_path);
+
+	return plan;
+}
+
 /*
  * create_unique_plan
  *	  Create a Unique plan for 'best_path' and (recursively) plans
@@ -1777,6 +1906,32 @@ create_sort_plan(PlannerInfo *root, SortPath *best_path, int flags)
 	return plan;
 }
 
+/*
+ * create_incrementalsort_plan
+ *
+ *	  Likewise, for an IncrementalSort plan.
+ */
+static IncrementalSort *
+create_incrementalsort_plan(PlannerInfo *root, IncrementalSortPath *best_path,
+							int flags)
+{
+	IncrementalSort *plan;
+	Plan	   *subplan;
+
+	/* See comments in create_sort_plan() above */
+	subplan = create_plan_recurse(root, best_path->spath.subpath,
+								  flags | CP_SMALL_TLIST);
+	plan = make_incrementalsort_from_pathkeys(subplan,
+											  best_path->spath.path.pathkeys,
+											  IS_OTHER_REL(best_path->spath.subpath->parent) ?
+											  best_path->spath.path.parent->relids : NULL,
+											  best_path->nPresortedCols);
+
+	copy_generic_path_info(&plan->sort.plan, (Path *) best_path);
+
+	return plan;
+}
+
 /*
  * create_group_plan
  *
@@ -2566,7 +2721,7 @@ create_seqscan_plan(PlannerInfo *root, Path *best_path,
 							 scan_clauses,
 							 scan_relid);
 
-	copy_generic_path_info(&scan_plan->plan, best_path);
+	copy_generic_path_info(&scan_plan->scan.plan, best_path);
 
 	return scan_plan;
 }
@@ -4313,6 +4468,19 @@ create_hashjoin_plan(PlannerInfo *root,
 		hash_plan->rows_total = best_path->inner_rows_total;
 	}
 
+	/*
+	 * Unless the join must return outer tuples without a match, we can have
+	 * a scan on the outer side drop the tuples that have none.  Each
+	 * participant of a parallel-aware join only sees part of the inner
+	 * tuples, though, so it couldn't tell.
+	 */
+	if (enable_runtime_filter &&
+		!best_path->jpath.path.parallel_aware &&
+		(best_path->jpath.jointype == JOIN_INNER ||
+		 best_path->jpath.jointype == JOIN_SEMI ||
+		 best_path->jpath.jointype == JOIN_RIGHT))
+		push_down_runtime_filter(root, hash_plan, outer_plan, hashclauses);
+
 	join_plan = make_hashjoin(tlist,
 							  joinclauses,
 							  otherclauses,
@@ -4328,6 +4496,69 @@ create_hashjoin_plan(PlannerInfo *root,
 }
 
 
+/*
+ * push_down_runtime_filter
+ *	  Have the Hash node build a Bloom filter over its join keys, for a
+ *	  sequential scan on the outer side of the hash join to test its tuples
+ *	  against.
+ *
+ * The scan may be below a Gather, in which case the filter is sent to the
+ * workers along with the Gather's other params.  Nothing is done if the
+ * outer plan is anything else, or if the filter isn't expected to remove
+ * enough tuples to pay for itself.
+ */
+static void
+push_down_runtime_filter(PlannerInfo *root, Hash *hash_plan,
+						 Plan *outer_plan, List *hashclauses)
+{
+	SeqScan    *scan;
+	List	   *keys = NIL;
+	List	   *inner_keys = NIL;
+	List	   *hashops = NIL;
+	Param	   *param;
+	ListCell   *lc;
+
+	if (IsA(outer_plan, SeqScan))
+		scan = (SeqScan *) outer_plan;
+	else if (IsA(outer_plan, Gather) && IsA(outer_plan->lefttree, SeqScan))
+		scan = (SeqScan *) outer_plan->lefttree;
+	else
+		return;
+
+	/* The hash clauses have already been switched to have outer keys left */
+	foreach(lc, hashclauses)
+	{
+		OpExpr	   *clause = (OpExpr *) lfirst(lc);
+
+		keys = lappend(keys, linitial(clause->args));
+		inner_keys = lappend(inner_keys, lsecond(clause->args));
+		hashops = lappend_oid(hashops, clause->opno);
+	}
+
+	/*
+	 * The scan evaluates the keys again, which mustn't change the result.
+	 * Below a Gather, they are evaluated in the workers.
+	 */
+	if (contain_volatile_functions((Node *) keys))
+		return;
+	if (IsA(outer_plan, Gather) && !is_parallel_safe(root, (Node *) keys))
+		return;
+
+	if (!runtime_filter_is_worthwhile(root, keys, inner_keys,
+									  outer_plan->plan_rows,
+									  hash_plan->plan.plan_rows,
+									  IsA(outer_plan, Gather)))
+		return;
+
+	param = SS_make_initplan_output_param(root, BYTEAOID, -1, InvalidOid);
+
+	hash_plan->filterParam = param->paramid;
+	scan->filterParam = param->paramid;
+	scan->filterKeys = keys;
+	scan->filterHashOps = hashops;
+}
+
+
 /*****************************************************************************
  *
  *	SUPPORTING ROUTINES
@@ -5096,13 +5327,16 @@ make_seqscan(List *qptlist,
 			 Index scanrelid)
 {
 	SeqScan    *node = makeNode(SeqScan);
-	Plan	   *plan = &node->plan;
+	Plan	   *plan = &node->scan.plan;
 
 	plan->targetlist = qptlist;
 	plan->qual = qpqual;
 	plan->lefttree = NULL;
 	plan->righttree = NULL;
-	node->scanrelid = scanrelid;
+	node->scan.scanrelid = scanrelid;
+	node->filterParam = -1;
+	node->filterKeys = NIL;
+	node->filterHashOps = NIL;
 
 	return node;
 }
@@ -5584,6 +5818,7 @@ make_hash(Plan *lefttree,
 	node->skewTable = skewTable;
 	node->skewColumn = skewColumn;
 	node->skewInherit = skewInherit;
+	node->filterParam = -1;
 
 	return node;
 }
@@ -5650,6 +5885,35 @@ make_sort(Plan *lefttree, int numCols,
 	return node;
 }
 
+/*
+ * make_incrementalsort --- basic routine to build an IncrementalSort plan node
+ *
+ * Caller must have built the sortColIdx, sortOperators, collations, and
+ * nullsFirst arrays already.  The first presortedCols of them are the
+ * columns the input is already sorted by.
+ */
+static IncrementalSort *
+make_incrementalsort(Plan *lefttree, int numCols, int presortedCols,
+					 AttrNumber *sortColIdx, Oid *sortOperators,
+					 Oid *collations, bool *nullsFirst)
+{
+	IncrementalSort *node = makeNode(IncrementalSort);
+	Plan	   *plan = &node->sort.plan;
+
+	plan->targetlist = lefttree->targetlist;
+	plan->qual = NIL;
+	plan->lefttree = lefttree;
+	plan->righttree = NULL;
+	node->presortedCols = presortedCols;
+	node->sort.numCols = numCols;
+	node->sort.sortColIdx = sortColIdx;
+	node->sort.sortOperators = sortOperators;
+	node->sort.collations = collations;
+	node->sort.nullsFirst = nullsFirst;
+
+	return node;
+}
+
 /*
  * prepare_sort_from_pathkeys
  *	  Prepare to sort according to given pathkeys
@@ -5996,6 +6260,42 @@ make_sort_from_pathkeys(Plan *lefttree, List *pathkeys, Relids relids)
 					 collations, nullsFirst);
 }
 
+/*
+ * make_incrementalsort_from_pathkeys
+ *	  Create an incremental sort plan to sort according to given pathkeys
+ *
+ *	  'lefttree' is the node which yields input tuples
+ *	  'pathkeys' is the list of pathkeys by which the result is to be sorted
+ *	  'relids' is the set of relations required by prepare_sort_from_pathkeys()
+ *	  'presortedCols' is the number of leading pathkeys the input is sorted by
+ */
+static IncrementalSort *
+make_incrementalsort_from_pathkeys(Plan *lefttree, List *pathkeys,
+								   Relids relids, int presortedCols)
+{
+	int			numsortkeys;
+	AttrNumber *sortColIdx;
+	Oid		   *sortOperators;
+	Oid		   *collations;
+	bool	   *nullsFirst;
+
+	/* Compute sort column info, and adjust lefttree as needed */
+	lefttree = prepare_sort_from_pathkeys(lefttree, pathkeys,
+										  relids,
+										  NULL,
+										  false,
+										  &numsortkeys,
+										  &sortColIdx,
+										  &sortOperators,
+										  &collations,
+										  &nullsFirst);
+
+	/* Now build the IncrementalSort node */
+	return make_incrementalsort(lefttree, numsortkeys, presortedCols,
+								sortColIdx, sortOperators,
+								collations, nullsFirst);
+}
+
 /*
  * make_sort_from_sortclauses
  *	  Create sort plan to sort according to given sortclauses
@@ -6107,6 +6407,30 @@ make_material(Plan *lefttree)
 	return node;
 }
 
+static ResultCache *
+make_resultcache(Plan *lefttree, Oid *eqoperators, List *param_exprs,
+				 bool singlerow, bool binary_mode, uint32 est_entries,
+				 Bitmapset *keyparamids)
+{
+	ResultCache *node = makeNode(ResultCache);
+	Plan	   *plan = &node->plan;
+
+	plan->targetlist = lefttree->targetlist;
+	plan->qual = NIL;
+	plan->lefttree = lefttree;
+	plan->righttree = NULL;
+
+	node->numKeys = list_length(param_exprs);
+	node->eqOperators = eqoperators;
+	node->param_exprs = param_exprs;
+	node->singlerow = singlerow;
+	node->binary_mode = binary_mode;
+	node->est_entries = est_entries;
+	node->keyparamids = keyparamids;
+
+	return node;
+}
+
 /*
  * materialize_finished_plan: stick a Material node atop a completed plan
  *
@@ -6714,7 +7038,9 @@ is_projection_capable_path(Path *path)
 	{
 		case T_Hash:
 		case T_Material:
+		case T_ResultCache:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
 		case T_LockRows:
@@ -6759,7 +7085,9 @@ is_projection_capable_plan(Plan *plan)
 	{
 		case T_Hash:
 		case T_Material:
+		case T_ResultCache:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
 		case T_LockRows:
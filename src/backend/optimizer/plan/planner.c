@@ -22,6 +22,7 @@
 #include "access/parallel.h"
 #include "access/sysattr.h"
 #include "access/xact.h"
+#include "catalog/pg_aggregate.h"
 #include "catalog/pg_constraint.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
@@ -53,10 +54,12 @@
 #include "parser/parse_agg.h"
 #include "rewrite/rewriteManip.h"
 #include "storage/dsm_impl.h"
+#include "utils/fmgroids.h"
 #include "utils/rel.h"
 #include "utils/selfuncs.h"
 #include "utils/lsyscache.h"
 #include "utils/syscache.h"
+#include "utils/typcache.h"
 
 
 /* GUC parameters */
@@ -218,6 +221,11 @@ static RelOptInfo *create_partial_grouping_paths(PlannerInfo *root,
 							  GroupPathExtraData *extra,
 							  bool force_rel_creation);
 static void gather_grouping_paths(PlannerInfo *root, RelOptInfo *rel);
+static bool can_parallel_hash_agg(PlannerInfo *root,
+					  RelOptInfo *grouped_rel,
+					  GroupPathExtraData *extra);
+static bool parallel_hash_agg_unsupported_walker(Node *node, void *context);
+static bool parallel_hash_agg_transfn_ok(Oid transfn);
 static bool can_partial_agg(PlannerInfo *root,
 				const AggClauseCosts *agg_costs);
 static void apply_scanjoin_target_to_paths(PlannerInfo *root,
@@ -4767,8 +4775,8 @@ create_distinct_paths(PlannerInfo *root,
 	 * die trying.  If we do have other choices, there are several things that
 	 * should prevent selection of hashing: if the query uses DISTINCT ON
 	 * (because it won't really have the expected behavior if we hash), or if
-	 * enable_hashagg is off, or if it looks like the hashtable will exceed
-	 * work_mem.
+	 * enable_hashagg is off.  A hashtable that exceeds work_mem spills to
+	 * disk, which cost_agg accounts for.
 	 *
 	 * Note: grouping_is_hashable() is much more expensive to check than the
 	 * other gating conditions, so we want to do it last.
@@ -4778,18 +4786,7 @@ create_distinct_paths(PlannerInfo *root,
 	else if (parse->hasDistinctOn || !enable_hashagg)
 		allow_hash = false;		/* policy-based decision not to hash */
 	else
-	{
-		Size		hashentrysize;
-
-		/* Estimate per-hash-entry space at tuple width... */
-		hashentrysize = MAXALIGN(cheapest_input_path->pathtarget->width) +
-			MAXALIGN(SizeofMinimalTupleHeader);
-		/* plus the per-hash-entry overhead */
-		hashentrysize += hash_agg_entry_size(0);
-
-		/* Allow hashing only if hashtable is predicted to fit in work_mem */
-		allow_hash = (hashentrysize * numDistinctRows <= work_mem * 1024L);
-	}
+		allow_hash = true;
 
 	if (allow_hash && grouping_is_hashable(parse->distinctClause))
 	{
@@ -4883,9 +4880,36 @@ create_ordered_paths(PlannerInfo *root,
 	{
 		Path	   *path = (Path *) lfirst(lc);
 		bool		is_sorted;
+		int			presorted_keys;
+
+		is_sorted = pathkeys_count_contained_in(root->sort_pathkeys,
+												path->pathkeys,
+												&presorted_keys);
+
+		/*
+		 * If the path is sorted by a prefix of the required pathkeys, an
+		 * incremental sort of it may be cheaper than a full sort of the
+		 * cheapest path, especially under a LIMIT.
+		 */
+		if (!is_sorted && presorted_keys > 0 && enable_incrementalsort)
+		{
+			Path	   *sorted_path;
+
+			sorted_path = (Path *) create_incremental_sort_path(root,
+																ordered_rel,
+																path,
+																root->sort_pathkeys,
+																presorted_keys,
+																limit_tuples);
+
+			/* Add projection step if needed */
+			if (sorted_path->pathtarget != target)
+				sorted_path = apply_projection_to_path(root, ordered_rel,
+													   sorted_path, target);
+
+			add_path(ordered_rel, sorted_path);
+		}
 
-		is_sorted = pathkeys_contained_in(root->sort_pathkeys,
-										  path->pathkeys);
 		if (path == cheapest_input_path || is_sorted)
 		{
 			if (!is_sorted)
@@ -4955,6 +4979,33 @@ create_ordered_paths(PlannerInfo *root,
 												path, target);
 
 			add_path(ordered_rel, path);
+
+			/*
+			 * Alternatively, have the workers write their sorted shares of
+			 * the input out as runs, for the leader to merge.  That spares
+			 * sending all the tuples through the tuple queues.  Under a
+			 * LIMIT, each worker sends only its first few tuples anyway.
+			 */
+			if (enable_parallel_sort && limit_tuples < 0)
+			{
+				path = (Path *) create_parallel_sort_path(root,
+														  ordered_rel,
+														  cheapest_partial_path,
+														  root->sort_pathkeys);
+				path = (Path *)
+					create_gather_merge_path(root, ordered_rel,
+											 path,
+											 path->pathtarget,
+											 root->sort_pathkeys, NULL,
+											 &total_groups);
+
+				/* Add projection step if needed */
+				if (path->pathtarget != target)
+					path = apply_projection_to_path(root, ordered_rel,
+													path, target);
+
+				add_path(ordered_rel, path);
+			}
 		}
 	}
 
@@ -6313,8 +6364,6 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 
 	if (can_hash)
 	{
-		Size		hashaggtablesize;
-
 		if (parse->groupingSets)
 		{
 			/*
@@ -6326,61 +6375,94 @@ add_paths_to_grouping_rel(PlannerInfo *root, RelOptInfo *input_rel,
 		}
 		else
 		{
-			hashaggtablesize = estimate_hashagg_tablesize(cheapest_path,
-														  agg_costs,
-														  dNumGroups);
+			/*
+			 * We just need an Agg over the cheapest-total input path, since
+			 * input order won't matter.  If the hash table doesn't fit in
+			 * work_mem, it spills to disk, and cost_agg charges for that.
+			 */
+			add_path(grouped_rel, (Path *)
+					 create_agg_path(root, grouped_rel,
+									 cheapest_path,
+									 grouped_rel->reltarget,
+									 AGG_HASHED,
+									 AGGSPLIT_SIMPLE,
+									 parse->groupClause,
+									 havingQual,
+									 agg_costs,
+									 dNumGroups));
 
 			/*
-			 * Provided that the estimated size of the hashtable does not
-			 * exceed work_mem, we'll generate a HashAgg Path, although if we
-			 * were unable to sort above, then we'd better generate a Path, so
-			 * that we at least have one.
+			 * Also consider a Parallel HashAggregate over the cheapest
+			 * partial path, in which all the workers add their input to one
+			 * shared hash table; gather_grouping_paths will put a Gather on
+			 * top of it.  The shared hash table can't spill to disk, so we
+			 * insist that it's expected to fit in work_mem.
 			 */
-			if (hashaggtablesize < work_mem * 1024L ||
-				grouped_rel->pathlist == NIL)
+			if (enable_parallel_hashagg &&
+				grouped_rel->consider_parallel &&
+				input_rel->partial_pathlist != NIL &&
+				!IS_OTHER_REL(grouped_rel) &&
+				can_parallel_hash_agg(root, grouped_rel, extra) &&
+				estimate_hashagg_tablesize(cheapest_path, agg_costs,
+										   dNumGroups) < work_mem * 1024L)
 			{
+				Path	   *partial_path = linitial(input_rel->partial_pathlist);
+				AggPath    *aggpath;
+				double		nparticipants;
+				Cost		lock_cost;
+
+				/* each participant returns its share of the groups */
+				aggpath = create_agg_path(root, grouped_rel,
+										  partial_path,
+										  grouped_rel->reltarget,
+										  AGG_HASHED,
+										  AGGSPLIT_SIMPLE,
+										  parse->groupClause,
+										  havingQual,
+										  agg_costs,
+										  clamp_row_est(dNumGroups /
+														partial_path->parallel_workers));
+
 				/*
-				 * We just need an Agg over the cheapest-total input path,
-				 * since input order won't matter.
+				 * cost_agg doesn't know that the hash table is shared.  Each
+				 * input tuple's group is looked up and updated with its
+				 * partition of the table locked, and participants that hit
+				 * the same group have to take turns, so with few groups
+				 * relative to the number of participants this is slower than
+				 * a partial aggregation in each worker.
 				 */
-				add_path(grouped_rel, (Path *)
-						 create_agg_path(root, grouped_rel,
-										 cheapest_path,
-										 grouped_rel->reltarget,
-										 AGG_HASHED,
-										 AGGSPLIT_SIMPLE,
-										 parse->groupClause,
-										 havingQual,
-										 agg_costs,
-										 dNumGroups));
+				nparticipants = partial_path->parallel_workers;
+				if (parallel_leader_participation)
+					nparticipants += 1.0;
+				lock_cost = cpu_operator_cost *
+					(1.0 + nparticipants / dNumGroups) * partial_path->rows;
+				aggpath->path.startup_cost += lock_cost;
+				aggpath->path.total_cost += lock_cost;
+
+				aggpath->path.parallel_aware = true;
+				add_partial_path(grouped_rel, (Path *) aggpath);
 			}
 		}
 
 		/*
 		 * Generate a Finalize HashAgg Path atop of the cheapest partially
-		 * grouped path, assuming there is one. Once again, we'll only do this
-		 * if it looks as though the hash table won't exceed work_mem.
+		 * grouped path, assuming there is one.
 		 */
 		if (partially_grouped_rel && partially_grouped_rel->pathlist)
 		{
 			Path	   *path = partially_grouped_rel->cheapest_total_path;
 
-			hashaggtablesize = estimate_hashagg_tablesize(path,
-														  agg_final_costs,
-														  dNumGroups);
-
-			if (hashaggtablesize < work_mem * 1024L)
-				add_path(grouped_rel, (Path *)
-						 create_agg_path(root,
-										 grouped_rel,
-										 path,
-										 grouped_rel->reltarget,
-										 AGG_HASHED,
-										 AGGSPLIT_FINAL_DESERIAL,
-										 parse->groupClause,
-										 havingQual,
-										 agg_final_costs,
-										 dNumGroups));
+			add_path(grouped_rel, (Path *)
+					 create_agg_path(root,
+									 grouped_rel,
+									 path,
+									 grouped_rel->reltarget,
+									 AGG_HASHED,
+									 AGGSPLIT_FINAL_DESERIAL,
+									 parse->groupClause,
+									 havingQual,
+									 agg_final_costs,
+									 dNumGroups));
 		}
 	}
 
@@ -6624,62 +6706,37 @@ create_partial_grouping_paths(PlannerInfo *root,
 
 	if (can_hash && cheapest_total_path != NULL)
 	{
-		Size		hashaggtablesize;
-
 		/* Checked above */
 		Assert(parse->hasAggs || parse->groupClause);
 
-		hashaggtablesize =
-			estimate_hashagg_tablesize(cheapest_total_path,
-									   agg_partial_costs,
-									   dNumPartialGroups);
-
-		/*
-		 * Tentatively produce a partial HashAgg Path, depending on if it
-		 * looks as if the hash table will fit in work_mem.
-		 */
-		if (hashaggtablesize < work_mem * 1024L &&
-			cheapest_total_path != NULL)
-		{
-			add_path(partially_grouped_rel, (Path *)
-					 create_agg_path(root,
-									 partially_grouped_rel,
-									 cheapest_total_path,
-									 partially_grouped_rel->reltarget,
-									 AGG_HASHED,
-									 AGGSPLIT_INITIAL_SERIAL,
-									 parse->groupClause,
-									 NIL,
-									 agg_partial_costs,
-									 dNumPartialGroups));
-		}
+		/* Tentatively produce a partial HashAgg Path */
+		add_path(partially_grouped_rel, (Path *)
+				 create_agg_path(root,
+								 partially_grouped_rel,
+								 cheapest_total_path,
+								 partially_grouped_rel->reltarget,
+								 AGG_HASHED,
+								 AGGSPLIT_INITIAL_SERIAL,
+								 parse->groupClause,
+								 NIL,
+								 agg_partial_costs,
+								 dNumPartialGroups));
 	}
 
 	if (can_hash && cheapest_partial_path != NULL)
 	{
-		Size		hashaggtablesize;
-
-		hashaggtablesize =
-			estimate_hashagg_tablesize(cheapest_partial_path,
-									   agg_partial_costs,
-									   dNumPartialPartialGroups);
-
 		/* Do the same for partial paths. */
-		if (hashaggtablesize < work_mem * 1024L &&
-			cheapest_partial_path != NULL)
-		{
-			add_partial_path(partially_grouped_rel, (Path *)
-							 create_agg_path(root,
-											 partially_grouped_rel,
-											 cheapest_partial_path,
-											 partially_grouped_rel->reltarget,
-											 AGG_HASHED,
-											 AGGSPLIT_INITIAL_SERIAL,
-											 parse->groupClause,
-											 NIL,
-											 agg_partial_costs,
-											 dNumPartialPartialGroups));
-		}
+		add_partial_path(partially_grouped_rel, (Path *)
+						 create_agg_path(root,
+										 partially_grouped_rel,
+										 cheapest_partial_path,
+										 partially_grouped_rel->reltarget,
+										 AGG_HASHED,
+										 AGGSPLIT_INITIAL_SERIAL,
+										 parse->groupClause,
+										 NIL,
+										 agg_partial_costs,
+										 dNumPartialPartialGroups));
 	}
 
 	/*
@@ -6747,6 +6804,161 @@ gather_grouping_paths(PlannerInfo *root, RelOptInfo *rel)
 	}
 }
 
+/*
+ * can_parallel_hash_agg
+ *
+ * Determines whether grouping can be done by a Parallel HashAggregate.  The
+ * executor hashes and compares the grouping columns as plain bytes, and keeps
+ * the transition states inline in the shared hash table, so only grouping
+ * columns of pass-by-value types whose equality is bitwise, and aggregates
+ * with pass-by-value transition states, are supported.  The aggregates'
+ * transition functions must also be ones that are safe to run while holding
+ * an LWLock; see parallel_hash_agg_transfn_ok.
+ */
+static bool
+can_parallel_hash_agg(PlannerInfo *root, RelOptInfo *grouped_rel,
+					  GroupPathExtraData *extra)
+{
+	Query	   *parse = root->parse;
+	ListCell   *lc;
+
+	/*
+	 * Columns that are functionally dependent on the grouping columns would
+	 * have to be stored in the hash table too, so don't bother with those.
+	 */
+	if (parse->groupClause == NIL || parse->groupingSets ||
+		parse->constraintDeps != NIL)
+		return false;
+
+	foreach(lc, parse->groupClause)
+	{
+		SortGroupClause *sgc = lfirst_node(SortGroupClause, lc);
+		Node	   *expr = get_sortgroupclause_expr(sgc, parse->targetList);
+
+		Oid			type = exprType(expr);
+
+		/* the type's own equality, which for these types is bitwise */
+		switch (type)
+		{
+			case BOOLOID:
+			case CHAROID:
+			case INT2OID:
+			case INT4OID:
+			case INT8OID:
+			case OIDOID:
+			case DATEOID:
+			case TIMEOID:
+			case TIMESTAMPOID:
+			case TIMESTAMPTZOID:
+				break;
+			default:
+				return false;
+		}
+		if (sgc->eqop != lookup_type_cache(type, TYPECACHE_EQ_OPR)->eq_opr)
+			return false;
+
+		/* int8 and the timestamp types might not be pass-by-value */
+		if (!get_typbyval(type))
+			return false;
+	}
+
+	if (parallel_hash_agg_unsupported_walker((Node *) grouped_rel->reltarget->exprs,
+											 NULL) ||
+		parallel_hash_agg_unsupported_walker(extra->havingQual, NULL))
+		return false;
+
+	return true;
+}
+
+/*
+ * Look for aggregates that can't be done by a Parallel HashAggregate.  The
+ * Aggrefs' aggtranstype must have been resolved already.
+ */
+static bool
+parallel_hash_agg_unsupported_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Aggref))
+	{
+		Aggref	   *aggref = (Aggref *) node;
+		HeapTuple	aggTuple;
+		Oid			transfn;
+
+		Assert(OidIsValid(aggref->aggtranstype));
+
+		if (aggref->aggorder != NIL ||
+			aggref->aggdistinct != NIL ||
+			aggref->aggtranstype == INTERNALOID ||
+			!get_typbyval(aggref->aggtranstype))
+			return true;
+
+		aggTuple = SearchSysCache1(AGGFNOID,
+								   ObjectIdGetDatum(aggref->aggfnoid));
+		if (!HeapTupleIsValid(aggTuple))
+			elog(ERROR, "cache lookup failed for aggregate %u",
+				 aggref->aggfnoid);
+		transfn = ((Form_pg_aggregate) GETSTRUCT(aggTuple))->aggtransfn;
+		ReleaseSysCache(aggTuple);
+
+		return !parallel_hash_agg_transfn_ok(transfn);
+	}
+	return expression_tree_walker(node, parallel_hash_agg_unsupported_walker,
+								  context);
+}
+
+/*
+ * Is the given function safe to use as a transition function in a Parallel
+ * HashAggregate?
+ *
+ * The executor calls the transition functions while holding the lock on the
+ * group's dshash partition, so we only accept built-in functions that are
+ * cheap, don't look at anything but their arguments, and can't fail (apart
+ * from count's overflow, which can't happen in practice).  No catalog
+ * property tells us that about a function, so they are listed here; any
+ * other aggregate makes us fall back to the other grouping paths.
+ */
+static bool
+parallel_hash_agg_transfn_ok(Oid transfn)
+{
+	switch (transfn)
+	{
+		case F_INT8INC:			/* count(*) */
+		case F_INT8INC_ANY:		/* count(any) */
+		case F_INT2_SUM:
+		case F_INT4_SUM:
+		case F_INT2LARGER:
+		case F_INT2SMALLER:
+		case F_INT4LARGER:
+		case F_INT4SMALLER:
+		case F_INT8LARGER:
+		case F_INT8SMALLER:
+		case F_OIDLARGER:
+		case F_OIDSMALLER:
+		case F_FLOAT4LARGER:
+		case F_FLOAT4SMALLER:
+		case F_FLOAT8LARGER:
+		case F_FLOAT8SMALLER:
+		case F_DATE_LARGER:
+		case F_DATE_SMALLER:
+		case F_TIME_LARGER:
+		case F_TIME_SMALLER:
+		case F_TIMESTAMP_LARGER:
+		case F_TIMESTAMP_SMALLER:
+		case F_BOOLAND_STATEFUNC:
+		case F_BOOLOR_STATEFUNC:
+		case F_INT2AND:
+		case F_INT2OR:
+		case F_INT4AND:
+		case F_INT4OR:
+		case F_INT8AND:
+		case F_INT8OR:
+			return true;
+		default:
+			return false;
+	}
+}
+
 /*
  * can_partial_agg
  *
@@ -455,11 +455,13 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 			{
 				SeqScan    *splan = (SeqScan *) plan;
 
-				splan->scanrelid += rtoffset;
-				splan->plan.targetlist =
-					fix_scan_list(root, splan->plan.targetlist, rtoffset);
-				splan->plan.qual =
-					fix_scan_list(root, splan->plan.qual, rtoffset);
+				splan->scan.scanrelid += rtoffset;
+				splan->scan.plan.targetlist =
+					fix_scan_list(root, splan->scan.plan.targetlist, rtoffset);
+				splan->scan.plan.qual =
+					fix_scan_list(root, splan->scan.plan.qual, rtoffset);
+				splan->filterKeys =
+					fix_scan_list(root, splan->filterKeys, rtoffset);
 			}
 			break;
 		case T_SampleScan:
@@ -639,9 +641,27 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 			}
 			break;
 
+		case T_ResultCache:
+			{
+				ResultCache *rcplan = (ResultCache *) plan;
+
+				/*
+				 * Like Material, ResultCache returns its input tuples
+				 * unmodified.  It does evaluate the cache keys, though.
+				 */
+				set_dummy_tlist_references(plan, rtoffset);
+
+				Assert(plan->qual == NIL);
+
+				rcplan->param_exprs = fix_scan_list(root, rcplan->param_exprs,
+													rtoffset);
+			}
+			break;
+
 		case T_Hash:
 		case T_Material:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
 
@@ -1882,6 +1902,16 @@ set_param_references(PlannerInfo *root, Plan *plan)
 			((GatherMerge *) plan)->initParam =
 				bms_intersect(plan->lefttree->extParam, initSetParam);
 	}
+
+	/*
+	 * A runtime filter pushed down into a scan below a Gather is set by the
+	 * hash join above it, but it must be passed to the workers just the same.
+	 */
+	if (IsA(plan, Gather) && IsA(plan->lefttree, SeqScan) &&
+		((SeqScan *) plan->lefttree)->filterParam >= 0)
+		((Gather *) plan)->initParam =
+			bms_add_member(((Gather *) plan)->initParam,
+						   ((SeqScan *) plan->lefttree)->filterParam);
 }
 
 /*
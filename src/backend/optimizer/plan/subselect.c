@@ -2353,7 +2353,17 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 			break;
 
 		case T_SeqScan:
-			context.paramids = bms_add_members(context.paramids, scan_params);
+			{
+				SeqScan    *sscan = (SeqScan *) plan;
+
+				finalize_primnode((Node *) sscan->filterKeys, &context);
+				/* the runtime filter comes from a hash join above */
+				if (sscan->filterParam >= 0)
+					context.paramids = bms_add_member(context.paramids,
+													  sscan->filterParam);
+				context.paramids = bms_add_members(context.paramids,
+												   scan_params);
+			}
 			break;
 
 		case T_SampleScan:
@@ -2695,6 +2705,13 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 							  &context);
 			finalize_primnode((Node *) ((HashJoin *) plan)->hashclauses,
 							  &context);
+			/* the outer child is allowed to reference a runtime filter */
+			if (((Hash *) plan->righttree)->filterParam >= 0)
+			{
+				locally_added_param = ((Hash *) plan->righttree)->filterParam;
+				valid_params = bms_add_member(bms_copy(valid_params),
+											  locally_added_param);
+			}
 			break;
 
 		case T_Limit:
@@ -2791,10 +2808,16 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 			/* rescan_param does *not* get added to scan_params */
 			break;
 
+		case T_ResultCache:
+			finalize_primnode((Node *) ((ResultCache *) plan)->param_exprs,
+							  &context);
+			break;
+
 		case T_ProjectSet:
 		case T_Hash:
 		case T_Material:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
 		case T_Group:
@@ -112,6 +112,7 @@ static bool contain_context_dependent_node_walker(Node *node, int *flags);
 static bool contain_leaked_vars_walker(Node *node, void *context);
 static Relids find_nonnullable_rels_walker(Node *node, bool top_level);
 static List *find_nonnullable_vars_walker(Node *node, bool top_level);
+static bool pull_paramids_walker(Node *node, Bitmapset **context);
 static bool is_strict_saop(ScalarArrayOpExpr *expr, bool falseOK);
 static Node *eval_const_expressions_mutator(Node *node,
 							   eval_const_expressions_context *context);
@@ -2281,6 +2282,37 @@ NumRelids(Node *clause)
 	return result;
 }
 
+/*
+ * pull_paramids
+ *
+ * Returns the paramids of all the PARAM_EXEC Params in 'clause'.
+ */
+Bitmapset *
+pull_paramids(Node *clause)
+{
+	Bitmapset  *result = NULL;
+
+	(void) pull_paramids_walker(clause, &result);
+	return result;
+}
+
+static bool
+pull_paramids_walker(Node *node, Bitmapset **context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Param))
+	{
+		Param	   *param = (Param *) node;
+
+		if (param->paramkind == PARAM_EXEC)
+			*context = bms_add_member(*context, param->paramid);
+		return false;
+	}
+	return expression_tree_walker(node, pull_paramids_walker,
+								  (void *) context);
+}
+
 /*
  * CommuteOpExpr: commute a binary operator clause
  *
@@ -256,6 +256,7 @@ static int	localNumBackends = 0;
  */
 static PgStat_ArchiverStats archiverStats;
 static PgStat_GlobalStats globalStats;
+static PgStat_ConnStartupStats connStartupStats;
 
 /*
  * List of OIDs of databases we need to write out.  If an entry is InvalidOid,
@@ -336,6 +337,7 @@ static void pgstat_recv_funcpurge(PgStat_MsgFuncpurge *msg, int len);
 static void pgstat_recv_recoveryconflict(PgStat_MsgRecoveryConflict *msg, int len);
 static void pgstat_recv_deadlock(PgStat_MsgDeadlock *msg, int len);
 static void pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len);
+static void pgstat_recv_connstartup(PgStat_MsgConnStartup *msg, int len);
 
 /* ------------------------------------------------------------
  * Public functions called from postmaster follow
@@ -1336,11 +1338,13 @@ pgstat_reset_shared_counters(const char *target)
 		msg.m_resettarget = RESET_ARCHIVER;
 	else if (strcmp(target, "bgwriter") == 0)
 		msg.m_resettarget = RESET_BGWRITER;
+	else if (strcmp(target, "connection_startup") == 0)
+		msg.m_resettarget = RESET_CONNECTION_STARTUP;
 	else
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
 				 errmsg("unrecognized reset target: \"%s\"", target),
-				 errhint("Target must be \"archiver\" or \"bgwriter\".")));
+				 errhint("Target must be \"archiver\", \"bgwriter\" or \"connection_startup\".")));
 
 	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_RESETSHAREDCOUNTER);
 	pgstat_send(&msg, sizeof(msg));
@@ -2580,6 +2584,22 @@ pgstat_fetch_global(void)
 	return &globalStats;
 }
 
+/*
+ * ---------
+ * pgstat_fetch_stat_connstartup() -
+ *
+ *	Support function for the SQL-callable pgstat* functions. Returns
+ *	a pointer to the connection startup statistics struct.
+ * ---------
+ */
+PgStat_ConnStartupStats *
+pgstat_fetch_stat_connstartup(void)
+{
+	backend_read_statsfile();
+
+	return &connStartupStats;
+}
+
 
 /* ------------------------------------------------------------
  * Functions for management of the shared-memory PgBackendStatus array
@@ -3574,6 +3594,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 
 	switch (w)
 	{
+		case WAIT_EVENT_APPEND_READY:
+			event_name = "AppendReady";
+			break;
 		case WAIT_EVENT_BGWORKER_SHUTDOWN:
 			event_name = "BgWorkerShutdown";
 			break;
@@ -3631,6 +3654,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_HASH_GROW_BUCKETS_REINSERTING:
 			event_name = "Hash/GrowBuckets/Reinserting";
 			break;
+		case WAIT_EVENT_HASHAGG_FILLING:
+			event_name = "HashAgg/Filling";
+			break;
 		case WAIT_EVENT_LOGICAL_SYNC_DATA:
 			event_name = "LogicalSyncData";
 			break;
@@ -3658,6 +3684,9 @@ pgstat_get_wait_ipc(WaitEventIPC w)
 		case WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN:
 			event_name = "ParallelCreateIndexScan";
 			break;
+		case WAIT_EVENT_PARALLEL_SORT:
+			event_name = "ParallelSort";
+			break;
 		case WAIT_EVENT_PROCARRAY_GROUP_UPDATE:
 			event_name = "ProcArrayGroupUpdate";
 			break;
@@ -4200,6 +4229,55 @@ pgstat_send_archiver(const char *xlog, bool failed)
 	pgstat_send(&msg, sizeof(msg));
 }
 
+/* ----------
+ * pgstat_report_connection_startup() -
+ *
+ *	Tell the collector how long each phase of setting up this backend's
+ *	client connection took.  ready_time is when the first ReadyForQuery
+ *	was sent, or zero if the connection is handed over to a session pool
+ *	worker instead.
+ * ----------
+ */
+void
+pgstat_report_connection_startup(Port *port, TimestampTz ready_time)
+{
+	PgStat_MsgConnStartup msg;
+	int			i;
+
+	if (pgStatSock == PGINVALID_SOCKET)
+		return;
+
+	for (i = 0; i < CONN_STARTUP_NUM_PHASES; i++)
+		msg.m_phase_time[i] = -1;
+
+#define CONN_STARTUP_TIME(phase, start, end) \
+	do { \
+		if ((start) != 0 && (end) != 0) \
+			msg.m_phase_time[phase] = (end) - (start); \
+	} while (0)
+
+	CONN_STARTUP_TIME(CONN_STARTUP_FORK, port->accept_time,
+					  port->SessionStartTime);
+	CONN_STARTUP_TIME(CONN_STARTUP_SSL, port->ssl_start_time,
+					  port->ssl_end_time);
+	CONN_STARTUP_TIME(CONN_STARTUP_AUTH, port->auth_start_time,
+					  port->auth_end_time);
+	CONN_STARTUP_TIME(CONN_STARTUP_INIT, port->init_start_time,
+					  port->init_end_time);
+	CONN_STARTUP_TIME(CONN_STARTUP_READY, port->init_end_time, ready_time);
+	CONN_STARTUP_TIME(CONN_STARTUP_TOTAL, port->accept_time, ready_time);
+
+#undef CONN_STARTUP_TIME
+
+	/* Authentication happens inside InitPostgres; count it only once */
+	if (msg.m_phase_time[CONN_STARTUP_INIT] >= 0 &&
+		msg.m_phase_time[CONN_STARTUP_AUTH] >= 0)
+		msg.m_phase_time[CONN_STARTUP_INIT] -= msg.m_phase_time[CONN_STARTUP_AUTH];
+
+	pgstat_setheader(&msg.m_hdr, PGSTAT_MTYPE_CONNSTARTUP);
+	pgstat_send(&msg, sizeof(msg));
+}
+
 /* ----------
  * pgstat_send_bgwriter() -
  *
@@ -4448,6 +4526,11 @@ PgstatCollectorMain(int argc, char *argv[])
 					pgstat_recv_tempfile((PgStat_MsgTempFile *) &msg, len);
 					break;
 
+				case PGSTAT_MTYPE_CONNSTARTUP:
+					pgstat_recv_connstartup((PgStat_MsgConnStartup *) &msg,
+											len);
+					break;
+
 				default:
 					break;
 			}
@@ -4713,6 +4796,12 @@ pgstat_write_statsfiles(bool permanent, bool allDbs)
 	rc = fwrite(&archiverStats, sizeof(archiverStats), 1, fpout);
 	(void) rc;					/* we'll check for error with ferror */
 
+	/*
+	 * Write connection startup stats struct
+	 */
+	rc = fwrite(&connStartupStats, sizeof(connStartupStats), 1, fpout);
+	(void) rc;					/* we'll check for error with ferror */
+
 	/*
 	 * Walk through the database table.
 	 */
@@ -4965,11 +5054,12 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 						 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
 
 	/*
-	 * Clear out global and archiver statistics so they start from zero in
-	 * case we can't load an existing statsfile.
+	 * Clear out global, archiver and connection startup statistics so they
+	 * start from zero in case we can't load an existing statsfile.
 	 */
 	memset(&globalStats, 0, sizeof(globalStats));
 	memset(&archiverStats, 0, sizeof(archiverStats));
+	memset(&connStartupStats, 0, sizeof(connStartupStats));
 
 	/*
 	 * Set the current timestamp (will be kept only in case we can't load an
@@ -4977,6 +5067,7 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 	 */
 	globalStats.stat_reset_timestamp = GetCurrentTimestamp();
 	archiverStats.stat_reset_timestamp = globalStats.stat_reset_timestamp;
+	connStartupStats.stat_reset_timestamp = globalStats.stat_reset_timestamp;
 
 	/*
 	 * Try to open the stats file. If it doesn't exist, the backends simply
@@ -5040,6 +5131,18 @@ pgstat_read_statsfiles(Oid onlydb, bool permanent, bool deep)
 		goto done;
 	}
 
+	/*
+	 * Read connection startup stats struct
+	 */
+	if (fread(&connStartupStats, 1, sizeof(connStartupStats),
+			  fpin) != sizeof(connStartupStats))
+	{
+		ereport(pgStatRunningInCollector ? LOG : WARNING,
+				(errmsg("corrupted statistics file \"%s\"", statfile)));
+		memset(&connStartupStats, 0, sizeof(connStartupStats));
+		goto done;
+	}
+
 	/*
 	 * We found an existing collector stats file. Read it and put all the
 	 * hashtable entries into place.
@@ -5338,6 +5441,7 @@ pgstat_read_db_statsfile_timestamp(Oid databaseid, bool permanent,
 	PgStat_StatDBEntry dbentry;
 	PgStat_GlobalStats myGlobalStats;
 	PgStat_ArchiverStats myArchiverStats;
+	PgStat_ConnStartupStats myConnStartupStats;
 	FILE	   *fpin;
 	int32		format_id;
 	const char *statfile = permanent ? PGSTAT_STAT_PERMANENT_FILENAME : pgstat_stat_filename;
@@ -5392,6 +5496,18 @@ pgstat_read_db_statsfile_timestamp(Oid databaseid, bool permanent,
 		return false;
 	}
 
+	/*
+	 * Read connection startup stats struct
+	 */
+	if (fread(&myConnStartupStats, 1, sizeof(myConnStartupStats),
+			  fpin) != sizeof(myConnStartupStats))
+	{
+		ereport(pgStatRunningInCollector ? LOG : WARNING,
+				(errmsg("corrupted statistics file \"%s\"", statfile)));
+		FreeFile(fpin);
+		return false;
+	}
+
 	/* By default, we're going to return the timestamp of the global file. */
 	*ts = myGlobalStats.stats_timestamp;
 
@@ -5954,6 +6070,12 @@ pgstat_recv_resetsharedcounter(PgStat_MsgResetsharedcounter *msg, int len)
 		memset(&archiverStats, 0, sizeof(archiverStats));
 		archiverStats.stat_reset_timestamp = GetCurrentTimestamp();
 	}
+	else if (msg->m_resettarget == RESET_CONNECTION_STARTUP)
+	{
+		/* Reset the connection startup statistics for the cluster. */
+		memset(&connStartupStats, 0, sizeof(connStartupStats));
+		connStartupStats.stat_reset_timestamp = GetCurrentTimestamp();
+	}
 
 	/*
 	 * Presumably the sender of this message validated the target, don't
@@ -6206,6 +6328,40 @@ pgstat_recv_tempfile(PgStat_MsgTempFile *msg, int len)
 	dbentry->n_temp_files += 1;
 }
 
+/* ----------
+ * pgstat_recv_connstartup() -
+ *
+ *	Process a CONNSTARTUP message.
+ * ----------
+ */
+static void
+pgstat_recv_connstartup(PgStat_MsgConnStartup *msg, int len)
+{
+	int			i;
+
+	for (i = 0; i < CONN_STARTUP_NUM_PHASES; i++)
+	{
+		PgStat_Counter usecs = msg->m_phase_time[i];
+		PgStat_Counter bound = 100;
+		int			bucket;
+
+		if (usecs < 0)
+			continue;
+
+		/* Buckets are a decade wide, starting below 0.1ms */
+		for (bucket = 0; bucket < CONN_STARTUP_HIST_BUCKETS - 1; bucket++)
+		{
+			if (usecs < bound)
+				break;
+			bound *= 10;
+		}
+
+		connStartupStats.count[i]++;
+		connStartupStats.total_time[i] += usecs;
+		connStartupStats.histogram[i][bucket]++;
+	}
+}
+
 /* ----------
  * pgstat_recv_funcstat() -
  *
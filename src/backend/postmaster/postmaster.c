@@ -81,6 +81,10 @@
 #include <sys/select.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_BONJOUR
 #include <dns_sd.h>
 #endif
@@ -99,6 +103,7 @@
 #include "catalog/pg_control.h"
 #include "common/file_perm.h"
 #include "common/ip.h"
+#include "common/zpq_stream.h"
 #include "lib/ilist.h"
 #include "libpq/auth.h"
 #include "libpq/libpq.h"
@@ -113,6 +118,7 @@
 #include "postmaster/fork_process.h"
 #include "postmaster/pgarch.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/sessionpool.h"
 #include "postmaster/syslogger.h"
 #include "replication/logicallauncher.h"
 #include "replication/walsender.h"
@@ -121,10 +127,12 @@
 #include "storage/pg_shmem.h"
 #include "storage/pmsignal.h"
 #include "storage/proc.h"
+#include "storage/sinval.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
 #include "utils/datetime.h"
 #include "utils/dynamic_loader.h"
+#include "utils/hsearch.h"
 #include "utils/memutils.h"
 #include "utils/pidfile.h"
 #include "utils/ps_status.h"
@@ -179,11 +187,66 @@ typedef struct bkend
 	int			bkend_type;
 	bool		dead_end;		/* is it going to send an error and quit? */
 	bool		bgworker_notify;	/* gets bgworker start/stop notifications */
+	struct SessionPool *pool;	/* session pool it serves, if any */
+	bool		prefork_idle;	/* preforked, waiting for a connection? */
+	pgsocket	session_sock;	/* socket for passing sessions to it */
 	dlist_node	elem;			/* list link in BackendList */
 } Backend;
 
 static dlist_head BackendList = DLIST_STATIC_INIT(BackendList);
 
+/*
+ * When session pooling is enabled, we keep a set of pool worker backends
+ * for each combination of database and user.  Client sessions handed to us
+ * by the backends that authenticated them are passed on to the workers in
+ * round-robin order.  The key is zero-padded so it can be hashed as a blob.
+ */
+typedef struct SessionPoolKey
+{
+	char		database[NAMEDATALEN];
+	char		username[NAMEDATALEN];
+} SessionPoolKey;
+
+typedef struct SessionPool
+{
+	SessionPoolKey key;			/* hash key; must be first */
+	int			n_workers;		/* number of entries in workers[] */
+	int			next_worker;	/* worker to try first for the next session */
+	Backend    *workers[FLEXIBLE_ARRAY_MEMBER]; /* SessionPoolSize entries */
+} SessionPool;
+
+static HTAB *SessionPools = NULL;
+
+/*
+ * Sessions returned to us by pool workers (see session_pool_return_delay)
+ * wait here until their client sends something, and are then passed on to
+ * any worker of their pool.  Their sockets are watched with an epoll set of
+ * their own, whose descriptor is one of the events ServerLoop waits for, so
+ * that the postmaster's wait set doesn't have to be resized as they come and
+ * go.
+ */
+typedef struct ParkedSession
+{
+	dlist_node	elem;			/* list link in ParkedSessions */
+	pgsocket	sock;			/* the client connection */
+	size_t		len;			/* length of msg */
+	char		msg[FLEXIBLE_ARRAY_MEMBER]; /* message from the worker */
+} ParkedSession;
+
+static dlist_head ParkedSessions = DLIST_STATIC_INIT(ParkedSessions);
+static int	ParkedSessionsFd = -1;
+
+/* Preforked backends waiting for a connection; see PreforkBackends */
+static Backend **PreforkIdle = NULL;
+static int	NumPreforkIdle = 0;
+
+/*
+ * Set when a preforked backend fails before getting a connection, typically
+ * because there was no free PGPROC for it.  We then don't prefork any more
+ * backends until some other backend has exited.
+ */
+static bool PreforkPaused = false;
+
 #ifdef EXEC_BACKEND
 static Backend *ShmemBackendArray;
 #endif
@@ -212,10 +275,25 @@ char	   *ListenAddresses;
  */
 int			ReservedBackends;
 
+/*
+ * PreforkBackends is the number of backends we keep forked in advance, ready
+ * to serve new connections.  Each has done as much of its initialization as
+ * it can without knowing the client, and waits for the postmaster to pass it
+ * a client socket.
+ */
+int			PreforkBackends;
+
 /* The socket(s) we're listening to. */
 #define MAXLISTEN	64
 static pgsocket ListenSocket[MAXLISTEN];
 
+/*
+ * What ServerLoop waits on: the listen sockets, the session pooling
+ * descriptors, and our latch.
+ */
+#define MAXSERVERLOOPEVENTS	(MAXLISTEN + 3)
+static WaitEventSet *pm_wait_set = NULL;
+
 /*
  * Set by the -o option
  */
@@ -415,8 +493,9 @@ static int	ServerLoop(void);
 static int	BackendStartup(Port *port);
 static int	ProcessStartupPacket(Port *port, bool SSLdone);
 static void SendNegotiateProtocolVersion(List *unrecognized_protocol_options);
+static char *SelectCompressionAlgorithm(Port *port, const char *algorithms);
 static void processCancelRequest(Port *port, void *pkt);
-static int	initMasks(fd_set *rmask);
+static void ConfigurePostmasterWaitSet(void);
 static void report_fork_failure_to_client(Port *port, int errnum);
 static CAC_state canAcceptConnections(void);
 static bool RandomCancelKey(int32 *cancel_key);
@@ -434,6 +513,25 @@ static pid_t StartChildProcess(AuxProcType type);
 static void StartAutovacuumWorker(void);
 static void MaybeStartWalReceiver(void);
 static void InitPostmasterDeathWatchHandle(void);
+static void InitSessionPools(void);
+static void HandleSessionHandoffs(void);
+static void DispatchSession(pgsocket sock, const char *msg, size_t len,
+				const char *database, const char *user, CAC_state cac);
+static bool StartSessionPoolWorker(SessionPool *pool, pgsocket sock,
+					   const char *msg, size_t len);
+static void RemoveSessionPoolWorker(Backend *bp);
+static void StopSessionPools(void);
+static bool ParkSession(pgsocket sock, const char *msg, size_t len);
+static void UnparkSession(ParkedSession *ps);
+static void HandleParkedSessions(void);
+static void DropParkedSessions(void);
+static void MaybeStartPreforkedBackends(void);
+static int	DispatchToPreforkedBackend(Port *port);
+static void RemovePreforkedBackend(Backend *bp);
+static void StopPreforkedBackends(void);
+#ifndef EXEC_BACKEND
+static void PreforkedBackendMain(pgsocket chan) pg_attribute_noreturn();
+#endif
 
 /*
  * Archiver is allowed to start up at the current postmaster state?
@@ -627,11 +725,12 @@ PostmasterMain(int argc, char *argv[])
 	 * In the postmaster, we want to install non-ignored handlers *without*
 	 * SA_RESTART.  This is because they'll be blocked at all times except
 	 * when ServerLoop is waiting for something to happen, and during that
-	 * window, we want signals to exit the select(2) wait so that ServerLoop
-	 * can respond if anything interesting happened.  On some platforms,
-	 * signals marked SA_RESTART would not cause the select() wait to end.
-	 * Child processes will generally want SA_RESTART, but we expect them to
-	 * set up their own handlers before unblocking signals.
+	 * window, we want signals to exit the wait so that ServerLoop can respond
+	 * if anything interesting happened.  The handlers also set the
+	 * postmaster's latch, since WaitEventSetWait() would otherwise just
+	 * resume waiting after being interrupted.  Child processes will generally
+	 * want SA_RESTART, but we expect them to set up their own handlers before
+	 * unblocking signals.
 	 *
 	 * CAUTION: when changing this list, check for side-effects on the signal
 	 * handling setup of child processes.  See tcop/postgres.c,
@@ -643,6 +742,9 @@ PostmasterMain(int argc, char *argv[])
 	pqinitmask();
 	PG_SETMASK(&BlockSig);
 
+	/* The handlers set our latch to wake up ServerLoop */
+	InitProcessLocalLatch();
+
 	pqsignal_no_restart(SIGHUP, SIGHUP_handler);	/* reread config file and
 													 * have children do same */
 	pqsignal_no_restart(SIGINT, pmdie); /* send SIGTERM and shut down */
@@ -1187,6 +1289,17 @@ PostmasterMain(int argc, char *argv[])
 	 */
 	InitPostmasterDeathWatchHandle();
 
+	/*
+	 * Set up the socket through which backends hand client sessions over to
+	 * the session pools, if pooling is enabled.  Preforked backends use it
+	 * to pass on cancel requests.
+	 */
+	if (SessionPoolSize > 0 || PreforkBackends > 0)
+		InitSessionPools();
+
+	if (PreforkBackends > 0)
+		PreforkIdle = (Backend **) palloc(PreforkBackends * sizeof(Backend *));
+
 #ifdef WIN32
 
 	/*
@@ -1613,19 +1726,18 @@ DetermineSleepTime(struct timeval *timeout)
 static int
 ServerLoop(void)
 {
-	fd_set		readmask;
-	int			nSockets;
+	WaitEvent	events[MAXSERVERLOOPEVENTS];
 	time_t		last_lockfile_recheck_time,
 				last_touch_time;
 
 	last_lockfile_recheck_time = last_touch_time = time(NULL);
 
-	nSockets = initMasks(&readmask);
+	ConfigurePostmasterWaitSet();
 
 	for (;;)
 	{
-		fd_set		rmask;
-		int			selres;
+		int			nevents;
+		int			i;
 		time_t		now;
 
 		/*
@@ -1633,25 +1745,24 @@ ServerLoop(void)
 		 *
 		 * We block all signals except while sleeping. That makes it safe for
 		 * signal handlers, which again block all signals while executing, to
-		 * do nontrivial work.
+		 * do nontrivial work.  Each of them sets our latch when done, which
+		 * ends the wait.
 		 *
 		 * If we are in PM_WAIT_DEAD_END state, then we don't want to accept
-		 * any new connections, so we don't call select(), and just sleep.
+		 * any new connections, so we don't wait on the sockets, and just
+		 * sleep.
 		 */
-		memcpy((char *) &rmask, (char *) &readmask, sizeof(fd_set));
-
 		if (pmState == PM_WAIT_DEAD_END)
 		{
 			PG_SETMASK(&UnBlockSig);
 
 			pg_usleep(100000L); /* 100 msec seems reasonable */
-			selres = 0;
+			nevents = 0;
 
 			PG_SETMASK(&BlockSig);
 		}
 		else
 		{
-			/* must set timeout each time; some OSes change it! */
 			struct timeval timeout;
 
 			/* Needs to run with blocked signals! */
@@ -1659,51 +1770,55 @@ ServerLoop(void)
 
 			PG_SETMASK(&UnBlockSig);
 
-			selres = select(nSockets, &rmask, NULL, NULL, &timeout);
+			/* There's no PGPROC to report a wait event in */
+			nevents = WaitEventSetWait(pm_wait_set,
+									   timeout.tv_sec * 1000L +
+									   timeout.tv_usec / 1000L,
+									   events, lengthof(events), 0);
 
 			PG_SETMASK(&BlockSig);
 		}
 
-		/* Now check the select() result */
-		if (selres < 0)
+		for (i = 0; i < nevents; i++)
 		{
-			if (errno != EINTR && errno != EWOULDBLOCK)
+			pgsocket	fd = events[i].fd;
+
+			/* A signal handler has run; the loop below does the rest */
+			if (events[i].events & WL_LATCH_SET)
 			{
-				ereport(LOG,
-						(errcode_for_socket_access(),
-						 errmsg("select() failed in postmaster: %m")));
-				return STATUS_ERROR;
+				ResetLatch(MyLatch);
+				continue;
 			}
-		}
 
-		/*
-		 * New connection pending on any of our sockets? If so, fork a child
-		 * process to deal with it.
-		 */
-		if (selres > 0)
-		{
-			int			i;
+			/* Sessions handed to us by backends, for the session pools */
+			if (fd == SessionHandoffSock[SESSION_HANDOFF_RECV])
+				HandleSessionHandoffs();
+
+			/* Returned sessions whose clients have sent something */
+			else if (fd == ParkedSessionsFd)
+				HandleParkedSessions();
 
-			for (i = 0; i < MAXLISTEN; i++)
+			/*
+			 * Otherwise it's one of the listen sockets, so there's a new
+			 * connection pending.  Fork a child process to deal with it.
+			 */
+			else
 			{
-				if (ListenSocket[i] == PGINVALID_SOCKET)
-					break;
-				if (FD_ISSET(ListenSocket[i], &rmask))
-				{
-					Port	   *port;
+				Port	   *port;
 
-					port = ConnCreate(ListenSocket[i]);
-					if (port)
-					{
+				port = ConnCreate(fd);
+				if (port)
+				{
+					if (NumPreforkIdle == 0 ||
+						DispatchToPreforkedBackend(port) != STATUS_OK)
 						BackendStartup(port);
 
-						/*
-						 * We no longer need the open socket or port structure
-						 * in this process
-						 */
-						StreamClose(port->sock);
-						ConnFree(port);
-					}
+					/*
+					 * We no longer need the open socket or port structure in
+					 * this process
+					 */
+					StreamClose(port->sock);
+					ConnFree(port);
 				}
 			}
 		}
@@ -1712,6 +1827,10 @@ ServerLoop(void)
 		if (SysLoggerPID == 0 && Logging_collector)
 			SysLoggerPID = SysLogger_Start();
 
+		/* Replace preforked backends that have been used up */
+		if (NumPreforkIdle < PreforkBackends)
+			MaybeStartPreforkedBackends();
+
 		/*
 		 * If no background writer process is running, and we are not in a
 		 * state that prevents it, start one.  It doesn't matter if this
@@ -1847,30 +1966,40 @@ ServerLoop(void)
 }
 
 /*
- * Initialise the masks for select() for the ports we are listening on.
- * Return the number of sockets to listen on.
+ * Set up the WaitEventSet that ServerLoop waits on.
+ *
+ * None of the descriptors change while ServerLoop runs, so this is done just
+ * once.  Where epoll is available, the cost of each wait doesn't depend on
+ * how many descriptors the set covers, nor are they limited by FD_SETSIZE.
  */
-static int
-initMasks(fd_set *rmask)
+static void
+ConfigurePostmasterWaitSet(void)
 {
-	int			maxsock = -1;
 	int			i;
 
-	FD_ZERO(rmask);
+	Assert(pm_wait_set == NULL);
+
+	pm_wait_set = CreateWaitEventSet(PostmasterContext, MAXSERVERLOOPEVENTS);
+
+	AddWaitEventToSet(pm_wait_set, WL_LATCH_SET, PGINVALID_SOCKET, MyLatch,
+					  NULL);
 
 	for (i = 0; i < MAXLISTEN; i++)
 	{
-		int			fd = ListenSocket[i];
-
-		if (fd == PGINVALID_SOCKET)
+		if (ListenSocket[i] == PGINVALID_SOCKET)
 			break;
-		FD_SET(fd, rmask);
-
-		if (fd > maxsock)
-			maxsock = fd;
+		AddWaitEventToSet(pm_wait_set, WL_SOCKET_READABLE, ListenSocket[i],
+						  NULL, NULL);
 	}
 
-	return maxsock + 1;
+	if (SessionHandoffSock[SESSION_HANDOFF_RECV] != PGINVALID_SOCKET)
+		AddWaitEventToSet(pm_wait_set, WL_SOCKET_READABLE,
+						  SessionHandoffSock[SESSION_HANDOFF_RECV],
+						  NULL, NULL);
+
+	if (ParkedSessionsFd >= 0)
+		AddWaitEventToSet(pm_wait_set, WL_SOCKET_READABLE, ParkedSessionsFd,
+						  NULL, NULL);
 }
 
 
@@ -1979,8 +2108,13 @@ retry1:
 		}
 
 #ifdef USE_SSL
-		if (SSLok == 'S' && secure_open_server(port) == -1)
-			return STATUS_ERROR;
+		if (SSLok == 'S')
+		{
+			port->ssl_start_time = GetCurrentTimestamp();
+			if (secure_open_server(port) == -1)
+				return STATUS_ERROR;
+			port->ssl_end_time = GetCurrentTimestamp();
+		}
 #endif
 		/* regular startup packet, cancel, etc packet should follow... */
 		/* but not another SSL negotiation request */
@@ -2069,12 +2203,21 @@ retry1:
 									valptr),
 							 errhint("Valid values are: \"false\", 0, \"true\", 1, \"database\".")));
 			}
+			else if (strcmp(nameptr, "_pq_.compression") == 0)
+			{
+				/*
+				 * The client can decompress with any of the listed
+				 * algorithms.  If we can't or won't use any of them, the
+				 * option is still recognized, we just don't acknowledge it.
+				 */
+				port->compression_algorithm =
+					SelectCompressionAlgorithm(port, valptr);
+			}
 			else if (strncmp(nameptr, "_pq_.", 5) == 0)
 			{
 				/*
 				 * Any option beginning with _pq_. is reserved for use as a
-				 * protocol-level option, but at present no such options are
-				 * defined.
+				 * protocol-level option.
 				 */
 				unrecognized_protocol_options =
 					lappend(unrecognized_protocol_options, pstrdup(nameptr));
@@ -2250,6 +2393,40 @@ SendNegotiateProtocolVersion(List *unrecognized_protocol_options)
 	/* no need to flush, some other message will follow */
 }
 
+/*
+ * Choose a protocol compression algorithm from the comma-separated list sent
+ * by the client, in the client's order of preference.  Returns NULL if
+ * compression is disabled or none of them is supported.
+ *
+ * Compressing encrypted traffic lets an attacker who can inject data into
+ * the connection learn secrets from the size of the encrypted messages, as
+ * in the CRIME attack on TLS, so SSL connections are only compressed if
+ * libpq_compression_over_ssl says so.
+ */
+static char *
+SelectCompressionAlgorithm(Port *port, const char *algorithms)
+{
+	char	   *rawstring;
+	char	   *algorithm;
+
+	if (!libpq_compression)
+		return NULL;
+	if (port->ssl_in_use && !libpq_compression_over_ssl)
+		return NULL;
+
+	rawstring = pstrdup(algorithms);
+	for (algorithm = strtok(rawstring, ", ");
+		 algorithm != NULL;
+		 algorithm = strtok(NULL, ", "))
+	{
+		if (zpq_algorithm_supported(algorithm))
+			return algorithm;
+	}
+	pfree(rawstring);
+
+	return NULL;
+}
+
 /*
  * The client has sent a cancel request packet, not a normal
  * start-a-new-connection packet.  Perform the necessary processing.
@@ -2269,9 +2446,47 @@ processCancelRequest(Port *port, void *pkt)
 	int			i;
 #endif
 
+	/*
+	 * A preforked backend's copy of the backend list dates from when it was
+	 * forked, so pass the request on to the postmaster instead.
+	 */
+	if (IsPreforkedBackend)
+	{
+		if (StreamSendSocket(SessionHandoffSock[SESSION_HANDOFF_SEND],
+							 PGINVALID_SOCKET, canc,
+							 sizeof(CancelRequestPacket), false) != STATUS_OK)
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not pass cancel request to postmaster: %m")));
+		return;
+	}
+
 	backendPID = (int) pg_ntoh32(canc->backendPID);
 	cancelAuthCode = (int32) pg_ntoh32(canc->cancelAuthCode);
 
+#ifndef EXEC_BACKEND
+
+	/*
+	 * A pooled session keeps the process ID and cancel key its client was
+	 * first given wherever it moves, so look for a pool worker that is
+	 * serving the session now.  A worker serves several sessions, so the
+	 * request is never matched against its own process ID and key below.
+	 */
+	dlist_foreach(iter, &BackendList)
+	{
+		bp = dlist_container(Backend, elem, iter.cur);
+		if (bp->pool != NULL &&
+			SessionPoolCancel(bp->child_slot, backendPID, cancelAuthCode))
+		{
+			ereport(DEBUG2,
+					(errmsg_internal("processing cancel request: sending SIGINT to process %d serving session of process %d",
+									 (int) bp->pid, backendPID)));
+			signal_child(bp->pid, SIGINT);
+			return;
+		}
+	}
+#endif
+
 	/*
 	 * See if we have a matching backend.  In the EXEC_BACKEND case, we can no
 	 * longer access the postmaster's own backend list, and must rely on the
@@ -2288,6 +2503,16 @@ processCancelRequest(Port *port, void *pkt)
 #endif
 		if (bp->pid == backendPID)
 		{
+#ifndef EXEC_BACKEND
+			if (bp->pool != NULL)
+			{
+				/* The session is idle, or the key is wrong */
+				ereport(DEBUG2,
+						(errmsg_internal("ignoring cancel request for process %d, which is not serving the session",
+										 backendPID)));
+				return;
+			}
+#endif
 			if (bp->cancel_key == cancelAuthCode)
 			{
 				/* Found a match; signal that backend to cancel current op */
@@ -2391,6 +2616,8 @@ ConnCreate(int serverFd)
 		return NULL;
 	}
 
+	port->accept_time = GetCurrentTimestamp();
+
 	/*
 	 * Allocate GSSAPI specific state struct
 	 */
@@ -2455,6 +2682,13 @@ ClosePostmasterPorts(bool am_syslogger)
 	postmaster_alive_fds[POSTMASTER_FD_OWN] = -1;
 #endif
 
+	/* Release the postmaster's wait set; this closes its epoll descriptor */
+	if (pm_wait_set != NULL)
+	{
+		FreeWaitEventSet(pm_wait_set);
+		pm_wait_set = NULL;
+	}
+
 	/* Close the listen sockets */
 	for (i = 0; i < MAXLISTEN; i++)
 	{
@@ -2465,6 +2699,45 @@ ClosePostmasterPorts(bool am_syslogger)
 		}
 	}
 
+	/* Close the sockets on which we pass sessions to session pool workers */
+	if (SessionHandoffSock[SESSION_HANDOFF_RECV] != PGINVALID_SOCKET)
+	{
+		StreamClose(SessionHandoffSock[SESSION_HANDOFF_RECV]);
+		SessionHandoffSock[SESSION_HANDOFF_RECV] = PGINVALID_SOCKET;
+	}
+	if (SessionPools != NULL)
+	{
+		dlist_iter	iter;
+
+		dlist_foreach(iter, &BackendList)
+		{
+			Backend    *bp = dlist_container(Backend, elem, iter.cur);
+
+			if (bp->session_sock != PGINVALID_SOCKET)
+				StreamClose(bp->session_sock);
+		}
+	}
+
+	/*
+	 * Close returned sessions' sockets too.  Don't touch the epoll set other
+	 * than closing it, since it's shared with the postmaster.
+	 */
+	if (ParkedSessionsFd >= 0)
+	{
+		dlist_mutable_iter iter;
+
+		dlist_foreach_modify(iter, &ParkedSessions)
+		{
+			ParkedSession *ps = dlist_container(ParkedSession, elem, iter.cur);
+
+			dlist_delete(iter.cur);
+			StreamClose(ps->sock);
+			free(ps);
+		}
+		close(ParkedSessionsFd);
+		ParkedSessionsFd = -1;
+	}
+
 	/* If using syslogger, close the read side of the pipe */
 	if (!am_syslogger)
 	{
@@ -2566,12 +2839,21 @@ SIGHUP_handler(SIGNAL_ARGS)
 		}
 #endif
 
+		/*
+		 * Preforked backends have stale copies of all of the above, so
+		 * replace them.
+		 */
+		StopPreforkedBackends();
+
 #ifdef EXEC_BACKEND
 		/* Update the starting-point file for future children */
 		write_nondefault_variables(PGC_SIGHUP);
 #endif
 	}
 
+	/* Wake up ServerLoop, so that it can react to what we did */
+	SetLatch(MyLatch);
+
 	PG_SETMASK(&UnBlockSig);
 
 	errno = save_errno;
@@ -2613,6 +2895,10 @@ pmdie(SIGNAL_ARGS)
 			sd_notify(0, "STOPPING=1");
 #endif
 
+			/* Session pool workers exit once their sessions are gone */
+			StopSessionPools();
+			StopPreforkedBackends();
+
 			if (pmState == PM_RUN || pmState == PM_RECOVERY ||
 				pmState == PM_HOT_STANDBY || pmState == PM_STARTUP)
 			{
@@ -2665,6 +2951,9 @@ pmdie(SIGNAL_ARGS)
 			ereport(LOG,
 					(errmsg("received fast shutdown request")));
 
+			/* Idle returned sessions are simply disconnected */
+			DropParkedSessions();
+
 			/* Report status */
 			AddToDataDirLockFile(LOCK_FILE_LINE_PM_STATUS, PM_STATUS_STOPPING);
 #ifdef USE_SYSTEMD
@@ -2732,6 +3021,8 @@ pmdie(SIGNAL_ARGS)
 			ereport(LOG,
 					(errmsg("received immediate shutdown request")));
 
+			DropParkedSessions();
+
 			/* Report status */
 			AddToDataDirLockFile(LOCK_FILE_LINE_PM_STATUS, PM_STATUS_STOPPING);
 #ifdef USE_SYSTEMD
@@ -2752,6 +3043,9 @@ pmdie(SIGNAL_ARGS)
 			break;
 	}
 
+	/* Wake up ServerLoop, so that it can react to what we did */
+	SetLatch(MyLatch);
+
 	PG_SETMASK(&UnBlockSig);
 
 	errno = save_errno;
@@ -3068,6 +3362,9 @@ reaper(SIGNAL_ARGS)
 	 */
 	PostmasterStateMachine();
 
+	/* Wake up ServerLoop, so that it can react to what we did */
+	SetLatch(MyLatch);
+
 	/* Done with signal handler */
 	PG_SETMASK(&UnBlockSig);
 
@@ -3253,6 +3550,16 @@ CleanupBackend(int pid,
 				 */
 				BackgroundWorkerStopNotifications(bp->pid);
 			}
+			if (bp->pool != NULL)
+				RemoveSessionPoolWorker(bp);
+			if (bp->prefork_idle)
+			{
+				if (!EXIT_STATUS_0(exitstatus))
+					PreforkPaused = true;
+				RemovePreforkedBackend(bp);
+			}
+			else
+				PreforkPaused = false;
 			dlist_delete(iter.cur);
 			free(bp);
 			break;
@@ -3289,6 +3596,9 @@ HandleChildCrash(int pid, int exitstatus, const char *procname)
 		LogChildExit(LOG, procname, pid, exitstatus);
 		ereport(LOG,
 				(errmsg("terminating any other active server processes")));
+
+		/* Sessions returned by pool workers go the same way as the rest */
+		DropParkedSessions();
 	}
 
 	/* Process background workers. */
@@ -3356,6 +3666,10 @@ HandleChildCrash(int pid, int exitstatus, const char *procname)
 				ShmemBackendArrayRemove(bp);
 #endif
 			}
+			if (bp->pool != NULL)
+				RemoveSessionPoolWorker(bp);
+			if (bp->prefork_idle)
+				RemovePreforkedBackend(bp);
 			dlist_delete(iter.cur);
 			free(bp);
 			/* Keep looping so we can signal remaining backends */
@@ -4004,6 +4318,11 @@ BackendStartup(Port *port)
 	/* Hasn't asked to be notified about any bgworkers yet */
 	bn->bgworker_notify = false;
 
+	/* Not a session pool worker; see StartSessionPoolWorker */
+	bn->pool = NULL;
+	bn->prefork_idle = false;
+	bn->session_sock = PGINVALID_SOCKET;
+
 #ifdef EXEC_BACKEND
 	pid = backend_forkexec(port);
 #else							/* !EXEC_BACKEND */
@@ -4063,105 +4382,883 @@ BackendStartup(Port *port)
 }
 
 /*
- * Try to report backend fork() failure to client before we close the
- * connection.  Since we do not care to risk blocking the postmaster on
- * this connection, we set the connection to non-blocking and try only once.
+ * InitSessionPools -- set up for session pooling
  *
- * This is grungy special-purpose code; we cannot use backend libpq since
- * it's not up and running.
+ * Creates the socket pair through which backends pass authenticated client
+ * sessions to us, and the table of session pools.
  */
 static void
-report_fork_failure_to_client(Port *port, int errnum)
+InitSessionPools(void)
 {
-	char		buffer[1000];
-	int			rc;
+#ifndef WIN32
+	HASHCTL		ctl;
 
-	/* Format the error message packet (always V2 protocol) */
-	snprintf(buffer, sizeof(buffer), "E%s%s\n",
-			 _("could not fork new process for connection: "),
-			 strerror(errnum));
+	if (socketpair(AF_UNIX, SOCK_DGRAM, 0, SessionHandoffSock) < 0)
+		ereport(FATAL,
+				(errcode_for_socket_access(),
+				 errmsg_internal("could not create session handoff socket pair: %m")));
 
-	/* Set port to non-blocking.  Don't do send() if this fails */
-	if (!pg_set_noblock(port->sock))
-		return;
+	if (!pg_set_noblock(SessionHandoffSock[SESSION_HANDOFF_RECV]))
+		ereport(FATAL,
+				(errcode_for_socket_access(),
+				 errmsg_internal("could not set session handoff socket to nonblocking mode: %m")));
 
-	/* We'll retry after EINTR, but ignore all other failures */
-	do
+	MemSet(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(SessionPoolKey);
+	ctl.entrysize = offsetof(SessionPool, workers) +
+		SessionPoolSize * sizeof(Backend *);
+	SessionPools = hash_create("Session pools", 16, &ctl,
+							   HASH_ELEM | HASH_BLOBS);
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (SessionPoolSize > 0)
 	{
-		rc = send(port->sock, buffer, strlen(buffer) + 1, 0);
-	} while (rc < 0 && errno == EINTR);
+		ParkedSessionsFd = epoll_create(16);
+		if (ParkedSessionsFd < 0)
+			ereport(FATAL,
+					(errmsg_internal("epoll_create failed: %m")));
+	}
+#endif
+#endif
 }
 
-
 /*
- * BackendInitialize -- initialize an interactive (postmaster-child)
- *				backend process, and collect the client's startup packet.
- *
- * returns: nothing.  Will not return at all if there's any failure.
+ * HandleSessionHandoffs -- receive sessions handed to us by backends
  *
- * Note: this code does not depend on having any access to shared memory.
- * In the EXEC_BACKEND case, we are physically attached to shared memory
- * but have not yet set up most of our local pointers to shmem structures.
+ * Each new session is passed on to a worker of the pool for its database
+ * and user, and our own copy of the client socket is closed.  Sessions
+ * returned by pool workers are parked until their client sends something.
+ * Cancel requests forwarded by preforked backends arrive here too.
  */
 static void
-BackendInitialize(Port *port)
+HandleSessionHandoffs(void)
 {
-	int			status;
-	int			ret;
-	char		remote_host[NI_MAXHOST];
-	char		remote_port[NI_MAXSERV];
-	char		remote_ps_data[NI_MAXHOST];
+	static char buf[MAX_SESSION_HANDOFF_LENGTH];
 
-	/* Save port etc. for ps status */
-	MyProcPort = port;
+	for (;;)
+	{
+		ssize_t		len = sizeof(buf);
+		pgsocket	sock;
+		const char *database;
+		const char *user;
+		CAC_state	cac;
 
-	/*
-	 * PreAuthDelay is a debugging aid for investigating problems in the
-	 * authentication cycle: it can be set in postgresql.conf to allow time to
-	 * attach to the newly-forked backend with a debugger.  (See also
-	 * PostAuthDelay, which we allow clients to pass through PGOPTIONS, but it
-	 * is not honored until after authentication.)
-	 */
-	if (PreAuthDelay > 0)
-		pg_usleep(PreAuthDelay * 1000000L);
+		sock = StreamReceiveSocket(SessionHandoffSock[SESSION_HANDOFF_RECV],
+								   buf, &len, true);
+		if (len < 0)
+		{
+			if (errno != EWOULDBLOCK && errno != EAGAIN)
+				ereport(LOG,
+						(errcode_for_socket_access(),
+						 errmsg("could not receive session from server process: %m")));
+			break;
+		}
+		if (sock == PGINVALID_SOCKET)
+		{
+			/* A cancel request received by a preforked backend */
+			if (len == sizeof(CancelRequestPacket))
+				processCancelRequest(NULL, buf);
+			continue;
+		}
 
-	/* This flag will remain set until InitPostgres finishes authentication */
-	ClientAuthInProgress = true;	/* limit visibility of log messages */
+		/*
+		 * If we're shutting down, just drop the session; the client will see
+		 * the connection closed, much as if it had been terminated.  Sessions
+		 * may still go to existing workers if we're out of child slots.
+		 */
+		cac = canAcceptConnections();
+		if (!SessionHandoffGetKey(buf, len, &database, &user))
+			ereport(LOG,
+					(errmsg("invalid session handoff message received")));
+		else if (Shutdown == NoShutdown &&
+				 (cac == CAC_OK || cac == CAC_TOOMANY))
+		{
+			SessionHandoffHeader hdr;
 
-	/* save process start time */
-	port->SessionStartTime = GetCurrentTimestamp();
-	MyStartTime = timestamptz_to_time_t(port->SessionStartTime);
+			memcpy(&hdr, buf, sizeof(hdr));
+			if ((hdr.flags & SESSION_HANDOFF_RESUMED) &&
+				ParkSession(sock, buf, len))
+				continue;		/* the socket is kept open while parked */
 
-	/* set these to empty in case they are needed before we set them up */
-	port->remote_host = "";
-	port->remote_port = "";
+			DispatchSession(sock, buf, len, database, user, cac);
+		}
 
-	/*
-	 * Initialize libpq and enable reporting of ereport errors to the client.
-	 * Must do this now because authentication uses libpq to send messages.
-	 */
-	pq_init();					/* initialize libpq to talk to client */
-	whereToSendOutput = DestRemote; /* now safe to ereport to client */
+		StreamClose(sock);
+	}
+}
 
-	/*
-	 * We arrange for a simple exit(1) if we receive SIGTERM or SIGQUIT or
-	 * timeout while trying to collect the startup packet.  Otherwise the
-	 * postmaster cannot shutdown the database FAST or IMMED cleanly if a
-	 * buggy client fails to send the packet promptly.  XXX it follows that
-	 * the remainder of this function must tolerate losing control at any
-	 * instant.  Likewise, any pg_on_exit_callback registered before or during
-	 * this function must be prepared to execute at any instant between here
-	 * and the end of this function.  Furthermore, affected callbacks execute
-	 * partially or not at all when a second exit-inducing signal arrives
-	 * after proc_exit_prepare() decrements on_proc_exit_index.  (Thanks to
-	 * that mechanic, callbacks need not anticipate more than one call.)  This
-	 * is fragile; it ought to instead follow the norm of handling interrupts
-	 * at selected, safe opportunities.
-	 */
-	pqsignal(SIGTERM, startup_die);
-	pqsignal(SIGQUIT, startup_die);
-	InitializeTimeouts();		/* establishes SIGALRM handler */
-	PG_SETMASK(&StartupBlockSig);
+/*
+ * DispatchSession -- pass a session on to a pool worker
+ *
+ * Until the pool has session_pool_size workers, every new session gets a new
+ * worker; after that, sessions are distributed round-robin, skipping any
+ * worker whose queue is full.  Returned sessions only go to running workers,
+ * since a new worker would put the client through the startup sequence.
+ */
+static void
+DispatchSession(pgsocket sock, const char *msg, size_t len,
+				const char *database, const char *user, CAC_state cac)
+{
+	SessionHandoffHeader hdr;
+	SessionPoolKey key;
+	SessionPool *pool;
+	bool		found;
+	int			i;
+
+	memcpy(&hdr, msg, sizeof(hdr));
+
+	MemSet(&key, 0, sizeof(key));
+	strlcpy(key.database, database, NAMEDATALEN);
+	strlcpy(key.username, user, NAMEDATALEN);
+
+	pool = (SessionPool *) hash_search(SessionPools, &key, HASH_ENTER_NULL,
+									   &found);
+	if (pool == NULL)
+	{
+		ereport(LOG,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+		return;
+	}
+	if (!found)
+	{
+		pool->n_workers = 0;
+		pool->next_worker = 0;
+	}
+
+	if (!(hdr.flags & SESSION_HANDOFF_RESUMED) &&
+		pool->n_workers < SessionPoolSize && cac == CAC_OK &&
+		StartSessionPoolWorker(pool, sock, msg, len))
+		return;
+
+	for (i = 0; i < pool->n_workers; i++)
+	{
+		int			n = (pool->next_worker + i) % pool->n_workers;
+
+		if (StreamSendSocket(pool->workers[n]->session_sock, sock,
+							 msg, len, true) == STATUS_OK)
+		{
+			pool->next_worker = (n + 1) % pool->n_workers;
+			return;
+		}
+		if (errno != EWOULDBLOCK && errno != EAGAIN)
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not pass session to server process %d: %m",
+							(int) pool->workers[n]->pid)));
+	}
+
+	/* The state of a returned session is lost until the next restart */
+	ereport(LOG,
+			(errmsg("no session pool worker available for database \"%s\" and user \"%s\"",
+					database, user)));
+}
+
+/*
+ * StartSessionPoolWorker -- start a new worker for a session pool
+ *
+ * The worker is given the session described by sock and msg as its first
+ * one.  Returns false if the worker could not be started.
+ */
+static bool
+StartSessionPoolWorker(SessionPool *pool, pgsocket sock,
+					   const char *msg, size_t len)
+{
+#ifndef EXEC_BACKEND
+	pgsocket	chan[2];
+	Backend    *bn;
+	pid_t		pid;
+
+	if (socketpair(AF_UNIX, SOCK_DGRAM, 0, chan) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not create socket pair for session pool: %m")));
+		return false;
+	}
+
+	/* The child will find its first session waiting for it */
+	if (!pg_set_noblock(chan[0]) ||
+		StreamSendSocket(chan[0], sock, msg, len, true) != STATUS_OK)
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not pass session to new server process: %m")));
+		closesocket(chan[0]);
+		closesocket(chan[1]);
+		return false;
+	}
+
+	bn = (Backend *) malloc(sizeof(Backend));
+	if (!bn)
+	{
+		ereport(LOG,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+		closesocket(chan[0]);
+		closesocket(chan[1]);
+		return false;
+	}
+
+	if (!RandomCancelKey(&MyCancelKey))
+	{
+		free(bn);
+		closesocket(chan[0]);
+		closesocket(chan[1]);
+		ereport(LOG,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not generate random cancel key")));
+		return false;
+	}
+
+	bn->cancel_key = MyCancelKey;
+	bn->dead_end = false;
+	bn->child_slot = MyPMChildSlot = AssignPostmasterChildSlot();
+	bn->bgworker_notify = false;
+	bn->pool = pool;
+	SessionPoolClearCancelSlot(bn->child_slot);
+	bn->prefork_idle = false;
+	bn->session_sock = chan[0];
+
+	pid = fork_process();
+	if (pid == 0)				/* child */
+	{
+		Port	   *port;
+
+		free(bn);
+
+		/* Detangle from postmaster */
+		InitPostmasterChild();
+
+		/* Close the postmaster's sockets, including our copy of sock */
+		ClosePostmasterPorts(false);
+		closesocket(chan[0]);
+		closesocket(sock);
+
+		/* Collect the first session and set up as for a regular backend */
+		SessionPoolSock = chan[1];
+		port = SessionPoolFirstSession();
+		BackendInitialize(port);
+
+		/* And run the backend */
+		BackendRun(port);
+	}
+
+	closesocket(chan[1]);
+
+	if (pid < 0)
+	{
+		/* in parent, fork failed */
+		int			save_errno = errno;
+
+		(void) ReleasePostmasterChildSlot(bn->child_slot);
+		closesocket(chan[0]);
+		free(bn);
+		errno = save_errno;
+		ereport(LOG,
+				(errmsg("could not fork new process for session pool: %m")));
+		return false;
+	}
+
+	/* in parent, successful fork */
+	ereport(DEBUG2,
+			(errmsg_internal("forked new session pool worker, pid=%d",
+							 (int) pid)));
+
+	bn->pid = pid;
+	bn->bkend_type = BACKEND_TYPE_NORMAL;
+	dlist_push_head(&BackendList, &bn->elem);
+
+	pool->workers[pool->n_workers++] = bn;
+
+	return true;
+#else							/* EXEC_BACKEND */
+	/* session pooling is not supported here; see check_session_pool_size */
+	return false;
+#endif							/* EXEC_BACKEND */
+}
+
+/*
+ * RemoveSessionPoolWorker -- forget about an exited session pool worker
+ *
+ * Any sessions still queued for it are lost.
+ */
+static void
+RemoveSessionPoolWorker(Backend *bp)
+{
+	SessionPool *pool = bp->pool;
+	int			i;
+
+	for (i = 0; i < pool->n_workers; i++)
+	{
+		if (pool->workers[i] == bp)
+		{
+			pool->workers[i] = pool->workers[--pool->n_workers];
+			break;
+		}
+	}
+	if (pool->next_worker >= pool->n_workers)
+		pool->next_worker = 0;
+
+	StreamClose(bp->session_sock);
+	bp->session_sock = PGINVALID_SOCKET;
+	bp->pool = NULL;
+}
+
+/*
+ * StopSessionPools -- tell all session pool workers to stop taking sessions
+ *
+ * Each worker exits once all of its current sessions have ended.
+ */
+static void
+StopSessionPools(void)
+{
+	dlist_iter	iter;
+
+	if (SessionPools == NULL)
+		return;
+
+	/*
+	 * Returned sessions are idle, but there will be no workers left to serve
+	 * them, so disconnect them now.
+	 */
+	DropParkedSessions();
+
+	dlist_foreach(iter, &BackendList)
+	{
+		Backend    *bp = dlist_container(Backend, elem, iter.cur);
+
+		if (bp->pool != NULL &&
+			StreamSendSocket(bp->session_sock, PGINVALID_SOCKET,
+							 NULL, 0, true) != STATUS_OK)
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not stop session pool worker %d: %m",
+							(int) bp->pid)));
+	}
+}
+
+/*
+ * ParkSession -- keep a returned session until its client sends something
+ *
+ * Returns false if the session could not be parked, in which case the caller
+ * still owns the socket.
+ */
+static bool
+ParkSession(pgsocket sock, const char *msg, size_t len)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	ParkedSession *ps;
+	struct epoll_event event;
+
+	if (ParkedSessionsFd < 0)
+		return false;
+
+	ps = (ParkedSession *) malloc(offsetof(ParkedSession, msg) + len);
+	if (ps == NULL)
+	{
+		ereport(LOG,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+		return false;
+	}
+	ps->sock = sock;
+	ps->len = len;
+	memcpy(ps->msg, msg, len);
+
+	event.events = EPOLLIN;
+	event.data.ptr = ps;
+	if (epoll_ctl(ParkedSessionsFd, EPOLL_CTL_ADD, sock, &event) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not watch returned session: %m")));
+		free(ps);
+		return false;
+	}
+
+	dlist_push_tail(&ParkedSessions, &ps->elem);
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ * UnparkSession -- stop watching a parked session
+ *
+ * The caller is responsible for the socket and for freeing ps.
+ */
+static void
+UnparkSession(ParkedSession *ps)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	/*
+	 * Remove the socket from the epoll set explicitly: closing our
+	 * descriptor is not enough while a newly forked child still has a copy.
+	 */
+	if (epoll_ctl(ParkedSessionsFd, EPOLL_CTL_DEL, ps->sock, NULL) < 0)
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not stop watching returned session: %m")));
+#endif
+	dlist_delete(&ps->elem);
+}
+
+/*
+ * HandleParkedSessions -- dispatch parked sessions that have become readable
+ */
+static void
+HandleParkedSessions(void)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event events[64];
+	int			nevents;
+
+	do
+	{
+		int			i;
+
+		nevents = epoll_wait(ParkedSessionsFd, events, lengthof(events), 0);
+		if (nevents < 0)
+		{
+			if (errno != EINTR)
+				ereport(LOG,
+						(errcode_for_socket_access(),
+						 errmsg("epoll_wait() failed in postmaster: %m")));
+			return;
+		}
+
+		for (i = 0; i < nevents; i++)
+		{
+			ParkedSession *ps = (ParkedSession *) events[i].data.ptr;
+			const char *database;
+			const char *user;
+			CAC_state	cac;
+
+			UnparkSession(ps);
+
+			/*
+			 * The same rules apply as for sessions handed to us directly.
+			 * Even if the client has gone away, a worker has to take the
+			 * session to free its state in shared memory.
+			 */
+			cac = canAcceptConnections();
+			if (Shutdown == NoShutdown &&
+				(cac == CAC_OK || cac == CAC_TOOMANY) &&
+				SessionHandoffGetKey(ps->msg, ps->len, &database, &user))
+				DispatchSession(ps->sock, ps->msg, ps->len,
+								database, user, cac);
+
+			StreamClose(ps->sock);
+			free(ps);
+		}
+	} while (nevents == lengthof(events));
+#endif
+}
+
+/*
+ * DropParkedSessions -- disconnect all parked sessions
+ *
+ * This is only done when shutting down or reinitializing after a crash, so
+ * there's no need to free the sessions' state in shared memory (which we
+ * couldn't do anyway).
+ */
+static void
+DropParkedSessions(void)
+{
+	dlist_mutable_iter iter;
+
+	dlist_foreach_modify(iter, &ParkedSessions)
+	{
+		ParkedSession *ps = dlist_container(ParkedSession, elem, iter.cur);
+
+		UnparkSession(ps);
+		StreamClose(ps->sock);
+		free(ps);
+	}
+}
+
+/*
+ * MaybeStartPreforkedBackends -- top up the set of preforked backends
+ *
+ * A preforked backend takes a PGPROC as soon as it starts, so we only fork
+ * one while there's a PGPROC left for it, not counting those reserved for
+ * superusers; connections arriving beyond that get a backend of their own,
+ * which reports "too many clients" as usual.  Should a preforked backend fail
+ * anyway, we wait for some other backend to exit before trying again, rather
+ * than fork replacements that fail the same way as fast as we can.
+ */
+static void
+MaybeStartPreforkedBackends(void)
+{
+#ifndef EXEC_BACKEND
+	while (NumPreforkIdle < PreforkBackends &&
+		   !PreforkPaused &&
+		   canAcceptConnections() == CAC_OK &&
+		   CountChildren(BACKEND_TYPE_NORMAL | BACKEND_TYPE_WALSND) <
+		   MaxConnections - ReservedBackends)
+	{
+		pgsocket	chan[2];
+		Backend    *bn;
+		pid_t		pid;
+
+		if (socketpair(AF_UNIX, SOCK_DGRAM, 0, chan) < 0)
+		{
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not create socket pair for preforked backend: %m")));
+			return;
+		}
+
+		bn = (Backend *) malloc(sizeof(Backend));
+		if (!bn)
+		{
+			closesocket(chan[0]);
+			closesocket(chan[1]);
+			ereport(LOG,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("out of memory")));
+			return;
+		}
+
+		if (!RandomCancelKey(&MyCancelKey))
+		{
+			free(bn);
+			closesocket(chan[0]);
+			closesocket(chan[1]);
+			ereport(LOG,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("could not generate random cancel key")));
+			return;
+		}
+
+		bn->cancel_key = MyCancelKey;
+		bn->dead_end = false;
+		bn->child_slot = MyPMChildSlot = AssignPostmasterChildSlot();
+		bn->bgworker_notify = false;
+		bn->pool = NULL;
+		bn->prefork_idle = true;
+		bn->session_sock = chan[0];
+
+		pid = fork_process();
+		if (pid == 0)			/* child */
+		{
+			free(bn);
+
+			/* Detangle from postmaster */
+			InitPostmasterChild();
+
+			/* Close the postmaster's sockets */
+			ClosePostmasterPorts(false);
+			closesocket(chan[0]);
+
+			PreforkedBackendMain(chan[1]);
+		}
+
+		closesocket(chan[1]);
+
+		if (pid < 0)
+		{
+			/* in parent, fork failed */
+			int			save_errno = errno;
+
+			(void) ReleasePostmasterChildSlot(bn->child_slot);
+			closesocket(chan[0]);
+			free(bn);
+			errno = save_errno;
+			ereport(LOG,
+					(errmsg("could not fork preforked backend process: %m")));
+			return;
+		}
+
+		/* in parent, successful fork */
+		ereport(DEBUG2,
+				(errmsg_internal("forked new preforked backend, pid=%d",
+								 (int) pid)));
+
+		bn->pid = pid;
+		bn->bkend_type = BACKEND_TYPE_NORMAL;
+		dlist_push_head(&BackendList, &bn->elem);
+
+		PreforkIdle[NumPreforkIdle++] = bn;
+	}
+#endif							/* EXEC_BACKEND */
+}
+
+/*
+ * DispatchToPreforkedBackend -- pass a new connection to a preforked backend
+ *
+ * The Port built by ConnCreate is sent along with the socket; the backend
+ * then goes on much as if BackendStartup had forked it for the connection.
+ *
+ * returns: STATUS_ERROR if no preforked backend could take the connection
+ */
+static int
+DispatchToPreforkedBackend(Port *port)
+{
+	port->canAcceptConnections = canAcceptConnections();
+	if (port->canAcceptConnections != CAC_OK)
+		return STATUS_ERROR;
+
+	while (NumPreforkIdle > 0)
+	{
+		/* Use the most recently started one, as its caches are freshest */
+		Backend    *bp = PreforkIdle[NumPreforkIdle - 1];
+		int			rc;
+
+		rc = StreamSendSocket(bp->session_sock, port->sock,
+							  port, sizeof(Port), true);
+		if (rc != STATUS_OK)
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not pass connection to preforked backend %d: %m",
+							(int) bp->pid)));
+
+		/*
+		 * Either way, this backend is not waiting for us anymore.  If we
+		 * failed to reach it, something is wrong with it; get rid of it.
+		 */
+		RemovePreforkedBackend(bp);
+		if (rc == STATUS_OK)
+			return STATUS_OK;
+		signal_child(bp->pid, SIGTERM);
+	}
+
+	return STATUS_ERROR;
+}
+
+/*
+ * RemovePreforkedBackend -- take a backend off the list of idle preforked
+ * backends
+ */
+static void
+RemovePreforkedBackend(Backend *bp)
+{
+	int			i;
+
+	for (i = 0; i < NumPreforkIdle; i++)
+	{
+		if (PreforkIdle[i] == bp)
+		{
+			memmove(&PreforkIdle[i], &PreforkIdle[i + 1],
+					(NumPreforkIdle - i - 1) * sizeof(Backend *));
+			NumPreforkIdle--;
+			break;
+		}
+	}
+
+	StreamClose(bp->session_sock);
+	bp->session_sock = PGINVALID_SOCKET;
+	bp->prefork_idle = false;
+}
+
+/*
+ * StopPreforkedBackends -- terminate all idle preforked backends
+ *
+ * This is used at shutdown, and when they would otherwise keep using stale
+ * configuration after a reload.  ServerLoop starts new ones as needed.
+ */
+static void
+StopPreforkedBackends(void)
+{
+	while (NumPreforkIdle > 0)
+	{
+		Backend    *bp = PreforkIdle[NumPreforkIdle - 1];
+
+		RemovePreforkedBackend(bp);
+		signal_child(bp->pid, SIGTERM);
+	}
+}
+
+#ifndef EXEC_BACKEND
+/*
+ * PreforkedBackendMain -- main entry point of a preforked backend
+ *
+ * Initialize as far as possible, then wait until the postmaster sends us a
+ * client connection on chan, and start up as a regular backend.
+ */
+static void
+PreforkedBackendMain(pgsocket chan)
+{
+	Port	   *port;
+
+	IsPreforkedBackend = true;
+
+	init_ps_display("preforked backend", "", "", "");
+
+	InitPreforkedBackend();
+
+	port = (Port *) calloc(1, sizeof(Port));
+	if (port == NULL)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+
+	for (;;)
+	{
+		int			rc;
+
+		rc = WaitLatchOrSocket(MyLatch,
+							   WL_LATCH_SET | WL_POSTMASTER_DEATH | WL_SOCKET_READABLE,
+							   chan, -1L, WAIT_EVENT_CLIENT_READ);
+
+		if (rc & WL_POSTMASTER_DEATH)
+			proc_exit(1);
+
+		if (rc & WL_LATCH_SET)
+		{
+			ResetLatch(MyLatch);
+
+			/* There's no client to tell about it, so exit quietly */
+			if (ProcDiePending)
+				proc_exit(0);
+
+			/* Keep up with shared invalidation messages while we wait */
+			if (catchupInterruptPending)
+				ProcessCatchupInterrupt();
+		}
+
+		if (rc & WL_SOCKET_READABLE)
+		{
+			pgsocket	sock;
+			ssize_t		len = sizeof(Port);
+
+			sock = StreamReceiveSocket(chan, port, &len, true);
+			if (sock != PGINVALID_SOCKET && len == sizeof(Port))
+			{
+				port->sock = sock;
+				break;
+			}
+			if (sock != PGINVALID_SOCKET)
+				StreamClose(sock);
+			if (len < 0 && (errno == EWOULDBLOCK || errno == EAGAIN))
+				continue;
+			ereport(FATAL,
+					(errmsg("invalid message received by preforked backend")));
+		}
+	}
+	closesocket(chan);
+
+#if defined(ENABLE_GSS) || defined(ENABLE_SSPI)
+	port->gss = (pg_gssinfo *) calloc(1, sizeof(pg_gssinfo));
+	if (!port->gss)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+#endif
+
+	/*
+	 * Carry on like a backend forked by BackendStartup.  Note that shared
+	 * memory exit callbacks are already registered at this point, so a
+	 * timeout or signal while collecting the startup packet runs them in the
+	 * signal handler; that's safe since we don't touch shared memory then.
+	 */
+	BackendInitialize(port);
+	BackendRun(port);
+}
+#endif							/* !EXEC_BACKEND */
+
+/*
+ * Try to report backend fork() failure to client before we close the
+ * connection.  Since we do not care to risk blocking the postmaster on
+ * this connection, we set the connection to non-blocking and try only once.
+ *
+ * This is grungy special-purpose code; we cannot use backend libpq since
+ * it's not up and running.
+ */
+static void
+report_fork_failure_to_client(Port *port, int errnum)
+{
+	char		buffer[1000];
+	int			rc;
+
+	/* Format the error message packet (always V2 protocol) */
+	snprintf(buffer, sizeof(buffer), "E%s%s\n",
+			 _("could not fork new process for connection: "),
+			 strerror(errnum));
+
+	/* Set port to non-blocking.  Don't do send() if this fails */
+	if (!pg_set_noblock(port->sock))
+		return;
+
+	/* We'll retry after EINTR, but ignore all other failures */
+	do
+	{
+		rc = send(port->sock, buffer, strlen(buffer) + 1, 0);
+	} while (rc < 0 && errno == EINTR);
+}
+
+
+/*
+ * BackendInitialize -- initialize an interactive (postmaster-child)
+ *				backend process, and collect the client's startup packet.
+ *
+ * returns: nothing.  Will not return at all if there's any failure.
+ *
+ * Note: this code does not depend on having any access to shared memory.
+ * In the EXEC_BACKEND case, we are physically attached to shared memory
+ * but have not yet set up most of our local pointers to shmem structures.
+ */
+static void
+BackendInitialize(Port *port)
+{
+	int			status;
+	int			ret;
+	char		remote_host[NI_MAXHOST];
+	char		remote_port[NI_MAXSERV];
+	char		remote_ps_data[NI_MAXHOST];
+
+	/* Save port etc. for ps status */
+	MyProcPort = port;
+
+	/*
+	 * PreAuthDelay is a debugging aid for investigating problems in the
+	 * authentication cycle: it can be set in postgresql.conf to allow time to
+	 * attach to the newly-forked backend with a debugger.  (See also
+	 * PostAuthDelay, which we allow clients to pass through PGOPTIONS, but it
+	 * is not honored until after authentication.)
+	 */
+	if (PreAuthDelay > 0)
+		pg_usleep(PreAuthDelay * 1000000L);
+
+	/* This flag will remain set until InitPostgres finishes authentication */
+	ClientAuthInProgress = true;	/* limit visibility of log messages */
+
+	/* save process start time */
+	port->SessionStartTime = GetCurrentTimestamp();
+	MyStartTime = timestamptz_to_time_t(port->SessionStartTime);
+
+	/* set these to empty in case they are needed before we set them up */
+	port->remote_host = "";
+	port->remote_port = "";
+
+	/*
+	 * Initialize libpq and enable reporting of ereport errors to the client.
+	 * Must do this now because authentication uses libpq to send messages.
+	 */
+	pq_init();					/* initialize libpq to talk to client */
+	whereToSendOutput = DestRemote; /* now safe to ereport to client */
+
+	/*
+	 * We arrange for a simple exit(1) if we receive SIGTERM or SIGQUIT or
+	 * timeout while trying to collect the startup packet.  Otherwise the
+	 * postmaster cannot shutdown the database FAST or IMMED cleanly if a
+	 * buggy client fails to send the packet promptly.  XXX it follows that
+	 * the remainder of this function must tolerate losing control at any
+	 * instant.  Likewise, any pg_on_exit_callback registered before or during
+	 * this function must be prepared to execute at any instant between here
+	 * and the end of this function.  Furthermore, affected callbacks execute
+	 * partially or not at all when a second exit-inducing signal arrives
+	 * after proc_exit_prepare() decrements on_proc_exit_index.  (Thanks to
+	 * that mechanic, callbacks need not anticipate more than one call.)  This
+	 * is fragile; it ought to instead follow the norm of handling interrupts
+	 * at selected, safe opportunities.
+	 */
+	pqsignal(SIGTERM, startup_die);
+	pqsignal(SIGQUIT, startup_die);
+	InitializeTimeouts();		/* establishes SIGALRM handler */
+	PG_SETMASK(&StartupBlockSig);
 
 	/*
 	 * Get the remote host name and port for logging and status display.
@@ -4187,8 +5284,11 @@ BackendInitialize(Port *port)
 	port->remote_host = strdup(remote_host);
 	port->remote_port = strdup(remote_port);
 
-	/* And now we can issue the Log_connections message, if wanted */
-	if (Log_connections)
+	/*
+	 * And now we can issue the Log_connections message, if wanted.  For a
+	 * session pool worker, the session was logged when it first connected.
+	 */
+	if (Log_connections && !IsSessionPoolWorker())
 	{
 		if (remote_port[0])
 			ereport(LOG,
@@ -4238,9 +5338,16 @@ BackendInitialize(Port *port)
 
 	/*
 	 * Receive the startup packet (which might turn out to be a cancel request
-	 * packet).
+	 * packet).  A session pool worker's first session was authenticated by
+	 * another backend, which already processed the startup packet.
 	 */
-	status = ProcessStartupPacket(port, false);
+	if (IsSessionPoolWorker())
+	{
+		FrontendProtocol = port->proto;
+		status = STATUS_OK;
+	}
+	else
+		status = ProcessStartupPacket(port, false);
 
 	/*
 	 * Stop here if it was bad or a cancel packet.  ProcessStartupPacket
@@ -5144,6 +6251,9 @@ sigusr1_handler(SIGNAL_ARGS)
 		signal_child(StartupPID, SIGUSR2);
 	}
 
+	/* Wake up ServerLoop, so that it can react to what we did */
+	SetLatch(MyLatch);
+
 	PG_SETMASK(&UnBlockSig);
 
 	errno = save_errno;
@@ -5420,6 +6530,9 @@ StartAutovacuumWorker(void)
 			bn->dead_end = false;
 			bn->child_slot = MyPMChildSlot = AssignPostmasterChildSlot();
 			bn->bgworker_notify = false;
+			bn->pool = NULL;
+			bn->prefork_idle = false;
+			bn->session_sock = PGINVALID_SOCKET;
 
 			bn->pid = StartAutoVacWorker();
 			if (bn->pid > 0)
@@ -5789,6 +6902,9 @@ assign_backendlist_entry(RegisteredBgWorker *rw)
 	bn->bkend_type = BACKEND_TYPE_BGWORKER;
 	bn->dead_end = false;
 	bn->bgworker_notify = false;
+	bn->pool = NULL;
+	bn->prefork_idle = false;
+	bn->session_sock = PGINVALID_SOCKET;
 
 	rw->rw_backend = bn;
 	rw->rw_child_slot = bn->child_slot;
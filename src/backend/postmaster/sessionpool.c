@@ -0,0 +1,1227 @@
+/*-------------------------------------------------------------------------
+ *
+ * sessionpool.c
+ *	  Built-in pooling of client sessions onto a bounded set of backends.
+ *
+ * When session_pool_size is set, a backend that has finished setting up a
+ * new client connection (including authentication) does not go on to serve
+ * it.  Instead it passes the client socket, together with the information
+ * from the startup packet, to the postmaster and exits.  The postmaster
+ * keeps up to session_pool_size pool workers for every combination of
+ * database and user, and hands the session to one of them; the first
+ * session of a new worker is passed to it when it is forked.
+ *
+ * A pool worker is an ordinary backend that keeps a list of client sessions
+ * and, whenever it is idle outside a transaction, switches to whichever
+ * session has sent something.  Session switching therefore happens only at
+ * transaction boundaries.  Prepared statements, the settings a session has
+ * changed with SET and its currval() and lastval() state are saved and
+ * restored when switching; everything else (temporary tables, WITH HOLD
+ * cursors, LISTEN registrations, session level advisory locks, the random
+ * number seed, loaded libraries) belongs to the worker and is shared by all
+ * the sessions it serves.
+ *
+ * Each session has its own cancel key, which it keeps along with the process
+ * ID its client was first given wherever the session moves.  A pool worker
+ * publishes the process ID and key of the session it is serving in shared
+ * memory, and the postmaster passes cancel requests on to whichever worker
+ * is serving the session named in the request (see SessionPoolCancel).
+ *
+ * When session_pool_return_delay is set, a pool worker also hands sessions
+ * that have been idle for that long back to the postmaster.  The session's
+ * settings and prepared statements go into shared memory (see
+ * SerializeSessionState).  The postmaster watches the session's socket, and
+ * once the client sends something passes the session on to any worker of
+ * its pool, which rebuilds its state and takes it up without repeating the
+ * startup sequence.  No sessions are returned while the worker holds state
+ * that cannot be moved, such as temporary tables.
+ *
+ * Conditions that end a regular backend's client connection, such as losing
+ * the connection in the middle of output, a protocol violation, or
+ * idle_in_transaction_session_timeout, only end the current session in a
+ * pool worker (see SessionPoolTerminateLevel).  The worker itself still
+ * exits when told to by the postmaster or pg_terminate_backend(), on a
+ * recovery conflict that terminates connections, if the postmaster dies, and
+ * on any FATAL error not tied to one client, taking all its sessions along.
+ *
+ * Messages between backends and the postmaster are sent as datagrams over
+ * Unix-domain socket pairs, with the client socket attached (see
+ * StreamSendSocket).  Each message holds a SessionHandoffHeader followed by
+ * the null-terminated database and user names and any number of
+ * null-terminated option name/value pairs.  A message of zero length
+ * without a socket tells a pool worker to stop accepting sessions, and to
+ * exit once its remaining sessions have disconnected.
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/sessionpool.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "access/session.h"
+#include "access/xact.h"
+#include "commands/prepare.h"
+#include "commands/sequence.h"
+#include "common/ip.h"
+#include "lib/ilist.h"
+#include "libpq/libpq.h"
+#include "libpq/pqformat.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "postmaster/postmaster.h"
+#include "postmaster/sessionpool.h"
+#include "replication/walsender.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/shmem.h"
+#include "tcop/dest.h"
+#include "tcop/tcopprot.h"
+#include "utils/backend_random.h"
+#include "utils/guc.h"
+#include "utils/guc_tables.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+#include "utils/timestamp.h"
+
+/*
+ * A client session served by a pool worker.  Everything belonging to the
+ * session, including this struct, lives in its own memory context.
+ */
+typedef struct PooledSession
+{
+	dlist_node	node;			/* list link in "sessions" */
+	MemoryContext cxt;			/* context holding the session's data */
+	Port	   *port;			/* the client connection */
+	bool		started;		/* have we sent it ReadyForQuery yet? */
+	int32		cancel_pid;		/* process ID its client was given */
+	int32		cancel_key;		/* cancel key its client was given */
+	TimestampTz idle_since;		/* when it last stopped being active */
+	HTAB	   *prepared_queries;	/* saved while the session is inactive */
+	List	   *settings;		/* saved GUC settings, as SessionSettings */
+	SequenceSessionState *sequences;	/* saved while inactive */
+	dsa_pointer state;			/* state from a previous worker, to restore */
+} PooledSession;
+
+/*
+ * What a pool worker publishes about the session it is serving, so that the
+ * postmaster can pass on cancel requests for it.  There is one of these for
+ * each postmaster child slot.  The worker sets session_pid and session_key,
+ * with session_pid zero while no session is current; the postmaster sets
+ * cancel_key and then cancel_pending before sending SIGINT.
+ */
+typedef struct SessionCancelSlot
+{
+	volatile int32 session_pid;
+	volatile int32 session_key;
+	volatile int32 cancel_key;
+	volatile sig_atomic_t cancel_pending;
+} SessionCancelSlot;
+
+/* GUC variables */
+int			SessionPoolSize = 0;
+int			SessionPoolReturnDelay = 0;
+
+pgsocket	SessionHandoffSock[2] = {PGINVALID_SOCKET, PGINVALID_SOCKET};
+pgsocket	SessionPoolSock = PGINVALID_SOCKET;
+
+static SessionCancelSlot *SessionCancelSlots = NULL;
+
+/* Sessions served by this pool worker, and the one currently active */
+static dlist_head sessions = DLIST_STATIC_INIT(sessions);
+static int	n_sessions = 0;
+static PooledSession *current_session = NULL;
+
+/* Is the postmaster still sending us new sessions? */
+static bool pool_channel_open = true;
+
+/* Have we logged that our sessions can't be returned for now? */
+static bool migration_blocker_reported = false;
+
+/* Must the current session be closed once we have recovered from an error? */
+static bool close_session_pending = false;
+
+/* Database and user all our sessions must be connected to */
+static char *pool_database = NULL;
+static char *pool_user = NULL;
+
+/* What we wait on while idle; rebuilt whenever the set of sessions changes */
+static WaitEventSet *session_wait_set = NULL;
+static bool session_wait_set_valid = false;
+
+/* Buffer for receiving messages from the postmaster */
+static char handoff_buf[MAX_SESSION_HANDOFF_LENGTH];
+
+static PooledSession *receive_session(bool nowait);
+static PooledSession *create_session(pgsocket sock, const char *msg,
+			   size_t len);
+static void receive_new_sessions(void);
+static long return_idle_sessions(void);
+static bool return_session(PooledSession *session);
+static void forget_session(PooledSession *session);
+static void switch_session(PooledSession *next);
+static void detach_current_session(void);
+static void save_session_settings(PooledSession *session);
+static void reset_session_settings(PooledSession *session);
+static void apply_session_settings(List *settings, GucContext context);
+static void restore_session_settings(List *settings);
+static void publish_cancel_key(PooledSession *session);
+
+
+/*
+ * Should this newly connected session be handed off to the session pool?
+ *
+ * Replication connections, SSL and compressed connections (whose state
+ * cannot be passed on) and connections using command-line options in the
+ * startup packet are always served by their own backend.  So are connections
+ * whose client has already sent more data, since that would be lost.
+ */
+bool
+SessionPoolEnabled(Port *port)
+{
+	return SessionPoolSize > 0 &&
+		IsUnderPostmaster &&
+		SessionHandoffSock[SESSION_HANDOFF_SEND] != PGINVALID_SOCKET &&
+		!IsSessionPoolWorker() &&
+		whereToSendOutput == DestRemote &&
+		PG_PROTOCOL_MAJOR(port->proto) >= 3 &&
+		!am_walsender &&
+		!port->ssl_in_use &&
+		port->zstream == NULL &&
+		port->cmdline_options == NULL &&
+		!pq_buffer_has_data();
+}
+
+/*
+ * Hand the current client session over to the postmaster, which passes it
+ * on to a pool worker, and exit.
+ *
+ * This is called after the session has been authenticated, but before the
+ * client has been sent anything beyond the authentication exchange.
+ */
+void
+SessionPoolHandoff(Port *port)
+{
+	SessionHandoffHeader hdr;
+	StringInfoData buf;
+	ListCell   *lc;
+
+	hdr.proto = port->proto;
+	hdr.flags = 0;
+	hdr.state = InvalidDsaPointer;
+	hdr.cancel_pid = 0;
+	hdr.cancel_key = 0;
+
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf, (char *) &hdr, sizeof(hdr));
+	appendBinaryStringInfo(&buf, port->database_name,
+						   strlen(port->database_name) + 1);
+	appendBinaryStringInfo(&buf, port->user_name,
+						   strlen(port->user_name) + 1);
+	foreach(lc, port->guc_options)
+	{
+		char	   *str = (char *) lfirst(lc);
+
+		appendBinaryStringInfo(&buf, str, strlen(str) + 1);
+	}
+
+	if (buf.len > MAX_SESSION_HANDOFF_LENGTH)
+		ereport(FATAL,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("startup options are too long for session pooling")));
+
+	/* Make sure the client has got everything we sent so far */
+	pq_flush();
+
+	if (StreamSendSocket(SessionHandoffSock[SESSION_HANDOFF_SEND], port->sock,
+						 buf.data, buf.len, false) != STATUS_OK)
+		ereport(FATAL,
+				(errcode_for_socket_access(),
+				 errmsg("could not pass connection to session pool: %m")));
+
+	/*
+	 * The session now belongs to the postmaster.  Make sure we don't send
+	 * anything more to the client on our way out.
+	 */
+	whereToSendOutput = DestNone;
+	proc_exit(0);
+}
+
+/*
+ * Extract the database and user names from a session handoff message.
+ * This is used by the postmaster to choose a pool for the session.
+ *
+ * Returns false if the message is malformed.
+ */
+bool
+SessionHandoffGetKey(const char *msg, size_t len,
+					 const char **database, const char **user)
+{
+	const char *end = msg + len;
+	const char *p = msg + sizeof(SessionHandoffHeader);
+
+	if (len <= sizeof(SessionHandoffHeader) || msg[len - 1] != '\0')
+		return false;
+
+	*database = p;
+	p += strlen(p) + 1;
+	if (p >= end)
+		return false;
+	*user = p;
+
+	return strlen(*database) < NAMEDATALEN && strlen(*user) < NAMEDATALEN;
+}
+
+/*
+ * Receive the first session of a newly started pool worker, which the
+ * postmaster sent before forking it.  The returned Port is then set up
+ * exactly as for a regular backend.
+ */
+Port *
+SessionPoolFirstSession(void)
+{
+	PooledSession *session;
+
+	Assert(IsSessionPoolWorker());
+
+	session = receive_session(false);
+	if (session == NULL)
+		proc_exit(0);
+
+	pool_database = MemoryContextStrdup(TopMemoryContext,
+										session->port->database_name);
+	pool_user = MemoryContextStrdup(TopMemoryContext,
+									session->port->user_name);
+
+	/*
+	 * The caller will take care of the startup sequence.  The postmaster
+	 * only passes returned sessions to workers that are already running.
+	 */
+	Assert(!session->started);
+	session->started = true;
+
+	/* PostgresMain sends the client our own process ID and cancel key */
+	session->cancel_pid = MyProcPid;
+	session->cancel_key = MyCancelKey;
+	current_session = session;
+	publish_cancel_key(session);
+
+	return session->port;
+}
+
+/*
+ * Apply the option settings from the first session's startup packet.
+ *
+ * Options are applied as if set by SET in the session, so that they can be
+ * saved and restored like other session settings when switching sessions.
+ */
+void
+SessionPoolStartSession(void)
+{
+	Assert(IsSessionPoolWorker() && current_session != NULL);
+
+	StartTransactionCommand();
+	apply_session_settings(current_session->port->guc_options,
+						   superuser() ? PGC_SUSET : PGC_USERSET);
+	CommitTransactionCommand();
+}
+
+/*
+ * Choose the session to serve next; called by a pool worker whenever it is
+ * idle and about to read a new command.
+ *
+ * If the current session has input waiting, we stay with it.  Otherwise we
+ * wait until any session becomes readable, and make it the current one.
+ * Sessions that have just been received take precedence; if we switch to
+ * one of those, *started is set to indicate that the caller must send it
+ * ReadyForQuery.
+ *
+ * Returns true if the current session was changed.
+ */
+bool
+SessionPoolSchedule(bool *started)
+{
+	*started = false;
+
+	if (current_session != NULL && pq_buffer_has_data())
+		return false;
+
+	if (current_session != NULL && SessionPoolReturnDelay > 0)
+		current_session->idle_since = GetCurrentTimestamp();
+
+	for (;;)
+	{
+		PooledSession *next = NULL;
+		dlist_iter	iter;
+
+		dlist_foreach(iter, &sessions)
+		{
+			PooledSession *session = dlist_container(PooledSession, node,
+													 iter.cur);
+
+			if (!session->started)
+			{
+				next = session;
+				break;
+			}
+		}
+
+		if (next == NULL)
+		{
+			WaitEvent	event;
+			long		timeout = -1L;
+
+			/* Nothing more to do once the postmaster has let us go */
+			if (dlist_is_empty(&sessions) && !pool_channel_open)
+				proc_exit(0);
+
+			/*
+			 * Sessions are only returned while the postmaster is still
+			 * taking them; it drops them when shutting down.
+			 */
+			if (SessionPoolReturnDelay > 0 && pool_channel_open)
+				timeout = return_idle_sessions();
+
+			if (!session_wait_set_valid)
+			{
+				if (session_wait_set != NULL)
+					FreeWaitEventSet(session_wait_set);
+				session_wait_set = CreateWaitEventSet(TopMemoryContext,
+													  3 + n_sessions);
+				AddWaitEventToSet(session_wait_set, WL_LATCH_SET,
+								  PGINVALID_SOCKET, MyLatch, NULL);
+				AddWaitEventToSet(session_wait_set, WL_POSTMASTER_DEATH,
+								  PGINVALID_SOCKET, NULL, NULL);
+				if (pool_channel_open)
+					AddWaitEventToSet(session_wait_set, WL_SOCKET_READABLE,
+									  SessionPoolSock, NULL, NULL);
+				dlist_foreach(iter, &sessions)
+				{
+					PooledSession *session = dlist_container(PooledSession,
+															 node, iter.cur);
+
+					AddWaitEventToSet(session_wait_set, WL_SOCKET_READABLE,
+									  session->port->sock, NULL, session);
+				}
+				session_wait_set_valid = true;
+			}
+
+			if (WaitEventSetWait(session_wait_set, timeout, &event, 1,
+								 WAIT_EVENT_CLIENT_READ) == 0)
+				continue;		/* timeout */
+
+			if (event.events & WL_POSTMASTER_DEATH)
+				ereport(FATAL,
+						(errcode(ERRCODE_ADMIN_SHUTDOWN),
+						 errmsg("terminating connection due to unexpected postmaster exit")));
+
+			if (event.events & WL_LATCH_SET)
+			{
+				ResetLatch(MyLatch);
+				ProcessClientReadInterrupt(true);
+
+				/* Pick up a new session_pool_return_delay while idle */
+				if (ConfigReloadPending)
+				{
+					ConfigReloadPending = false;
+					ProcessConfigFile(PGC_SIGHUP);
+				}
+				continue;
+			}
+
+			if (event.user_data == NULL)
+			{
+				receive_new_sessions();
+				continue;
+			}
+
+			next = (PooledSession *) event.user_data;
+		}
+
+		if (next == current_session)
+			return false;
+
+		switch_session(next);
+		if (!next->started)
+		{
+			next->started = true;
+			*started = true;
+		}
+		return true;
+	}
+}
+
+/*
+ * Forget the current session after its client has disconnected.
+ *
+ * Everything the session owned is released, and its settings are reset, so
+ * that the next session starts from a clean slate.
+ */
+void
+SessionPoolCloseSession(void)
+{
+	PooledSession *session = current_session;
+	HTAB	   *queries;
+
+	Assert(session != NULL);
+
+	StartTransactionCommand();
+	DropAllPreparedStatements();
+	queries = SavePreparedStatements();
+	if (queries != NULL)
+		hash_destroy(queries);
+	pfree(SaveSequenceSessionState());
+
+	save_session_settings(session);
+	pq_switch_port(NULL);
+	whereToSendOutput = DestNone;
+	reset_session_settings(session);
+	CommitTransactionCommand();
+
+	current_session = NULL;
+	publish_cancel_key(NULL);
+	forget_session(session);
+
+	/* Whatever ended the session doesn't concern the next one */
+	close_session_pending = false;
+	ClientConnectionLost = false;
+}
+
+/*
+ * Error level at which to report a condition that ends the client's session.
+ *
+ * A regular backend just exits with FATAL.  In a pool worker that would
+ * disconnect all the other sessions too, so we use ERROR to abort whatever
+ * the current session was doing, and note that the session is to be closed;
+ * PostgresMain does that once it has recovered from the error (see
+ * SessionPoolClosePending).
+ */
+int
+SessionPoolTerminateLevel(void)
+{
+	if (!IsSessionPoolWorker() || current_session == NULL)
+		return FATAL;
+
+	close_session_pending = true;
+	return ERROR;
+}
+
+/*
+ * Must the current session be closed after the error we are recovering
+ * from?  The caller must then abort any transaction and call
+ * SessionPoolCloseSession.
+ */
+bool
+SessionPoolClosePending(void)
+{
+	return close_session_pending;
+}
+
+/*
+ * Report the size of the shared memory holding the cancel keys of the
+ * sessions that pool workers are serving.
+ */
+Size
+SessionPoolShmemSize(void)
+{
+	return mul_size(MaxLivePostmasterChildren(), sizeof(SessionCancelSlot));
+}
+
+/*
+ * Allocate and initialize that shared memory.
+ */
+void
+SessionPoolShmemInit(void)
+{
+	bool		found;
+
+	SessionCancelSlots = (SessionCancelSlot *)
+		ShmemInitStruct("SessionCancelSlots", SessionPoolShmemSize(), &found);
+
+	if (!found)
+		MemSet(SessionCancelSlots, 0, SessionPoolShmemSize());
+}
+
+/*
+ * Forget what a previous pool worker in the given postmaster child slot
+ * published.  Called by the postmaster before starting a new pool worker.
+ */
+void
+SessionPoolClearCancelSlot(int child_slot)
+{
+	SessionCancelSlot *slot;
+
+	Assert(child_slot > 0 && child_slot <= MaxLivePostmasterChildren());
+	slot = &SessionCancelSlots[child_slot - 1];
+
+	slot->session_pid = 0;
+	slot->session_key = 0;
+	slot->cancel_key = 0;
+	slot->cancel_pending = false;
+}
+
+/*
+ * Check whether the pool worker in the given postmaster child slot is
+ * serving the session a cancel request names, and if so, record the request
+ * for it.  The postmaster must then send the worker SIGINT.
+ *
+ * The worker may have switched sessions by the time the signal arrives; it
+ * checks the recorded key against the session it is serving then (see
+ * SessionPoolCancelIsForCurrent).  This only reads what the worker has
+ * published, so at worst a bogus entry costs an ignored signal.
+ */
+bool
+SessionPoolCancel(int child_slot, int pid, int32 key)
+{
+	SessionCancelSlot *slot;
+
+	if (child_slot <= 0 || child_slot > MaxLivePostmasterChildren())
+		return false;
+	slot = &SessionCancelSlots[child_slot - 1];
+
+	if (pid == 0 || slot->session_pid != pid || slot->session_key != key)
+		return false;
+
+	slot->cancel_key = key;
+	pg_write_barrier();
+	slot->cancel_pending = true;
+	return true;
+}
+
+/*
+ * Should SIGINT cancel the current query?  Called from the signal handler.
+ *
+ * In a pool worker, a cancel request passed on by the postmaster only
+ * applies if it is for the session we are serving now.  Any other SIGINT,
+ * such as from pg_cancel_backend(), cancels whatever we are running.
+ */
+bool
+SessionPoolCancelIsForCurrent(void)
+{
+	SessionCancelSlot *slot;
+
+	if (!IsSessionPoolWorker() || SessionCancelSlots == NULL ||
+		MyPMChildSlot <= 0)
+		return true;
+	slot = &SessionCancelSlots[MyPMChildSlot - 1];
+
+	if (!slot->cancel_pending)
+		return true;
+	slot->cancel_pending = false;
+	pg_read_barrier();
+
+	return slot->session_pid != 0 && slot->cancel_key == slot->session_key;
+}
+
+/*
+ * Receive one session from the postmaster.
+ *
+ * Returns NULL if there is nothing to receive (with nowait) or if we have
+ * been told to stop accepting sessions.
+ */
+static PooledSession *
+receive_session(bool nowait)
+{
+	for (;;)
+	{
+		pgsocket	sock;
+		ssize_t		len = sizeof(handoff_buf);
+		PooledSession *session;
+
+		sock = StreamReceiveSocket(SessionPoolSock, handoff_buf, &len, nowait);
+		if (len < 0)
+		{
+			if (errno == EWOULDBLOCK || errno == EAGAIN)
+				return NULL;
+			ereport(FATAL,
+					(errcode_for_socket_access(),
+					 errmsg("could not receive session from postmaster: %m")));
+		}
+
+		if (sock == PGINVALID_SOCKET)
+		{
+			if (len == 0)
+			{
+				/* We have been told to stop */
+				pool_channel_open = false;
+				session_wait_set_valid = false;
+				return NULL;
+			}
+			ereport(LOG,
+					(errmsg("invalid session pool message received")));
+			continue;
+		}
+
+		session = create_session(sock, handoff_buf, len);
+		if (session != NULL)
+			return session;
+		StreamClose(sock);
+	}
+}
+
+/*
+ * Set up a PooledSession for a client socket received from the postmaster.
+ * Returns NULL if the accompanying message is malformed.
+ */
+static PooledSession *
+create_session(pgsocket sock, const char *msg, size_t len)
+{
+	SessionHandoffHeader hdr;
+	const char *database;
+	const char *user;
+	const char *end = msg + len;
+	const char *p;
+	MemoryContext cxt;
+	MemoryContext oldcxt;
+	PooledSession *session;
+	Port	   *port;
+	char		remote_host[NI_MAXHOST];
+	char		remote_port[NI_MAXSERV];
+
+	if (!SessionHandoffGetKey(msg, len, &database, &user))
+	{
+		ereport(LOG,
+				(errmsg("invalid session pool message received")));
+		return NULL;
+	}
+
+	if (pool_database != NULL &&
+		(strcmp(database, pool_database) != 0 || strcmp(user, pool_user) != 0))
+	{
+		ereport(LOG,
+				(errmsg("session for database \"%s\" and user \"%s\" sent to wrong pool",
+						database, user)));
+		return NULL;
+	}
+
+	cxt = AllocSetContextCreate(TopMemoryContext,
+								"PooledSession",
+								ALLOCSET_SMALL_SIZES);
+	oldcxt = MemoryContextSwitchTo(cxt);
+
+	memcpy(&hdr, msg, sizeof(hdr));
+
+	session = (PooledSession *) palloc0(sizeof(PooledSession));
+	session->cxt = cxt;
+	session->cancel_pid = hdr.cancel_pid;
+	session->cancel_key = hdr.cancel_key;
+	session->idle_since = GetCurrentTimestamp();
+	session->state = InvalidDsaPointer;
+
+	port = (Port *) palloc0(sizeof(Port));
+	port->sock = sock;
+	port->canAcceptConnections = CAC_OK;
+	port->proto = hdr.proto;
+	port->database_name = pstrdup(database);
+	port->user_name = pstrdup(user);
+
+	/* The rest of the message consists of option name/value pairs */
+	p = user + strlen(user) + 1;
+	while (p < end)
+	{
+		const char *value = p + strlen(p) + 1;
+
+		if (value >= end)
+			break;
+		port->guc_options = lappend(port->guc_options, pstrdup(p));
+		port->guc_options = lappend(port->guc_options, pstrdup(value));
+		p = value + strlen(value) + 1;
+	}
+
+	/*
+	 * A returned session's client has been through the startup sequence, and
+	 * its state is restored when we first switch to it.
+	 */
+	if (hdr.flags & SESSION_HANDOFF_RESUMED)
+	{
+		session->started = true;
+		session->state = hdr.state;
+	}
+	else
+	{
+		/*
+		 * A new session gets a cancel key of its own, since we serve others
+		 * with the same process ID.
+		 */
+		session->cancel_pid = MyProcPid;
+		if (!pg_backend_random((char *) &session->cancel_key,
+							   sizeof(session->cancel_key)))
+		{
+			ereport(LOG,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("could not generate random cancel key")));
+			MemoryContextSwitchTo(oldcxt);
+			MemoryContextDelete(cxt);
+			return NULL;
+		}
+	}
+
+	port->laddr.salen = sizeof(port->laddr.addr);
+	if (getsockname(sock, (struct sockaddr *) &port->laddr.addr,
+					&port->laddr.salen) < 0)
+		ereport(LOG,
+				(errmsg("getsockname() failed: %m")));
+	port->raddr.salen = sizeof(port->raddr.addr);
+	if (getpeername(sock, (struct sockaddr *) &port->raddr.addr,
+					&port->raddr.salen) < 0)
+		ereport(LOG,
+				(errmsg("getpeername() failed: %m")));
+
+	remote_host[0] = '\0';
+	remote_port[0] = '\0';
+	(void) pg_getnameinfo_all(&port->raddr.addr, port->raddr.salen,
+							  remote_host, sizeof(remote_host),
+							  remote_port, sizeof(remote_port),
+							  (log_hostname ? 0 : NI_NUMERICHOST) | NI_NUMERICSERV);
+	port->remote_host = pstrdup(remote_host);
+	port->remote_port = pstrdup(remote_port);
+	port->SessionStartTime = GetCurrentTimestamp();
+
+#if defined(ENABLE_GSS) || defined(ENABLE_SSPI)
+	/* Kept separately, like in ConnCreate, so the Port layout is unchanged */
+	port->gss = (pg_gssinfo *) calloc(1, sizeof(pg_gssinfo));
+	if (port->gss == NULL)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory")));
+#endif
+
+	session->port = port;
+	MemoryContextSwitchTo(oldcxt);
+
+	dlist_push_tail(&sessions, &session->node);
+	n_sessions++;
+	session_wait_set_valid = false;
+
+	if (Log_connections && !session->started)
+		ereport(LOG,
+				(errmsg("pooled session received: host=%s%s%s user=%s database=%s",
+						remote_host,
+						remote_port[0] ? " port=" : "", remote_port,
+						user, database)));
+
+	return session;
+}
+
+/*
+ * Receive all sessions the postmaster has queued for us.
+ */
+static void
+receive_new_sessions(void)
+{
+	while (pool_channel_open && receive_session(true) != NULL)
+		;
+}
+
+/*
+ * Hand sessions that have been idle for session_pool_return_delay back to
+ * the postmaster.
+ *
+ * Returns the time in milliseconds until the next session becomes due, or
+ * -1 if there is none.
+ */
+static long
+return_idle_sessions(void)
+{
+	TimestampTz now = GetCurrentTimestamp();
+	long		timeout = -1L;
+	const char *blocker;
+	dlist_mutable_iter iter;
+
+	/*
+	 * While we hold state that cannot move with a session, we can't tell
+	 * which sessions depend on it, so none can be returned.
+	 */
+	blocker = GetSessionMigrationBlocker();
+	if (blocker != NULL)
+	{
+		if (!migration_blocker_reported)
+		{
+			ereport(LOG,
+					(errmsg("pooled sessions of this server process cannot be returned to the postmaster for now"),
+					 errdetail("The server process has %s.", _(blocker))));
+			migration_blocker_reported = true;
+		}
+		return -1L;
+	}
+	migration_blocker_reported = false;
+
+	dlist_foreach_modify(iter, &sessions)
+	{
+		PooledSession *session = dlist_container(PooledSession, node,
+												 iter.cur);
+		long		secs;
+		int			usecs;
+		long		remaining;
+
+		/* Skip sessions that are about to be served anyway */
+		if (!session->started || DsaPointerIsValid(session->state))
+			continue;
+
+		if (TimestampDifferenceExceeds(session->idle_since, now,
+									   SessionPoolReturnDelay))
+		{
+			if (session == current_session)
+			{
+				detach_current_session();
+				StartTransactionCommand();
+				reset_session_settings(session);
+				CommitTransactionCommand();
+			}
+
+			if (return_session(session))
+				continue;
+
+			/* Try again after another delay */
+			session->idle_since = now;
+		}
+
+		TimestampDifference(now,
+							TimestampTzPlusMilliseconds(session->idle_since,
+														SessionPoolReturnDelay),
+							&secs, &usecs);
+		remaining = secs * 1000 + (usecs + 999) / 1000;
+		if (timeout < 0 || remaining < timeout)
+			timeout = remaining;
+	}
+
+	return timeout;
+}
+
+/*
+ * Send an inactive session back to the postmaster, and forget about it.
+ *
+ * Returns false if the session has to stay with us for now: if there is no
+ * room for its state in shared memory, or the postmaster's queue is full.
+ */
+static bool
+return_session(PooledSession *session)
+{
+	SessionHandoffHeader hdr;
+	StringInfoData buf;
+	int			rc;
+	int			save_errno;
+
+	Assert(session != current_session);
+	Assert(session->sequences != NULL);
+
+	hdr.proto = session->port->proto;
+	hdr.flags = SESSION_HANDOFF_RESUMED;
+	hdr.cancel_pid = session->cancel_pid;
+	hdr.cancel_key = session->cancel_key;
+	hdr.state = SerializeSessionState(session->settings,
+									  session->prepared_queries,
+									  session->sequences);
+	if (!DsaPointerIsValid(hdr.state))
+		return false;
+
+	initStringInfo(&buf);
+	appendBinaryStringInfo(&buf, (char *) &hdr, sizeof(hdr));
+	appendBinaryStringInfo(&buf, session->port->database_name,
+						   strlen(session->port->database_name) + 1);
+	appendBinaryStringInfo(&buf, session->port->user_name,
+						   strlen(session->port->user_name) + 1);
+
+	rc = StreamSendSocket(SessionHandoffSock[SESSION_HANDOFF_SEND],
+						  session->port->sock, buf.data, buf.len, true);
+	save_errno = errno;
+	pfree(buf.data);
+
+	if (rc != STATUS_OK)
+	{
+		DiscardSessionState(hdr.state);
+		if (save_errno != EWOULDBLOCK && save_errno != EAGAIN)
+		{
+			errno = save_errno;
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not return session to postmaster: %m")));
+		}
+		return false;
+	}
+
+	/* The new worker will prepare the statements again */
+	DiscardPreparedStatements(session->prepared_queries);
+	session->prepared_queries = NULL;
+
+	forget_session(session);
+	elog(DEBUG2, "returned idle session to postmaster");
+	return true;
+}
+
+/*
+ * Close our copy of a session's socket and release everything it owned.
+ * The session must not be the current one.
+ */
+static void
+forget_session(PooledSession *session)
+{
+	Assert(session != current_session);
+
+	if (DsaPointerIsValid(session->state))
+		DiscardSessionState(session->state);
+
+	StreamClose(session->port->sock);
+#if defined(ENABLE_GSS) || defined(ENABLE_SSPI)
+	if (session->port->gss != NULL)
+		free(session->port->gss);
+#endif
+
+	dlist_delete(&session->node);
+	n_sessions--;
+	MemoryContextDelete(session->cxt);
+	session_wait_set_valid = false;
+}
+
+/*
+ * Make another session the current one.
+ */
+static void
+switch_session(PooledSession *next)
+{
+	PooledSession *prev = current_session;
+
+	/*
+	 * Reset the previous session's settings while no client is connected,
+	 * so that no ParameterStatus messages are sent for them.  Applying the
+	 * next session's settings does report them, which is harmless since
+	 * they are the values its client expects anyway.
+	 */
+	if (prev != NULL)
+		detach_current_session();
+
+	StartTransactionCommand();
+	if (prev != NULL)
+		reset_session_settings(prev);
+
+	pq_switch_port(next->port);
+	whereToSendOutput = DestRemote;
+	FrontendProtocol = next->port->proto;
+	current_session = next;
+	publish_cancel_key(next);
+
+	RestorePreparedStatements(next->prepared_queries);
+	next->prepared_queries = NULL;
+	if (next->sequences != NULL)
+	{
+		RestoreSequenceSessionState(next->sequences);
+		pfree(next->sequences);
+		next->sequences = NULL;
+	}
+
+	if (next->started)
+		restore_session_settings(next->settings);
+	else
+		apply_session_settings(next->port->guc_options,
+							   superuser() ? PGC_SUSET : PGC_USERSET);
+
+	/* A session returned by another worker brings its state along */
+	if (DsaPointerIsValid(next->state))
+	{
+		dsa_pointer state = next->state;
+
+		next->state = InvalidDsaPointer;
+		RestoreSessionState(state);
+	}
+	CommitTransactionCommand();
+
+	if (!next->started)
+	{
+		StringInfoData buf;
+
+		/* Send the same startup messages as PostgresMain does */
+		BeginReportingGUCOptions();
+
+		pq_beginmessage(&buf, 'K');
+		pq_sendint32(&buf, next->cancel_pid);
+		pq_sendint32(&buf, next->cancel_key);
+		pq_endmessage(&buf);
+	}
+}
+
+/*
+ * Save the current session's prepared statements and settings, and leave
+ * no client connected.  The settings are still in effect; the caller must
+ * reset them.
+ */
+static void
+detach_current_session(void)
+{
+	PooledSession *session = current_session;
+	MemoryContext oldcxt;
+
+	/*
+	 * The session must have seen all our output.  If its client has gone
+	 * away meanwhile, we notice when the socket reports EOF, so don't let
+	 * that end the session we switch to next.
+	 */
+	pq_flush();
+	ClientConnectionLost = false;
+	session->prepared_queries = SavePreparedStatements();
+	oldcxt = MemoryContextSwitchTo(session->cxt);
+	session->sequences = SaveSequenceSessionState();
+	MemoryContextSwitchTo(oldcxt);
+	save_session_settings(session);
+
+	pq_switch_port(NULL);
+	whereToSendOutput = DestNone;
+	current_session = NULL;
+	publish_cancel_key(NULL);
+}
+
+/*
+ * Remember the settings the current session has made with SET, along with
+ * the context and source they were made in, so that they can be restored
+ * the same way when it becomes active again.
+ */
+static void
+save_session_settings(PooledSession *session)
+{
+	struct config_generic **vars = get_guc_variables();
+	int			nvars = GetNumConfigOptions();
+	MemoryContext oldcxt;
+	ListCell   *lc;
+	int			i;
+
+	oldcxt = MemoryContextSwitchTo(session->cxt);
+
+	foreach(lc, session->settings)
+	{
+		SessionSetting *setting = (SessionSetting *) lfirst(lc);
+
+		pfree(setting->name);
+		pfree(setting->value);
+	}
+	list_free_deep(session->settings);
+	session->settings = NIL;
+
+	for (i = 0; i < nvars; i++)
+	{
+		struct config_generic *var = vars[i];
+		SessionSetting *setting;
+		const char *value;
+
+		if (var->source != PGC_S_SESSION ||
+			(var->context != PGC_USERSET && var->context != PGC_SUSET))
+			continue;
+
+		/*
+		 * Variables that RESET ALL leaves alone are per-transaction state,
+		 * except for the ones tracking the session's identity.
+		 */
+		if ((var->flags & GUC_NO_RESET_ALL) &&
+			strcmp(var->name, "role") != 0 &&
+			strcmp(var->name, "session_authorization") != 0)
+			continue;
+
+		value = GetConfigOption(var->name, false, false);
+		if (value == NULL)
+			continue;
+
+		setting = (SessionSetting *) palloc(sizeof(SessionSetting));
+		setting->name = pstrdup(var->name);
+		setting->value = pstrdup(value);
+		setting->context = var->scontext;
+		setting->source = var->source;
+
+		/*
+		 * Put session_authorization first, since setting it overrides any
+		 * earlier SET ROLE.
+		 */
+		if (strcmp(var->name, "session_authorization") == 0)
+			session->settings = lcons(setting, session->settings);
+		else
+			session->settings = lappend(session->settings, setting);
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+}
+
+/*
+ * Return the settings saved for a session to their default values.
+ */
+static void
+reset_session_settings(PooledSession *session)
+{
+	ListCell   *lc;
+
+	foreach(lc, session->settings)
+	{
+		SessionSetting *setting = (SessionSetting *) lfirst(lc);
+
+		(void) set_config_option(setting->name, NULL, PGC_SUSET,
+								 PGC_S_SESSION, GUC_ACTION_SET, true,
+								 WARNING, false);
+	}
+}
+
+/*
+ * Make the settings saved for a session again, each in the context and with
+ * the source it was originally made in.
+ */
+static void
+restore_session_settings(List *settings)
+{
+	ListCell   *lc;
+
+	foreach(lc, settings)
+	{
+		SessionSetting *setting = (SessionSetting *) lfirst(lc);
+
+		(void) set_config_option(setting->name, setting->value,
+								 setting->context, setting->source,
+								 GUC_ACTION_SET, true, WARNING, false);
+	}
+}
+
+/*
+ * Apply a list of alternating option names and values as session settings.
+ */
+static void
+apply_session_settings(List *settings, GucContext context)
+{
+	ListCell   *lc = list_head(settings);
+
+	while (lc)
+	{
+		char	   *name = lfirst(lc);
+		char	   *value = lfirst(lnext(lc));
+
+		lc = lnext(lnext(lc));
+
+		(void) set_config_option(name, value, context, PGC_S_SESSION,
+								 GUC_ACTION_SET, true, WARNING, false);
+	}
+}
+
+/*
+ * Publish the process ID and cancel key of the session we are now serving,
+ * or that we are serving none, for the postmaster to find (see
+ * SessionPoolCancel).  The process ID is cleared while the key changes, so
+ * that the postmaster never matches a half-updated entry.
+ */
+static void
+publish_cancel_key(PooledSession *session)
+{
+	SessionCancelSlot *slot;
+
+	if (MyPMChildSlot <= 0)
+		return;
+	slot = &SessionCancelSlots[MyPMChildSlot - 1];
+
+	slot->session_pid = 0;
+	if (session == NULL)
+		return;
+	pg_write_barrier();
+	slot->session_key = session->cancel_key;
+	pg_write_barrier();
+	slot->session_pid = session->cancel_pid;
+}
@@ -205,6 +205,35 @@ BarrierArriveAndDetach(Barrier *barrier)
 	return BarrierDetachImpl(barrier, true);
 }
 
+/*
+ * Arrive at this barrier, and detach unless the caller is the only remaining
+ * participant, in which case the phase is advanced and the caller stays
+ * attached.  Returns true if the caller is still attached.  This provides a
+ * way to elect one participant to carry on alone with a following phase
+ * without anyone having to wait, so it must only be used while no other
+ * participant can be waiting at the barrier.
+ */
+bool
+BarrierArriveAndDetachExceptLast(Barrier *barrier)
+{
+	Assert(!barrier->static_party);
+
+	SpinLockAcquire(&barrier->mutex);
+	Assert(barrier->arrived == 0);
+	if (barrier->participants > 1)
+	{
+		--barrier->participants;
+		SpinLockRelease(&barrier->mutex);
+
+		return false;
+	}
+	Assert(barrier->participants == 1);
+	++barrier->phase;
+	SpinLockRelease(&barrier->mutex);
+
+	return true;
+}
+
 /*
  * Attach to a barrier.  All waiting participants will now wait for this
  * participant to call BarrierArriveAndWait(), BarrierDetach() or
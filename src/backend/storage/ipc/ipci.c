@@ -19,6 +19,7 @@
 #include "access/heapam.h"
 #include "access/multixact.h"
 #include "access/nbtree.h"
+#include "access/session.h"
 #include "access/subtrans.h"
 #include "access/twophase.h"
 #include "commands/async.h"
@@ -28,6 +29,7 @@
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/sessionpool.h"
 #include "replication/logicallauncher.h"
 #include "replication/slot.h"
 #include "replication/walreceiver.h"
@@ -45,6 +47,8 @@
 #include "storage/sinvaladt.h"
 #include "storage/spin.h"
 #include "utils/backend_random.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 
 
@@ -150,6 +154,10 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 		size = add_size(size, SyncScanShmemSize());
 		size = add_size(size, AsyncShmemSize());
 		size = add_size(size, BackendRandomShmemSize());
+		size = add_size(size, SessionStateShmemSize());
+		size = add_size(size, SessionPoolShmemSize());
+		size = add_size(size, SharedCatCacheShmemSize());
+		size = add_size(size, SharedPlanCacheShmemSize());
 #ifdef EXEC_BACKEND
 		size = add_size(size, ShmemBackendArraySize());
 #endif
@@ -270,6 +278,10 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 	SyncScanShmemInit();
 	AsyncShmemInit();
 	BackendRandomShmemInit();
+	SessionStateShmemInit();
+	SessionPoolShmemInit();
+	SharedCatCacheShmemInit();
+	SharedPlanCacheShmemInit();
 
 #ifdef EXEC_BACKEND
 
@@ -21,6 +21,8 @@
 #include "storage/proc.h"
 #include "storage/sinvaladt.h"
 #include "utils/inval.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
 
 
 uint64		SharedInvalidMessageCounter;
@@ -48,7 +50,22 @@ volatile sig_atomic_t catchupInterruptPending = false;
 void
 SendSharedInvalidMessages(const SharedInvalidationMessage *msgs, int n)
 {
+	bool		shared_catcache;
+	bool		shared_plancache;
+
+	/*
+	 * Stale tuples and plans must be gone from the shared catalog and plan
+	 * caches before anyone could act on these messages.
+	 */
+	shared_catcache = SharedCatCacheBeginInvalidate(msgs, n);
+	shared_plancache = SharedPlanCacheBeginInvalidate(msgs, n);
+
 	SIInsertDataEntries(msgs, n);
+
+	if (shared_plancache)
+		SharedPlanCacheEndInvalidate();
+	if (shared_catcache)
+		SharedCatCacheEndInvalidate();
 }
 
 /*
@@ -2305,6 +2305,36 @@ LockReleaseSession(LOCKMETHODID lockmethodid)
 	}
 }
 
+/*
+ * LockMethodHeldByMe -- Does the current process hold any locks of the
+ *		specified lock method?
+ *
+ * Between transactions, any such locks are necessarily session locks.
+ */
+bool
+LockMethodHeldByMe(LOCKMETHODID lockmethodid)
+{
+	HASH_SEQ_STATUS status;
+	LOCALLOCK  *locallock;
+
+	if (lockmethodid <= 0 || lockmethodid >= lengthof(LockMethods))
+		elog(ERROR, "unrecognized lock method: %d", lockmethodid);
+
+	hash_seq_init(&status, LockMethodLocalHash);
+
+	while ((locallock = (LOCALLOCK *) hash_seq_search(&status)) != NULL)
+	{
+		if (LOCALLOCK_LOCKMETHOD(*locallock) == lockmethodid &&
+			locallock->nLocks > 0)
+		{
+			hash_seq_term(&status);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 /*
  * LockReleaseCurrentOwner
  *		Release all locks belonging to CurrentResourceOwner
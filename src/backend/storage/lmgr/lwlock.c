@@ -516,11 +516,20 @@ RegisterLWLockTranches(void)
 						  "session_record_table");
 	LWLockRegisterTranche(LWTRANCHE_SESSION_TYPMOD_TABLE,
 						  "session_typmod_table");
+	LWLockRegisterTranche(LWTRANCHE_SESSION_STATE_DSA,
+						  "session_state_dsa");
+	LWLockRegisterTranche(LWTRANCHE_SHARED_CATCACHE, "shared_catcache");
+	LWLockRegisterTranche(LWTRANCHE_SHARED_CATCACHE_DSA,
+						  "shared_catcache_dsa");
+	LWLockRegisterTranche(LWTRANCHE_SHARED_PLANCACHE, "shared_plancache");
+	LWLockRegisterTranche(LWTRANCHE_SHARED_PLANCACHE_DSA,
+						  "shared_plancache_dsa");
 	LWLockRegisterTranche(LWTRANCHE_SHARED_TUPLESTORE,
 						  "shared_tuplestore");
 	LWLockRegisterTranche(LWTRANCHE_TBM, "tbm");
 	LWLockRegisterTranche(LWTRANCHE_PARALLEL_APPEND, "parallel_append");
 	LWLockRegisterTranche(LWTRANCHE_PARALLEL_HASH_JOIN, "parallel_hash_join");
+	LWLockRegisterTranche(LWTRANCHE_PARALLEL_HASH_AGG, "parallel_hash_agg");
 
 	/* Register named tranches. */
 	for (i = 0; i < NamedLWLockTrancheRequests; i++)
@@ -21,6 +21,9 @@
 
 #include <fcntl.h>
 #include <limits.h>
+#ifdef HAVE_MALLOC_TRIM
+#include <malloc.h>
+#endif
 #include <signal.h>
 #include <unistd.h>
 #include <sys/socket.h>
@@ -56,6 +59,7 @@
 #include "pg_getopt.h"
 #include "postmaster/autovacuum.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/sessionpool.h"
 #include "replication/logicallauncher.h"
 #include "replication/logicalworker.h"
 #include "replication/slot.h"
@@ -70,9 +74,12 @@
 #include "tcop/pquery.h"
 #include "tcop/tcopprot.h"
 #include "tcop/utility.h"
+#include "utils/catcache.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/plancache.h"
 #include "utils/ps_status.h"
+#include "utils/relcache.h"
 #include "utils/snapmgr.h"
 #include "utils/timeout.h"
 #include "utils/timestamp.h"
@@ -99,6 +106,9 @@ int			max_stack_depth = 100;
 /* wait N seconds to allow attach from a debugger */
 int			PostAuthDelay = 0;
 
+/* give back unused memory after this many milliseconds idle; 0 disables */
+int			IdleMemoryReclaimDelay = 0;
+
 
 
 /* ----------------
@@ -149,6 +159,12 @@ static bool ignore_till_sync = false;
  */
 static bool stmt_timeout_active = false;
 
+/*
+ * Flag to keep track of whether we have reported connection startup timing
+ * to the statistics collector yet.
+ */
+static bool connection_startup_reported = false;
+
 /*
  * If an unnamed prepared statement exists, it's stored here.
  * We keep it separate from the hashtable kept by commands/prepare.c
@@ -178,6 +194,7 @@ static int	InteractiveBackend(StringInfo inBuf);
 static int	interactive_getc(void);
 static int	SocketBackend(StringInfo inBuf);
 static int	ReadCommand(StringInfo inBuf);
+static void ProcessIdleMemoryReclaim(void);
 static void forbidden_in_wal_sender(char firstchar);
 static List *pg_rewrite_query(Query *query);
 static bool check_log_statement(List *stmt_list);
@@ -191,6 +208,7 @@ static bool IsTransactionExitStmt(Node *parsetree);
 static bool IsTransactionExitStmtList(List *pstmts);
 static bool IsTransactionStmtList(List *pstmts);
 static void drop_unnamed_stmt(void);
+static void InitBackendSignals(void);
 static void log_disconnections(int code, Datum arg);
 static void enable_statement_timeout(void);
 static void disable_statement_timeout(void);
@@ -439,7 +457,7 @@ SocketBackend(StringInfo inBuf)
 			doing_extended_query_message = true;
 			/* these are only legal in protocol 3 */
 			if (PG_PROTOCOL_MAJOR(FrontendProtocol) < 3)
-				ereport(FATAL,
+				ereport(SessionPoolTerminateLevel(),
 						(errcode(ERRCODE_PROTOCOL_VIOLATION),
 						 errmsg("invalid frontend message type %d", qtype)));
 			break;
@@ -451,7 +469,7 @@ SocketBackend(StringInfo inBuf)
 			doing_extended_query_message = false;
 			/* only legal in protocol 3 */
 			if (PG_PROTOCOL_MAJOR(FrontendProtocol) < 3)
-				ereport(FATAL,
+				ereport(SessionPoolTerminateLevel(),
 						(errcode(ERRCODE_PROTOCOL_VIOLATION),
 						 errmsg("invalid frontend message type %d", qtype)));
 			break;
@@ -462,7 +480,7 @@ SocketBackend(StringInfo inBuf)
 			doing_extended_query_message = false;
 			/* these are only legal in protocol 3 */
 			if (PG_PROTOCOL_MAJOR(FrontendProtocol) < 3)
-				ereport(FATAL,
+				ereport(SessionPoolTerminateLevel(),
 						(errcode(ERRCODE_PROTOCOL_VIOLATION),
 						 errmsg("invalid frontend message type %d", qtype)));
 			break;
@@ -474,7 +492,7 @@ SocketBackend(StringInfo inBuf)
 			 * fatal because we have probably lost message boundary sync, and
 			 * there's no good way to recover.
 			 */
-			ereport(FATAL,
+			ereport(SessionPoolTerminateLevel(),
 					(errcode(ERRCODE_PROTOCOL_VIOLATION),
 					 errmsg("invalid frontend message type %d", qtype)));
 			break;
@@ -541,6 +559,10 @@ ProcessClientReadInterrupt(bool blocked)
 		/* Process sinval catchup interrupts that happened while reading */
 		if (notifyInterruptPending)
 			ProcessNotifyInterrupt();
+
+		/* Give back memory if we have been idle for long enough */
+		if (IdleMemoryReclaimPending)
+			ProcessIdleMemoryReclaim();
 	}
 	else if (ProcDiePending && blocked)
 	{
@@ -553,6 +575,41 @@ ProcessClientReadInterrupt(bool blocked)
 	errno = save_errno;
 }
 
+/*
+ * ProcessIdleMemoryReclaim() - give back memory while the session is idle
+ *
+ * Long-lived sessions keep the caches they have built up at their busiest,
+ * even if they are idle most of the time.  After idle_memory_reclaim_delay,
+ * we drop the catalog cache and relcache entries and the generic plans that
+ * haven't been used since the last time we did this, which leaves the
+ * working set of the session's recent activity.  Then we free the memory
+ * contexts that aset.c keeps for reuse, and ask malloc to return free memory
+ * to the operating system.  Memory freed within a context generally stays
+ * with the context for reuse, so the last step mostly helps with the
+ * contexts of plans and relcache entries that have been deleted.
+ */
+static void
+ProcessIdleMemoryReclaim(void)
+{
+	IdleMemoryReclaimPending = false;
+
+	/* Only possible between transactions */
+	if (IsTransactionOrTransactionBlock())
+		return;
+
+	elog(DEBUG2, "reclaiming memory of idle session");
+
+	CatalogCacheShrink();
+	RelationCacheShrink();
+	PlanCacheShrink();
+
+	AllocSetReleaseFreeLists();
+
+#ifdef HAVE_MALLOC_TRIM
+	malloc_trim(0);
+#endif
+}
+
 /*
  * ProcessClientWriteInterrupt() - Process interrupts specific to client writes
  *
@@ -2690,9 +2747,10 @@ StatementCancelHandler(SIGNAL_ARGS)
 	int			save_errno = errno;
 
 	/*
-	 * Don't joggle the elbow of proc_exit
+	 * Don't joggle the elbow of proc_exit, nor cancel a pooled session's
+	 * query on behalf of another session's client
 	 */
-	if (!proc_exit_inprogress)
+	if (!proc_exit_inprogress && SessionPoolCancelIsForCurrent())
 	{
 		InterruptPending = true;
 		QueryCancelPending = true;
@@ -2925,11 +2983,20 @@ ProcessInterrupts(void)
 	}
 	if (ClientConnectionLost)
 	{
+		int			elevel = SessionPoolTerminateLevel();
+
 		QueryCancelPending = false; /* lost connection trumps QueryCancel */
 		LockErrorCleanup();
 		/* don't send to client, we already know the connection to be dead. */
 		whereToSendOutput = DestNone;
-		ereport(FATAL,
+
+		/*
+		 * A pool worker only ends the session.  Unlike FATAL, the ERROR can
+		 * be caught, so keep raising it until the session has been closed.
+		 */
+		if (elevel == ERROR)
+			InterruptPending = true;
+		ereport(elevel,
 				(errcode(ERRCODE_CONNECTION_FAILURE),
 				 errmsg("connection to client lost")));
 	}
@@ -3042,9 +3109,13 @@ ProcessInterrupts(void)
 	{
 		/* Has the timeout setting changed since last we looked? */
 		if (IdleInTransactionSessionTimeout > 0)
-			ereport(FATAL,
+		{
+			/* a pool worker carries on with its other sessions */
+			IdleInTransactionSessionTimeoutPending = false;
+			ereport(SessionPoolTerminateLevel(),
 					(errcode(ERRCODE_IDLE_IN_TRANSACTION_SESSION_TIMEOUT),
 					 errmsg("terminating connection due to idle-in-transaction timeout")));
+		}
 		else
 			IdleInTransactionSessionTimeoutPending = false;
 
@@ -3052,6 +3123,9 @@ ProcessInterrupts(void)
 
 	if (ParallelMessagePending)
 		HandleParallelMessages();
+
+	if (LogMemoryContextPending)
+		ProcessLogMemoryContextInterrupt();
 }
 
 
@@ -3605,6 +3679,102 @@ process_postgres_switches(int argc, char *argv[], GucContext ctx,
 }
 
 
+/*
+ * Set up signal handlers and masks for a backend, and block all signals
+ * except SIGQUIT.
+ *
+ * Note that postmaster blocked all signals before forking child process,
+ * so there is no race condition whereby we might receive a signal before
+ * we have set up the handler.
+ *
+ * Also note: it's best not to use any signals that are SIG_IGNored in the
+ * postmaster.  If such a signal arrives before we are able to change the
+ * handler to non-SIG_IGN, it'll get dropped.  Instead, make a dummy
+ * handler in the postmaster to reserve the signal. (Of course, this isn't
+ * an issue for signals that are locally generated, such as SIGALRM and
+ * SIGPIPE.)
+ */
+static void
+InitBackendSignals(void)
+{
+	if (am_walsender)
+		WalSndSignals();
+	else
+	{
+		pqsignal(SIGHUP, PostgresSigHupHandler);	/* set flag to read config
+													 * file */
+		pqsignal(SIGINT, StatementCancelHandler);	/* cancel current query */
+		pqsignal(SIGTERM, die); /* cancel current query and exit */
+
+		/*
+		 * In a standalone backend, SIGQUIT can be generated from the keyboard
+		 * easily, while SIGTERM cannot, so we make both signals do die()
+		 * rather than quickdie().
+		 */
+		if (IsUnderPostmaster)
+			pqsignal(SIGQUIT, quickdie);	/* hard crash time */
+		else
+			pqsignal(SIGQUIT, die); /* cancel current query and exit */
+		InitializeTimeouts();	/* establishes SIGALRM handler */
+
+		/*
+		 * Ignore failure to write to frontend. Note: if frontend closes
+		 * connection, we will notice it and exit cleanly when control next
+		 * returns to outer loop.  This seems safer than forcing exit in the
+		 * midst of output during who-knows-what operation...
+		 */
+		pqsignal(SIGPIPE, SIG_IGN);
+		pqsignal(SIGUSR1, procsignal_sigusr1_handler);
+		pqsignal(SIGUSR2, SIG_IGN);
+		pqsignal(SIGFPE, FloatExceptionHandler);
+
+		/*
+		 * Reset some signals that are accepted by postmaster but not by
+		 * backend
+		 */
+		pqsignal(SIGCHLD, SIG_DFL); /* system() requires this on some
+									 * platforms */
+	}
+
+	pqinitmask();
+
+	if (IsUnderPostmaster)
+	{
+		/* We allow SIGQUIT (quickdie) at all times */
+		sigdelset(&BlockSig, SIGQUIT);
+	}
+
+	PG_SETMASK(&BlockSig);		/* block everything except SIGQUIT */
+}
+
+
+/* ----------------------------------------------------------------
+ * InitPreforkedBackend
+ *	   set up a preforked backend as far as possible without a client
+ *
+ * This does the part of PostgresMain's initialization that doesn't depend
+ * on the client connection, including the database-independent part of
+ * InitPostgres.  The postmaster then passes the backend a client connection
+ * when one arrives, and it goes through the usual startup sequence, skipping
+ * what has already been done.
+ * ----------------------------------------------------------------
+ */
+void
+InitPreforkedBackend(void)
+{
+	Assert(IsUnderPostmaster && IsPreforkedBackend);
+
+	InitBackendSignals();
+
+	BaseInit();
+	InitProcess();
+
+	PG_SETMASK(&UnBlockSig);
+
+	InitPostgresEarly();
+}
+
+
 /* ----------------------------------------------------------------
  * PostgresMain
  *	   postgres main loop -- all backends, interactive or otherwise start here
@@ -3626,6 +3796,7 @@ PostgresMain(int argc, char *argv[],
 	sigjmp_buf	local_sigjmp_buf;
 	volatile bool send_ready_for_query = true;
 	bool		disable_idle_in_transaction_timeout = false;
+	bool		disable_idle_memory_reclaim_timeout = false;
 
 	/* Initialize startup process environment if necessary. */
 	if (!IsUnderPostmaster)
@@ -3664,66 +3835,8 @@ PostgresMain(int argc, char *argv[],
 
 	/*
 	 * Set up signal handlers and masks.
-	 *
-	 * Note that postmaster blocked all signals before forking child process,
-	 * so there is no race condition whereby we might receive a signal before
-	 * we have set up the handler.
-	 *
-	 * Also note: it's best not to use any signals that are SIG_IGNored in the
-	 * postmaster.  If such a signal arrives before we are able to change the
-	 * handler to non-SIG_IGN, it'll get dropped.  Instead, make a dummy
-	 * handler in the postmaster to reserve the signal. (Of course, this isn't
-	 * an issue for signals that are locally generated, such as SIGALRM and
-	 * SIGPIPE.)
 	 */
-	if (am_walsender)
-		WalSndSignals();
-	else
-	{
-		pqsignal(SIGHUP, PostgresSigHupHandler);	/* set flag to read config
-													 * file */
-		pqsignal(SIGINT, StatementCancelHandler);	/* cancel current query */
-		pqsignal(SIGTERM, die); /* cancel current query and exit */
-
-		/*
-		 * In a standalone backend, SIGQUIT can be generated from the keyboard
-		 * easily, while SIGTERM cannot, so we make both signals do die()
-		 * rather than quickdie().
-		 */
-		if (IsUnderPostmaster)
-			pqsignal(SIGQUIT, quickdie);	/* hard crash time */
-		else
-			pqsignal(SIGQUIT, die); /* cancel current query and exit */
-		InitializeTimeouts();	/* establishes SIGALRM handler */
-
-		/*
-		 * Ignore failure to write to frontend. Note: if frontend closes
-		 * connection, we will notice it and exit cleanly when control next
-		 * returns to outer loop.  This seems safer than forcing exit in the
-		 * midst of output during who-knows-what operation...
-		 */
-		pqsignal(SIGPIPE, SIG_IGN);
-		pqsignal(SIGUSR1, procsignal_sigusr1_handler);
-		pqsignal(SIGUSR2, SIG_IGN);
-		pqsignal(SIGFPE, FloatExceptionHandler);
-
-		/*
-		 * Reset some signals that are accepted by postmaster but not by
-		 * backend
-		 */
-		pqsignal(SIGCHLD, SIG_DFL); /* system() requires this on some
-									 * platforms */
-	}
-
-	pqinitmask();
-
-	if (IsUnderPostmaster)
-	{
-		/* We allow SIGQUIT (quickdie) at all times */
-		sigdelset(&BlockSig, SIGQUIT);
-	}
-
-	PG_SETMASK(&BlockSig);		/* block everything except SIGQUIT */
+	InitBackendSignals();
 
 	if (!IsUnderPostmaster)
 	{
@@ -3748,21 +3861,27 @@ PostgresMain(int argc, char *argv[],
 		InitializeMaxBackends();
 	}
 
-	/* Early initialization */
-	BaseInit();
-
 	/*
-	 * Create a per-backend PGPROC struct in shared memory, except in the
-	 * EXEC_BACKEND case where this was done in SubPostmasterMain. We must do
-	 * this before we can use LWLocks (and in the EXEC_BACKEND case we already
-	 * had to do some stuff with LWLocks).
+	 * Early initialization.  A preforked backend has done this already, see
+	 * InitPreforkedBackend.
 	 */
+	if (!IsPreforkedBackend)
+	{
+		BaseInit();
+
+		/*
+		 * Create a per-backend PGPROC struct in shared memory, except in the
+		 * EXEC_BACKEND case where this was done in SubPostmasterMain. We must
+		 * do this before we can use LWLocks (and in the EXEC_BACKEND case we
+		 * already had to do some stuff with LWLocks).
+		 */
 #ifdef EXEC_BACKEND
-	if (!IsUnderPostmaster)
-		InitProcess();
+		if (!IsUnderPostmaster)
+			InitProcess();
 #else
-	InitProcess();
+		InitProcess();
 #endif
+	}
 
 	/* We need to allow SIGINT, etc during the initial transaction */
 	PG_SETMASK(&UnBlockSig);
@@ -3774,7 +3893,11 @@ PostgresMain(int argc, char *argv[],
 	 * it inside InitPostgres() instead.  In particular, anything that
 	 * involves database access should be there, not here.
 	 */
+	if (MyProcPort != NULL)
+		MyProcPort->init_start_time = GetCurrentTimestamp();
 	InitPostgres(dbname, InvalidOid, username, InvalidOid, NULL, false);
+	if (MyProcPort != NULL)
+		MyProcPort->init_end_time = GetCurrentTimestamp();
 
 	/*
 	 * If the PostmasterContext is still around, recycle the space; we don't
@@ -3791,6 +3914,19 @@ PostgresMain(int argc, char *argv[],
 
 	SetProcessingMode(NormalProcessing);
 
+	/*
+	 * With session pooling, we are done once the session is authenticated:
+	 * it is handed over to a pool worker, and we exit.  A pool worker
+	 * applies its first session's startup options now instead.
+	 */
+	if (MyProcPort != NULL && SessionPoolEnabled(MyProcPort))
+	{
+		pgstat_report_connection_startup(MyProcPort, 0);
+		SessionPoolHandoff(MyProcPort);
+	}
+	if (IsSessionPoolWorker())
+		SessionPoolStartSession();
+
 	/*
 	 * Now all GUC states are fully set up.  Report them to client if
 	 * appropriate.
@@ -3980,11 +4116,27 @@ PostgresMain(int argc, char *argv[],
 		 * messages from the client, so there isn't much we can do with the
 		 * connection anymore.
 		 */
-		if (pq_is_reading_msg())
+		if (pq_is_reading_msg() && !IsSessionPoolWorker())
 			ereport(FATAL,
 					(errcode(ERRCODE_PROTOCOL_VIOLATION),
 					 errmsg("terminating connection because protocol synchronization was lost")));
 
+		/*
+		 * A session pool worker closes just the session the error ended, or
+		 * whose messages we lost track of, and goes on serving the others.
+		 */
+		if (IsSessionPoolWorker() &&
+			(SessionPoolClosePending() || pq_is_reading_msg()))
+		{
+			if (!SessionPoolClosePending())
+				ereport(COMMERROR,
+						(errcode(ERRCODE_PROTOCOL_VIOLATION),
+						 errmsg("closing pooled session because protocol synchronization was lost")));
+			AbortOutOfAnyTransaction();
+			ignore_till_sync = false;
+			SessionPoolCloseSession();
+		}
+
 		/* Now we can allow interrupts again */
 		RESUME_INTERRUPTS();
 	}
@@ -4070,10 +4222,26 @@ PostgresMain(int argc, char *argv[],
 
 				set_ps_display("idle", false);
 				pgstat_report_activity(STATE_IDLE, NULL);
+
+				/* Start the idle memory reclaim timer */
+				if (IdleMemoryReclaimDelay > 0)
+				{
+					disable_idle_memory_reclaim_timeout = true;
+					enable_timeout_after(IDLE_MEMORY_RECLAIM_TIMEOUT,
+										 IdleMemoryReclaimDelay);
+				}
 			}
 
 			ReadyForQuery(whereToSendOutput);
 			send_ready_for_query = false;
+
+			/* Report how long it took to get here the first time */
+			if (!connection_startup_reported && MyProcPort != NULL)
+			{
+				pgstat_report_connection_startup(MyProcPort,
+												 GetCurrentTimestamp());
+				connection_startup_reported = true;
+			}
 		}
 
 		/*
@@ -4084,6 +4252,30 @@ PostgresMain(int argc, char *argv[],
 		 */
 		DoingCommandRead = true;
 
+		/*
+		 * (2b) In a session pool worker, pick the session to serve next.
+		 * This is only possible between transactions.  A session that has
+		 * just been received needs to be sent ReadyForQuery first.
+		 */
+		if (IsSessionPoolWorker() && !ignore_till_sync &&
+			!IsTransactionOrTransactionBlock())
+		{
+			bool		started;
+
+			if (SessionPoolSchedule(&started))
+			{
+				/* The unnamed statement belonged to the previous session */
+				drop_unnamed_stmt();
+
+				if (started)
+				{
+					DoingCommandRead = false;
+					send_ready_for_query = true;
+					continue;
+				}
+			}
+		}
+
 		/*
 		 * (3) read a command (loop blocks here)
 		 */
@@ -4102,13 +4294,19 @@ PostgresMain(int argc, char *argv[],
 		DoingCommandRead = false;
 
 		/*
-		 * (5) turn off the idle-in-transaction timeout
+		 * (5) turn off the idle-in-transaction and idle memory reclaim
+		 * timeouts
 		 */
 		if (disable_idle_in_transaction_timeout)
 		{
 			disable_timeout(IDLE_IN_TRANSACTION_SESSION_TIMEOUT, false);
 			disable_idle_in_transaction_timeout = false;
 		}
+		if (disable_idle_memory_reclaim_timeout)
+		{
+			disable_timeout(IDLE_MEMORY_RECLAIM_TIMEOUT, false);
+			disable_idle_memory_reclaim_timeout = false;
+		}
 
 		/*
 		 * (6) check for any other interesting events that happened while we
@@ -4348,6 +4546,22 @@ PostgresMain(int argc, char *argv[],
 				if (whereToSendOutput == DestRemote)
 					whereToSendOutput = DestNone;
 
+				/*
+				 * A session pool worker just forgets about the session, and
+				 * goes on serving its other sessions.
+				 */
+				if (IsSessionPoolWorker())
+				{
+					/* SocketBackend returns EOF with cancel still held off */
+					if (firstchar == EOF)
+						RESUME_CANCEL_INTERRUPTS();
+					AbortOutOfAnyTransaction();
+					xact_started = false;
+					ignore_till_sync = false;
+					SessionPoolCloseSession();
+					break;
+				}
+
 				/*
 				 * NOTE: if you are tempted to add more code here, DON'T!
 				 * Whatever you had in mind to do should be set up as an
@@ -4369,7 +4583,7 @@ PostgresMain(int argc, char *argv[],
 				break;
 
 			default:
-				ereport(FATAL,
+				ereport(SessionPoolTerminateLevel(),
 						(errcode(ERRCODE_PROTOCOL_VIOLATION),
 						 errmsg("invalid frontend message type %d",
 								firstchar)));
@@ -26,6 +26,7 @@
 #include "storage/proc.h"
 #include "storage/procarray.h"
 #include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/inet.h"
 #include "utils/timestamp.h"
@@ -1882,3 +1883,90 @@ pg_stat_get_archiver(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(HeapTupleGetDatum(
 									  heap_form_tuple(tupdesc, values, nulls)));
 }
+
+/*
+ * Returns statistics about the phases of connection startup, one row per
+ * phase.  Names are indexed by PgStat_ConnStartupPhase.
+ */
+Datum
+pg_stat_get_connection_startup(PG_FUNCTION_ARGS)
+{
+#define PG_STAT_GET_CONNECTION_STARTUP_COLS	5
+	static const char *const phase_names[CONN_STARTUP_NUM_PHASES] = {
+		"fork",
+		"ssl",
+		"authentication",
+		"initialization",
+		"ready_for_query",
+		"total"
+	};
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	PgStat_ConnStartupStats *stats;
+	int			i;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Get statistics about connection startup */
+	stats = pgstat_fetch_stat_connstartup();
+
+	for (i = 0; i < CONN_STARTUP_NUM_PHASES; i++)
+	{
+		Datum		values[PG_STAT_GET_CONNECTION_STARTUP_COLS];
+		bool		nulls[PG_STAT_GET_CONNECTION_STARTUP_COLS];
+		Datum		buckets[CONN_STARTUP_HIST_BUCKETS];
+		int			j;
+
+		MemSet(values, 0, sizeof(values));
+		MemSet(nulls, 0, sizeof(nulls));
+
+		for (j = 0; j < CONN_STARTUP_HIST_BUCKETS; j++)
+			buckets[j] = Int64GetDatum(stats->histogram[i][j]);
+
+		values[0] = CStringGetTextDatum(phase_names[i]);
+		values[1] = Int64GetDatum(stats->count[i]);
+		/* convert microseconds to milliseconds */
+		values[2] = Float8GetDatum(((double) stats->total_time[i]) / 1000.0);
+		values[3] = PointerGetDatum(construct_array(buckets,
+													CONN_STARTUP_HIST_BUCKETS,
+													INT8OID, sizeof(int64),
+													FLOAT8PASSBYVAL, 'd'));
+		if (stats->stat_reset_timestamp == 0)
+			nulls[4] = true;
+		else
+			values[4] = TimestampTzGetDatum(stats->stat_reset_timestamp);
+
+		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
@@ -25,9 +25,7 @@
 #include "catalog/pg_operator.h"
 #include "catalog/pg_type.h"
 #include "miscadmin.h"
-#ifdef CATCACHE_STATS
-#include "storage/ipc.h"		/* for on_proc_exit */
-#endif
+#include "storage/ipc.h"
 #include "storage/lmgr.h"
 #include "utils/builtins.h"
 #include "utils/datum.h"
@@ -37,6 +35,7 @@
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
+#include "utils/sharedcatcache.h"
 #include "utils/syscache.h"
 #include "utils/tqual.h"
 
@@ -101,9 +100,11 @@ static void CatCacheRemoveCTup(CatCache *cache, CatCTup *ct);
 static void CatCacheRemoveCList(CatCache *cache, CatCList *cl);
 static void CatalogCacheInitializeCache(CatCache *cache);
 static CatCTup *CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
+						dsa_pointer shared_tuple,
 						Datum *arguments,
 						uint32 hashValue, Index hashIndex,
 						bool negative);
+static void CatCacheReleaseSharedTuples(int code, Datum arg);
 
 static void CatCacheFreeKeys(TupleDesc tupdesc, int nkeys, int *attnos,
 				 Datum *keys);
@@ -498,6 +499,9 @@ CatCacheRemoveCTup(CatCache *cache, CatCTup *ct)
 		CatCacheFreeKeys(cache->cc_tupdesc, cache->cc_nkeys,
 						 cache->cc_keyno, ct->keys);
 
+	if (DsaPointerIsValid(ct->shared_tuple))
+		SharedCatCacheRelease(ct->shared_tuple);
+
 	pfree(ct);
 
 	--cache->cc_ntup;
@@ -718,6 +722,96 @@ ResetCatalogCaches(void)
 	CACHE1_elog(DEBUG2, "end of ResetCatalogCaches call");
 }
 
+/*
+ *		CatalogCacheShrink
+ *
+ * Remove the entries and lists of all caches that haven't been searched for
+ * since the last call, and aren't referenced.  This is used to give back
+ * memory after a session has been idle for a while; the entries that are
+ * still in use are those looked up since the previous time it was idle.
+ */
+void
+CatalogCacheShrink(void)
+{
+	slist_iter	iter;
+
+	CACHE1_elog(DEBUG2, "CatalogCacheShrink called");
+
+	slist_foreach(iter, &CacheHdr->ch_caches)
+	{
+		CatCache   *cache = slist_container(CatCache, cc_next, iter.cur);
+		dlist_mutable_iter citer;
+		int			i;
+
+		/* Lists first, since they keep their members from being removed */
+		dlist_foreach_modify(citer, &cache->cc_lists)
+		{
+			CatCList   *cl = dlist_container(CatCList, cache_elem, citer.cur);
+
+			if (cl->refcount == 0 && !cl->recently_used)
+				CatCacheRemoveCList(cache, cl);
+			else
+				cl->recently_used = false;
+		}
+
+		for (i = 0; i < cache->cc_nbuckets; i++)
+		{
+			dlist_head *bucket = &cache->cc_bucket[i];
+
+			dlist_foreach_modify(citer, bucket)
+			{
+				CatCTup    *ct = dlist_container(CatCTup, cache_elem, citer.cur);
+
+				if (ct->refcount == 0 && ct->c_list == NULL &&
+					!ct->recently_used)
+					CatCacheRemoveCTup(cache, ct);
+				else
+					ct->recently_used = false;
+			}
+		}
+	}
+
+	CACHE1_elog(DEBUG2, "end of CatalogCacheShrink call");
+}
+
+/*
+ *		CatCacheReleaseSharedTuples
+ *
+ * Drop the references our entries hold to tuples in the shared catalog
+ * cache, so that those can be freed once no one else uses them.  This is an
+ * on_shmem_exit callback, registered when we first take a tuple from the
+ * shared cache; the entries are marked dead, since their tuples may be gone
+ * at any moment afterwards.
+ */
+static void
+CatCacheReleaseSharedTuples(int code, Datum arg)
+{
+	slist_iter	iter;
+
+	slist_foreach(iter, &CacheHdr->ch_caches)
+	{
+		CatCache   *cache = slist_container(CatCache, cc_next, iter.cur);
+		int			i;
+
+		for (i = 0; i < cache->cc_nbuckets; i++)
+		{
+			dlist_iter	citer;
+
+			dlist_foreach(citer, &cache->cc_bucket[i])
+			{
+				CatCTup    *ct = dlist_container(CatCTup, cache_elem, citer.cur);
+
+				if (DsaPointerIsValid(ct->shared_tuple))
+				{
+					SharedCatCacheRelease(ct->shared_tuple);
+					ct->shared_tuple = InvalidDsaPointer;
+					ct->dead = true;
+				}
+			}
+		}
+	}
+}
+
 /*
  *		CatalogCacheFlushCatalog
  *
@@ -1281,6 +1375,7 @@ SearchCatCacheInternal(CatCache *cache,
 		 * near the front of the hashbucket's list.)
 		 */
 		dlist_move_head(bucket, &ct->cache_elem);
+		ct->recently_used = true;
 
 		/*
 		 * If it's a positive entry, bump its refcount and return it. If it's
@@ -1340,6 +1435,10 @@ SearchCatCacheMiss(CatCache *cache,
 	HeapTuple	ntp;
 	CatCTup    *ct;
 	Datum		arguments[CATCACHE_MAXKEYS];
+	HeapTupleData stuple;
+	dsa_pointer shared_tuple;
+	uint64		shared_generation;
+	static bool shared_exit_registered = false;
 
 	/* Initialize local parameter array */
 	arguments[0] = v1;
@@ -1347,6 +1446,41 @@ SearchCatCacheMiss(CatCache *cache,
 	arguments[2] = v3;
 	arguments[3] = v4;
 
+	/*
+	 * If some other backend has loaded the tuple into the shared catalog
+	 * cache, use it from there rather than reading the relation.
+	 */
+	shared_tuple = SharedCatCacheSearch(cache, hashValue, arguments, &stuple);
+	if (DsaPointerIsValid(shared_tuple))
+	{
+		/* Our entries' references must be dropped before we go away */
+		if (!shared_exit_registered)
+		{
+			on_shmem_exit(CatCacheReleaseSharedTuples, 0);
+			shared_exit_registered = true;
+		}
+
+		ct = CatalogCacheCreateEntry(cache, &stuple, shared_tuple, arguments,
+									 hashValue, hashIndex,
+									 false);
+		/* immediately set the refcount to 1 */
+		ResourceOwnerEnlargeCatCacheRefs(CurrentResourceOwner);
+		ct->refcount++;
+		ResourceOwnerRememberCatCacheRef(CurrentResourceOwner, &ct->tuple);
+
+		CACHE3_elog(DEBUG2, "SearchCatCache(%s): put shared tuple in bucket %d",
+					cache->cc_relname, hashIndex);
+
+#ifdef CATCACHE_STATS
+		cache->cc_newloads++;
+#endif
+
+		return &ct->tuple;
+	}
+
+	/* This must come before the relation is read; see sharedcatcache.c */
+	shared_generation = SharedCatCacheBeginLoad();
+
 	/*
 	 * Ok, need to make a lookup in the relation, copy the scankey and fill
 	 * out any per-call fields.
@@ -1385,8 +1519,8 @@ SearchCatCacheMiss(CatCache *cache,
 
 	while (HeapTupleIsValid(ntp = systable_getnext(scandesc)))
 	{
-		ct = CatalogCacheCreateEntry(cache, ntp, arguments,
-									 hashValue, hashIndex,
+		ct = CatalogCacheCreateEntry(cache, ntp, InvalidDsaPointer,
+									 arguments, hashValue, hashIndex,
 									 false);
 		/* immediately set the refcount to 1 */
 		ResourceOwnerEnlargeCatCacheRefs(CurrentResourceOwner);
@@ -1399,6 +1533,11 @@ SearchCatCacheMiss(CatCache *cache,
 
 	heap_close(relation, AccessShareLock);
 
+	/* Let other backends have the tuple, too */
+	if (ct != NULL)
+		SharedCatCacheInsert(cache, hashValue, arguments, &ct->tuple,
+							 shared_generation);
+
 	/*
 	 * If tuple was not found, we need to build a negative cache entry
 	 * containing a fake tuple.  The fake tuple has the correct key columns,
@@ -1414,8 +1553,8 @@ SearchCatCacheMiss(CatCache *cache,
 		if (IsBootstrapProcessingMode())
 			return NULL;
 
-		ct = CatalogCacheCreateEntry(cache, NULL, arguments,
-									 hashValue, hashIndex,
+		ct = CatalogCacheCreateEntry(cache, NULL, InvalidDsaPointer,
+									 arguments, hashValue, hashIndex,
 									 true);
 
 		CACHE4_elog(DEBUG2, "SearchCatCache(%s): Contains %d/%d tuples",
@@ -1599,6 +1738,7 @@ SearchCatCacheList(CatCache *cache,
 		 * individually.)
 		 */
 		dlist_move_head(&cache->cc_lists, &cl->cache_elem);
+		cl->recently_used = true;
 
 		/* Bump the list's refcount and return it */
 		ResourceOwnerEnlargeCatCacheListRefs(CurrentResourceOwner);
@@ -1699,8 +1839,8 @@ SearchCatCacheList(CatCache *cache,
 			if (!found)
 			{
 				/* We didn't find a usable entry, so make a new one */
-				ct = CatalogCacheCreateEntry(cache, ntp, arguments,
-											 hashValue, hashIndex,
+				ct = CatalogCacheCreateEntry(cache, ntp, InvalidDsaPointer,
+											 arguments, hashValue, hashIndex,
 											 false);
 			}
 
@@ -1760,6 +1900,7 @@ SearchCatCacheList(CatCache *cache,
 	cl->refcount = 0;			/* for the moment */
 	cl->dead = false;
 	cl->ordered = ordered;
+	cl->recently_used = true;
 	cl->nkeys = nkeys;
 	cl->hash_value = lHashValue;
 	cl->n_members = nmembers;
@@ -1818,9 +1959,14 @@ ReleaseCatCacheList(CatCList *list)
  * CatalogCacheCreateEntry
  *		Create a new CatCTup entry, copying the given HeapTuple and other
  *		supplied data into it.  The new entry initially has refcount 0.
+ *
+ * If shared_tuple is valid, ntp is the tuple of that shared catalog cache
+ * entry, and the new entry refers to it instead of copying it.  The new
+ * entry takes over the caller's reference to the shared tuple.
  */
 static CatCTup *
-CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
+CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp,
+						dsa_pointer shared_tuple, Datum *arguments,
 						uint32 hashValue, Index hashIndex,
 						bool negative)
 {
@@ -1829,7 +1975,33 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
 	MemoryContext oldcxt;
 
 	/* negative entries have no tuple associated */
-	if (ntp)
+	if (ntp && DsaPointerIsValid(shared_tuple))
+	{
+		int			i;
+
+		Assert(!negative);
+		/* shared tuples are flattened already */
+		Assert(!HeapTupleHasExternal(ntp));
+
+		ct = (CatCTup *) MemoryContextAlloc(CacheMemoryContext,
+											sizeof(CatCTup));
+		ct->tuple = *ntp;
+
+		/* extract keys - they'll point into the shared tuple */
+		for (i = 0; i < cache->cc_nkeys; i++)
+		{
+			Datum		atp;
+			bool		isnull;
+
+			atp = heap_getattr(&ct->tuple,
+							   cache->cc_keyno[i],
+							   cache->cc_tupdesc,
+							   &isnull);
+			Assert(!isnull);
+			ct->keys[i] = atp;
+		}
+	}
+	else if (ntp)
 	{
 		int			i;
 
@@ -1901,10 +2073,12 @@ CatalogCacheCreateEntry(CatCache *cache, HeapTuple ntp, Datum *arguments,
 	 */
 	ct->ct_magic = CT_MAGIC;
 	ct->my_cache = cache;
+	ct->shared_tuple = shared_tuple;
 	ct->c_list = NULL;
 	ct->refcount = 0;			/* for the moment */
 	ct->dead = false;
 	ct->negative = negative;
+	ct->recently_used = true;
 	ct->hash_value = hashValue;
 
 	dlist_push_head(&cache->cc_bucket[hashIndex], &ct->cache_elem);
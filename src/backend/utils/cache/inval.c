@@ -741,6 +741,19 @@ PrepareInvalidationState(void)
 	transInvalInfo = myInfo;
 }
 
+/*
+ * HavePendingInvalidations
+ *		Has the current transaction registered any invalidations?
+ *
+ * If so, it has changed catalog contents in ways that other backends can't
+ * see yet.
+ */
+bool
+HavePendingInvalidations(void)
+{
+	return transInvalInfo != NULL;
+}
+
 /*
  * PostPrepare_Inval
  *		Clean up after successful PREPARE.
@@ -19,6 +19,11 @@
  * re-planning if the active search_path is different from the previous time
  * or, if RLS is involved, if the user changes or the RLS environment changes.
  *
+ * When shared_plan_cache_size is set, generic plans are also shared between
+ * sessions through sharedplancache.c: before building a generic plan, we
+ * look there for one that another session has built for the same query
+ * trees, and we offer the generic plans we build ourselves.
+ *
  * Note that if the sinval was a result of user DDL actions, parse analysis
  * could throw an error, for example if a column referenced by the query is
  * no longer present.  Another possibility is for the query's output tupdesc
@@ -67,6 +72,7 @@
 #include "utils/memutils.h"
 #include "utils/resowner_private.h"
 #include "utils/rls.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 
@@ -93,6 +99,15 @@ static List *RevalidateCachedQuery(CachedPlanSource *plansource,
 static bool CheckCachedPlan(CachedPlanSource *plansource);
 static CachedPlan *BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 				ParamListInfo boundParams, QueryEnvironment *queryEnv);
+static CachedPlan *MakeCachedPlan(CachedPlanSource *plansource, List *plist,
+			   MemoryContext plan_context);
+static void LinkGenericPlan(CachedPlanSource *plansource, CachedPlan *plan);
+static bool PlanSourceIsShareable(CachedPlanSource *plansource,
+					  QueryEnvironment *queryEnv);
+static bool UseSharedGenericPlan(CachedPlanSource *plansource,
+					 QueryEnvironment *queryEnv);
+static void ShareGenericPlan(CachedPlanSource *plansource, CachedPlan *plan,
+				 uint64 generation);
 static bool choose_custom_plan(CachedPlanSource *plansource,
 				   ParamListInfo boundParams);
 static double cached_plan_cost(CachedPlan *plan, bool include_planner);
@@ -885,10 +900,8 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	CachedPlan *plan;
 	List	   *plist;
 	bool		snapshot_set;
-	bool		is_transient;
 	MemoryContext plan_context;
 	MemoryContext oldcxt = CurrentMemoryContext;
-	ListCell   *lc;
 
 	/*
 	 * Normally the querytree should be valid already, but if it's not,
@@ -964,10 +977,27 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	else
 		plan_context = CurrentMemoryContext;
 
-	/*
-	 * Create and fill the CachedPlan struct within the new context.
-	 */
-	plan = (CachedPlan *) palloc(sizeof(CachedPlan));
+	plan = MakeCachedPlan(plansource, plist, plan_context);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return plan;
+}
+
+/*
+ * MakeCachedPlan: create the CachedPlan struct for a list of PlannedStmts.
+ *
+ * The struct is created in plan_context, which must also contain plist.
+ */
+static CachedPlan *
+MakeCachedPlan(CachedPlanSource *plansource, List *plist,
+			   MemoryContext plan_context)
+{
+	CachedPlan *plan;
+	bool		is_transient;
+	ListCell   *lc;
+
+	plan = (CachedPlan *) MemoryContextAlloc(plan_context, sizeof(CachedPlan));
 	plan->magic = CACHEDPLAN_MAGIC;
 	plan->stmt_list = plist;
 
@@ -1003,13 +1033,169 @@ BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 	plan->is_oneshot = plansource->is_oneshot;
 	plan->is_saved = false;
 	plan->is_valid = true;
+	plan->recently_used = false;
 
 	/* assign generation number to new plan */
 	plan->generation = ++(plansource->generation);
 
+	return plan;
+}
+
+/*
+ * LinkGenericPlan: install a new generic plan in its plansource.
+ *
+ * Any previous generic plan must have been released already.
+ */
+static void
+LinkGenericPlan(CachedPlanSource *plansource, CachedPlan *plan)
+{
+	Assert(plansource->gplan == NULL);
+
+	plansource->gplan = plan;
+	plan->refcount++;
+	/* Immediately reparent into appropriate context */
+	if (plansource->is_saved)
+	{
+		/* saved plans all live under CacheMemoryContext */
+		MemoryContextSetParent(plan->context, CacheMemoryContext);
+		plan->is_saved = true;
+	}
+	else
+	{
+		/* otherwise, it should be a sibling of the plansource */
+		MemoryContextSetParent(plan->context,
+							   MemoryContextGetParent(plansource->context));
+	}
+}
+
+/*
+ * PlanSourceIsShareable: can the generic plan go in the shared plan cache?
+ *
+ * Caller must have already called RevalidateCachedQuery.
+ */
+static bool
+PlanSourceIsShareable(CachedPlanSource *plansource, QueryEnvironment *queryEnv)
+{
+	ListCell   *lc;
+
+	if (shared_plan_cache_size == 0)
+		return false;
+
+	/* Ephemeral named relations are private to this session */
+	if (queryEnv != NULL)
+		return false;
+
+	/* Utility statements can't be read back from text */
+	foreach(lc, plansource->query_list)
+	{
+		Query	   *query = lfirst_node(Query, lc);
+
+		if (query->commandType == CMD_UTILITY)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * UseSharedGenericPlan: adopt a generic plan that another session built.
+ *
+ * If the shared plan cache has a plan for the plansource's current query
+ * trees, it is installed as the generic plan and checked like a plan of our
+ * own with CheckCachedPlan.  On a "true" return, we have acquired the locks
+ * needed to run the plan.
+ */
+static bool
+UseSharedGenericPlan(CachedPlanSource *plansource, QueryEnvironment *queryEnv)
+{
+	char	   *planstr;
+	MemoryContext plan_context;
+	MemoryContext oldcxt;
+	List	   *plist;
+	ListCell   *lc1;
+	ListCell   *lc2;
+
+	Assert(plansource->is_valid);
+	Assert(plansource->gplan == NULL);
+
+	if (!PlanSourceIsShareable(plansource, queryEnv))
+		return false;
+
+	planstr = SharedPlanCacheSearch(nodeToString(plansource->query_list),
+									plansource->cursor_options);
+	if (planstr == NULL)
+		return false;
+
+	plan_context = AllocSetContextCreate(CurrentMemoryContext,
+										 "CachedPlan",
+										 ALLOCSET_START_SMALL_SIZES);
+	MemoryContextCopyAndSetIdentifier(plan_context, plansource->query_string);
+
+	oldcxt = MemoryContextSwitchTo(plan_context);
+	plist = (List *) stringToNode(planstr);
 	MemoryContextSwitchTo(oldcxt);
+	pfree(planstr);
 
-	return plan;
+	/* Statement locations don't survive the trip through text */
+	Assert(list_length(plist) == list_length(plansource->query_list));
+	forboth(lc1, plist, lc2, plansource->query_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc1);
+		Query	   *query = lfirst_node(Query, lc2);
+
+		plannedstmt->stmt_location = query->stmt_location;
+		plannedstmt->stmt_len = query->stmt_len;
+	}
+
+	LinkGenericPlan(plansource, MakeCachedPlan(plansource, plist,
+											   plan_context));
+	/* Only plans that don't depend on the snapshot are shared */
+	Assert(!TransactionIdIsValid(plansource->gplan->saved_xmin));
+
+	if (!CheckCachedPlan(plansource))
+		return false;
+
+	elog(DEBUG2, "using generic plan from shared plan cache");
+	return true;
+}
+
+/*
+ * ShareGenericPlan: offer a generic plan we built to other sessions.
+ *
+ * generation is what SharedPlanCacheBeginLoad returned before planning.
+ */
+static void
+ShareGenericPlan(CachedPlanSource *plansource, CachedPlan *plan,
+				 uint64 generation)
+{
+	List	   *relationOids;
+	List	   *invalItems;
+	ListCell   *lc;
+
+	/* A transient plan is only good for this session's snapshot */
+	if (TransactionIdIsValid(plan->saved_xmin))
+		return;
+
+	/* The plan depends on whatever its query trees depend on, too */
+	relationOids = list_copy(plansource->relationOids);
+	invalItems = list_copy(plansource->invalItems);
+	foreach(lc, plan->stmt_list)
+	{
+		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc);
+
+		relationOids = list_concat_unique_oid(relationOids,
+											  plannedstmt->relationOids);
+		invalItems = list_concat(invalItems,
+								 list_copy(plannedstmt->invalItems));
+	}
+
+	SharedPlanCacheInsert(nodeToString(plansource->query_list),
+						  plansource->cursor_options,
+						  nodeToString(plan->stmt_list),
+						  relationOids, invalItems, generation);
+
+	list_free(relationOids);
+	list_free(invalItems);
 }
 
 /*
@@ -1162,28 +1348,37 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 			plan = plansource->gplan;
 			Assert(plan->magic == CACHEDPLAN_MAGIC);
 		}
+		else if (UseSharedGenericPlan(plansource, queryEnv))
+		{
+			/* Another session had already built the generic plan we want */
+			plan = plansource->gplan;
+			plansource->generic_cost = cached_plan_cost(plan, false);
+
+			/*
+			 * As below, we may find out only now that a custom plan would be
+			 * better.  Then we don't need the locks that CheckCachedPlan took
+			 * for the generic plan.
+			 */
+			customplan = choose_custom_plan(plansource, boundParams);
+			if (customplan)
+				AcquireExecutorLocks(plan->stmt_list, false);
+		}
 		else
 		{
+			uint64		shared_generation = 0;
+
+			/* Other sessions can use the plan, if it is current enough */
+			if (PlanSourceIsShareable(plansource, queryEnv))
+				shared_generation = SharedPlanCacheBeginLoad();
+
 			/* Build a new generic plan */
 			plan = BuildCachedPlan(plansource, qlist, NULL, queryEnv);
 			/* Just make real sure plansource->gplan is clear */
 			ReleaseGenericPlan(plansource);
 			/* Link the new generic plan into the plansource */
-			plansource->gplan = plan;
-			plan->refcount++;
-			/* Immediately reparent into appropriate context */
-			if (plansource->is_saved)
-			{
-				/* saved plans all live under CacheMemoryContext */
-				MemoryContextSetParent(plan->context, CacheMemoryContext);
-				plan->is_saved = true;
-			}
-			else
-			{
-				/* otherwise, it should be a sibling of the plansource */
-				MemoryContextSetParent(plan->context,
-									   MemoryContextGetParent(plansource->context));
-			}
+			LinkGenericPlan(plansource, plan);
+			if (shared_generation != 0)
+				ShareGenericPlan(plansource, plan, shared_generation);
 			/* Update generic_cost whenever we make a new generic plan */
 			plansource->generic_cost = cached_plan_cost(plan, false);
 
@@ -1222,6 +1417,7 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 	Assert(plan != NULL);
 
 	/* Flag the plan as in use by caller */
+	plan->recently_used = true;
 	if (useResOwner)
 		ResourceOwnerEnlargePlanCacheRefs(CurrentResourceOwner);
 	plan->refcount++;
@@ -1856,6 +2052,32 @@ PlanCacheSysCallback(Datum arg, int cacheid, uint32 hashvalue)
 	ResetPlanCache();
 }
 
+/*
+ * PlanCacheShrink: release generic plans not used since the last call.
+ *
+ * This is used to give back memory after the session has been idle for a
+ * while.  The plans are rebuilt if the statements are executed again; the
+ * analyzed query trees are kept.
+ */
+void
+PlanCacheShrink(void)
+{
+	CachedPlanSource *plansource;
+
+	for (plansource = first_saved_plan; plansource; plansource = plansource->next_saved)
+	{
+		Assert(plansource->magic == CACHEDPLANSOURCE_MAGIC);
+
+		if (plansource->gplan == NULL)
+			continue;
+
+		if (plansource->gplan->recently_used)
+			plansource->gplan->recently_used = false;
+		else
+			ReleaseGenericPlan(plansource);
+	}
+}
+
 /*
  * ResetPlanCache: invalidate all cached plans.
  */
@@ -1078,6 +1078,48 @@ RelationBuildPartitionKey(Relation relation)
 	relation->rd_partkey = key;
 }
 
+/*
+ * RelationGetPartitionKey -- get partition key, if relation is partitioned
+ *
+ * The key is built the first time it's asked for rather than along with the
+ * rest of the relcache entry, since many uses of a partitioned table never
+ * need it.
+ */
+PartitionKey
+RelationGetPartitionKey(Relation rel)
+{
+	if (rel->rd_rel->relkind != RELKIND_PARTITIONED_TABLE)
+		return NULL;
+
+	if (unlikely(rel->rd_partkey == NULL))
+		RelationBuildPartitionKey(rel);
+
+	return rel->rd_partkey;
+}
+
+/*
+ * RelationGetPartitionDesc -- get partition descriptor, if relation is
+ *		partitioned
+ *
+ * Like the partition key, the descriptor is built when first asked for.
+ * That matters more, since building it means reading the bounds of all
+ * partitions: opening a partition, for instance to check a row inserted
+ * into it against its partition constraint, only needs the parent's key.
+ * Once built, the descriptor is kept across rebuilds of the entry unless the
+ * set of partitions changes; see RelationClearRelation.
+ */
+PartitionDesc
+RelationGetPartitionDesc(Relation rel)
+{
+	if (rel->rd_rel->relkind != RELKIND_PARTITIONED_TABLE)
+		return NULL;
+
+	if (unlikely(rel->rd_partdesc == NULL))
+		RelationBuildPartitionDesc(rel);
+
+	return rel->rd_partdesc;
+}
+
 /*
  *		equalRuleLocks
  *
@@ -1387,19 +1429,11 @@ RelationBuildDesc(Oid targetRelId, bool insertIt)
 	relation->rd_fkeylist = NIL;
 	relation->rd_fkeyvalid = false;
 
-	/* if a partitioned table, initialize key and partition descriptor info */
-	if (relation->rd_rel->relkind == RELKIND_PARTITIONED_TABLE)
-	{
-		RelationBuildPartitionKey(relation);
-		RelationBuildPartitionDesc(relation);
-	}
-	else
-	{
-		relation->rd_partkeycxt = NULL;
-		relation->rd_partkey = NULL;
-		relation->rd_partdesc = NULL;
-		relation->rd_pdcxt = NULL;
-	}
+	/* partitioning data is not loaded till asked for */
+	relation->rd_partkeycxt = NULL;
+	relation->rd_partkey = NULL;
+	relation->rd_partdesc = NULL;
+	relation->rd_pdcxt = NULL;
 
 	/*
 	 * if it's an index, initialize index-related information
@@ -2137,6 +2171,7 @@ RelationIdGetRelation(Oid relationId)
 				RelationClearRelation(rd, true);
 			Assert(rd->rd_isvalid);
 		}
+		rd->rd_recently_used = true;
 		return rd;
 	}
 
@@ -2146,7 +2181,10 @@ RelationIdGetRelation(Oid relationId)
 	 */
 	rd = RelationBuildDesc(relationId, true);
 	if (RelationIsValid(rd))
+	{
 		RelationIncrementReferenceCount(rd);
+		rd->rd_recently_used = true;
+	}
 	return rd;
 }
 
@@ -2606,6 +2644,14 @@ RelationClearRelation(Relation relation, bool rebuild)
 		keep_rules = equalRuleLocks(relation->rd_rules, newrel->rd_rules);
 		keep_policies = equalRSDesc(relation->rd_rsdesc, newrel->rd_rsdesc);
 		keep_partkey = (relation->rd_partkey != NULL);
+
+		/*
+		 * The partition descriptor is normally only built when asked for, but
+		 * if the old entry has one, someone may be holding a pointer to it.
+		 * Build the new one now, so we can keep the old if it's unchanged.
+		 */
+		if (relation->rd_partdesc != NULL)
+			RelationBuildPartitionDesc(newrel);
 		keep_partdesc = equalPartitionDescs(relation->rd_partkey,
 											relation->rd_partdesc,
 											newrel->rd_partdesc);
@@ -2898,6 +2944,43 @@ RelationCacheInvalidate(void)
 	list_free(rebuildList);
 }
 
+/*
+ * RelationCacheShrink
+ *	 Blow away cached relation descriptors that have zero reference counts
+ *	 and haven't been opened since the last call.
+ *
+ *	 This is used to give back memory after the session has been idle for a
+ *	 while, so it is called outside any transaction; entries for relations
+ *	 created or given a new relfilenode in a transaction can't be around
+ *	 then, but we check anyway.  No catalog access or SI message processing
+ *	 happens here, so a single pass is safe.
+ */
+void
+RelationCacheShrink(void)
+{
+	HASH_SEQ_STATUS status;
+	RelIdCacheEnt *idhentry;
+
+	hash_seq_init(&status, RelationIdCache);
+
+	while ((idhentry = (RelIdCacheEnt *) hash_seq_search(&status)) != NULL)
+	{
+		Relation	relation = idhentry->reldesc;
+
+		if (relation->rd_recently_used ||
+			!RelationHasReferenceCountZero(relation) ||
+			relation->rd_isnailed ||
+			relation->rd_createSubid != InvalidSubTransactionId ||
+			relation->rd_newRelfilenodeSubid != InvalidSubTransactionId)
+		{
+			relation->rd_recently_used = false;
+			continue;
+		}
+
+		RelationClearRelation(relation, false);
+	}
+}
+
 /*
  * RelationCloseSmgrByOid - close a relcache entry's smgr link
  *
@@ -3909,27 +3992,6 @@ RelationCacheInitializePhase3(void)
 			restart = true;
 		}
 
-		/*
-		 * Reload the partition key and descriptor for a partitioned table.
-		 */
-		if (relation->rd_rel->relkind == RELKIND_PARTITIONED_TABLE &&
-			relation->rd_partkey == NULL)
-		{
-			RelationBuildPartitionKey(relation);
-			Assert(relation->rd_partkey != NULL);
-
-			restart = true;
-		}
-
-		if (relation->rd_rel->relkind == RELKIND_PARTITIONED_TABLE &&
-			relation->rd_partdesc == NULL)
-		{
-			RelationBuildPartitionDesc(relation);
-			Assert(relation->rd_partdesc != NULL);
-
-			restart = true;
-		}
-
 		/* Release hold on the relation */
 		RelationDecrementReferenceCount(relation);
 
@@ -0,0 +1,620 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.c
+ *	  Catalog cache tier shared by all backends.
+ *
+ * Each backend's catcache is private, so every backend reads the same
+ * catalog tuples for itself, and keeps its own copy of them.  When
+ * shared_catcache_size is set, a backend that reads a tuple from a catalog
+ * also copies it into a hash table in shared memory, where any other
+ * backend that misses in its own catcache looks before scanning the
+ * catalog.  Only positive entries are shared; negative entries and lists
+ * stay private.  The tuples live in a DSA area created in place in the main
+ * shared memory segment, and limited to its size.  When the area fills up,
+ * everything in it is thrown away, and the tuples that are still in demand
+ * come back as backends miss on them.
+ *
+ * A backend that finds a tuple here doesn't copy it: its catcache entry
+ * points to the shared tuple, and holds a reference that keeps it in place
+ * until the entry is removed, even if the tuple has been thrown out of the
+ * hash table meanwhile.  Shared tuples are never changed, so that is safe.
+ * Each tuple has a reference count, which includes one reference for being
+ * in the hash table; whoever drops the last one frees the tuple.
+ *
+ * A shared entry must be removed before any backend could miss it in its
+ * own catcache because of the catalog change that made it stale; otherwise
+ * that backend would load the stale tuple right back.  So the backend that
+ * sends the invalidation messages for a change removes the entries they
+ * cover first, in SharedCatCacheBeginInvalidate, before the messages are
+ * queued.  A backend that loads a tuple from the catalog adds it to the
+ * table only if no invalidation was in progress when it started the load,
+ * and none has begun since: then it has processed every message sent so
+ * far, so the tuple it read is current, and any invalidation that starts
+ * later will remove it.  This is tracked with a generation counter that is
+ * bumped when each invalidation begins, and a count of invalidations in
+ * progress.
+ *
+ * A backend whose own transaction has changed catalogs sees tuples that no
+ * one else can, and during logical decoding catalogs are read as of some
+ * time in the past, so neither looks at the shared tier.
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedcatcache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "miscadmin.h"
+#include "port/atomics.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/dsa.h"
+#include "utils/dynahash.h"
+#include "utils/hashutils.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/sharedcatcache.h"
+#include "utils/snapmgr.h"
+
+
+/* Number of partition locks protecting the hash buckets */
+#define NUM_SHARED_CATCACHE_PARTITIONS	128
+
+/*
+ * A tuple in the shared tier.  The tuple data follows the struct, at a
+ * MAXALIGN'd offset, and is always flattened: catcache entries never
+ * contain out-of-line values.
+ */
+typedef struct SharedCatCTup
+{
+	dsa_pointer next;			/* next entry in the same bucket, if any */
+	Oid			dbid;			/* database, or InvalidOid if shared catalog */
+	Oid			reloid;			/* catalog the tuple came from */
+	int			cacheid;		/* catcache it was loaded for */
+	uint32		hash_value;		/* hash value of the cache keys */
+	ItemPointerData t_self;		/* location of the tuple in the catalog */
+	uint32		t_len;			/* length of the tuple data */
+	pg_atomic_uint32 refcount;	/* references, including the hash table's */
+} SharedCatCTup;
+
+#define SHARED_CTUP_DATA(e) \
+	((HeapTupleHeader) ((char *) (e) + MAXALIGN(sizeof(SharedCatCTup))))
+
+typedef struct SharedCatCacheControl
+{
+	pg_atomic_uint64 generation;	/* bumped when an invalidation begins */
+	pg_atomic_uint32 invalidating;	/* number of invalidations in progress */
+	pg_atomic_uint32 nentries;	/* number of tuples in the hash table */
+	int			nbuckets;		/* always a power of 2 */
+	LWLockPadded locks[NUM_SHARED_CATCACHE_PARTITIONS];
+	dsa_pointer buckets[FLEXIBLE_ARRAY_MEMBER];
+} SharedCatCacheControl;
+
+/* GUC variable */
+int			shared_catcache_size = 0;
+
+static SharedCatCacheControl *SharedCatCacheCtl = NULL;
+static void *SharedCatCachePlace = NULL;
+static dsa_area *SharedCatCacheArea = NULL;
+
+static int	SharedCatCacheBuckets(void);
+static dsa_area *GetSharedCatCacheArea(void);
+static bool SharedCatCacheUsable(void);
+static uint32 SharedCatCacheBucket(Oid dbid, int cacheid, uint32 hashValue);
+static bool SharedCTupMatches(CatCache *cache, HeapTuple tuple,
+				  Datum *arguments);
+static void SharedCTupUnref(dsa_area *area, dsa_pointer dp);
+static void SharedCatCacheRemove(Oid dbid, int cacheid, uint32 hashValue);
+static void SharedCatCachePurge(bool all, Oid dbid, Oid reloid);
+
+
+/*
+ * Number of hash buckets: about one for every 256 bytes of tuple space.
+ */
+static int
+SharedCatCacheBuckets(void)
+{
+	long		nbuckets = (long) shared_catcache_size * 1024L / 256;
+
+	return 1 << my_log2(Max(nbuckets, 1024));
+}
+
+/*
+ * Report shared memory space needed by SharedCatCacheShmemInit.
+ */
+Size
+SharedCatCacheShmemSize(void)
+{
+	Size		size;
+
+	if (shared_catcache_size == 0)
+		return 0;
+
+	size = add_size(offsetof(SharedCatCacheControl, buckets),
+					mul_size(SharedCatCacheBuckets(), sizeof(dsa_pointer)));
+	size = add_size(size, mul_size(shared_catcache_size, 1024));
+
+	return size;
+}
+
+/*
+ * Create the shared tier's hash table and tuple area in shared memory.
+ *
+ * As with the session state area, the tuple area is pinned, and the
+ * postmaster detaches from it right away.
+ */
+void
+SharedCatCacheShmemInit(void)
+{
+	Size		area_size = mul_size(shared_catcache_size, 1024);
+	int			nbuckets;
+	bool		found;
+
+	if (shared_catcache_size == 0)
+		return;
+
+	nbuckets = SharedCatCacheBuckets();
+	SharedCatCacheCtl = (SharedCatCacheControl *)
+		ShmemInitStruct("Shared Catcache",
+						add_size(offsetof(SharedCatCacheControl, buckets),
+								 mul_size(nbuckets, sizeof(dsa_pointer))),
+						&found);
+	SharedCatCachePlace = ShmemInitStruct("Shared Catcache Area",
+										  area_size, &found);
+	if (!found)
+	{
+		dsa_area   *area;
+		int			i;
+
+		pg_atomic_init_u64(&SharedCatCacheCtl->generation, 1);
+		pg_atomic_init_u32(&SharedCatCacheCtl->invalidating, 0);
+		pg_atomic_init_u32(&SharedCatCacheCtl->nentries, 0);
+		SharedCatCacheCtl->nbuckets = nbuckets;
+		for (i = 0; i < NUM_SHARED_CATCACHE_PARTITIONS; i++)
+			LWLockInitialize(&SharedCatCacheCtl->locks[i].lock,
+							 LWTRANCHE_SHARED_CATCACHE);
+		for (i = 0; i < nbuckets; i++)
+			SharedCatCacheCtl->buckets[i] = InvalidDsaPointer;
+
+		area = dsa_create_in_place(SharedCatCachePlace, area_size,
+								   LWTRANCHE_SHARED_CATCACHE_DSA, NULL);
+		/* never reach out for more memory than we were given */
+		dsa_set_size_limit(area, area_size);
+		dsa_pin(area);
+		dsa_release_in_place(SharedCatCachePlace);
+		dsa_detach(area);
+	}
+}
+
+/*
+ * Attach to the tuple area, if we haven't already.
+ */
+static dsa_area *
+GetSharedCatCacheArea(void)
+{
+	if (SharedCatCacheArea == NULL)
+	{
+		MemoryContext old_context;
+
+		Assert(SharedCatCachePlace != NULL);
+
+		old_context = MemoryContextSwitchTo(TopMemoryContext);
+		SharedCatCacheArea = dsa_attach_in_place(SharedCatCachePlace, NULL);
+		dsa_pin_mapping(SharedCatCacheArea);
+		on_shmem_exit(dsa_on_shmem_exit_release_in_place,
+					  PointerGetDatum(SharedCatCachePlace));
+		MemoryContextSwitchTo(old_context);
+	}
+
+	return SharedCatCacheArea;
+}
+
+/*
+ * Can the current backend use the shared tier right now?
+ */
+static bool
+SharedCatCacheUsable(void)
+{
+	return SharedCatCacheCtl != NULL &&
+		!IsBootstrapProcessingMode() &&
+		!HistoricSnapshotActive() &&
+		!HavePendingInvalidations();
+}
+
+static uint32
+SharedCatCacheBucket(Oid dbid, int cacheid, uint32 hashValue)
+{
+	uint32		hash;
+
+	hash = hash_combine(hashValue, murmurhash32((uint32) cacheid));
+	hash = hash_combine(hash, murmurhash32((uint32) dbid));
+
+	return hash & (SharedCatCacheCtl->nbuckets - 1);
+}
+
+#define SharedCatCachePartitionLock(bucket) \
+	(&SharedCatCacheCtl->locks[(bucket) % NUM_SHARED_CATCACHE_PARTITIONS].lock)
+
+/*
+ * Does a tuple have the given cache keys?  The caller has already checked
+ * the hash value.
+ */
+static bool
+SharedCTupMatches(CatCache *cache, HeapTuple tuple, Datum *arguments)
+{
+	int			i;
+
+	for (i = 0; i < cache->cc_nkeys; i++)
+	{
+		Datum		key;
+		bool		isnull;
+
+		key = heap_getattr(tuple, cache->cc_keyno[i], cache->cc_tupdesc,
+						   &isnull);
+		Assert(!isnull);
+		if (!(cache->cc_fastequal[i]) (key, arguments[i]))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Drop a reference to a shared tuple, and free it if that was the last one.
+ */
+static void
+SharedCTupUnref(dsa_area *area, dsa_pointer dp)
+{
+	SharedCatCTup *e = (SharedCatCTup *) dsa_get_address(area, dp);
+
+	if (pg_atomic_sub_fetch_u32(&e->refcount, 1) == 0)
+		dsa_free(area, dp);
+}
+
+/*
+ * Look for a tuple in the shared tier.
+ *
+ * If it is there, *tuple is set up to point to the shared copy, and the
+ * shared entry is returned with a reference held for the caller, who must
+ * drop it with SharedCatCacheRelease once done with the tuple.  Returns
+ * InvalidDsaPointer if the tuple is not there.
+ */
+dsa_pointer
+SharedCatCacheSearch(CatCache *cache, uint32 hashValue, Datum *arguments,
+					 HeapTuple tuple)
+{
+	Oid			dbid = cache->cc_relisshared ? InvalidOid : MyDatabaseId;
+	dsa_area   *area;
+	uint32		bucket;
+	LWLock	   *partitionLock;
+	dsa_pointer dp;
+
+	if (!SharedCatCacheUsable())
+		return InvalidDsaPointer;
+
+	area = GetSharedCatCacheArea();
+	bucket = SharedCatCacheBucket(dbid, cache->id, hashValue);
+	partitionLock = SharedCatCachePartitionLock(bucket);
+
+	LWLockAcquire(partitionLock, LW_SHARED);
+	for (dp = SharedCatCacheCtl->buckets[bucket];
+		 DsaPointerIsValid(dp);
+		 dp = ((SharedCatCTup *) dsa_get_address(area, dp))->next)
+	{
+		SharedCatCTup *e = (SharedCatCTup *) dsa_get_address(area, dp);
+
+		if (e->cacheid != cache->id || e->dbid != dbid ||
+			e->hash_value != hashValue)
+			continue;
+
+		tuple->t_len = e->t_len;
+		tuple->t_self = e->t_self;
+		tuple->t_tableOid = e->reloid;
+		tuple->t_data = SHARED_CTUP_DATA(e);
+		if (!SharedCTupMatches(cache, tuple, arguments))
+			continue;
+
+		/* the hash table's reference keeps it alive until we have ours */
+		pg_atomic_fetch_add_u32(&e->refcount, 1);
+		break;
+	}
+	LWLockRelease(partitionLock);
+
+	return dp;
+}
+
+/*
+ * Drop the reference to a shared tuple returned by SharedCatCacheSearch.
+ */
+void
+SharedCatCacheRelease(dsa_pointer entry)
+{
+	SharedCTupUnref(GetSharedCatCacheArea(), entry);
+}
+
+/*
+ * Get ready to load a tuple from a catalog, for SharedCatCacheInsert.
+ *
+ * Returns the generation to pass to SharedCatCacheInsert, or 0 if the tuple
+ * mustn't be added to the shared tier.  Pending invalidation messages are
+ * processed here, so that the catalog scan that follows sees at least every
+ * change that has been invalidated so far.
+ */
+uint64
+SharedCatCacheBeginLoad(void)
+{
+	uint64		generation;
+
+	if (!SharedCatCacheUsable())
+		return 0;
+
+	/* see SharedCatCacheBeginInvalidate for the other side of this */
+	generation = pg_atomic_read_u64(&SharedCatCacheCtl->generation);
+	pg_memory_barrier();
+	if (pg_atomic_read_u32(&SharedCatCacheCtl->invalidating) != 0)
+		return 0;
+
+	AcceptInvalidationMessages();
+
+	/* processing the messages may have changed catalogs we can't share */
+	if (!SharedCatCacheUsable())
+		return 0;
+
+	return generation;
+}
+
+/*
+ * Add a tuple that was just loaded from a catalog to the shared tier.
+ *
+ * "generation" is what SharedCatCacheBeginLoad returned before the catalog
+ * was scanned.  If an invalidation has begun since, the tuple may be stale
+ * already, so it is left out.
+ */
+void
+SharedCatCacheInsert(CatCache *cache, uint32 hashValue, Datum *arguments,
+					 HeapTuple tuple, uint64 generation)
+{
+	Oid			dbid = cache->cc_relisshared ? InvalidOid : MyDatabaseId;
+	dsa_area   *area;
+	uint32		bucket;
+	LWLock	   *partitionLock;
+	Size		size;
+	dsa_pointer newdp;
+	dsa_pointer dp;
+	SharedCatCTup *newe;
+
+	if (generation == 0)
+		return;
+
+	Assert(!HeapTupleHasExternal(tuple));
+
+	/* don't let a few huge tuples crowd out everything else */
+	size = MAXALIGN(sizeof(SharedCatCTup)) + tuple->t_len;
+	if (size > (Size) shared_catcache_size * 1024 / 64)
+		return;
+
+	area = GetSharedCatCacheArea();
+	newdp = dsa_allocate_extended(area, size, DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(newdp))
+	{
+		/*
+		 * Out of space; start over with what's in demand from now on.  If
+		 * the hash table is empty already, the space is all taken by tuples
+		 * that backends are using, and there's nothing to free until they
+		 * are done with them.
+		 */
+		if (pg_atomic_read_u32(&SharedCatCacheCtl->nentries) > 0)
+		{
+			elog(DEBUG1, "shared catalog cache is full, resetting it");
+			SharedCatCachePurge(true, InvalidOid, InvalidOid);
+		}
+		return;
+	}
+
+	newe = (SharedCatCTup *) dsa_get_address(area, newdp);
+	newe->dbid = dbid;
+	newe->reloid = cache->cc_reloid;
+	newe->cacheid = cache->id;
+	newe->hash_value = hashValue;
+	newe->t_self = tuple->t_self;
+	newe->t_len = tuple->t_len;
+	pg_atomic_init_u32(&newe->refcount, 1);
+	memcpy(SHARED_CTUP_DATA(newe), tuple->t_data, tuple->t_len);
+
+	bucket = SharedCatCacheBucket(dbid, cache->id, hashValue);
+	partitionLock = SharedCatCachePartitionLock(bucket);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	if (pg_atomic_read_u64(&SharedCatCacheCtl->generation) == generation)
+	{
+		/* another backend may have added the same tuple meanwhile */
+		for (dp = SharedCatCacheCtl->buckets[bucket];
+			 DsaPointerIsValid(dp);
+			 dp = ((SharedCatCTup *) dsa_get_address(area, dp))->next)
+		{
+			SharedCatCTup *e = (SharedCatCTup *) dsa_get_address(area, dp);
+			HeapTupleData etuple;
+
+			if (e->cacheid != cache->id || e->dbid != dbid ||
+				e->hash_value != hashValue)
+				continue;
+
+			etuple.t_len = e->t_len;
+			etuple.t_self = e->t_self;
+			etuple.t_tableOid = e->reloid;
+			etuple.t_data = SHARED_CTUP_DATA(e);
+			if (SharedCTupMatches(cache, &etuple, arguments))
+				break;
+		}
+
+		if (!DsaPointerIsValid(dp))
+		{
+			newe->next = SharedCatCacheCtl->buckets[bucket];
+			SharedCatCacheCtl->buckets[bucket] = newdp;
+			newdp = InvalidDsaPointer;
+			pg_atomic_fetch_add_u32(&SharedCatCacheCtl->nentries, 1);
+		}
+	}
+	LWLockRelease(partitionLock);
+
+	if (DsaPointerIsValid(newdp))
+		dsa_free(area, newdp);
+}
+
+/*
+ * Remove all tuples with the given cache id and hash value.
+ */
+static void
+SharedCatCacheRemove(Oid dbid, int cacheid, uint32 hashValue)
+{
+	dsa_area   *area = GetSharedCatCacheArea();
+	uint32		bucket = SharedCatCacheBucket(dbid, cacheid, hashValue);
+	LWLock	   *partitionLock = SharedCatCachePartitionLock(bucket);
+	dsa_pointer *link;
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	link = &SharedCatCacheCtl->buckets[bucket];
+	while (DsaPointerIsValid(*link))
+	{
+		dsa_pointer dp = *link;
+		SharedCatCTup *e = (SharedCatCTup *) dsa_get_address(area, dp);
+
+		if (e->cacheid == cacheid && e->dbid == dbid &&
+			e->hash_value == hashValue)
+		{
+			*link = e->next;
+			pg_atomic_fetch_sub_u32(&SharedCatCacheCtl->nentries, 1);
+			SharedCTupUnref(area, dp);
+		}
+		else
+			link = &e->next;
+	}
+	LWLockRelease(partitionLock);
+}
+
+/*
+ * Remove all tuples of a catalog in a database, or of all catalogs in a
+ * database if reloid is InvalidOid, or simply all tuples if "all" is set.
+ *
+ * This has to visit every bucket, but it's only needed for rare events.
+ * Partitions are locked one at a time, since removing tuples is always
+ * safe.
+ */
+static void
+SharedCatCachePurge(bool all, Oid dbid, Oid reloid)
+{
+	dsa_area   *area = GetSharedCatCacheArea();
+	int			partition;
+
+	for (partition = 0; partition < NUM_SHARED_CATCACHE_PARTITIONS; partition++)
+	{
+		LWLock	   *partitionLock = &SharedCatCacheCtl->locks[partition].lock;
+		int			bucket;
+
+		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+		for (bucket = partition;
+			 bucket < SharedCatCacheCtl->nbuckets;
+			 bucket += NUM_SHARED_CATCACHE_PARTITIONS)
+		{
+			dsa_pointer *link = &SharedCatCacheCtl->buckets[bucket];
+
+			while (DsaPointerIsValid(*link))
+			{
+				dsa_pointer dp = *link;
+				SharedCatCTup *e = (SharedCatCTup *) dsa_get_address(area, dp);
+
+				if (all ||
+					(e->dbid == dbid &&
+					 (!OidIsValid(reloid) || e->reloid == reloid)))
+				{
+					*link = e->next;
+					pg_atomic_fetch_sub_u32(&SharedCatCacheCtl->nentries, 1);
+					SharedCTupUnref(area, dp);
+				}
+				else
+					link = &e->next;
+			}
+		}
+		LWLockRelease(partitionLock);
+	}
+}
+
+/*
+ * Remove the tuples covered by invalidation messages about to be sent.
+ *
+ * Called by SendSharedInvalidMessages before the messages are queued.  If
+ * this returns true, the caller must call SharedCatCacheEndInvalidate once
+ * they have been queued; until then, no backend adds tuples to the shared
+ * tier.
+ */
+bool
+SharedCatCacheBeginInvalidate(const SharedInvalidationMessage *msgs, int n)
+{
+	int			i;
+
+	if (SharedCatCacheCtl == NULL)
+		return false;
+
+	for (i = 0; i < n; i++)
+	{
+		if (msgs[i].id >= 0 || msgs[i].id == SHAREDINVALCATALOG_ID)
+			break;
+	}
+	if (i == n)
+		return false;
+
+	/* attach now, so that nothing can fail once we've begun */
+	(void) GetSharedCatCacheArea();
+
+	/*
+	 * Announce the invalidation before removing anything, so that loads
+	 * that have begun already don't add tuples that we've already removed.
+	 * See SharedCatCacheBeginLoad.
+	 */
+	pg_atomic_fetch_add_u32(&SharedCatCacheCtl->invalidating, 1);
+	pg_atomic_fetch_add_u64(&SharedCatCacheCtl->generation, 1);
+
+	for (; i < n; i++)
+	{
+		const SharedInvalidationMessage *msg = &msgs[i];
+
+		if (msg->id >= 0)
+			SharedCatCacheRemove(msg->cc.dbId, msg->cc.id, msg->cc.hashValue);
+		else if (msg->id == SHAREDINVALCATALOG_ID)
+			SharedCatCachePurge(false, msg->cat.dbId, msg->cat.catId);
+	}
+
+	return true;
+}
+
+/*
+ * The invalidation messages have been queued, so backends may add tuples
+ * to the shared tier again.
+ */
+void
+SharedCatCacheEndInvalidate(void)
+{
+	pg_atomic_fetch_sub_u32(&SharedCatCacheCtl->invalidating, 1);
+}
+
+/*
+ * Remove all tuples of a database that is being dropped.
+ *
+ * No invalidation messages are sent for the database's catalogs, and its
+ * OID may be used again later.
+ */
+void
+SharedCatCacheForgetDatabase(Oid dbid)
+{
+	if (SharedCatCacheCtl == NULL)
+		return;
+
+	SharedCatCachePurge(false, dbid, InvalidOid);
+}
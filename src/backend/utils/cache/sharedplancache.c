@@ -0,0 +1,727 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.c
+ *	  Generic plans shared by all backends.
+ *
+ * Every backend plans its prepared statements for itself, so when many
+ * sessions prepare the same statements, each of them pays for planning the
+ * same generic plans.  When shared_plan_cache_size is set, plancache.c
+ * copies each generic plan it builds into a hash table in shared memory, and
+ * a backend that needs a generic plan looks there before planning.  As in
+ * the shared catalog cache, the entries live in a DSA area created in place
+ * in the main shared memory segment, and when the area fills up everything
+ * in it is thrown away.
+ *
+ * A plan is looked up by the text form of the rewritten query trees it was
+ * built from, together with the database, the current role and the planner
+ * settings.  The query trees already reflect the search_path in use, since
+ * all names in them have been resolved to OIDs, as well as row security
+ * policies; and the planner makes no other decisions that depend on the
+ * session, except those covered by the role and the settings.  Plans are
+ * stored in the text form made by nodeToString(), which is how plans are
+ * passed to parallel workers too.
+ *
+ * Stale plans are removed the same way as stale shared catalog tuples (see
+ * sharedcatcache.c): the backend that sends invalidation messages removes
+ * the plans they affect before the messages are queued, and a backend adds
+ * a plan only if no invalidation has begun since it began planning.  A plan
+ * depends on the relations and the functions listed in it, just like a
+ * generic plan in plancache.c, and on the catalogs for which plancache.c
+ * invalidates all plans.  Since plans are found by their query, not by what
+ * they depend on, removing them means visiting every entry; this is done
+ * once for each batch of messages.
+ *
+ * A backend that takes a plan from here locks the relations it uses and
+ * then checks that its own plan cache hasn't invalidated it meanwhile, just
+ * as for a generic plan it has kept itself.
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/utils/cache/sharedplancache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/hash.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "nodes/plannodes.h"
+#include "port/atomics.h"
+#include "storage/ipc.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/dsa.h"
+#include "utils/dynahash.h"
+#include "utils/guc_tables.h"
+#include "utils/hashutils.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/sharedplancache.h"
+#include "utils/snapmgr.h"
+#include "utils/syscache.h"
+
+
+/* Number of partition locks protecting the hash buckets */
+#define NUM_SHARED_PLANCACHE_PARTITIONS	128
+
+/* An invalidation item of a plan, as in PlanInvalItem */
+typedef struct SharedPlanInvalItem
+{
+	int			cacheId;
+	uint32		hashValue;
+} SharedPlanInvalItem;
+
+/*
+ * A plan in the shared plan cache.  The struct is followed, at a MAXALIGN'd
+ * offset, by the OIDs of the relations the plan depends on, its
+ * invalidation items, the query key and the plan, the last two as
+ * null-terminated strings.
+ */
+typedef struct SharedPlanEntry
+{
+	dsa_pointer next;			/* next entry in the same bucket, if any */
+	uint32		hash_value;		/* hash value of the key */
+	Oid			dbid;			/* database the plan was made in */
+	Oid			roleid;			/* role the plan was made for */
+	int			cursor_options; /* cursor options it was made with */
+	int			nrelids;		/* number of relation OIDs */
+	int			nitems;			/* number of invalidation items */
+	Size		key_len;		/* length of the query key */
+	Size		plan_len;		/* length of the plan */
+} SharedPlanEntry;
+
+#define SHARED_PLAN_RELIDS(e) \
+	((Oid *) ((char *) (e) + MAXALIGN(sizeof(SharedPlanEntry))))
+#define SHARED_PLAN_ITEMS(e) \
+	((SharedPlanInvalItem *) (SHARED_PLAN_RELIDS(e) + (e)->nrelids))
+#define SHARED_PLAN_KEY(e) \
+	((char *) (SHARED_PLAN_ITEMS(e) + (e)->nitems))
+#define SHARED_PLAN_PLAN(e) \
+	(SHARED_PLAN_KEY(e) + (e)->key_len + 1)
+
+typedef struct SharedPlanCacheControl
+{
+	pg_atomic_uint64 generation;	/* bumped when an invalidation begins */
+	pg_atomic_uint32 invalidating;	/* number of invalidations in progress */
+	pg_atomic_uint32 nentries;	/* number of plans in the cache */
+	int			nbuckets;		/* always a power of 2 */
+	LWLockPadded locks[NUM_SHARED_PLANCACHE_PARTITIONS];
+	dsa_pointer buckets[FLEXIBLE_ARRAY_MEMBER];
+} SharedPlanCacheControl;
+
+/* GUC variable */
+int			shared_plan_cache_size = 0;
+
+static SharedPlanCacheControl *SharedPlanCacheCtl = NULL;
+static void *SharedPlanCachePlace = NULL;
+static dsa_area *SharedPlanCacheArea = NULL;
+
+static int	SharedPlanCacheBuckets(void);
+static dsa_area *GetSharedPlanCacheArea(void);
+static bool SharedPlanCacheUsable(void);
+static char *SharedPlanKey(const char *query);
+static uint32 SharedPlanHash(const char *key, Size key_len, int cursor_options);
+static SharedPlanEntry *SharedPlanLookup(dsa_area *area, uint32 bucket,
+				 uint32 hashValue, const char *key, Size key_len,
+				 int cursor_options);
+static bool IsPlanInvalidationMessage(const SharedInvalidationMessage *msg);
+static bool SharedPlanIsStale(SharedPlanEntry *e,
+				  const SharedInvalidationMessage *msgs, int n);
+static void SharedPlanCachePurge(bool all, Oid dbid,
+					 const SharedInvalidationMessage *msgs, int n);
+
+
+/*
+ * Number of hash buckets: about one for every 4kB of plan space.
+ */
+static int
+SharedPlanCacheBuckets(void)
+{
+	long		nbuckets = (long) shared_plan_cache_size / 4;
+
+	return 1 << my_log2(Max(nbuckets, 256));
+}
+
+/*
+ * Report shared memory space needed by SharedPlanCacheShmemInit.
+ */
+Size
+SharedPlanCacheShmemSize(void)
+{
+	Size		size;
+
+	if (shared_plan_cache_size == 0)
+		return 0;
+
+	size = add_size(offsetof(SharedPlanCacheControl, buckets),
+					mul_size(SharedPlanCacheBuckets(), sizeof(dsa_pointer)));
+	size = add_size(size, mul_size(shared_plan_cache_size, 1024));
+
+	return size;
+}
+
+/*
+ * Create the shared plan cache's hash table and plan area in shared memory.
+ *
+ * The plan area is pinned, and the postmaster detaches from it right away.
+ */
+void
+SharedPlanCacheShmemInit(void)
+{
+	Size		area_size = mul_size(shared_plan_cache_size, 1024);
+	int			nbuckets;
+	bool		found;
+
+	if (shared_plan_cache_size == 0)
+		return;
+
+	nbuckets = SharedPlanCacheBuckets();
+	SharedPlanCacheCtl = (SharedPlanCacheControl *)
+		ShmemInitStruct("Shared Plan Cache",
+						add_size(offsetof(SharedPlanCacheControl, buckets),
+								 mul_size(nbuckets, sizeof(dsa_pointer))),
+						&found);
+	SharedPlanCachePlace = ShmemInitStruct("Shared Plan Cache Area",
+										   area_size, &found);
+	if (!found)
+	{
+		dsa_area   *area;
+		int			i;
+
+		pg_atomic_init_u64(&SharedPlanCacheCtl->generation, 1);
+		pg_atomic_init_u32(&SharedPlanCacheCtl->invalidating, 0);
+		pg_atomic_init_u32(&SharedPlanCacheCtl->nentries, 0);
+		SharedPlanCacheCtl->nbuckets = nbuckets;
+		for (i = 0; i < NUM_SHARED_PLANCACHE_PARTITIONS; i++)
+			LWLockInitialize(&SharedPlanCacheCtl->locks[i].lock,
+							 LWTRANCHE_SHARED_PLANCACHE);
+		for (i = 0; i < nbuckets; i++)
+			SharedPlanCacheCtl->buckets[i] = InvalidDsaPointer;
+
+		area = dsa_create_in_place(SharedPlanCachePlace, area_size,
+								   LWTRANCHE_SHARED_PLANCACHE_DSA, NULL);
+		/* never reach out for more memory than we were given */
+		dsa_set_size_limit(area, area_size);
+		dsa_pin(area);
+		dsa_release_in_place(SharedPlanCachePlace);
+		dsa_detach(area);
+	}
+}
+
+/*
+ * Attach to the plan area, if we haven't already.
+ */
+static dsa_area *
+GetSharedPlanCacheArea(void)
+{
+	if (SharedPlanCacheArea == NULL)
+	{
+		MemoryContext old_context;
+
+		Assert(SharedPlanCachePlace != NULL);
+
+		old_context = MemoryContextSwitchTo(TopMemoryContext);
+		SharedPlanCacheArea = dsa_attach_in_place(SharedPlanCachePlace, NULL);
+		dsa_pin_mapping(SharedPlanCacheArea);
+		on_shmem_exit(dsa_on_shmem_exit_release_in_place,
+					  PointerGetDatum(SharedPlanCachePlace));
+		MemoryContextSwitchTo(old_context);
+	}
+
+	return SharedPlanCacheArea;
+}
+
+/*
+ * Can the current backend use the shared plan cache right now?
+ *
+ * Not if its own transaction has changed catalogs, since then it may see
+ * tables and functions that nobody else sees yet, or no longer sees ones
+ * that other backends' plans use.
+ */
+static bool
+SharedPlanCacheUsable(void)
+{
+	return SharedPlanCacheCtl != NULL &&
+		!IsBootstrapProcessingMode() &&
+		!HistoricSnapshotActive() &&
+		!HavePendingInvalidations();
+}
+
+/*
+ * Build the key of a plan: the planner settings, followed by the query.
+ *
+ * The settings are those in the groups that affect the choice of plans.
+ * This is rebuilt for each lookup, but that only happens when a backend
+ * needs a new generic plan.
+ */
+static char *
+SharedPlanKey(const char *query)
+{
+	struct config_generic **guc_vars = get_guc_variables();
+	int			num_vars = GetNumConfigOptions();
+	StringInfoData buf;
+	int			i;
+
+	initStringInfo(&buf);
+
+	for (i = 0; i < num_vars; i++)
+	{
+		struct config_generic *gconf = guc_vars[i];
+
+		switch (gconf->group)
+		{
+			case RESOURCES_MEM:
+			case RESOURCES_ASYNCHRONOUS:
+			case QUERY_TUNING_METHOD:
+			case QUERY_TUNING_COST:
+			case QUERY_TUNING_GEQO:
+			case QUERY_TUNING_OTHER:
+				break;
+			default:
+				continue;
+		}
+
+		switch (gconf->vartype)
+		{
+			case PGC_BOOL:
+				appendStringInfo(&buf, "%d ",
+								 (int) *((struct config_bool *) gconf)->variable);
+				break;
+			case PGC_INT:
+				appendStringInfo(&buf, "%d ",
+								 *((struct config_int *) gconf)->variable);
+				break;
+			case PGC_REAL:
+				appendStringInfo(&buf, "%.17g ",
+								 *((struct config_real *) gconf)->variable);
+				break;
+			case PGC_STRING:
+				{
+					char	   *val = *((struct config_string *) gconf)->variable;
+
+					appendStringInfo(&buf, "%zu:%s ",
+									 val ? strlen(val) : 0,
+									 val ? val : "");
+				}
+				break;
+			case PGC_ENUM:
+				appendStringInfo(&buf, "%d ",
+								 *((struct config_enum *) gconf)->variable);
+				break;
+		}
+	}
+
+	appendStringInfoString(&buf, query);
+
+	return buf.data;
+}
+
+static uint32
+SharedPlanHash(const char *key, Size key_len, int cursor_options)
+{
+	uint32		hash;
+
+	hash = DatumGetUInt32(hash_any((const unsigned char *) key, key_len));
+	hash = hash_combine(hash, murmurhash32((uint32) MyDatabaseId));
+	hash = hash_combine(hash, murmurhash32((uint32) GetUserId()));
+	hash = hash_combine(hash, murmurhash32((uint32) cursor_options));
+
+	return hash;
+}
+
+#define SharedPlanCacheBucket(hashValue) \
+	((hashValue) & (SharedPlanCacheCtl->nbuckets - 1))
+#define SharedPlanCachePartitionLock(bucket) \
+	(&SharedPlanCacheCtl->locks[(bucket) % NUM_SHARED_PLANCACHE_PARTITIONS].lock)
+
+/*
+ * Find the plan with the given key in a bucket, or return NULL.  The caller
+ * must hold the bucket's partition lock.
+ */
+static SharedPlanEntry *
+SharedPlanLookup(dsa_area *area, uint32 bucket, uint32 hashValue,
+				 const char *key, Size key_len, int cursor_options)
+{
+	dsa_pointer dp;
+
+	for (dp = SharedPlanCacheCtl->buckets[bucket];
+		 DsaPointerIsValid(dp);
+		 dp = ((SharedPlanEntry *) dsa_get_address(area, dp))->next)
+	{
+		SharedPlanEntry *e = (SharedPlanEntry *) dsa_get_address(area, dp);
+
+		if (e->hash_value == hashValue &&
+			e->dbid == MyDatabaseId &&
+			e->roleid == GetUserId() &&
+			e->cursor_options == cursor_options &&
+			e->key_len == key_len &&
+			memcmp(SHARED_PLAN_KEY(e), key, key_len) == 0)
+			return e;
+	}
+
+	return NULL;
+}
+
+/*
+ * Look for a generic plan for a query in the shared plan cache.
+ *
+ * "query" is the text form of the query's rewritten query trees.  Returns a
+ * palloc'd copy of the text form of the plan's statement list, or NULL if
+ * there's none.
+ */
+char *
+SharedPlanCacheSearch(const char *query, int cursor_options)
+{
+	dsa_area   *area;
+	char	   *key;
+	Size		key_len;
+	uint32		hashValue;
+	uint32		bucket;
+	LWLock	   *partitionLock;
+	SharedPlanEntry *e;
+	char	   *result = NULL;
+
+	if (!SharedPlanCacheUsable())
+		return NULL;
+
+	area = GetSharedPlanCacheArea();
+	key = SharedPlanKey(query);
+	key_len = strlen(key);
+	hashValue = SharedPlanHash(key, key_len, cursor_options);
+	bucket = SharedPlanCacheBucket(hashValue);
+	partitionLock = SharedPlanCachePartitionLock(bucket);
+
+	LWLockAcquire(partitionLock, LW_SHARED);
+	e = SharedPlanLookup(area, bucket, hashValue, key, key_len,
+						 cursor_options);
+	if (e != NULL)
+	{
+		result = palloc(e->plan_len + 1);
+		memcpy(result, SHARED_PLAN_PLAN(e), e->plan_len + 1);
+	}
+	LWLockRelease(partitionLock);
+
+	pfree(key);
+
+	return result;
+}
+
+/*
+ * Get ready to build a generic plan, for SharedPlanCacheInsert.
+ *
+ * Returns the generation to pass to SharedPlanCacheInsert, or 0 if the plan
+ * mustn't be added to the shared plan cache.  As in SharedCatCacheBeginLoad,
+ * pending invalidation messages are processed here, so that planning sees
+ * at least every change that has been invalidated so far.
+ */
+uint64
+SharedPlanCacheBeginLoad(void)
+{
+	uint64		generation;
+
+	if (!SharedPlanCacheUsable())
+		return 0;
+
+	/* see SharedPlanCacheBeginInvalidate for the other side of this */
+	generation = pg_atomic_read_u64(&SharedPlanCacheCtl->generation);
+	pg_memory_barrier();
+	if (pg_atomic_read_u32(&SharedPlanCacheCtl->invalidating) != 0)
+		return 0;
+
+	AcceptInvalidationMessages();
+
+	/* processing the messages may have changed catalogs we can't share */
+	if (!SharedPlanCacheUsable())
+		return 0;
+
+	return generation;
+}
+
+/*
+ * Add a generic plan that was just built to the shared plan cache.
+ *
+ * "plan" is the text form of the plan's statement list, and relationOids and
+ * invalItems are everything it depends on.  "generation" is what
+ * SharedPlanCacheBeginLoad returned before planning began.
+ */
+void
+SharedPlanCacheInsert(const char *query, int cursor_options, const char *plan,
+					  List *relationOids, List *invalItems, uint64 generation)
+{
+	dsa_area   *area;
+	char	   *key;
+	Size		key_len;
+	Size		plan_len;
+	uint32		hashValue;
+	uint32		bucket;
+	LWLock	   *partitionLock;
+	Size		size;
+	dsa_pointer newdp;
+	SharedPlanEntry *newe;
+	Oid		   *relids;
+	SharedPlanInvalItem *items;
+	ListCell   *lc;
+
+	if (generation == 0)
+		return;
+
+	key = SharedPlanKey(query);
+	key_len = strlen(key);
+	plan_len = strlen(plan);
+
+	/* don't let a few huge plans crowd out everything else */
+	size = MAXALIGN(sizeof(SharedPlanEntry)) +
+		list_length(relationOids) * sizeof(Oid) +
+		list_length(invalItems) * sizeof(SharedPlanInvalItem) +
+		key_len + 1 + plan_len + 1;
+	if (size > (Size) shared_plan_cache_size * 1024 / 16)
+	{
+		pfree(key);
+		return;
+	}
+
+	area = GetSharedPlanCacheArea();
+	newdp = dsa_allocate_extended(area, size, DSA_ALLOC_NO_OOM);
+	if (!DsaPointerIsValid(newdp))
+	{
+		/* out of space; start over with what's in demand from now on */
+		elog(DEBUG1, "shared plan cache is full, resetting it");
+		SharedPlanCachePurge(true, InvalidOid, NULL, 0);
+		pfree(key);
+		return;
+	}
+
+	hashValue = SharedPlanHash(key, key_len, cursor_options);
+
+	newe = (SharedPlanEntry *) dsa_get_address(area, newdp);
+	newe->hash_value = hashValue;
+	newe->dbid = MyDatabaseId;
+	newe->roleid = GetUserId();
+	newe->cursor_options = cursor_options;
+	newe->nrelids = list_length(relationOids);
+	newe->nitems = list_length(invalItems);
+	newe->key_len = key_len;
+	newe->plan_len = plan_len;
+
+	relids = SHARED_PLAN_RELIDS(newe);
+	foreach(lc, relationOids)
+		*relids++ = lfirst_oid(lc);
+	items = SHARED_PLAN_ITEMS(newe);
+	foreach(lc, invalItems)
+	{
+		PlanInvalItem *item = lfirst_node(PlanInvalItem, lc);
+
+		items->cacheId = item->cacheId;
+		items->hashValue = item->hashValue;
+		items++;
+	}
+	memcpy(SHARED_PLAN_KEY(newe), key, key_len + 1);
+	memcpy(SHARED_PLAN_PLAN(newe), plan, plan_len + 1);
+
+	bucket = SharedPlanCacheBucket(hashValue);
+	partitionLock = SharedPlanCachePartitionLock(bucket);
+
+	LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+	/* another backend may have added the same plan meanwhile */
+	if (pg_atomic_read_u64(&SharedPlanCacheCtl->generation) == generation &&
+		SharedPlanLookup(area, bucket, hashValue, key, key_len,
+						 cursor_options) == NULL)
+	{
+		newe->next = SharedPlanCacheCtl->buckets[bucket];
+		SharedPlanCacheCtl->buckets[bucket] = newdp;
+		pg_atomic_fetch_add_u32(&SharedPlanCacheCtl->nentries, 1);
+		newdp = InvalidDsaPointer;
+	}
+	LWLockRelease(partitionLock);
+
+	if (DsaPointerIsValid(newdp))
+		dsa_free(area, newdp);
+	pfree(key);
+}
+
+/*
+ * Is this a message that can make plans stale?  These are the messages that
+ * plancache.c's invalidation callbacks act on.
+ */
+static bool
+IsPlanInvalidationMessage(const SharedInvalidationMessage *msg)
+{
+	if (msg->id == SHAREDINVALRELCACHE_ID)
+		return true;
+	if (msg->id < 0)
+		return false;
+
+	switch (msg->cc.id)
+	{
+		case PROCOID:
+		case NAMESPACEOID:
+		case OPEROID:
+		case AMOPOPID:
+		case FOREIGNSERVEROID:
+		case FOREIGNDATAWRAPPEROID:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Does any of the messages make a plan stale?
+ */
+static bool
+SharedPlanIsStale(SharedPlanEntry *e, const SharedInvalidationMessage *msgs,
+				  int n)
+{
+	Oid		   *relids = SHARED_PLAN_RELIDS(e);
+	SharedPlanInvalItem *items = SHARED_PLAN_ITEMS(e);
+	int			i;
+	int			j;
+
+	for (i = 0; i < n; i++)
+	{
+		const SharedInvalidationMessage *msg = &msgs[i];
+
+		if (msg->id == SHAREDINVALRELCACHE_ID)
+		{
+			if (OidIsValid(msg->rc.dbId) && msg->rc.dbId != e->dbid)
+				continue;
+			if (!OidIsValid(msg->rc.relId) && e->nrelids > 0)
+				return true;
+			for (j = 0; j < e->nrelids; j++)
+			{
+				if (relids[j] == msg->rc.relId)
+					return true;
+			}
+		}
+		else if (msg->id >= 0)
+		{
+			if (OidIsValid(msg->cc.dbId) && msg->cc.dbId != e->dbid)
+				continue;
+			if (msg->cc.id != PROCOID)
+			{
+				/* plancache.c invalidates everything for the others */
+				if (IsPlanInvalidationMessage(msg))
+					return true;
+				continue;
+			}
+			for (j = 0; j < e->nitems; j++)
+			{
+				if (items[j].cacheId == msg->cc.id &&
+					items[j].hashValue == msg->cc.hashValue)
+					return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Remove the plans made stale by some invalidation messages, or all plans
+ * of a database if msgs is NULL, or simply all plans if "all" is set.
+ *
+ * This has to visit every bucket.  Partitions are locked one at a time,
+ * since removing plans is always safe.
+ */
+static void
+SharedPlanCachePurge(bool all, Oid dbid,
+					 const SharedInvalidationMessage *msgs, int n)
+{
+	dsa_area   *area = GetSharedPlanCacheArea();
+	int			partition;
+
+	for (partition = 0; partition < NUM_SHARED_PLANCACHE_PARTITIONS; partition++)
+	{
+		LWLock	   *partitionLock = &SharedPlanCacheCtl->locks[partition].lock;
+		int			bucket;
+
+		LWLockAcquire(partitionLock, LW_EXCLUSIVE);
+		for (bucket = partition;
+			 bucket < SharedPlanCacheCtl->nbuckets;
+			 bucket += NUM_SHARED_PLANCACHE_PARTITIONS)
+		{
+			dsa_pointer *link = &SharedPlanCacheCtl->buckets[bucket];
+
+			while (DsaPointerIsValid(*link))
+			{
+				dsa_pointer dp = *link;
+				SharedPlanEntry *e = (SharedPlanEntry *) dsa_get_address(area, dp);
+
+				if (all ||
+					(msgs == NULL ? e->dbid == dbid :
+					 SharedPlanIsStale(e, msgs, n)))
+				{
+					*link = e->next;
+					dsa_free(area, dp);
+					pg_atomic_fetch_sub_u32(&SharedPlanCacheCtl->nentries, 1);
+				}
+				else
+					link = &e->next;
+			}
+		}
+		LWLockRelease(partitionLock);
+	}
+}
+
+/*
+ * Remove the plans made stale by invalidation messages about to be sent.
+ *
+ * Called by SendSharedInvalidMessages before the messages are queued.  If
+ * this returns true, the caller must call SharedPlanCacheEndInvalidate once
+ * they have been queued; until then, no backend adds plans to the cache.
+ */
+bool
+SharedPlanCacheBeginInvalidate(const SharedInvalidationMessage *msgs, int n)
+{
+	int			i;
+
+	if (SharedPlanCacheCtl == NULL)
+		return false;
+
+	for (i = 0; i < n; i++)
+	{
+		if (IsPlanInvalidationMessage(&msgs[i]))
+			break;
+	}
+	if (i == n)
+		return false;
+
+	/* attach now, so that nothing can fail once we've begun */
+	(void) GetSharedPlanCacheArea();
+
+	/* see SharedCatCacheBeginInvalidate */
+	pg_atomic_fetch_add_u32(&SharedPlanCacheCtl->invalidating, 1);
+	pg_atomic_fetch_add_u64(&SharedPlanCacheCtl->generation, 1);
+
+	if (pg_atomic_read_u32(&SharedPlanCacheCtl->nentries) > 0)
+		SharedPlanCachePurge(false, InvalidOid, msgs + i, n - i);
+
+	return true;
+}
+
+/*
+ * The invalidation messages have been queued, so backends may add plans to
+ * the cache again.
+ */
+void
+SharedPlanCacheEndInvalidate(void)
+{
+	pg_atomic_fetch_sub_u32(&SharedPlanCacheCtl->invalidating, 1);
+}
+
+/*
+ * Remove all plans of a database that is being dropped, since its OID may
+ * be used again later.
+ */
+void
+SharedPlanCacheForgetDatabase(Oid dbid)
+{
+	if (SharedPlanCacheCtl == NULL)
+		return;
+
+	SharedPlanCachePurge(false, dbid, NULL, 0);
+}
@@ -262,6 +262,21 @@ static int	SecurityRestrictionContext = 0;
 /* We also remember if a SET ROLE is currently active */
 static bool SetRoleIsActive = false;
 
+/*
+ * Initialize process-local latch support, and point MyLatch at our
+ * process-local latch
+ *
+ * This is done by the postmaster itself, by each of its children, and by a
+ * standalone backend.
+ */
+void
+InitProcessLocalLatch(void)
+{
+	InitializeLatchSupport();
+	MyLatch = &LocalLatchData;
+	InitLatch(MyLatch);
+}
+
 /*
  * Initialize the basic environment for a postmaster child
  *
@@ -290,9 +305,7 @@ InitPostmasterChild(void)
 	on_exit_reset();
 
 	/* Initialize process-local latch support */
-	InitializeLatchSupport();
-	MyLatch = &LocalLatchData;
-	InitLatch(MyLatch);
+	InitProcessLocalLatch();
 
 	/*
 	 * If possible, make this process a group leader, so that the postmaster
@@ -321,9 +334,7 @@ InitStandaloneProcess(const char *argv0)
 	MyStartTime = time(NULL);	/* set our start time in case we call elog */
 
 	/* Initialize process-local latch support */
-	InitializeLatchSupport();
-	MyLatch = &LocalLatchData;
-	InitLatch(MyLatch);
+	InitProcessLocalLatch();
 
 	/* Compute paths, no postmaster to inherit from */
 	if (my_exec_path[0] == '\0')
@@ -33,12 +33,14 @@
 #include "catalog/pg_db_role_setting.h"
 #include "catalog/pg_tablespace.h"
 #include "libpq/auth.h"
+#include "libpq/libpq.h"
 #include "libpq/libpq-be.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/sessionpool.h"
 #include "replication/walsender.h"
 #include "storage/bufmgr.h"
 #include "storage/fd.h"
@@ -72,6 +74,7 @@ static void ShutdownPostgres(int code, Datum arg);
 static void StatementTimeoutHandler(void);
 static void LockTimeoutHandler(void);
 static void IdleInTransactionSessionTimeoutHandler(void);
+static void IdleMemoryReclaimTimeoutHandler(void);
 static bool ThereIsAtLeastOneRole(void);
 static void process_startup_options(Port *port, bool am_superuser);
 static void process_settings(Oid databaseid, Oid roleid);
@@ -186,6 +189,8 @@ PerformAuthentication(Port *port)
 	/* This should be set already, but let's make sure */
 	ClientAuthInProgress = true;	/* limit visibility of log messages */
 
+	port->auth_start_time = GetCurrentTimestamp();
+
 	/*
 	 * In EXEC_BACKEND case, we didn't inherit the contents of pg_hba.conf
 	 * etcetera from the postmaster, and have to load them ourselves.
@@ -242,6 +247,17 @@ PerformAuthentication(Port *port)
 	 */
 	disable_timeout(STATEMENT_TIMEOUT, false);
 
+	port->auth_end_time = GetCurrentTimestamp();
+
+	/*
+	 * Switch to protocol compression now if the client asked for it.  The
+	 * authentication exchange can carry passwords next to data the client
+	 * chose, such as the user name, which is what compression side channels
+	 * feed on, so it is never compressed.
+	 */
+	if (port->compression_algorithm != NULL)
+		pq_enable_compression(port->compression_algorithm);
+
 	if (Log_connections)
 	{
 		if (am_walsender)
@@ -538,39 +554,19 @@ BaseInit(void)
 
 
 /* --------------------------------
- * InitPostgres
- *		Initialize POSTGRES.
- *
- * The database can be specified by name, using the in_dbname parameter, or by
- * OID, using the dboid parameter.  In the latter case, the actual database
- * name can be returned to the caller in out_dbname.  If out_dbname isn't
- * NULL, it must point to a buffer of size NAMEDATALEN.
- *
- * Similarly, the username can be passed by name, using the username parameter,
- * or by OID using the useroid parameter.
- *
- * In bootstrap mode no parameters are used.  The autovacuum launcher process
- * doesn't use any parameters either, because it only goes far enough to be
- * able to read pg_database; it doesn't connect to any particular database.
- * In walsender mode only username is used.
- *
- * As of PostgreSQL 8.2, we expect InitProcess() was already called, so we
- * already have a PGPROC struct ... but it's not completely filled in yet.
+ * InitPostgresEarly
+ *		Perform the part of InitPostgres that does not depend on the
+ *		database or user we are going to connect as.
  *
- * Note:
- *		Be very careful with the order of calls in the InitPostgres function.
+ * This is normally called by InitPostgres.  A preforked backend calls it
+ * before it has a client connection, so that it can skip this work when
+ * the client arrives.
  * --------------------------------
  */
 void
-InitPostgres(const char *in_dbname, Oid dboid, const char *username,
-			 Oid useroid, char *out_dbname, bool override_allow_connections)
+InitPostgresEarly(void)
 {
 	bool		bootstrap = IsBootstrapProcessingMode();
-	bool		am_superuser;
-	char	   *fullpath;
-	char		dbname[NAMEDATALEN];
-
-	elog(DEBUG3, "InitPostgres");
 
 	/*
 	 * Add my PGPROC struct to the ProcArray.
@@ -595,19 +591,6 @@ InitPostgres(const char *in_dbname, Oid dboid, const char *username,
 	/* Now that we have a BackendId, we can participate in ProcSignal */
 	ProcSignalInit(MyBackendId);
 
-	/*
-	 * Also set up timeout handlers needed for backend operation.  We need
-	 * these in every case except bootstrap.
-	 */
-	if (!bootstrap)
-	{
-		RegisterTimeout(DEADLOCK_TIMEOUT, CheckDeadLockAlert);
-		RegisterTimeout(STATEMENT_TIMEOUT, StatementTimeoutHandler);
-		RegisterTimeout(LOCK_TIMEOUT, LockTimeoutHandler);
-		RegisterTimeout(IDLE_IN_TRANSACTION_SESSION_TIMEOUT,
-						IdleInTransactionSessionTimeoutHandler);
-	}
-
 	/*
 	 * bufmgr needs another initialization call too
 	 */
@@ -669,6 +652,65 @@ InitPostgres(const char *in_dbname, Oid dboid, const char *username,
 	 * entirely possible, we need the AbortTransaction call to clean up.
 	 */
 	before_shmem_exit(ShutdownPostgres, 0);
+}
+
+
+/* --------------------------------
+ * InitPostgres
+ *		Initialize POSTGRES.
+ *
+ * The database can be specified by name, using the in_dbname parameter, or by
+ * OID, using the dboid parameter.  In the latter case, the actual database
+ * name can be returned to the caller in out_dbname.  If out_dbname isn't
+ * NULL, it must point to a buffer of size NAMEDATALEN.
+ *
+ * Similarly, the username can be passed by name, using the username parameter,
+ * or by OID using the useroid parameter.
+ *
+ * In bootstrap mode no parameters are used.  The autovacuum launcher process
+ * doesn't use any parameters either, because it only goes far enough to be
+ * able to read pg_database; it doesn't connect to any particular database.
+ * In walsender mode only username is used.
+ *
+ * As of PostgreSQL 8.2, we expect InitProcess() was already called, so we
+ * already have a PGPROC struct ... but it's not completely filled in yet.
+ *
+ * Note:
+ *		Be very careful with the order of calls in the InitPostgres function.
+ * --------------------------------
+ */
+void
+InitPostgres(const char *in_dbname, Oid dboid, const char *username,
+			 Oid useroid, char *out_dbname, bool override_allow_connections)
+{
+	bool		bootstrap = IsBootstrapProcessingMode();
+	bool		am_superuser;
+	char	   *fullpath;
+	char		dbname[NAMEDATALEN];
+
+	elog(DEBUG3, "InitPostgres");
+
+	/*
+	 * A preforked backend did the first part of the initialization while
+	 * waiting for its client to connect.
+	 */
+	if (!IsPreforkedBackend)
+		InitPostgresEarly();
+
+	/*
+	 * Also set up timeout handlers needed for backend operation.  We need
+	 * these in every case except bootstrap.
+	 */
+	if (!bootstrap)
+	{
+		RegisterTimeout(DEADLOCK_TIMEOUT, CheckDeadLockAlert);
+		RegisterTimeout(STATEMENT_TIMEOUT, StatementTimeoutHandler);
+		RegisterTimeout(LOCK_TIMEOUT, LockTimeoutHandler);
+		RegisterTimeout(IDLE_IN_TRANSACTION_SESSION_TIMEOUT,
+						IdleInTransactionSessionTimeoutHandler);
+		RegisterTimeout(IDLE_MEMORY_RECLAIM_TIMEOUT,
+						IdleMemoryReclaimTimeoutHandler);
+	}
 
 	/* The autovacuum launcher is done here */
 	if (IsAutoVacuumLauncherProcess())
@@ -744,7 +786,15 @@ InitPostgres(const char *in_dbname, Oid dboid, const char *username,
 	{
 		/* normal multiuser case */
 		Assert(MyProcPort != NULL);
-		PerformAuthentication(MyProcPort);
+
+		/*
+		 * A session pool worker's first session has already been
+		 * authenticated by the backend that handed it over.
+		 */
+		if (IsSessionPoolWorker())
+			ClientAuthInProgress = false;
+		else
+			PerformAuthentication(MyProcPort);
 		InitializeSessionUserId(username, useroid);
 		am_superuser = superuser();
 	}
@@ -1011,9 +1061,11 @@ InitPostgres(const char *in_dbname, Oid dboid, const char *username,
 	/*
 	 * Now process any command-line switches and any additional GUC variable
 	 * settings passed in the startup packet.   We couldn't do this before
-	 * because we didn't know if client is a superuser.
+	 * because we didn't know if client is a superuser.  A session pool
+	 * worker applies them as session settings later instead; see
+	 * SessionPoolStartSession.
 	 */
-	if (MyProcPort != NULL)
+	if (MyProcPort != NULL && !IsSessionPoolWorker())
 		process_startup_options(MyProcPort, am_superuser);
 
 	/* Process pg_db_role_setting options */
@@ -1206,6 +1258,17 @@ IdleInTransactionSessionTimeoutHandler(void)
 	SetLatch(MyLatch);
 }
 
+/*
+ * The reclaim itself is done by ProcessClientReadInterrupt, which the latch
+ * wakes up.
+ */
+static void
+IdleMemoryReclaimTimeoutHandler(void)
+{
+	IdleMemoryReclaimPending = true;
+	SetLatch(MyLatch);
+}
+
 /*
  * Returns true if at least one role is defined in this database cluster.
  */
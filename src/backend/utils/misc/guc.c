@@ -41,6 +41,7 @@
 #include "commands/vacuum.h"
 #include "commands/variable.h"
 #include "commands/trigger.h"
+#include "executor/execBatch.h"
 #include "funcapi.h"
 #include "jit/jit.h"
 #include "libpq/auth.h"
@@ -60,6 +61,7 @@
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/sessionpool.h"
 #include "postmaster/syslogger.h"
 #include "postmaster/walwriter.h"
 #include "replication/logicallauncher.h"
@@ -86,6 +88,8 @@
 #include "utils/portal.h"
 #include "utils/ps_status.h"
 #include "utils/rls.h"
+#include "utils/sharedcatcache.h"
+#include "utils/sharedplancache.h"
 #include "utils/snapmgr.h"
 #include "utils/tzparser.h"
 #include "utils/varlena.h"
@@ -181,6 +185,11 @@ static const char *show_tcp_keepalives_idle(void);
 static const char *show_tcp_keepalives_interval(void);
 static const char *show_tcp_keepalives_count(void);
 static bool check_maxconnections(int *newval, void **extra, GucSource source);
+static bool check_session_pool_size(int *newval, void **extra, GucSource source);
+static bool check_session_pool_return_delay(int *newval, void **extra, GucSource source);
+static bool check_shared_catcache_size(int *newval, void **extra, GucSource source);
+static bool check_shared_plan_cache_size(int *newval, void **extra, GucSource source);
+static bool check_prefork_backends(int *newval, void **extra, GucSource source);
 static bool check_max_worker_processes(int *newval, void **extra, GucSource source);
 static bool check_autovacuum_max_workers(int *newval, void **extra, GucSource source);
 static bool check_autovacuum_work_mem(int *newval, void **extra, GucSource source);
@@ -861,6 +870,15 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_incrementalsort", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of incremental sort steps."),
+			NULL
+		},
+		&enable_incrementalsort,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_hashagg", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of hashed aggregation plans."),
@@ -879,6 +897,15 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_resultcache", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of result caching."),
+			NULL
+		},
+		&enable_resultcache,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_nestloop", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of nested-loop join plans."),
@@ -906,6 +933,15 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_runtime_filter", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables pushing Bloom filters from hash joins down into scans."),
+			NULL
+		},
+		&enable_runtime_filter,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_gathermerge", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of gather merge plans."),
@@ -951,6 +987,33 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_parallel_hashagg", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel hashed aggregation plans."),
+			NULL
+		},
+		&enable_parallel_hashagg,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_parallel_sort", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel sort plans."),
+			NULL
+		},
+		&enable_parallel_sort,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_async_append", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of async append plans."),
+			NULL
+		},
+		&enable_async_append,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"geqo", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("Enables genetic query optimization."),
@@ -990,6 +1053,24 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"libpq_compression", PGC_SIGHUP, CONN_AUTH_SETTINGS,
+			gettext_noop("Allows clients to request compression of the connection."),
+			NULL
+		},
+		&libpq_compression,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"libpq_compression_over_ssl", PGC_SIGHUP, CONN_AUTH_SETTINGS,
+			gettext_noop("Allows clients to request compression of SSL connections."),
+			NULL
+		},
+		&libpq_compression_over_ssl,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"ssl", PGC_SIGHUP, CONN_AUTH_SSL,
 			gettext_noop("Enables SSL connections."),
@@ -1864,6 +1945,15 @@ static struct config_int ConfigureNamesInt[] =
 		8, 1, INT_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"executor_batch_size", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the number of rows processed at a time in batch mode."),
+			gettext_noop("Zero disables batch-mode execution.")
+		},
+		&executor_batch_size,
+		1024, 0, 65536,
+		NULL, NULL, NULL
+	},
 	{
 		{"geqo_threshold", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("Sets the threshold of FROM items beyond which GEQO is used."),
@@ -1967,6 +2057,39 @@ static struct config_int ConfigureNamesInt[] =
 		check_maxconnections, NULL, NULL
 	},
 
+	{
+		{"session_pool_size", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the number of backends serving pooled sessions for each database and user."),
+			gettext_noop("Zero disables session pooling.")
+		},
+		&SessionPoolSize,
+		0, 0, MAX_BACKENDS,
+		check_session_pool_size, NULL, NULL
+	},
+
+	{
+		{"session_pool_return_delay", PGC_SIGHUP, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the time a pooled session may be idle before it is returned to the postmaster."),
+			gettext_noop("A returned session is passed on to any worker of its pool "
+						 "once its client sends another command.  "
+						 "Zero keeps every session with the worker it was first given to."),
+			GUC_UNIT_MS
+		},
+		&SessionPoolReturnDelay,
+		0, 0, INT_MAX,
+		check_session_pool_return_delay, NULL, NULL
+	},
+
+	{
+		{"prefork_backends", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the number of backends started in advance of connection requests."),
+			NULL
+		},
+		&PreforkBackends,
+		0, 0, MAX_BACKENDS,
+		check_prefork_backends, NULL, NULL
+	},
+
 	{
 		/* see max_connections and max_wal_senders */
 		{"superuser_reserved_connections", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
@@ -2004,6 +2127,28 @@ static struct config_int ConfigureNamesInt[] =
 		check_temp_buffers, NULL, NULL
 	},
 
+	{
+		{"shared_catcache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the amount of shared memory used to share catalog cache entries between sessions."),
+			gettext_noop("0 turns this feature off."),
+			GUC_UNIT_KB
+		},
+		&shared_catcache_size,
+		0, 0, MAX_KILOBYTES,
+		check_shared_catcache_size, NULL, NULL
+	},
+
+	{
+		{"shared_plan_cache_size", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Sets the amount of shared memory used to share generic plans between sessions."),
+			gettext_noop("0 turns this feature off."),
+			GUC_UNIT_KB
+		},
+		&shared_plan_cache_size,
+		0, 0, MAX_KILOBYTES,
+		check_shared_plan_cache_size, NULL, NULL
+	},
+
 	{
 		{"port", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
 			gettext_noop("Sets the TCP port the server listens on."),
@@ -2260,6 +2405,17 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"idle_memory_reclaim_delay", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Sets the idle time after which a session gives back unused cache memory."),
+			gettext_noop("A value of 0 turns this off."),
+			GUC_UNIT_MS
+		},
+		&IdleMemoryReclaimDelay,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"vacuum_freeze_min_age", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Minimum age at which VACUUM should freeze a table row."),
@@ -10594,6 +10750,67 @@ check_maxconnections(int *newval, void **extra, GucSource source)
 	return true;
 }
 
+static bool
+check_session_pool_size(int *newval, void **extra, GucSource source)
+{
+#if defined(EXEC_BACKEND) || defined(WIN32)
+	if (*newval != 0)
+	{
+		GUC_check_errdetail("Session pooling is not supported on this platform.");
+		return false;
+	}
+#endif
+	return true;
+}
+
+static bool
+check_session_pool_return_delay(int *newval, void **extra, GucSource source)
+{
+#if !defined(HAVE_SYS_EPOLL_H) || defined(EXEC_BACKEND)
+	if (*newval != 0)
+	{
+		GUC_check_errdetail("Returning pooled sessions is not supported on this platform.");
+		return false;
+	}
+#endif
+	return true;
+}
+
+static bool
+check_shared_catcache_size(int *newval, void **extra, GucSource source)
+{
+	if (*newval != 0 && *newval < 1024)
+	{
+		GUC_check_errdetail("\"shared_catcache_size\" must be 0 or at least 1MB.");
+		return false;
+	}
+	return true;
+}
+
+static bool
+check_shared_plan_cache_size(int *newval, void **extra, GucSource source)
+{
+	if (*newval != 0 && *newval < 1024)
+	{
+		GUC_check_errdetail("\"shared_plan_cache_size\" must be 0 or at least 1MB.");
+		return false;
+	}
+	return true;
+}
+
+static bool
+check_prefork_backends(int *newval, void **extra, GucSource source)
+{
+#if defined(EXEC_BACKEND) || defined(WIN32)
+	if (*newval != 0)
+	{
+		GUC_check_errdetail("Preforked backends are not supported on this platform.");
+		return false;
+	}
+#endif
+	return true;
+}
+
 static bool
 check_autovacuum_max_workers(int *newval, void **extra, GucSource source)
 {
@@ -4399,6 +4399,32 @@ tuplesort_initialize_shared(Sharedsort *shared, int nWorkers, dsm_segment *seg)
 	}
 }
 
+/*
+ * tuplesort_reset_shared - reset shared tuplesort state for another sort
+ *
+ * Must be called from leader process before workers are launched again,
+ * once all worker tuplesorts of the previous sort have ended.  The files
+ * of the previous sort are removed, so that its runs cannot be mistaken for
+ * those of the next one.
+ */
+void
+tuplesort_reset_shared(Sharedsort *shared)
+{
+	int			i;
+
+	SharedFileSetDeleteAll(&shared->fileset);
+
+	SpinLockAcquire(&shared->mutex);
+	shared->currentWorker = 0;
+	shared->workersFinished = 0;
+	SpinLockRelease(&shared->mutex);
+	for (i = 0; i < shared->nTapes; i++)
+	{
+		shared->tapes[i].firstblocknumber = 0L;
+		shared->tapes[i].buffilesize = 0;
+	}
+}
+
 /*
  * tuplesort_attach_shared - attach to shared tuplesort state
  *
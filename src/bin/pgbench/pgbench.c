@@ -421,7 +421,9 @@ typedef enum MetaCommand
 	META_IF,					/* \if */
 	META_ELIF,					/* \elif */
 	META_ELSE,					/* \else */
-	META_ENDIF					/* \endif */
+	META_ENDIF,					/* \endif */
+	META_STARTPIPELINE,			/* \startpipeline */
+	META_ENDPIPELINE			/* \endpipeline */
 } MetaCommand;
 
 typedef enum QueryMode
@@ -2400,6 +2402,10 @@ getMetaCommand(const char *cmd)
 		mc = META_ELSE;
 	else if (pg_strcasecmp(cmd, "endif") == 0)
 		mc = META_ENDIF;
+	else if (pg_strcasecmp(cmd, "startpipeline") == 0)
+		mc = META_STARTPIPELINE;
+	else if (pg_strcasecmp(cmd, "endpipeline") == 0)
+		mc = META_ENDPIPELINE;
 	else
 		mc = META_NONE;
 	return mc;
@@ -2547,6 +2553,37 @@ chooseScript(TState *thread)
 	return i - 1;
 }
 
+/*
+ * Prepare the SQL commands of the chosen script, if not done yet on this
+ * connection.  This has to happen before entering pipeline mode, since
+ * PQprepare is not allowed there.
+ */
+static void
+prepareCommands(CState *st)
+{
+	int			j;
+	Command   **commands = sql_script[st->use_file].commands;
+
+	if (st->prepared[st->use_file])
+		return;
+
+	for (j = 0; commands[j] != NULL; j++)
+	{
+		PGresult   *res;
+		char		name[MAX_PREPARE_NAME];
+
+		if (commands[j]->type != SQL_COMMAND)
+			continue;
+		preparedStatementName(name, st->use_file, j);
+		res = PQprepare(st->con, name,
+						commands[j]->argv[0], commands[j]->argc - 1, NULL);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			fprintf(stderr, "%s", PQerrorMessage(st->con));
+		PQclear(res);
+	}
+	st->prepared[st->use_file] = true;
+}
+
 /* Send a SQL command, using the chosen querymode */
 static bool
 sendCommand(CState *st, Command *command)
@@ -2582,27 +2619,7 @@ sendCommand(CState *st, Command *command)
 		char		name[MAX_PREPARE_NAME];
 		const char *params[MAX_ARGS];
 
-		if (!st->prepared[st->use_file])
-		{
-			int			j;
-			Command   **commands = sql_script[st->use_file].commands;
-
-			for (j = 0; commands[j] != NULL; j++)
-			{
-				PGresult   *res;
-				char		name[MAX_PREPARE_NAME];
-
-				if (commands[j]->type != SQL_COMMAND)
-					continue;
-				preparedStatementName(name, st->use_file, j);
-				res = PQprepare(st->con, name,
-								commands[j]->argv[0], commands[j]->argc - 1, NULL);
-				if (PQresultStatus(res) != PGRES_COMMAND_OK)
-					fprintf(stderr, "%s", PQerrorMessage(st->con));
-				PQclear(res);
-			}
-			st->prepared[st->use_file] = true;
-		}
+		prepareCommands(st);
 
 		getQueryParams(st, command, params);
 		preparedStatementName(name, st->use_file, st->command);
@@ -2627,6 +2644,61 @@ sendCommand(CState *st, Command *command)
 		return true;
 }
 
+/*
+ * Read and discard the results of the commands of a pipeline, up to and
+ * including the result of the Sync sent at \endpipeline, then leave pipeline
+ * mode.  Sets the next state of the client.
+ *
+ * Returns false if we need to wait for more input from the server.
+ */
+static bool
+readPipelineResults(CState *st)
+{
+	PGresult   *res;
+
+	for (;;)
+	{
+		if (PQisBusy(st->con))
+			return false;		/* don't have the whole result yet */
+
+		res = PQgetResult(st->con);
+
+		/* a NULL separates the results of consecutive commands */
+		if (res == NULL)
+			continue;
+
+		switch (PQresultStatus(res))
+		{
+			case PGRES_COMMAND_OK:
+			case PGRES_TUPLES_OK:
+			case PGRES_EMPTY_QUERY:
+				/* OK */
+				PQclear(res);
+				break;
+			case PGRES_PIPELINE_SYNC:
+				PQclear(res);
+				if (PQexitPipelineMode(st->con) == 0)
+				{
+					commandFailed(st, "endpipeline", PQerrorMessage(st->con));
+					st->state = CSTATE_ABORTED;
+				}
+				else
+					st->state = CSTATE_END_COMMAND;
+				return true;
+			case PGRES_PIPELINE_ABORTED:
+				commandFailed(st, "SQL", "pipeline aborted");
+				PQclear(res);
+				st->state = CSTATE_ABORTED;
+				return true;
+			default:
+				commandFailed(st, "SQL", PQerrorMessage(st->con));
+				PQclear(res);
+				st->state = CSTATE_ABORTED;
+				return true;
+		}
+	}
+}
+
 /*
  * Parse the argument to a \sleep command, and return the requested amount
  * of delay, in microseconds.  Returns true on success, false on error.
@@ -2861,7 +2933,13 @@ doCustom(TState *thread, CState *st, StatsData *agg)
 				 */
 				if (command == NULL)
 				{
-					st->state = CSTATE_END_TX;
+					if (PQpipelineStatus(st->con) != PQ_PIPELINE_OFF)
+					{
+						commandFailed(st, "SQL", "end of script reached within a pipeline");
+						st->state = CSTATE_ABORTED;
+					}
+					else
+						st->state = CSTATE_END_TX;
 					break;
 				}
 
@@ -2883,6 +2961,11 @@ doCustom(TState *thread, CState *st, StatsData *agg)
 						commandFailed(st, "SQL", "SQL command send failed");
 						st->state = CSTATE_ABORTED;
 					}
+					else if (PQpipelineStatus(st->con) != PQ_PIPELINE_OFF)
+					{
+						/* results are collected at \endpipeline */
+						st->state = CSTATE_END_COMMAND;
+					}
 					else
 						st->state = CSTATE_WAIT_RESULT;
 				}
@@ -3037,6 +3120,54 @@ doCustom(TState *thread, CState *st, StatsData *agg)
 							/* succeeded */
 						}
 					}
+					else if (command->meta == META_STARTPIPELINE)
+					{
+						if (querymode == QUERY_SIMPLE)
+						{
+							commandFailed(st, "startpipeline", "cannot use pipeline mode with the simple query protocol");
+							st->state = CSTATE_ABORTED;
+							break;
+						}
+						if (PQpipelineStatus(st->con) != PQ_PIPELINE_OFF)
+						{
+							commandFailed(st, "startpipeline", "already in pipeline mode");
+							st->state = CSTATE_ABORTED;
+							break;
+						}
+
+						/* statements can't be prepared once in the pipeline */
+						if (querymode == QUERY_PREPARED)
+							prepareCommands(st);
+
+						if (PQenterPipelineMode(st->con) == 0)
+						{
+							commandFailed(st, "startpipeline", "failed to enter pipeline mode");
+							st->state = CSTATE_ABORTED;
+							break;
+						}
+					}
+					else if (command->meta == META_ENDPIPELINE)
+					{
+						if (PQpipelineStatus(st->con) != PQ_PIPELINE_ON)
+						{
+							commandFailed(st, "endpipeline", "not in pipeline mode");
+							st->state = CSTATE_ABORTED;
+							break;
+						}
+						if (!PQpipelineSync(st->con))
+						{
+							commandFailed(st, "endpipeline", "failed to send a pipeline sync");
+							st->state = CSTATE_ABORTED;
+							break;
+						}
+
+						/*
+						 * Collect the results of the whole pipeline, and
+						 * leave pipeline mode once the sync arrives.
+						 */
+						st->state = CSTATE_WAIT_RESULT;
+						break;
+					}
 
 					move_to_end_command:
 					/*
@@ -3146,6 +3277,13 @@ doCustom(TState *thread, CState *st, StatsData *agg)
 				if (PQisBusy(st->con))
 					return;		/* don't have the whole result yet */
 
+				if (PQpipelineStatus(st->con) != PQ_PIPELINE_OFF)
+				{
+					if (!readPipelineResults(st))
+						return;	/* need more input */
+					break;
+				}
+
 				/*
 				 * Read and discard the query result;
 				 */
@@ -4149,7 +4287,9 @@ process_backslash_command(PsqlScanState sstate, const char *source)
 			syntax_error(source, lineno, my_command->line, my_command->argv[0],
 						 "missing command", NULL, -1);
 	}
-	else if (my_command->meta == META_ELSE || my_command->meta == META_ENDIF)
+	else if (my_command->meta == META_ELSE || my_command->meta == META_ENDIF ||
+			 my_command->meta == META_STARTPIPELINE ||
+			 my_command->meta == META_ENDPIPELINE)
 	{
 		if (my_command->argc != 1)
 			syntax_error(source, lineno, my_command->line, my_command->argv[0],
@@ -474,6 +474,53 @@ pgbench(
 \shell echo shell-echo-output
 } });
 
+# pipeline mode
+pgbench(
+	'-t 1 -n -M extended', 0,
+	[ qr{type: .*/001_pgbench_pipeline}, qr{processed: 1/1} ],
+	[ qr{^$} ],
+	'pgbench pipeline',
+	{   '001_pgbench_pipeline' => q{
+-- test startpipeline
+\startpipeline
+} . "select 1;\n" x 10 . q{
+\endpipeline
+} });
+
+# test that pipeline mode works with prepared statements, too
+pgbench(
+	'-t 1 -n -M prepared', 0,
+	[ qr{type: .*/001_pgbench_pipeline_prep}, qr{processed: 1/1} ],
+	[ qr{^$} ],
+	'pgbench pipeline with prepared statements',
+	{   '001_pgbench_pipeline_prep' => q{
+\set aid 1
+\startpipeline
+select :aid;
+select :aid + 1;
+\endpipeline
+select 3;
+} });
+
+# protocol compression, with results too large to arrive in one read
+SKIP:
+{
+	skip "postgres was not built with zlib support", 3
+	  if !check_pg_config("#define HAVE_LIBZ 1");
+
+	local $ENV{PGCOMPRESSION} = 'on';
+	pgbench(
+		'--no-vacuum --client=2 --transactions=5', 0,
+		[ qr{processed: 10/10} ],
+		[ qr{^$} ],
+		'pgbench with compression',
+		{   '001_pgbench_compression' => q{
+\set n random(1000, 20000)
+select repeat(md5(:n::text), :n);
+select count(*) from generate_series(1, :n);
+} });
+}
+
 # trigger many expression errors
 my @errors = (
 
@@ -626,6 +673,26 @@ SELECT LEAST(:i, :i, :i, :i, :i, :i, :i, :i, :i, :i, :i);
 		[qr{invalid command .* "nosuchcommand"}], q{\nosuchcommand} ],
 	[ 'misc empty script', 1, [qr{empty command list for script}], q{} ],
 	[ 'bad boolean', 0, [qr{malformed variable.*trueXXX}], q{\set b :badtrue or true} ],
+
+	# PIPELINE
+	[   'pipeline sql error', 0,
+		[qr{ERROR:  division by zero}],
+		q{\startpipeline
+SELECT 1 / 0;
+SELECT 1;
+\endpipeline} ],
+	[   'pipeline already in pipeline', 0,
+		[qr{already in pipeline mode}],
+		q{\startpipeline
+\startpipeline} ],
+	[   'pipeline not in pipeline', 0,
+		[qr{not in pipeline mode}], q{\endpipeline} ],
+	[   'pipeline unclosed', 0,
+		[qr{end of script reached within a pipeline}],
+		q{\startpipeline
+SELECT 1;} ],
+	[   'pipeline unexpected argument', 1,
+		[qr{unexpected argument}], q{\startpipeline now} ],
     );
 
 
@@ -0,0 +1,334 @@
+/*-------------------------------------------------------------------------
+ *
+ * zpq_stream.c
+ *	  Stream compression of frontend/backend protocol traffic.
+ *
+ * A ZpqStream sits between the protocol code and the (possibly encrypted)
+ * connection.  Everything written to it is compressed and passed on to the
+ * transmit function as a single stream, flushed at the end of every write so
+ * that the peer can decompress whole messages without waiting for more data.
+ * Reads go the other way.  Both directions keep their own buffer of
+ * compressed data, so the stream can be driven by blocking as well as by
+ * non-blocking transmit and receive functions.
+ *
+ * This is used by both the backend and libpq.
+ *
+ * Portions Copyright (c) 2018, PostgreSQL Global Development Group
+ *
+ *
+ * IDENTIFICATION
+ *	  src/common/zpq_stream.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef FRONTEND
+#include "postgres.h"
+#else
+#include "postgres_fe.h"
+#endif
+
+#include "common/zpq_stream.h"
+
+#ifdef HAVE_LIBZ
+
+#include <zlib.h>
+
+/* Size of the buffers for compressed data, in either direction */
+#define ZPQ_BUFFER_SIZE		8192
+
+/*
+ * Speed matters more than ratio here: the point is to get more through a slow
+ * link, not to make the sender the bottleneck.
+ */
+#define ZPQ_COMPRESSION_LEVEL	Z_BEST_SPEED
+
+struct ZpqStream
+{
+	zpq_tx_func tx_func;
+	zpq_rx_func rx_func;
+	void	   *arg;
+
+	z_stream	tx;				/* deflate state */
+	z_stream	rx;				/* inflate state */
+
+	/*
+	 * tx_deflate_pending is set if the last deflate() call ran out of output
+	 * space, so that it may have more compressed data to return even without
+	 * more input.  rx_inflate_pending is likewise for inflate().
+	 */
+	bool		tx_deflate_pending;
+	bool		rx_inflate_pending;
+
+	const char *errmsg;			/* set if the codec has failed */
+
+	size_t		tx_pos;			/* next byte of tx_buf to send */
+	size_t		tx_len;			/* end of compressed data in tx_buf */
+	size_t		rx_pos;			/* next byte of rx_buf to decompress */
+	size_t		rx_len;			/* end of compressed data in rx_buf */
+	size_t		rx_size;		/* allocated size of rx_buf */
+	char		tx_buf[ZPQ_BUFFER_SIZE];
+	char		rx_buf[FLEXIBLE_ARRAY_MEMBER];
+};
+
+/*
+ * Is the named compression algorithm supported?
+ */
+bool
+zpq_algorithm_supported(const char *name)
+{
+	return strcmp(name, ZPQ_ALGORITHM_ZLIB) == 0;
+}
+
+/*
+ * Create a compression stream on top of the given transmit and receive
+ * functions, which are passed "arg" on every call.
+ *
+ * rx_data_size bytes at rx_data are compressed data that was already read
+ * from the connection, and is decompressed before anything else.
+ *
+ * Returns NULL if out of memory.
+ */
+ZpqStream *
+zpq_create(zpq_tx_func tx_func, zpq_rx_func rx_func, void *arg,
+		   const char *rx_data, size_t rx_data_size)
+{
+	ZpqStream  *zs;
+	size_t		rx_size = Max(rx_data_size, ZPQ_BUFFER_SIZE);
+
+	zs = (ZpqStream *) malloc(offsetof(ZpqStream, rx_buf) + rx_size);
+	if (zs == NULL)
+		return NULL;
+	memset(zs, 0, offsetof(ZpqStream, rx_buf));
+	zs->rx_size = rx_size;
+
+	zs->tx_func = tx_func;
+	zs->rx_func = rx_func;
+	zs->arg = arg;
+
+	if (deflateInit(&zs->tx, ZPQ_COMPRESSION_LEVEL) != Z_OK)
+	{
+		free(zs);
+		return NULL;
+	}
+	if (inflateInit(&zs->rx) != Z_OK)
+	{
+		deflateEnd(&zs->tx);
+		free(zs);
+		return NULL;
+	}
+
+	memcpy(zs->rx_buf, rx_data, rx_data_size);
+	zs->rx_len = rx_data_size;
+
+	return zs;
+}
+
+/*
+ * Read and decompress up to size bytes into buf.
+ *
+ * Returns the number of bytes stored.  If there is no decompressed data to
+ * return, returns whatever the receive function returned: 0 at end of input,
+ * or -1 with errno set, for example to EWOULDBLOCK.  Returns
+ * ZPQ_STREAM_ERROR if the compressed data is corrupt.
+ */
+ssize_t
+zpq_read(ZpqStream *zs, void *buf, size_t size)
+{
+	Assert(size > 0);
+
+	for (;;)
+	{
+		ssize_t		rc;
+
+		if (zs->rx_pos < zs->rx_len || zs->rx_inflate_pending)
+		{
+			size_t		produced;
+			int			zrc;
+
+			zs->rx.next_in = (Bytef *) zs->rx_buf + zs->rx_pos;
+			zs->rx.avail_in = zs->rx_len - zs->rx_pos;
+			zs->rx.next_out = (Bytef *) buf;
+			zs->rx.avail_out = size;
+
+			zrc = inflate(&zs->rx, Z_SYNC_FLUSH);
+			if (zrc != Z_OK && zrc != Z_BUF_ERROR)
+			{
+				/* the sender never ends the stream, so Z_STREAM_END is bad */
+				zs->errmsg = zs->rx.msg ? zs->rx.msg : "invalid compressed data";
+				errno = EIO;
+				return ZPQ_STREAM_ERROR;
+			}
+
+			zs->rx_pos = zs->rx_len - zs->rx.avail_in;
+			zs->rx_inflate_pending = (zs->rx.avail_out == 0);
+
+			produced = size - zs->rx.avail_out;
+			if (produced > 0)
+				return produced;
+		}
+
+		/*
+		 * inflate() consumes all the input it is given unless it runs out of
+		 * output space, so the buffer is empty by now.
+		 */
+		Assert(zs->rx_pos == zs->rx_len);
+		zs->rx_pos = zs->rx_len = 0;
+
+		rc = zs->rx_func(zs->arg, zs->rx_buf, zs->rx_size);
+		if (rc <= 0)
+			return rc;
+		zs->rx_len = rc;
+	}
+}
+
+/*
+ * Compress size bytes at buf and send them, together with any compressed data
+ * left over from earlier calls.  Pass size 0 to just send the left-overs.
+ *
+ * Returns the number of bytes of buf that were consumed.  These are not
+ * necessarily sent yet if the transmit function would block: zpq_buffered_tx
+ * tells whether more calls are needed to get everything out.  If nothing at
+ * all could be consumed (or, with size 0, not all the left-overs could be
+ * sent), returns whatever the transmit function returned.  Returns
+ * ZPQ_STREAM_ERROR if compression fails.
+ */
+ssize_t
+zpq_write(ZpqStream *zs, const void *buf, size_t size)
+{
+	size_t		consumed = 0;
+
+	for (;;)
+	{
+		int			zrc;
+
+		/* Get rid of the compressed data we have before making more */
+		while (zs->tx_pos < zs->tx_len)
+		{
+			ssize_t		rc;
+
+			rc = zs->tx_func(zs->arg, zs->tx_buf + zs->tx_pos,
+							 zs->tx_len - zs->tx_pos);
+			if (rc <= 0)
+				return consumed > 0 ? (ssize_t) consumed : rc;
+			zs->tx_pos += rc;
+		}
+		zs->tx_pos = zs->tx_len = 0;
+
+		if (consumed == size && !zs->tx_deflate_pending)
+			return consumed;
+
+		zs->tx.next_in = (Bytef *) buf + consumed;
+		zs->tx.avail_in = size - consumed;
+		zs->tx.next_out = (Bytef *) zs->tx_buf;
+		zs->tx.avail_out = ZPQ_BUFFER_SIZE;
+
+		zrc = deflate(&zs->tx, Z_SYNC_FLUSH);
+		if (zrc != Z_OK && zrc != Z_BUF_ERROR)
+		{
+			zs->errmsg = zs->tx.msg ? zs->tx.msg : "could not compress data";
+			errno = EIO;
+			return ZPQ_STREAM_ERROR;
+		}
+
+		consumed = size - zs->tx.avail_in;
+		zs->tx_len = ZPQ_BUFFER_SIZE - zs->tx.avail_out;
+		zs->tx_deflate_pending = (zs->tx.avail_out == 0);
+	}
+}
+
+/*
+ * Could zpq_read return data without calling the receive function?
+ */
+bool
+zpq_buffered_rx(ZpqStream *zs)
+{
+	return zs->rx_pos < zs->rx_len || zs->rx_inflate_pending;
+}
+
+/*
+ * Is there compressed data that zpq_write has not sent yet?
+ */
+bool
+zpq_buffered_tx(ZpqStream *zs)
+{
+	return zs->tx_pos < zs->tx_len || zs->tx_deflate_pending;
+}
+
+/*
+ * Describe the error that made zpq_read or zpq_write return ZPQ_STREAM_ERROR.
+ */
+const char *
+zpq_error(ZpqStream *zs)
+{
+	return zs->errmsg;
+}
+
+void
+zpq_free(ZpqStream *zs)
+{
+	if (zs == NULL)
+		return;
+	deflateEnd(&zs->tx);
+	inflateEnd(&zs->rx);
+	free(zs);
+}
+
+#else							/* !HAVE_LIBZ */
+
+/*
+ * Without zlib there is nothing to negotiate, so streams are never created
+ * and the remaining functions are never reached.
+ */
+
+bool
+zpq_algorithm_supported(const char *name)
+{
+	return false;
+}
+
+ZpqStream *
+zpq_create(zpq_tx_func tx_func, zpq_rx_func rx_func, void *arg,
+		   const char *rx_data, size_t rx_data_size)
+{
+	return NULL;
+}
+
+ssize_t
+zpq_read(ZpqStream *zs, void *buf, size_t size)
+{
+	errno = EIO;
+	return ZPQ_STREAM_ERROR;
+}
+
+ssize_t
+zpq_write(ZpqStream *zs, const void *buf, size_t size)
+{
+	errno = EIO;
+	return ZPQ_STREAM_ERROR;
+}
+
+bool
+zpq_buffered_rx(ZpqStream *zs)
+{
+	return false;
+}
+
+bool
+zpq_buffered_tx(ZpqStream *zs)
+{
+	return false;
+}
+
+const char *
+zpq_error(ZpqStream *zs)
+{
+	return "compression is not supported by this build";
+}
+
+void
+zpq_free(ZpqStream *zs)
+{
+}
+
+#endif							/* HAVE_LIBZ */
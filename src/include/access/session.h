@@ -13,9 +13,13 @@
 #define SESSION_H
 
 #include "lib/dshash.h"
+#include "nodes/pg_list.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
 
-/* Avoid including typcache.h */
+/* Avoid including typcache.h and sequence.h */
 struct SharedRecordTypmodRegistry;
+struct SequenceSessionState;
 
 /*
  * A struct encapsulating some elements of a user's session.  For now this
@@ -38,6 +42,29 @@ extern dsm_handle GetSessionDsmHandle(void);
 extern void AttachSession(dsm_handle handle);
 extern void DetachSession(void);
 
+/*
+ * A setting a client session has made, with the context and source it was
+ * made in, so that it can be made again the same way when the session is
+ * served again.
+ */
+typedef struct SessionSetting
+{
+	char	   *name;
+	char	   *value;
+	GucContext	context;
+	GucSource	source;
+} SessionSetting;
+
+/* Moving client sessions between backends */
+extern Size SessionStateShmemSize(void);
+extern void SessionStateShmemInit(void);
+extern const char *GetSessionMigrationBlocker(void);
+extern dsa_pointer SerializeSessionState(List *settings,
+					  HTAB *prepared_queries,
+					  struct SequenceSessionState *sequences);
+extern void RestoreSessionState(dsa_pointer state);
+extern void DiscardSessionState(dsa_pointer state);
+
 /* The current session, or NULL for none. */
 extern Session *CurrentSession;
 
@@ -208,6 +208,19 @@
 #define unlikely(x) ((x) != 0)
 #endif
 
+/*
+ * pg_prefetch_mem
+ *		Hint to the CPU that the memory at the given address will be read
+ *		soon, so that a cache miss on it can be overlapped with other work.
+ *		This never faults, even for an invalid address, and is a no-op on
+ *		compilers that offer no way to express it.
+ */
+#if __GNUC__ >= 3
+#define pg_prefetch_mem(a)	__builtin_prefetch(a)
+#else
+#define pg_prefetch_mem(a)	((void) 0)
+#endif
+
 /*
  * CppAsString
  *		Convert the argument to a string, using the C preprocessor.
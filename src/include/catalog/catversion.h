@@ -53,6 +53,6 @@
  */
 
 /*							yyyymmddN */
-#define CATALOG_VERSION_NO	201804091
+#define CATALOG_VERSION_NO	201804102
 
 #endif
@@ -15,6 +15,7 @@
 
 #include "commands/explain.h"
 #include "datatype/timestamp.h"
+#include "utils/hsearch.h"
 #include "utils/plancache.h"
 
 /*
@@ -56,5 +57,12 @@ extern TupleDesc FetchPreparedStatementResultDesc(PreparedStatement *stmt);
 extern List *FetchPreparedStatementTargetList(PreparedStatement *stmt);
 
 extern void DropAllPreparedStatements(void);
+extern HTAB *SavePreparedStatements(void);
+extern void RestorePreparedStatements(HTAB *queries);
+extern void DiscardPreparedStatements(HTAB *queries);
+extern Size EstimatePreparedStatementsSpace(HTAB *queries);
+extern void SerializePreparedStatements(HTAB *queries, Size maxsize,
+							char *start_address);
+extern void RecreatePreparedStatements(const char *start_address, Size size);
 
 #endif							/* PREPARE_H */
@@ -51,6 +51,28 @@ typedef struct xl_seq_rec
 	/* SEQUENCE TUPLE DATA FOLLOWS AT THE END */
 } xl_seq_rec;
 
+/*
+ * The currval() and lastval() state of a client session, kept while a
+ * session pool worker serves other sessions, or while the session moves to
+ * another backend.  It is a flat struct, so that it can be copied as is.
+ */
+typedef struct SequenceSessionValue
+{
+	Oid			relid;			/* the sequence */
+	int64		last;			/* value last returned by nextval */
+} SequenceSessionValue;
+
+typedef struct SequenceSessionState
+{
+	Oid			lastval_relid;	/* sequence lastval() reports, if any */
+	int			nvalues;		/* number of values[] */
+	SequenceSessionValue values[FLEXIBLE_ARRAY_MEMBER];
+} SequenceSessionState;
+
+#define SequenceSessionStateSize(nvalues) \
+	(offsetof(SequenceSessionState, values) + \
+	 (nvalues) * sizeof(SequenceSessionValue))
+
 extern int64 nextval_internal(Oid relid, bool check_permissions);
 extern Datum nextval(PG_FUNCTION_ARGS);
 extern List *sequence_options(Oid relid);
@@ -60,6 +82,8 @@ extern ObjectAddress AlterSequence(ParseState *pstate, AlterSeqStmt *stmt);
 extern void DeleteSequenceTuple(Oid relid);
 extern void ResetSequence(Oid seq_relid);
 extern void ResetSequenceCaches(void);
+extern SequenceSessionState *SaveSequenceSessionState(void);
+extern void RestoreSequenceSessionState(const SequenceSessionState *state);
 
 extern void seq_redo(XLogReaderState *rptr);
 extern void seq_desc(StringInfo buf, XLogReaderState *rptr);
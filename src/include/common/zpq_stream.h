@@ -0,0 +1,38 @@
+/*
+ * zpq_stream.h
+ *	  Stream compression of frontend/backend protocol traffic.
+ *
+ * Portions Copyright (c) 2018, PostgreSQL Global Development Group
+ *
+ * src/include/common/zpq_stream.h
+ */
+#ifndef ZPQ_STREAM_H
+#define ZPQ_STREAM_H
+
+/* Name of the only compression algorithm supported so far */
+#define ZPQ_ALGORITHM_ZLIB		"zlib"
+
+/* Returned by zpq_read() and zpq_write() if the codec reports an error */
+#define ZPQ_STREAM_ERROR		(-2)
+
+/*
+ * Functions used by the stream to send or receive compressed data.  They
+ * must behave like send() and recv(): return the number of bytes
+ * transferred, 0 at end of input, or -1 with errno set.
+ */
+typedef ssize_t (*zpq_tx_func) (void *arg, const void *data, size_t size);
+typedef ssize_t (*zpq_rx_func) (void *arg, void *data, size_t size);
+
+typedef struct ZpqStream ZpqStream;
+
+extern bool zpq_algorithm_supported(const char *name);
+extern ZpqStream *zpq_create(zpq_tx_func tx_func, zpq_rx_func rx_func,
+		   void *arg, const char *rx_data, size_t rx_data_size);
+extern ssize_t zpq_read(ZpqStream *zs, void *buf, size_t size);
+extern ssize_t zpq_write(ZpqStream *zs, const void *buf, size_t size);
+extern bool zpq_buffered_rx(ZpqStream *zs);
+extern bool zpq_buffered_tx(ZpqStream *zs);
+extern const char *zpq_error(ZpqStream *zs);
+extern void zpq_free(ZpqStream *zs);
+
+#endif							/* ZPQ_STREAM_H */
@@ -0,0 +1,132 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.h
+ *	  Batch-mode evaluation of scans and expressions.
+ *
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/executor/execBatch.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXECBATCH_H
+#define EXECBATCH_H
+
+#include <math.h>
+
+#include "nodes/execnodes.h"
+#include "utils/builtins.h"
+
+/* GUC: maximum number of rows per batch, 0 disables batch mode */
+extern int	executor_batch_size;
+
+/* Kinds of BatchExpr */
+typedef enum BatchExprKind
+{
+	BATCH_EXPR_VAR,				/* column of the scan */
+	BATCH_EXPR_CONST,			/* constant */
+	BATCH_EXPR_CMP,				/* comparison of two built-in scalars */
+	BATCH_EXPR_ARITH,			/* arithmetic on two built-in scalars */
+	BATCH_EXPR_FUNC,			/* any other function or operator */
+	BATCH_EXPR_AND,
+	BATCH_EXPR_OR,
+	BATCH_EXPR_NOT,
+	BATCH_EXPR_NULLTEST
+} BatchExprKind;
+
+/* Operand types with specialized comparisons and arithmetic */
+typedef enum BatchType
+{
+	BATCH_TYPE_INT4,			/* int4, and date */
+	BATCH_TYPE_INT8,			/* int8, timestamp and timestamptz */
+	BATCH_TYPE_FLOAT8
+} BatchType;
+
+typedef enum BatchOp
+{
+	BATCH_OP_LT,
+	BATCH_OP_LE,
+	BATCH_OP_EQ,
+	BATCH_OP_NE,
+	BATCH_OP_GE,
+	BATCH_OP_GT,
+	BATCH_OP_ADD,
+	BATCH_OP_SUB,
+	BATCH_OP_MUL
+} BatchOp;
+
+/*
+ * An expression compiled for batch-mode evaluation.
+ *
+ * Evaluating it over a selection of rows of the current batch fills in
+ * values[] and isnull[] at the positions of those rows.  Only pass-by-value
+ * types are supported, so the results never point into memory that needs
+ * to be kept.
+ */
+typedef struct BatchExpr
+{
+	BatchExprKind kind;
+	Datum	   *values;			/* results, indexed by row in the batch */
+	bool	   *isnull;
+
+	BatchType	type;			/* operand type, for CMP and ARITH */
+	BatchOp		op;				/* operator, for CMP and ARITH */
+	NullTestType nulltesttype;	/* for NULLTEST */
+
+	int			nargs;			/* number of arguments */
+	struct BatchExpr **args;	/* argument expressions */
+
+	FunctionCallInfo fcinfo;	/* for FUNC */
+	bool		strict;			/* FUNC is strict */
+
+	int		   *sel;			/* scratch selection, for AND and OR */
+} BatchExpr;
+
+/*
+ * State for reading a sequential scan a batch of rows at a time.
+ *
+ * The columns the batch expressions refer to are extracted from each tuple
+ * into arrays, and the scan's quals are applied to the whole batch, leaving
+ * the rows that passed them in sel[].
+ */
+typedef struct BatchScanState
+{
+	SeqScanState *scanstate;	/* the scan being read */
+	int			batch_size;		/* maximum number of rows per batch */
+	int			natts;			/* number of columns in the relation */
+	int			ncols;			/* number of columns needed */
+	AttrNumber *cols;			/* attnos of the needed columns */
+	AttrNumber	maxattno;		/* highest needed attno */
+	Datum	  **colvalues;		/* column values, indexed by attno - 1 */
+	bool	  **colnulls;		/* column null flags, likewise */
+	List	   *quals;			/* BatchExprs for the scan's quals */
+	int			nrows;			/* number of rows in the current batch */
+	int		   *sel;			/* rows of the batch that passed the quals */
+	int			nsel;			/* number of entries in sel */
+	bool		done;			/* have we reached the end of the scan? */
+	long		nbatches;		/* number of batches read, for EXPLAIN */
+} BatchScanState;
+
+extern BatchScanState *ExecInitBatchScan(PlanState *planstate, int batch_size);
+extern BatchExpr *ExecBuildBatchExpr(BatchScanState *bscan, Expr *expr);
+extern void ExecBatchScanBegin(BatchScanState *bscan);
+extern bool ExecBatchScanNext(BatchScanState *bscan);
+extern void ExecEvalBatchExpr(BatchExpr *bexpr, const int *sel, int nsel);
+extern int ExecBatchQual(BatchExpr *bexpr, const int *sel, int nsel,
+			  int *result);
+
+/*
+ * Compare two float8s the way float8_cmp_internal() does, but without a
+ * function call in the common case of neither being a NaN.
+ */
+static inline int
+batch_float8_cmp(float8 a, float8 b)
+{
+	if (likely(!isnan(a) && !isnan(b)))
+		return (a > b) ? 1 : ((a < b) ? -1 : 0);
+	return float8_cmp_internal(a, b);
+}
+
+#endif							/* EXECBATCH_H */
@@ -137,6 +137,8 @@ extern TupleHashEntry FindTupleHashEntry(TupleHashTable hashtable,
 				   TupleTableSlot *slot,
 				   ExprState *eqcomp,
 				   FmgrInfo *hashfunctions);
+extern uint32 TupleHashTableHashSlot(TupleHashTable hashtable,
+					   TupleTableSlot *slot);
 
 /*
  * prototypes from functions in execJunk.c
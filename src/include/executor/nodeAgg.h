@@ -14,7 +14,12 @@
 #ifndef NODEAGG_H
 #define NODEAGG_H
 
+#include "access/parallel.h"
+#include "executor/execBatch.h"
+#include "lib/dshash.h"
 #include "nodes/execnodes.h"
+#include "storage/barrier.h"
+#include "storage/buffile.h"
 
 
 /*
@@ -288,6 +293,10 @@ typedef struct AggStatePerPhaseData
  * When doing grouping sets with hashing, we have one of these for each
  * grouping set. (When doing hashing without grouping sets, we have just one of
  * them.)
+ *
+ * Once the hash tables have used up their memory, input tuples of groups
+ * that are not in the hash table yet are written to one of spill_npartitions
+ * files instead, chosen by the next bits of the tuple's hash value.
  */
 typedef struct AggStatePerHashData
 {
@@ -302,14 +311,131 @@ typedef struct AggStatePerHashData
 	AttrNumber *hashGrpColIdxInput; /* hash col indices in input slot */
 	AttrNumber *hashGrpColIdxHash;	/* indices in hashtbl tuples */
 	Agg		   *aggnode;		/* original Agg node, for numGroups etc. */
+	int			spill_npartitions;	/* number of partitions, 0 if none */
+	int			spill_used_bits;	/* hash bits used, including these */
+	BufFile   **spill_files;	/* partition files, created on demand */
+	double	   *spill_ntuples;	/* number of tuples in each partition */
 }			AggStatePerHashData;
 
+/*
+ * AggStateSpillBatchData - spilled input of one grouping set
+ *
+ * Tuples written to one partition file while aggregating either the original
+ * input or an earlier batch.  They are aggregated later, one batch at a time,
+ * and may be partitioned again if they still don't fit in memory.
+ */
+typedef struct AggStateSpillBatchData
+{
+	int			setno;			/* grouping set the tuples are for */
+	int			used_bits;		/* hash bits used to partition them */
+	BufFile    *file;			/* hash values and tuples */
+	double		ntuples;		/* number of tuples in the file */
+}			AggStateSpillBatchData;
+
+/*
+ * AggBatchTransKind - how a transition function is applied in batch mode
+ *
+ * The transition functions of the common built-in aggregates are done
+ * inline; any other is called through fmgr once per row.
+ */
+typedef enum AggBatchTransKind
+{
+	AGG_BATCH_TRANS_GENERIC,	/* call the transition function */
+	AGG_BATCH_TRANS_COUNT_STAR, /* int8inc */
+	AGG_BATCH_TRANS_COUNT,		/* int8inc_any */
+	AGG_BATCH_TRANS_INT4_SUM,	/* int4_sum */
+	AGG_BATCH_TRANS_FLOAT8_SUM, /* float8pl */
+	AGG_BATCH_TRANS_INT4_MIN,	/* int4smaller, date_smaller */
+	AGG_BATCH_TRANS_INT4_MAX,	/* int4larger, date_larger */
+	AGG_BATCH_TRANS_INT8_MIN,	/* int8smaller, timestamp_smaller */
+	AGG_BATCH_TRANS_INT8_MAX,	/* int8larger, timestamp_larger */
+	AGG_BATCH_TRANS_FLOAT8_MIN, /* float8smaller */
+	AGG_BATCH_TRANS_FLOAT8_MAX	/* float8larger */
+} AggBatchTransKind;
+
+/*
+ * AggStatePerTransBatchData - per-transition-state batch-mode information
+ */
+typedef struct AggStatePerTransBatchData
+{
+	AggBatchTransKind kind;
+	BatchExpr **args;			/* numTransInputs input expressions */
+	BatchExpr  *filter;			/* FILTER clause, or NULL */
+}			AggStatePerTransBatchData;
+
+/*
+ * AggStateBatchData - batch-mode execution state
+ *
+ * A plain Agg whose input is a sequential scan reads the scan a batch of rows
+ * at a time, if the scan's quals and all the aggregates' inputs can be
+ * evaluated in batch mode (see executor/execBatch.c).  This is set up during
+ * ExecInitAgg() and does not change thereafter.
+ */
+typedef struct AggStateBatchData
+{
+	BatchScanState *scan;		/* batch-mode reader of the outer plan */
+	AggStatePerTransBatchData *pertrans;	/* array, indexed by transno */
+	int		   *sel;			/* scratch selection for FILTER clauses */
+}			AggStateBatchData;
+
+/*
+ * ParallelAggState - shared state of a Parallel HashAggregate
+ *
+ * All participants add their input to one dshash table, created by whichever
+ * of them gets there first.  Each entry holds the grouping columns, followed
+ * by the transition states of the group.  Once every participant has added
+ * all its input, as arranged by the barrier, the groups are finalized and
+ * returned a dshash lock partition at a time, the partitions being handed
+ * out to the participants by next_partition.
+ */
+typedef struct ParallelAggState
+{
+	LWLock		lock;			/* protects hashtable */
+	dshash_table_handle hashtable;	/* shared hash table, once created */
+	Barrier		barrier;		/* phase 0: filling, 1: returning groups */
+	pg_atomic_uint32 next_partition;	/* next partition to return */
+}			ParallelAggState;
+
+/*
+ * AggStateSharedData - backend-local state of a Parallel HashAggregate
+ *
+ * The key of a shared hash table entry is the values of the grouping columns
+ * followed by their null flags.  Only grouping columns of pass-by-value types
+ * whose equality is bitwise equality are supported, so that the key can be
+ * hashed and compared as plain bytes, and only pass-by-value transition
+ * states, so that the entry can hold them directly.  The planner checks that.
+ *
+ * The aggregates' FILTER clauses and arguments are evaluated before the
+ * group's entry is locked, using the separately initialized expressions
+ * here, so that only the transition functions run while the lock is held.
+ */
+typedef struct AggStateSharedData
+{
+	ParallelAggState *pstate;	/* shared state, in the DSM segment */
+	dshash_table *hashtable;	/* shared hash table, once attached */
+	dshash_parameters params;	/* key and entry sizes, etc. */
+	Size		pergroup_offset;	/* offset of transition states in entry */
+	char	   *key;			/* key of the current input tuple */
+	ExprState **transfilters;	/* per-trans FILTER clause, or NULL */
+	ExprState ***transargs;		/* per-trans transfn arguments */
+	bool	   *transskip;		/* per-trans: input filtered out? */
+	int			partition;		/* partition being returned, or -1 */
+	dshash_partition_iterator iter; /* position in that partition */
+}			AggStateSharedData;
+
 
 extern AggState *ExecInitAgg(Agg *node, EState *estate, int eflags);
 extern void ExecEndAgg(AggState *node);
 extern void ExecReScanAgg(AggState *node);
 
+extern void ExecAggEstimate(AggState *node, ParallelContext *pcxt);
+extern void ExecAggInitializeDSM(AggState *node, ParallelContext *pcxt);
+extern void ExecAggReInitializeDSM(AggState *node, ParallelContext *pcxt);
+extern void ExecAggInitializeWorker(AggState *node,
+						ParallelWorkerContext *pwcxt);
+
 extern Size hash_agg_entry_size(int numAggs);
+extern int	hash_agg_max_partitions(void);
 
 extern Datum aggregate_dummy(PG_FUNCTION_ARGS);
 
@@ -15,10 +15,20 @@
 #define NODEHASH_H
 
 #include "access/parallel.h"
+#include "lib/bloomfilter.h"
 #include "nodes/execnodes.h"
 
 struct SharedHashJoinBatch;
 
+/*
+ * A runtime filter is passed to the scan it is pushed down into as a bytea
+ * Datum, holding a Bloom filter over the hash values of the inner tuples.
+ * The filter is stored at a MAXALIGN'd offset.
+ */
+#define RUNTIME_FILTER_OFFSET	MAXALIGN(VARHDRSZ)
+#define DatumGetRuntimeFilter(X) \
+	((bloom_filter *) ((char *) DatumGetPointer(X) + RUNTIME_FILTER_OFFSET))
+
 extern HashState *ExecInitHash(Hash *node, EState *estate, int eflags);
 extern Node *MultiExecHash(HashState *node);
 extern void ExecEndHash(HashState *node);
@@ -56,8 +66,11 @@ extern void ExecHashGetBucketAndBatch(HashJoinTable hashtable,
 extern bool ExecScanHashBucket(HashJoinState *hjstate, ExprContext *econtext);
 extern bool ExecParallelScanHashBucket(HashJoinState *hjstate, ExprContext *econtext);
 extern void ExecPrepHashTableForUnmatched(HashJoinState *hjstate);
+extern bool ExecParallelPrepHashTableForUnmatched(HashJoinState *hjstate);
 extern bool ExecScanHashTableForUnmatched(HashJoinState *hjstate,
 							  ExprContext *econtext);
+extern bool ExecParallelScanHashTableForUnmatched(HashJoinState *hjstate,
+									  ExprContext *econtext);
 extern void ExecHashTableReset(HashJoinTable hashtable);
 extern void ExecHashTableResetMatchFlags(HashJoinTable hashtable);
 extern void ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
@@ -16,6 +16,24 @@
 
 #include "access/parallel.h"
 #include "nodes/execnodes.h"
+#include "storage/condition_variable.h"
+#include "storage/spin.h"
+
+/*
+ * ParallelSortState - shared state of a parallel-aware Sort
+ *
+ * Every participant sorts its share of the input into a run, using the
+ * Sharedsort that follows this struct in the same DSM chunk, and the leader
+ * merges the runs once nparticipantsdone shows that they are all written.
+ * If instrumenting, the workers' sort statistics come after the Sharedsort.
+ */
+typedef struct ParallelSortState
+{
+	ConditionVariable cv;		/* signaled when a participant is done */
+	slock_t		mutex;			/* protects nparticipantsdone */
+	int			nparticipantsdone;	/* number of participants done sorting */
+	Size		info_offset;	/* offset of the SharedSortInfo, or 0 */
+} ParallelSortState;
 
 extern SortState *ExecInitSort(Sort *node, EState *estate, int eflags);
 extern void ExecEndSort(SortState *node);
@@ -23,9 +41,10 @@ extern void ExecSortMarkPos(SortState *node);
 extern void ExecSortRestrPos(SortState *node);
 extern void ExecReScanSort(SortState *node);
 
-/* parallel instrumentation support */
+/* parallel sort and instrumentation support */
 extern void ExecSortEstimate(SortState *node, ParallelContext *pcxt);
 extern void ExecSortInitializeDSM(SortState *node, ParallelContext *pcxt);
+extern void ExecSortReInitializeDSM(SortState *node, ParallelContext *pcxt);
 extern void ExecSortInitializeWorker(SortState *node, ParallelWorkerContext *pwcxt);
 extern void ExecSortRetrieveInstrumentation(SortState *node);
 
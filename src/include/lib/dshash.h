@@ -16,6 +16,15 @@
 
 #include "utils/dsa.h"
 
+/*
+ * The number of partitions for locking purposes.  This is set to match
+ * NUM_BUFFER_PARTITIONS for now, on the basis that whatever's good enough for
+ * the buffer pool must be good enough for any other purpose.  This could
+ * become a runtime parameter in future.
+ */
+#define DSHASH_NUM_PARTITIONS_LOG2 7
+#define DSHASH_NUM_PARTITIONS (1 << DSHASH_NUM_PARTITIONS_LOG2)
+
 /* The opaque type representing a hash table. */
 struct dshash_table;
 typedef struct dshash_table dshash_table;
@@ -59,6 +68,18 @@ typedef struct dshash_parameters
 struct dshash_table_item;
 typedef struct dshash_table_item dshash_table_item;
 
+/*
+ * State for iterating over the entries in one lock partition.  The members
+ * are private to dshash.c.
+ */
+typedef struct dshash_partition_iterator
+{
+	dshash_table *hash_table;
+	size_t		bucket;			/* next bucket to look at */
+	size_t		end_bucket;		/* first bucket of the next partition */
+	dsa_pointer item;			/* next item to return */
+} dshash_partition_iterator;
+
 /* Creating, sharing and destroying from hash tables. */
 extern dshash_table *dshash_create(dsa_area *area,
 			  const dshash_parameters *params,
@@ -80,6 +101,12 @@ extern bool dshash_delete_key(dshash_table *hash_table, const void *key);
 extern void dshash_delete_entry(dshash_table *hash_table, void *entry);
 extern void dshash_release_lock(dshash_table *hash_table, void *entry);
 
+/* Iterating over entries, when there are no concurrent modifications. */
+extern void dshash_partition_iterate_begin(dshash_table *hash_table,
+							   int partition,
+							   dshash_partition_iterator *iter);
+extern void *dshash_partition_iterate_next(dshash_partition_iterator *iter);
+
 /* Convenience hash and compare functions wrapping memcmp and tag_hash. */
 extern int	dshash_memcmp(const void *a, const void *b, size_t size, void *arg);
 extern dshash_hash dshash_memhash(const void *v, size_t size, void *arg);
@@ -63,6 +63,7 @@ typedef struct
 #endif
 #endif							/* ENABLE_SSPI */
 
+#include "common/zpq_stream.h"
 #include "datatype/timestamp.h"
 #include "libpq/hba.h"
 #include "libpq/pqcomm.h"
@@ -150,6 +151,19 @@ typedef struct Port
 	 */
 	TimestampTz SessionStartTime;	/* backend start time */
 
+	/*
+	 * When each phase of connection startup began and ended, for the
+	 * pg_stat_connection_startup view.  Zero if the phase was not reached.
+	 * The backend process starts running at SessionStartTime.
+	 */
+	TimestampTz accept_time;	/* postmaster accepted the connection */
+	TimestampTz ssl_start_time; /* SSL handshake */
+	TimestampTz ssl_end_time;
+	TimestampTz auth_start_time;	/* client authentication */
+	TimestampTz auth_end_time;
+	TimestampTz init_start_time;	/* InitPostgres */
+	TimestampTz init_end_time;
+
 	/*
 	 * TCP keepalive settings.
 	 *
@@ -175,6 +189,15 @@ typedef struct Port
 	void	   *gss;
 #endif
 
+	/*
+	 * Protocol compression.  compression_algorithm is the algorithm chosen
+	 * from the client's request, if any; compression starts once the client
+	 * is authenticated.  All traffic after the CompressionAck message then
+	 * goes through zstream.
+	 */
+	char	   *compression_algorithm;
+	ZpqStream  *zstream;
+
 	/*
 	 * SSL structures.
 	 */
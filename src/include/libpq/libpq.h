@@ -20,6 +20,7 @@
 #include "libpq/libpq-be.h"
 #include "storage/latch.h"
 
+struct iovec;					/* avoid including port/pg_iovec.h here */
 
 typedef struct
 {
@@ -53,14 +54,23 @@ extern PGDLLIMPORT PQcommMethods *PqCommMethods;
 /*
  * prototypes for functions in pqcomm.c
  */
+extern bool libpq_compression;
+extern bool libpq_compression_over_ssl;
+
 extern int StreamServerPort(int family, char *hostName,
 				 unsigned short portNumber, char *unixSocketDir,
 				 pgsocket ListenSocket[], int MaxListen);
 extern int	StreamConnection(pgsocket server_fd, Port *port);
 extern void StreamClose(pgsocket sock);
+extern int StreamSendSocket(pgsocket chan, pgsocket sock, const void *data,
+				 size_t len, bool nowait);
+extern pgsocket StreamReceiveSocket(pgsocket chan, void *data, ssize_t *len,
+					bool nowait);
 extern void TouchSocketFiles(void);
 extern void RemoveSocketFiles(void);
 extern void pq_init(void);
+extern void pq_switch_port(Port *port);
+extern void pq_enable_compression(const char *algorithm);
 extern int	pq_getbytes(char *s, size_t len);
 extern int	pq_getstring(StringInfo s);
 extern void pq_startmsgread(void);
@@ -70,6 +80,7 @@ extern int	pq_getmessage(StringInfo s, int maxlen);
 extern int	pq_getbyte(void);
 extern int	pq_peekbyte(void);
 extern int	pq_getbyte_if_available(unsigned char *c);
+extern bool pq_buffer_has_data(void);
 extern int	pq_putbytes(const char *s, size_t len);
 
 /*
@@ -90,8 +101,11 @@ extern int	secure_open_server(Port *port);
 extern void secure_close(Port *port);
 extern ssize_t secure_read(Port *port, void *ptr, size_t len);
 extern ssize_t secure_write(Port *port, void *ptr, size_t len);
+extern ssize_t secure_writev(Port *port, const struct iovec *iov, int iovcnt);
 extern ssize_t secure_raw_read(Port *port, void *ptr, size_t len);
 extern ssize_t secure_raw_write(Port *port, const void *ptr, size_t len);
+extern ssize_t secure_raw_writev(Port *port, const struct iovec *iov,
+				  int iovcnt);
 
 extern bool ssl_loaded_verify_locations;
 
@@ -18,6 +18,7 @@
 #include "access/heapam.h"
 #include "access/tupconvert.h"
 #include "executor/instrument.h"
+#include "lib/ilist.h"
 #include "lib/pairingheap.h"
 #include "nodes/params.h"
 #include "nodes/plannodes.h"
@@ -435,6 +436,12 @@ typedef struct ResultRelInfo
 	/* true when modifying foreign table directly */
 	bool		ri_usesFdwDirectModify;
 
+	/* batch insert stuff, for foreign tables whose FDW supports it */
+	int			ri_NumSlots;	/* number of tuples accumulated in the batch */
+	int			ri_BatchSize;	/* max number of tuples inserted in a batch */
+	TupleTableSlot **ri_Slots;	/* input tuples for batch insert */
+	TupleTableSlot **ri_PlanSlots;	/* corresponding subplan output tuples */
+
 	/* list of WithCheckOption's to be checked */
 	List	   *ri_WithCheckOptions;
 
@@ -991,6 +998,8 @@ typedef struct PlanState
 	 * descriptor, without encoding knowledge about all executor nodes.
 	 */
 	TupleDesc	scandesc;
+
+	bool		async_capable;	/* true if node is async-capable */
 } PlanState;
 
 /* ----------------
@@ -1120,6 +1129,23 @@ typedef struct ModifyTableState
 	int			mt_merge_subcommands;
 } ModifyTableState;
 
+/* ----------------
+ *	 AsyncRequest
+ *
+ *		State for an asynchronous tuple request.
+ * ----------------
+ */
+typedef struct AsyncRequest
+{
+	struct PlanState *requestor;	/* Node that wants a tuple */
+	struct PlanState *requestee;	/* Node from which a tuple is wanted */
+	int			request_index;	/* Scratch space for requestor */
+	bool		callback_pending;	/* Callback is needed */
+	bool		request_complete;	/* Request complete, result valid */
+	TupleTableSlot *result;		/* Result (NULL or an empty slot if no more
+								 * tuples) */
+} AsyncRequest;
+
 /* ----------------
  *	 AppendState information
  *
@@ -1130,6 +1156,18 @@ typedef struct ModifyTableState
  *							eliminated from the scan, or NULL if not possible.
  *		valid_subplans		for runtime pruning, valid appendplans indexes to
  *							scan.
+ *		begun				false means we have not yet started any
+ *							subplan; async subplans are kicked off then.
+ *		asyncplans			indexes of the async-capable subplans.
+ *		asyncrequests		one AsyncRequest per subplan, NULL for the
+ *							synchronous ones.
+ *		asyncresults		tuples returned by async subplans that have not
+ *							been handed up yet.
+ *		syncdone			true once all synchronous subplans are done.
+ *		nasyncremain		number of async subplans not yet exhausted.
+ *		needrequest			async subplans ready for another request.
+ *		eventset			WaitEventSet used to wait for async subplans.
+ *		valid_asyncplans	for runtime pruning, valid async subplans.
  * ----------------
  */
 
@@ -1149,6 +1187,17 @@ struct AppendState
 	Size		pstate_len;		/* size of parallel coordination info */
 	struct PartitionPruneState *as_prune_state;
 	Bitmapset  *as_valid_subplans;
+	bool		as_begun;
+	Bitmapset  *as_asyncplans;
+	int			as_nasyncplans;
+	AsyncRequest **as_asyncrequests;
+	TupleTableSlot **as_asyncresults;
+	int			as_nasyncresults;
+	bool		as_syncdone;
+	int			as_nasyncremain;
+	Bitmapset  *as_needrequest;
+	struct WaitEventSet *as_eventset;
+	Bitmapset  *as_valid_asyncplans;
 	bool		(*choose_next_subplan) (AppendState *);
 };
 
@@ -1258,6 +1307,11 @@ typedef struct SeqScanState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 	Size		pscan_len;		/* size of parallel heap scan descriptor */
+	/* runtime filter pushed down from a hash join, see SeqScan */
+	int			filterParam;	/* ID of Param for the filter, or -1 */
+	List	   *filterKeys;		/* list of ExprState for the join keys */
+	FmgrInfo   *filterHashFunctions;	/* hash functions for the keys */
+	bool	   *filterHashStrict;	/* is each hash operator strict? */
 } SeqScanState;
 
 /* ----------------
@@ -1835,6 +1889,12 @@ typedef struct MergeJoinState
  *		hj_JoinState			current state of ExecHashJoin state machine
  *		hj_MatchedOuter			true if found a join match for current outer
  *		hj_OuterNotEmpty		true if outer relation known not empty
+ *		hj_OuterQueue			outer tuples read ahead of probing
+ *		hj_OuterQueueHash		their hash values
+ *		hj_OuterQueueBucket		their buckets, or -1 if not prefetched
+ *		hj_OuterQueueCount		number of tuples in hj_OuterQueue
+ *		hj_OuterQueueNext		index of next tuple to return from it
+ *		hj_OuterQueueDone		true if read-ahead reached end of batch
  * ----------------
  */
 
@@ -1862,6 +1922,12 @@ typedef struct HashJoinState
 	int			hj_JoinState;
 	bool		hj_MatchedOuter;
 	bool		hj_OuterNotEmpty;
+	TupleTableSlot **hj_OuterQueue;
+	uint32	   *hj_OuterQueueHash;
+	int		   *hj_OuterQueueBucket;
+	int			hj_OuterQueueCount;
+	int			hj_OuterQueueNext;
+	bool		hj_OuterQueueDone;
 } HashJoinState;
 
 
@@ -1887,6 +1953,51 @@ typedef struct MaterialState
 	Tuplestorestate *tuplestorestate;
 } MaterialState;
 
+/* ----------------
+ *	 ResultCacheState information
+ *
+ *		result cache nodes keep the tuples returned by their subplan for
+ *		each set of parameter values, in a hash table whose least recently
+ *		used entries are evicted to keep within work_mem.
+ * ----------------
+ */
+typedef struct ResultCacheInstrumentation
+{
+	uint64		cache_hits;		/* rescans answered from the cache */
+	uint64		cache_misses;	/* rescans that had to run the subplan */
+	uint64		cache_evictions;	/* entries evicted to free memory */
+	uint64		cache_overflows;	/* rescans whose results did not fit */
+	Size		mem_peak;		/* peak memory used by the cache, in bytes */
+} ResultCacheInstrumentation;
+
+struct resultcache_hash;		/* private to nodeResultCache.c */
+struct ResultCacheEntry;
+struct ResultCacheTuple;
+
+typedef struct ResultCacheState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	int			rc_status;		/* state of ExecResultCache's state machine */
+	int			nkeys;			/* number of cache keys */
+	ExprState **param_exprs;	/* cache keys */
+	FmgrInfo   *hashfunctions;	/* hash functions for the cache keys */
+	ExprState  *cache_eq_expr;	/* compares tableslot with probeslot */
+	TupleTableSlot *tableslot;	/* holds the keys of a cache entry */
+	TupleTableSlot *probeslot;	/* holds the keys being looked up */
+	struct resultcache_hash *hashtable; /* the cache entries */
+	dlist_head	lru_list;		/* entries, least recently used first */
+	MemoryContext tableContext; /* memory context holding the cache */
+	Size		mem_used;		/* memory used by the cache entries */
+	Size		mem_limit;		/* memory the cache is allowed to use */
+	uint32		est_entries;	/* initial size of the hash table */
+	bool		singlerow;		/* entry complete after the first tuple? */
+	bool		binary_mode;	/* match keys datum for datum? */
+	Bitmapset  *keyparamids;	/* paramids of the params in the keys */
+	struct ResultCacheEntry *entry; /* entry of the current scan, or NULL */
+	struct ResultCacheTuple *last_tuple;	/* last tuple returned from it */
+	ResultCacheInstrumentation stats;	/* execution statistics */
+} ResultCacheState;
+
 /* ----------------
  *	 Shared memory container for per-worker sort information
  * ----------------
@@ -1913,8 +2024,35 @@ typedef struct SortState
 	void	   *tuplesortstate; /* private state of tuplesort.c */
 	bool		am_worker;		/* are we a worker? */
 	SharedSortInfo *shared_info;	/* one entry per worker */
+	struct ParallelSortState *pstate;	/* shared state, if parallel-aware */
+	struct ParallelContext *pcxt;	/* leader's parallel context, likewise */
 } SortState;
 
+/* ----------------
+ *	 IncrementalSortState information
+ *
+ *		The input is read in batches of at least a minimum number of tuples
+ *		that end at a change in the presorted keys, and each batch is sorted
+ *		on its own.  The tuple that ends a batch is kept in transfer_tuple
+ *		for the next one.
+ * ----------------
+ */
+typedef struct IncrementalSortState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	bool		bounded;		/* is the result set bounded? */
+	int64		bound;			/* if bounded, how many tuples are needed */
+	int64		bound_Done;		/* number of tuples sorted so far */
+	bool		sort_Done;		/* current batch sorted yet? */
+	bool		outerNodeDone;	/* read all of the input yet? */
+	ExprState  *presortedEq;	/* equality of the presorted columns */
+	TupleTableSlot *group_pivot;	/* a tuple of the batch's last group */
+	TupleTableSlot *transfer_tuple; /* first tuple of the next batch */
+	void	   *tuplesortstate; /* private state of tuplesort.c */
+	int64		nbatches;		/* number of batches sorted */
+	TuplesortInstrumentation sinstrument;	/* stats of the biggest batch */
+} IncrementalSortState;
+
 /* ---------------------
  *	GroupState information
  * ---------------------
@@ -1944,6 +2082,8 @@ typedef struct AggStatePerTransData *AggStatePerTrans;
 typedef struct AggStatePerGroupData *AggStatePerGroup;
 typedef struct AggStatePerPhaseData *AggStatePerPhase;
 typedef struct AggStatePerHashData *AggStatePerHash;
+typedef struct AggStateBatchData *AggStateBatch;
+typedef struct AggStateSharedData *AggStateShared;
 
 typedef struct AggState
 {
@@ -1995,6 +2135,23 @@ typedef struct AggState
 	AggStatePerGroup *all_pergroups;	/* array of first ->pergroups, than
 										 * ->hash_pergroup */
 	ProjectionInfo *combinedproj;	/* projection machinery */
+
+	/* batch-mode execution state, or NULL if not using batch mode */
+	AggStateBatch batch;
+
+	/* these fields are used when hash tables spill to disk: */
+	bool		hash_spill_mode;	/* memory full, spill tuples of new groups */
+	int			hash_used_bits; /* hash bits used to partition the input */
+	Size		hash_mem_limit; /* memory allowed for the hash tables */
+	double		hash_ngroups_current;	/* number of groups in memory */
+	List	   *hash_spill_batches; /* batches not yet aggregated */
+	TupleTableSlot *hash_spill_slot;	/* slot for reading spilled tuples */
+	int			hash_batches_used;	/* number of batches aggregated */
+	Size		hash_mem_peak;	/* peak hash table memory usage */
+	uint64		hash_disk_used; /* bytes written to spill files */
+
+	/* shared hash table state of a Parallel HashAggregate, or NULL */
+	AggStateShared shared;
 } AggState;
 
 /* ----------------
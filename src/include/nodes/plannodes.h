@@ -140,6 +140,11 @@ typedef struct Plan
 	bool		parallel_aware; /* engage parallel-aware logic? */
 	bool		parallel_safe;	/* OK to use as part of parallel plan? */
 
+	/*
+	 * information needed for asynchronous execution
+	 */
+	bool		async_capable;	/* engage asynchronous-capable logic? */
+
 	/*
 	 * Common structural data for all Plan types.
 	 */
@@ -349,9 +354,21 @@ typedef struct Scan
 
 /* ----------------
  *		sequential scan node
+ *
+ * A hash join above the scan may push a runtime filter down into it: a
+ * Bloom filter over the hash values of the inner join keys, which the Hash
+ * node passes in the PARAM_EXEC param filterParam once it has been built.
+ * Tuples whose filterKeys hash to a value missing from the filter can't
+ * have a join partner, so the scan drops them.
  * ----------------
  */
-typedef Scan SeqScan;
+typedef struct SeqScan
+{
+	Scan		scan;
+	int			filterParam;	/* ID of Param for the filter, or -1 */
+	List	   *filterKeys;		/* outer join key expressions */
+	List	   *filterHashOps;	/* hash join operator OIDs for the keys */
+} SeqScan;
 
 /* ----------------
  *		table sample scan node
@@ -753,6 +770,27 @@ typedef struct Material
 	Plan		plan;
 } Material;
 
+/* ----------------
+ *		result cache node
+ *
+ * The tuples returned by the subplan are kept for each set of values of
+ * param_exprs, which must contain all the parameters that the subplan's
+ * results depend on, so that rescans with the same values need not run the
+ * subplan again.  Only the inner side of a nestloop uses this.
+ * ----------------
+ */
+typedef struct ResultCache
+{
+	Plan		plan;
+	int			numKeys;		/* number of cache keys */
+	Oid		   *eqOperators;	/* equality operators to compare keys with */
+	List	   *param_exprs;	/* cache keys, as expressions of parameters */
+	bool		singlerow;		/* at most one tuple per set of keys? */
+	bool		binary_mode;	/* match keys datum for datum? */
+	uint32		est_entries;	/* estimated number of entries, or 0 */
+	Bitmapset  *keyparamids;	/* paramids of the params in param_exprs */
+} ResultCache;
+
 /* ----------------
  *		sort node
  * ----------------
@@ -767,6 +805,19 @@ typedef struct Sort
 	bool	   *nullsFirst;		/* NULLS FIRST/LAST directions */
 } Sort;
 
+/* ----------------
+ *		incremental sort node
+ *
+ * The input is already sorted by the first presortedCols sort keys, so only
+ * each group of tuples that are equal in those needs to be sorted.
+ * ----------------
+ */
+typedef struct IncrementalSort
+{
+	Sort		sort;
+	int			presortedCols;	/* number of presorted columns */
+} IncrementalSort;
+
 /* ---------------
  *	 group node -
  *		Used for queries with GROUP BY (but no aggregates) specified.
@@ -904,6 +955,7 @@ typedef struct Hash
 	bool		skewInherit;	/* is outer join rel an inheritance tree? */
 	/* all other info is in the parent HashJoin node */
 	double		rows_total;		/* estimate total rows if parallel_aware */
+	int			filterParam;	/* ID of Param for a runtime filter, or -1 */
 } Hash;
 
 /* ----------------
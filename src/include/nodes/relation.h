@@ -1344,6 +1344,24 @@ typedef struct MaterialPath
 	Path	   *subpath;
 } MaterialPath;
 
+/*
+ * ResultCachePath represents a ResultCache plan node, i.e., a cache of the
+ * output of a parameterized subpath for each set of parameter values.  It is
+ * used on the inner side of a nestloop, when the outer side is expected to
+ * supply the same values over and over.
+ */
+typedef struct ResultCachePath
+{
+	Path		path;
+	Path	   *subpath;
+	List	   *eq_operators;	/* equality operators for the cache keys */
+	List	   *param_exprs;	/* cache keys */
+	bool		singlerow;		/* at most one tuple per set of keys? */
+	bool		binary_mode;	/* match keys datum for datum? */
+	double		calls;			/* expected number of rescans */
+	uint32		est_entries;	/* expected number of cache entries */
+} ResultCachePath;
+
 /*
  * UniquePath represents elimination of distinct rows from the output of
  * its subpath.
@@ -1537,6 +1555,18 @@ typedef struct SortPath
 	Path	   *subpath;		/* path representing input source */
 } SortPath;
 
+/*
+ * IncrementalSortPath represents an incremental sort step
+ *
+ * This is like a regular sort, except the input is already sorted by the
+ * first nPresortedCols pathkeys.
+ */
+typedef struct IncrementalSortPath
+{
+	SortPath	spath;
+	int			nPresortedCols; /* number of presorted columns */
+} IncrementalSortPath;
+
 /*
  * GroupPath represents grouping (of presorted input)
  *
@@ -74,6 +74,7 @@ extern bool is_pseudo_constant_clause(Node *clause);
 extern bool is_pseudo_constant_clause_relids(Node *clause, Relids relids);
 
 extern int	NumRelids(Node *clause);
+extern Bitmapset *pull_paramids(Node *clause);
 
 extern void CommuteOpExpr(OpExpr *clause);
 extern void CommuteRowCompareExpr(RowCompareExpr *clause);
@@ -78,6 +78,14 @@ extern MergeAppendPath *create_merge_append_path(PlannerInfo *root,
 extern ResultPath *create_result_path(PlannerInfo *root, RelOptInfo *rel,
 				   PathTarget *target, List *resconstantqual);
 extern MaterialPath *create_material_path(RelOptInfo *rel, Path *subpath);
+extern ResultCachePath *create_resultcache_path(PlannerInfo *root,
+						RelOptInfo *rel,
+						Path *subpath,
+						List *param_exprs,
+						List *eq_operators,
+						bool singlerow,
+						bool binary_mode,
+						double calls);
 extern UniquePath *create_unique_path(PlannerInfo *root, RelOptInfo *rel,
 				   Path *subpath, SpecialJoinInfo *sjinfo);
 extern GatherPath *create_gather_path(PlannerInfo *root,
@@ -175,6 +183,16 @@ extern SortPath *create_sort_path(PlannerInfo *root,
 				 Path *subpath,
 				 List *pathkeys,
 				 double limit_tuples);
+extern SortPath *create_parallel_sort_path(PlannerInfo *root,
+						  RelOptInfo *rel,
+						  Path *subpath,
+						  List *pathkeys);
+extern IncrementalSortPath *create_incremental_sort_path(PlannerInfo *root,
+							 RelOptInfo *rel,
+							 Path *subpath,
+							 List *pathkeys,
+							 int presorted_keys,
+							 double limit_tuples);
 extern GroupPath *create_group_path(PlannerInfo *root,
 				  RelOptInfo *rel,
 				  Path *subpath,
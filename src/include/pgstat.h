@@ -21,6 +21,7 @@
 #include "utils/hsearch.h"
 #include "utils/relcache.h"
 
+struct Port;					/* not to include libpq-be.h here */
 
 /* ----------
  * Paths for the statistics files (relative to installation's $PGDATA).
@@ -64,7 +65,8 @@ typedef enum StatMsgType
 	PGSTAT_MTYPE_FUNCPURGE,
 	PGSTAT_MTYPE_RECOVERYCONFLICT,
 	PGSTAT_MTYPE_TEMPFILE,
-	PGSTAT_MTYPE_DEADLOCK
+	PGSTAT_MTYPE_DEADLOCK,
+	PGSTAT_MTYPE_CONNSTARTUP
 } StatMsgType;
 
 /* ----------
@@ -119,9 +121,32 @@ typedef struct PgStat_TableCounts
 typedef enum PgStat_Shared_Reset_Target
 {
 	RESET_ARCHIVER,
-	RESET_BGWRITER
+	RESET_BGWRITER,
+	RESET_CONNECTION_STARTUP
 } PgStat_Shared_Reset_Target;
 
+/* ----------
+ * Phases of connection startup timed by each new backend
+ * ----------
+ */
+typedef enum PgStat_ConnStartupPhase
+{
+	CONN_STARTUP_FORK,			/* accept() until backend process is running */
+	CONN_STARTUP_SSL,			/* SSL handshake */
+	CONN_STARTUP_AUTH,			/* client authentication */
+	CONN_STARTUP_INIT,			/* rest of InitPostgres */
+	CONN_STARTUP_READY,			/* InitPostgres until first ReadyForQuery */
+	CONN_STARTUP_TOTAL			/* accept() until first ReadyForQuery */
+} PgStat_ConnStartupPhase;
+
+#define CONN_STARTUP_NUM_PHASES		(CONN_STARTUP_TOTAL + 1)
+
+/*
+ * Each phase's durations are counted in a histogram whose buckets cover
+ * less than 0.1ms, 1ms, 10ms, 100ms, 1s and 10s, and everything longer.
+ */
+#define CONN_STARTUP_HIST_BUCKETS	7
+
 /* Possible object types for resetting single counters */
 typedef enum PgStat_Single_Reset_Type
 {
@@ -531,6 +556,19 @@ typedef struct PgStat_MsgDeadlock
 } PgStat_MsgDeadlock;
 
 
+/* ----------
+ * PgStat_MsgConnStartup		Sent by a new backend to report how long
+ *								each phase of connection startup took.
+ * ----------
+ */
+typedef struct PgStat_MsgConnStartup
+{
+	PgStat_MsgHdr m_hdr;
+	PgStat_Counter m_phase_time[CONN_STARTUP_NUM_PHASES];	/* usecs, or -1 if
+															 * not timed */
+} PgStat_MsgConnStartup;
+
+
 /* ----------
  * PgStat_Msg					Union over all possible messages.
  * ----------
@@ -555,6 +593,7 @@ typedef union PgStat_Msg
 	PgStat_MsgFuncpurge msg_funcpurge;
 	PgStat_MsgRecoveryConflict msg_recoveryconflict;
 	PgStat_MsgDeadlock msg_deadlock;
+	PgStat_MsgConnStartup msg_connstartup;
 } PgStat_Msg;
 
 
@@ -566,7 +605,7 @@ typedef union PgStat_Msg
  * ------------------------------------------------------------
  */
 
-#define PGSTAT_FILE_FORMAT_ID	0x01A5BC9D
+#define PGSTAT_FILE_FORMAT_ID	0x01A5BC9E
 
 /* ----------
  * PgStat_StatDBEntry			The collector's data per database
@@ -694,6 +733,18 @@ typedef struct PgStat_GlobalStats
 	TimestampTz stat_reset_timestamp;
 } PgStat_GlobalStats;
 
+/*
+ * Connection startup statistics kept in the stats collector
+ */
+typedef struct PgStat_ConnStartupStats
+{
+	PgStat_Counter count[CONN_STARTUP_NUM_PHASES];
+	PgStat_Counter total_time[CONN_STARTUP_NUM_PHASES]; /* times in
+														 * microseconds */
+	PgStat_Counter histogram[CONN_STARTUP_NUM_PHASES][CONN_STARTUP_HIST_BUCKETS];
+	TimestampTz stat_reset_timestamp;
+} PgStat_ConnStartupStats;
+
 
 /* ----------
  * Backend types
@@ -799,7 +850,8 @@ typedef enum
  */
 typedef enum
 {
-	WAIT_EVENT_BGWORKER_SHUTDOWN = PG_WAIT_IPC,
+	WAIT_EVENT_APPEND_READY = PG_WAIT_IPC,
+	WAIT_EVENT_BGWORKER_SHUTDOWN,
 	WAIT_EVENT_BGWORKER_STARTUP,
 	WAIT_EVENT_BTREE_PAGE,
 	WAIT_EVENT_EXECUTE_GATHER,
@@ -818,6 +870,7 @@ typedef enum
 	WAIT_EVENT_HASH_GROW_BUCKETS_ELECTING,
 	WAIT_EVENT_HASH_GROW_BUCKETS_REINSERTING,
 	WAIT_EVENT_HASH_GROW_BUCKETS_ALLOCATING,
+	WAIT_EVENT_HASHAGG_FILLING,
 	WAIT_EVENT_LOGICAL_SYNC_DATA,
 	WAIT_EVENT_LOGICAL_SYNC_STATE_CHANGE,
 	WAIT_EVENT_MQ_INTERNAL,
@@ -827,6 +880,7 @@ typedef enum
 	WAIT_EVENT_PARALLEL_FINISH,
 	WAIT_EVENT_PARALLEL_BITMAP_SCAN,
 	WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN,
+	WAIT_EVENT_PARALLEL_SORT,
 	WAIT_EVENT_PROCARRAY_GROUP_UPDATE,
 	WAIT_EVENT_CLOG_GROUP_UPDATE,
 	WAIT_EVENT_REPLICATION_ORIGIN_DROP,
@@ -1337,6 +1391,8 @@ extern void pgstat_twophase_postabort(TransactionId xid, uint16 info,
 
 extern void pgstat_send_archiver(const char *xlog, bool failed);
 extern void pgstat_send_bgwriter(void);
+extern void pgstat_report_connection_startup(struct Port *port,
+								 TimestampTz ready_time);
 
 /* ----------
  * Support functions for the SQL-callable functions to
@@ -1351,5 +1407,6 @@ extern PgStat_StatFuncEntry *pgstat_fetch_stat_funcentry(Oid funcid);
 extern int	pgstat_fetch_stat_numbackends(void);
 extern PgStat_ArchiverStats *pgstat_fetch_stat_archiver(void);
 extern PgStat_GlobalStats *pgstat_fetch_global(void);
+extern PgStat_ConnStartupStats *pgstat_fetch_stat_connstartup(void);
 
 #endif							/* PGSTAT_H */
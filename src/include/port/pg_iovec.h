@@ -0,0 +1,35 @@
+/*-------------------------------------------------------------------------
+ *
+ * pg_iovec.h
+ *	  Header for the vectored I/O structure.
+ *
+ * struct iovec comes from <sys/uio.h> where that exists.  Windows doesn't
+ * have it, so we supply a compatible definition there; code that does a
+ * gathering write must fall back to writing one buffer at a time on that
+ * platform.
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ *
+ * src/include/port/pg_iovec.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PG_IOVEC_H
+#define PG_IOVEC_H
+
+#ifndef WIN32
+
+#include <sys/uio.h>
+
+#else
+
+/* POSIX-compatible definition for Windows */
+struct iovec
+{
+	void	   *iov_base;
+	size_t		iov_len;
+};
+
+#endif							/* WIN32 */
+
+#endif							/* PG_IOVEC_H */
@@ -16,6 +16,7 @@
 /* GUC options */
 extern bool EnableSSL;
 extern int	ReservedBackends;
+extern int	PreforkBackends;
 extern PGDLLIMPORT int PostPortNumber;
 extern int	Unix_socket_permissions;
 extern char *Unix_socket_group;
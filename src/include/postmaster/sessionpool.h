@@ -0,0 +1,92 @@
+/*-------------------------------------------------------------------------
+ *
+ * sessionpool.h
+ *	  Exports from postmaster/sessionpool.c.
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ *
+ * src/include/postmaster/sessionpool.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _SESSIONPOOL_H
+#define _SESSIONPOOL_H
+
+#include "libpq/libpq-be.h"
+#include "libpq/pqcomm.h"
+#include "utils/dsa.h"
+
+/* GUC options */
+extern int	SessionPoolSize;
+extern int	SessionPoolReturnDelay;
+
+/*
+ * Datagram socket pair through which backends hand authenticated client
+ * sessions over to the postmaster.  The postmaster reads from the
+ * SESSION_HANDOFF_RECV end; all other processes may write to the
+ * SESSION_HANDOFF_SEND end.
+ */
+extern pgsocket SessionHandoffSock[2];
+
+#define SESSION_HANDOFF_RECV	0
+#define SESSION_HANDOFF_SEND	1
+
+/*
+ * In a backend serving pooled sessions, the socket on which the postmaster
+ * sends it new sessions; PGINVALID_SOCKET in all other processes.
+ */
+extern pgsocket SessionPoolSock;
+
+#define IsSessionPoolWorker() (SessionPoolSock != PGINVALID_SOCKET)
+
+/*
+ * Fixed-size start of a message describing a session.  It is followed by the
+ * database and user names and, for a new session, the option name/value
+ * pairs from its startup packet.
+ */
+typedef struct SessionHandoffHeader
+{
+	ProtocolVersion proto;		/* frontend protocol version */
+	uint32		flags;			/* see below */
+	int32		cancel_pid;		/* process ID given to a returned session's
+								 * client */
+	int32		cancel_key;		/* cancel key given to its client */
+	dsa_pointer state;			/* serialized state of a returned session */
+} SessionHandoffHeader;
+
+/*
+ * The session has been served before, and is being returned to the postmaster
+ * to be passed on to whichever pool worker is free when the client next sends
+ * something.  The client has already been through the startup sequence, and
+ * the session's settings and prepared statements are in "state" (see
+ * SerializeSessionState).
+ */
+#define SESSION_HANDOFF_RESUMED		0x0001
+
+/*
+ * Upper bound on the size of a message describing a session: the header,
+ * database and user names, and the options from the startup packet, which
+ * cannot be longer than the packet itself.
+ */
+#define MAX_SESSION_HANDOFF_LENGTH \
+	(sizeof(SessionHandoffHeader) + 2 * NAMEDATALEN + MAX_STARTUP_PACKET_LENGTH)
+
+extern bool SessionPoolEnabled(Port *port);
+extern void SessionPoolHandoff(Port *port) pg_attribute_noreturn();
+extern bool SessionHandoffGetKey(const char *msg, size_t len,
+					 const char **database, const char **user);
+
+extern Port *SessionPoolFirstSession(void);
+extern void SessionPoolStartSession(void);
+extern bool SessionPoolSchedule(bool *started);
+extern void SessionPoolCloseSession(void);
+extern int	SessionPoolTerminateLevel(void);
+extern bool SessionPoolClosePending(void);
+
+extern Size SessionPoolShmemSize(void);
+extern void SessionPoolShmemInit(void);
+extern void SessionPoolClearCancelSlot(int child_slot);
+extern bool SessionPoolCancel(int child_slot, int pid, int32 key);
+extern bool SessionPoolCancelIsForCurrent(void);
+
+#endif							/* _SESSIONPOOL_H */
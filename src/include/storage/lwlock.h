@@ -212,10 +212,16 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_LOCK_MANAGER,
 	LWTRANCHE_PREDICATE_LOCK_MANAGER,
 	LWTRANCHE_PARALLEL_HASH_JOIN,
+	LWTRANCHE_PARALLEL_HASH_AGG,
 	LWTRANCHE_PARALLEL_QUERY_DSA,
 	LWTRANCHE_SESSION_DSA,
 	LWTRANCHE_SESSION_RECORD_TABLE,
 	LWTRANCHE_SESSION_TYPMOD_TABLE,
+	LWTRANCHE_SESSION_STATE_DSA,
+	LWTRANCHE_SHARED_CATCACHE,
+	LWTRANCHE_SHARED_CATCACHE_DSA,
+	LWTRANCHE_SHARED_PLANCACHE,
+	LWTRANCHE_SHARED_PLANCACHE_DSA,
 	LWTRANCHE_SHARED_TUPLESTORE,
 	LWTRANCHE_TBM,
 	LWTRANCHE_PARALLEL_APPEND,
@@ -23,6 +23,7 @@
 #include "access/htup.h"
 #include "access/skey.h"
 #include "lib/ilist.h"
+#include "utils/dsa.h"
 #include "utils/relcache.h"
 
 /*
@@ -118,8 +119,16 @@ typedef struct catctup
 	int			refcount;		/* number of active references */
 	bool		dead;			/* dead but not yet removed? */
 	bool		negative;		/* negative cache entry? */
+	bool		recently_used;	/* searched since last CatalogCacheShrink? */
 	HeapTupleData tuple;		/* tuple management header */
 
+	/*
+	 * An entry taken from the shared catalog cache doesn't have a copy of the
+	 * tuple of its own; its tuple header points to the shared copy, which
+	 * stays in place as long as we hold a reference to it.
+	 */
+	dsa_pointer shared_tuple;	/* shared tuple we refer to, or invalid */
+
 	/*
 	 * The tuple may also be a member of at most one CatCList.  (If a single
 	 * catcache is list-searched with varying numbers of keys, we may have to
@@ -130,7 +139,11 @@ typedef struct catctup
 	struct catclist *c_list;	/* containing CatCList, or NULL if none */
 
 	CatCache   *my_cache;		/* link to owning catcache */
-	/* properly aligned tuple data follows, unless a negative entry */
+
+	/*
+	 * properly aligned tuple data follows, unless a negative entry or one
+	 * referring to a shared tuple
+	 */
 } CatCTup;
 
 
@@ -172,6 +185,7 @@ typedef struct catclist
 	int			refcount;		/* number of active references */
 	bool		dead;			/* dead but not yet removed? */
 	bool		ordered;		/* members listed in index order? */
+	bool		recently_used;	/* searched since last CatalogCacheShrink? */
 	short		nkeys;			/* number of lookup keys specified */
 	int			n_members;		/* number of member tuples */
 	CatCache   *my_cache;		/* link to owning catcache */
@@ -218,6 +232,7 @@ extern CatCList *SearchCatCacheList(CatCache *cache, int nkeys,
 extern void ReleaseCatCacheList(CatCList *list);
 
 extern void ResetCatalogCaches(void);
+extern void CatalogCacheShrink(void);
 extern void CatalogCacheFlushCatalog(Oid catId);
 extern void CatCacheInvalidate(CatCache *cache, uint32 hashValue);
 extern void PrepareToInvalidateCacheTuple(Relation relation,
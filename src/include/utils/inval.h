@@ -33,6 +33,8 @@ extern void AtPrepare_Inval(void);
 
 extern void PostPrepare_Inval(void);
 
+extern bool HavePendingInvalidations(void);
+
 extern void CommandEndInvalidationMessages(void);
 
 extern void CacheInvalidateHeapTuple(Relation relation,
@@ -82,8 +82,10 @@ extern void MemoryContextSetParent(MemoryContext context,
 extern Size GetMemoryChunkSpace(void *pointer);
 extern MemoryContext MemoryContextGetParent(MemoryContext context);
 extern bool MemoryContextIsEmpty(MemoryContext context);
+extern Size MemoryContextMemAllocated(MemoryContext context, bool recurse);
 extern void MemoryContextStats(MemoryContext context);
-extern void MemoryContextStatsDetail(MemoryContext context, int max_children);
+extern void MemoryContextStatsDetail(MemoryContext context, int max_children,
+						 bool print_to_stderr);
 extern void MemoryContextAllowInCriticalSection(MemoryContext context,
 									bool allow);
 
@@ -92,6 +94,9 @@ extern void MemoryContextCheck(MemoryContext context);
 #endif
 extern bool MemoryContextContains(MemoryContext context, void *pointer);
 
+extern void HandleLogMemoryContextInterrupt(void);
+extern void ProcessLogMemoryContextInterrupt(void);
+
 /* Handy macro for copying and assigning context ID ... but note double eval */
 #define MemoryContextCopyAndSetIdentifier(cxt, id) \
 	MemoryContextSetIdentifier(cxt, MemoryContextStrdup(cxt, id))
@@ -154,6 +159,7 @@ extern MemoryContext AllocSetContextCreateExtended(MemoryContext parent,
 							  Size minContextSize,
 							  Size initBlockSize,
 							  Size maxBlockSize);
+extern void AllocSetReleaseFreeLists(void);
 
 /*
  * This wrapper macro exists to check for non-constant strings used as context
@@ -0,0 +1,38 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedcatcache.h
+ *	  Catalog cache tier shared by all backends.
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedcatcache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDCATCACHE_H
+#define SHAREDCATCACHE_H
+
+#include "storage/sinval.h"
+#include "utils/catcache.h"
+
+/* GUC variable, in kilobytes; 0 disables the shared tier */
+extern int	shared_catcache_size;
+
+extern Size SharedCatCacheShmemSize(void);
+extern void SharedCatCacheShmemInit(void);
+
+extern dsa_pointer SharedCatCacheSearch(CatCache *cache, uint32 hashValue,
+					 Datum *arguments, HeapTuple tuple);
+extern void SharedCatCacheRelease(dsa_pointer entry);
+extern uint64 SharedCatCacheBeginLoad(void);
+extern void SharedCatCacheInsert(CatCache *cache, uint32 hashValue,
+					 Datum *arguments, HeapTuple tuple,
+					 uint64 generation);
+
+extern bool SharedCatCacheBeginInvalidate(const SharedInvalidationMessage *msgs,
+							  int n);
+extern void SharedCatCacheEndInvalidate(void);
+extern void SharedCatCacheForgetDatabase(Oid dbid);
+
+#endif							/* SHAREDCATCACHE_H */
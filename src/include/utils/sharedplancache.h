@@ -0,0 +1,36 @@
+/*-------------------------------------------------------------------------
+ *
+ * sharedplancache.h
+ *	  Generic plans shared by all backends.
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/utils/sharedplancache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef SHAREDPLANCACHE_H
+#define SHAREDPLANCACHE_H
+
+#include "nodes/pg_list.h"
+#include "storage/sinval.h"
+
+/* GUC variable, in kilobytes; 0 disables the shared plan cache */
+extern int	shared_plan_cache_size;
+
+extern Size SharedPlanCacheShmemSize(void);
+extern void SharedPlanCacheShmemInit(void);
+
+extern char *SharedPlanCacheSearch(const char *query, int cursor_options);
+extern uint64 SharedPlanCacheBeginLoad(void);
+extern void SharedPlanCacheInsert(const char *query, int cursor_options,
+					  const char *plan, List *relationOids,
+					  List *invalItems, uint64 generation);
+
+extern bool SharedPlanCacheBeginInvalidate(const SharedInvalidationMessage *msgs,
+							   int n);
+extern void SharedPlanCacheEndInvalidate(void);
+extern void SharedPlanCacheForgetDatabase(Oid dbid);
+
+#endif							/* SHAREDPLANCACHE_H */
@@ -250,6 +250,7 @@ extern int	tuplesort_merge_order(int64 allowedMem);
 extern Size tuplesort_estimate_shared(int nworkers);
 extern void tuplesort_initialize_shared(Sharedsort *shared, int nWorkers,
 							dsm_segment *seg);
+extern void tuplesort_reset_shared(Sharedsort *shared);
 extern void tuplesort_attach_shared(Sharedsort *shared, dsm_segment *seg);
 
 /*
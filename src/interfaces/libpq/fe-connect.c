@@ -123,6 +123,7 @@ static int ldapServiceLookup(const char *purl, PQconninfoOption *options,
 #define DefaultOption	""
 #define DefaultAuthtype		  ""
 #define DefaultTargetSessionAttrs	"any"
+#define DefaultCompression	"off"
 #define DefaultSCRAMChannelBinding	SCRAM_CHANNEL_BINDING_TLS_UNIQUE
 #ifdef USE_SSL
 #define DefaultSSLMode "prefer"
@@ -325,6 +326,10 @@ static const internalPQconninfoOption PQconninfoOptions[] = {
 		"Replication", "D", 5,
 	offsetof(struct pg_conn, replication)},
 
+	{"compression", "PGCOMPRESSION", DefaultCompression, NULL,
+		"Compression", "", 5,	/* sizeof("zlib") = 5 */
+	offsetof(struct pg_conn, compression)},
+
 	{"target_session_attrs", "PGTARGETSESSIONATTRS",
 		DefaultTargetSessionAttrs, NULL,
 		"Target-Session-Attrs", "", 11, /* sizeof("read-write") = 11 */
@@ -368,6 +373,7 @@ static void freePGconn(PGconn *conn);
 static void closePGconn(PGconn *conn);
 static void release_all_addrinfo(PGconn *conn);
 static void sendTerminateConn(PGconn *conn);
+static void pqFreeCommandQueue(PGcmdQueueEntry *queue);
 static PQconninfoOption *conninfo_init(PQExpBuffer errorMessage);
 static PQconninfoOption *parse_connection_string(const char *conninfo,
 						PQExpBuffer errorMessage, bool use_defaults);
@@ -433,6 +439,10 @@ pqDropConnection(PGconn *conn, bool flushInput)
 	/* Drop any SSL state */
 	pqsecure_close(conn);
 
+	/* Likewise for compression, along with any data it still holds */
+	zpq_free(conn->zstream);
+	conn->zstream = NULL;
+
 	/* Close the socket itself */
 	if (conn->sock != PGINVALID_SOCKET)
 		closesocket(conn->sock);
@@ -445,6 +455,10 @@ pqDropConnection(PGconn *conn, bool flushInput)
 	/* Always discard any unsent data */
 	conn->outCount = 0;
 
+	/* Likewise, discard any pending commands */
+	pqFreeCommandQueue(conn->cmd_queue_head);
+	conn->cmd_queue_head = conn->cmd_queue_tail = NULL;
+
 	/* Free authentication state */
 #ifdef ENABLE_GSS
 	{
@@ -487,6 +501,24 @@ pqDropConnection(PGconn *conn, bool flushInput)
 	}
 }
 
+/*
+ * pqFreeCommandQueue
+ * Free all the entries of PGcmdQueueEntry queue passed.
+ */
+static void
+pqFreeCommandQueue(PGcmdQueueEntry *queue)
+{
+	while (queue != NULL)
+	{
+		PGcmdQueueEntry *cur = queue;
+
+		queue = cur->next;
+		if (cur->query)
+			free(cur->query);
+		free(cur);
+	}
+}
+
 
 /*
  *		Connecting to a Database
@@ -1178,6 +1210,33 @@ connectOptions2(PGconn *conn)
 			goto oom_error;
 	}
 
+	/*
+	 * Validate compression option.  "on" picks an algorithm, currently the
+	 * only one there is.
+	 */
+	if (conn->compression)
+	{
+		if (strcmp(conn->compression, "off") != 0 &&
+			strcmp(conn->compression, "on") != 0 &&
+			strcmp(conn->compression, ZPQ_ALGORITHM_ZLIB) != 0)
+		{
+			conn->status = CONNECTION_BAD;
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("invalid compression value: \"%s\"\n"),
+							  conn->compression);
+			return false;
+		}
+		if (strcmp(conn->compression, "off") != 0 &&
+			!zpq_algorithm_supported(ZPQ_ALGORITHM_ZLIB))
+		{
+			conn->status = CONNECTION_BAD;
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("compression value \"%s\" invalid when compression support is not compiled in\n"),
+							  conn->compression);
+			return false;
+		}
+	}
+
 	/*
 	 * Validate target_session_attrs option.
 	 */
@@ -2657,10 +2716,11 @@ keep_going:						/* We will come back to here until there is
 
 				/*
 				 * Validate message type: we expect only an authentication
-				 * request or an error here.  Anything else probably means
+				 * request or an error here, possibly preceded by a response to
+				 * the protocol options we sent.  Anything else probably means
 				 * it's not Postgres on the other end at all.
 				 */
-				if (!(beresp == 'R' || beresp == 'E'))
+				if (!(beresp == 'R' || beresp == 'E' || beresp == 'v'))
 				{
 					appendPQExpBuffer(&conn->errorMessage,
 									  libpq_gettext(
@@ -2693,7 +2753,8 @@ keep_going:						/* We will come back to here until there is
 				 * length in an error, it means we're really talking to a
 				 * pre-3.0-protocol server; cope.
 				 */
-				if (beresp == 'R' && (msgLength < 8 || msgLength > 2000))
+				if ((beresp == 'R' || beresp == 'v') &&
+					(msgLength < 8 || msgLength > 2000))
 				{
 					appendPQExpBuffer(&conn->errorMessage,
 									  libpq_gettext(
@@ -2759,6 +2820,17 @@ keep_going:						/* We will come back to here until there is
 					return PGRES_POLLING_READING;
 				}
 
+				/*
+				 * NegotiateProtocolVersion means the server didn't recognize
+				 * some of our protocol options.  The only one we send asks
+				 * for compression, which we can do without.
+				 */
+				if (beresp == 'v')
+				{
+					conn->inStart = conn->inCursor + msgLength;
+					goto keep_going;
+				}
+
 				/* Handle errors. */
 				if (beresp == 'E')
 				{
@@ -2887,6 +2959,15 @@ keep_going:						/* We will come back to here until there is
 					/* We are done with authentication exchange */
 					conn->status = CONNECTION_AUTH_OK;
 
+					/*
+					 * If we asked for compression, the server's answer is
+					 * the next message.
+					 */
+					conn->compression_pending =
+						(PG_PROTOCOL_MAJOR(conn->pversion) >= 3 &&
+						 conn->compression != NULL &&
+						 strcmp(conn->compression, "off") != 0);
+
 					/*
 					 * Set asyncStatus so that PQgetResult will think that
 					 * what comes back next is the result of a query.  See
@@ -2901,6 +2982,63 @@ keep_going:						/* We will come back to here until there is
 
 		case CONNECTION_AUTH_OK:
 			{
+				/*
+				 * If the server agreed to compress the connection, it says so
+				 * with CompressionAck right after AuthenticationOk, and
+				 * everything after that message is compressed.  Any other
+				 * message means we go on without compression.
+				 */
+				if (conn->compression_pending)
+				{
+					char		beresp;
+					int			msgLength;
+
+					conn->inCursor = conn->inStart;
+					if (pqGetc(&beresp, conn))
+					{
+						/* We'll come back when there is more data */
+						return PGRES_POLLING_READING;
+					}
+					if (beresp == 'z')
+					{
+						if (pqGetInt(&msgLength, 4, conn))
+						{
+							/* We'll come back when there is more data */
+							return PGRES_POLLING_READING;
+						}
+						if (msgLength < 5 || msgLength > 2000)
+						{
+							appendPQExpBufferStr(&conn->errorMessage,
+												 libpq_gettext("invalid compression acknowledgement from server\n"));
+							goto error_return;
+						}
+						if (conn->inEnd - conn->inCursor < msgLength - 4)
+						{
+							/* We'll come back when there is more data */
+							return PGRES_POLLING_READING;
+						}
+						if (pqGets(&conn->workBuffer, conn) ||
+							conn->inCursor != conn->inStart + 1 + msgLength)
+						{
+							appendPQExpBufferStr(&conn->errorMessage,
+												 libpq_gettext("invalid compression acknowledgement from server\n"));
+							goto error_return;
+						}
+						conn->inStart = conn->inCursor;
+
+						if (!zpq_algorithm_supported(conn->workBuffer.data))
+						{
+							appendPQExpBuffer(&conn->errorMessage,
+											  libpq_gettext("server selected unexpected compression algorithm \"%s\"\n"),
+											  conn->workBuffer.data);
+							goto error_return;
+						}
+						if (pqEnableCompression(conn))
+							goto error_return;
+					}
+					conn->compression_pending = false;
+				}
+
 				/*
 				 * Now we expect to hear from the backend. A ReadyForQuery
 				 * message indicates that startup is successful, but we might
@@ -3492,6 +3630,8 @@ freePGconn(PGconn *conn)
 		free(conn->sslcompression);
 	if (conn->requirepeer)
 		free(conn->requirepeer);
+	if (conn->compression)
+		free(conn->compression);
 #if defined(ENABLE_GSS) || defined(ENABLE_SSPI)
 	if (conn->krbsrvname)
 		free(conn->krbsrvname);
@@ -3501,8 +3641,8 @@ freePGconn(PGconn *conn)
 		free(conn->gsslib);
 #endif
 	/* Note that conn->Pfdebug is not ours to close or free */
-	if (conn->last_query)
-		free(conn->last_query);
+	pqFreeCommandQueue(conn->cmd_queue_head);
+	pqFreeCommandQueue(conn->cmd_queue_recycle);
 	if (conn->inBuffer)
 		free(conn->inBuffer);
 	if (conn->outBuffer)
@@ -3603,6 +3743,7 @@ closePGconn(PGconn *conn)
 	pqDropConnection(conn, true);
 	conn->status = CONNECTION_BAD;	/* Well, not really _bad_ - just absent */
 	conn->asyncStatus = PGASYNC_IDLE;
+	conn->pipelineStatus = PQ_PIPELINE_OFF;
 	pqClearAsyncResult(conn);	/* deallocate result */
 	resetPQExpBuffer(&conn->errorMessage);
 	release_all_addrinfo(conn);
@@ -6146,6 +6287,15 @@ PQbackendPID(const PGconn *conn)
 	return conn->be_pid;
 }
 
+PGpipelineStatus
+PQpipelineStatus(const PGconn *conn)
+{
+	if (!conn)
+		return PQ_PIPELINE_OFF;
+
+	return conn->pipelineStatus;
+}
+
 int
 PQconnectionNeedsPassword(const PGconn *conn)
 {
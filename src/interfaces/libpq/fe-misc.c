@@ -56,6 +56,11 @@
 
 static int	pqPutMsgBytes(const void *buf, size_t len, PGconn *conn);
 static int	pqSendSome(PGconn *conn, int len);
+static ssize_t pqConnRead(PGconn *conn, void *ptr, size_t len);
+static ssize_t pqConnWrite(PGconn *conn, const void *ptr, size_t len);
+static bool pqCompressedSendPending(PGconn *conn);
+static ssize_t pqZpqTx(void *arg, const void *data, size_t size);
+static ssize_t pqZpqRx(void *arg, void *data, size_t size);
 static int pqSocketCheck(PGconn *conn, int forRead, int forWrite,
 			  time_t end_time);
 static int	pqSocketPoll(int sock, int forRead, int forWrite, time_t end_time);
@@ -614,6 +619,65 @@ pqPutMsgEnd(PGconn *conn)
 	return 0;
 }
 
+/*
+ * pqConnRead: read from the connection, decompressing if need be
+ *
+ * Returns like pqsecure_read(), which sets the error message on failure.
+ */
+static ssize_t
+pqConnRead(PGconn *conn, void *ptr, size_t len)
+{
+	ssize_t		n;
+
+	if (conn->zstream == NULL)
+		return pqsecure_read(conn, ptr, len);
+
+	n = zpq_read(conn->zstream, ptr, len);
+	if (n == ZPQ_STREAM_ERROR)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("could not decompress data from server: %s\n"),
+						  zpq_error(conn->zstream));
+		SOCK_ERRNO_SET(EIO);
+	}
+	return n;
+}
+
+/*
+ * pqConnWrite: write to the connection, compressing if need be
+ *
+ * Returns like pqsecure_write(), which sets the error message on failure.
+ * With compression, data reported as sent may still be held by the
+ * compression stream; len may be 0 to just send that.
+ */
+static ssize_t
+pqConnWrite(PGconn *conn, const void *ptr, size_t len)
+{
+	ssize_t		n;
+
+	if (conn->zstream == NULL)
+		return pqsecure_write(conn, ptr, len);
+
+	n = zpq_write(conn->zstream, ptr, len);
+	if (n == ZPQ_STREAM_ERROR)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("could not compress data: %s\n"),
+						  zpq_error(conn->zstream));
+		SOCK_ERRNO_SET(EIO);
+	}
+	return n;
+}
+
+/*
+ * pqCompressedSendPending: is compressed output waiting to be sent?
+ */
+static bool
+pqCompressedSendPending(PGconn *conn)
+{
+	return conn->zstream != NULL && zpq_buffered_tx(conn->zstream);
+}
+
 /* ----------
  * pqReadData: read more data, if any is available
  * Possible return values:
@@ -678,8 +742,8 @@ pqReadData(PGconn *conn)
 
 	/* OK, try to read some data */
 retry3:
-	nread = pqsecure_read(conn, conn->inBuffer + conn->inEnd,
-						  conn->inBufSize - conn->inEnd);
+	nread = pqConnRead(conn, conn->inBuffer + conn->inEnd,
+					   conn->inBufSize - conn->inEnd);
 	if (nread < 0)
 	{
 		if (SOCK_ERRNO == EINTR)
@@ -768,8 +832,8 @@ retry3:
 	 * arrived.
 	 */
 retry4:
-	nread = pqsecure_read(conn, conn->inBuffer + conn->inEnd,
-						  conn->inBufSize - conn->inEnd);
+	nread = pqConnRead(conn, conn->inBuffer + conn->inEnd,
+					   conn->inBufSize - conn->inEnd);
 	if (nread < 0)
 	{
 		if (SOCK_ERRNO == EINTR)
@@ -842,12 +906,12 @@ pqSendSome(PGconn *conn, int len)
 	}
 
 	/* while there's still data to send */
-	while (len > 0)
+	while (len > 0 || pqCompressedSendPending(conn))
 	{
 		int			sent;
 
 #ifndef WIN32
-		sent = pqsecure_write(conn, ptr, len);
+		sent = pqConnWrite(conn, ptr, len);
 #else
 
 		/*
@@ -855,7 +919,7 @@ pqSendSome(PGconn *conn, int len)
 		 * failure-point appears to be different in different versions of
 		 * Windows, but 64k should always be safe.
 		 */
-		sent = pqsecure_write(conn, ptr, Min(len, 65536));
+		sent = pqConnWrite(conn, ptr, Min(len, 65536));
 #endif
 
 		if (sent < 0)
@@ -896,7 +960,7 @@ pqSendSome(PGconn *conn, int len)
 			remaining -= sent;
 		}
 
-		if (len > 0)
+		if (len > 0 || pqCompressedSendPending(conn))
 		{
 			/*
 			 * We didn't send it all, wait till we can send more.
@@ -963,13 +1027,63 @@ pqFlush(PGconn *conn)
 	if (conn->Pfdebug)
 		fflush(conn->Pfdebug);
 
-	if (conn->outCount > 0)
+	if (conn->outCount > 0 || pqCompressedSendPending(conn))
 		return pqSendSome(conn, conn->outCount);
 
 	return 0;
 }
 
 
+/*
+ * pqEnableCompression: compress all further traffic on the connection
+ *
+ * This is called when the server has acknowledged our request for
+ * compression.  Whatever was received after the acknowledgement is compressed
+ * already, so it is handed over to the compression stream.
+ *
+ * Returns 0 if OK, EOF on failure with conn->errorMessage set.
+ */
+int
+pqEnableCompression(PGconn *conn)
+{
+	Assert(conn->zstream == NULL);
+
+	conn->zstream = zpq_create(pqZpqTx, pqZpqRx, conn,
+							   conn->inBuffer + conn->inStart,
+							   conn->inEnd - conn->inStart);
+	if (conn->zstream == NULL)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("out of memory\n"));
+		return EOF;
+	}
+	conn->inCursor = conn->inEnd = conn->inStart;
+
+	/*
+	 * Decompress the data we were given now, since the caller might otherwise
+	 * wait for the socket to become readable before looking at it.
+	 */
+	if (zpq_buffered_rx(conn->zstream) && pqReadData(conn) < 0)
+		return EOF;
+
+	return 0;
+}
+
+/*
+ * Transmit and receive functions of the compression stream.
+ */
+static ssize_t
+pqZpqTx(void *arg, const void *data, size_t size)
+{
+	return pqsecure_write((PGconn *) arg, data, size);
+}
+
+static ssize_t
+pqZpqRx(void *arg, void *data, size_t size)
+{
+	return pqsecure_read((PGconn *) arg, data, size);
+}
+
 /*
  * pqWait: wait until we can read or write the connection socket
  *
@@ -1038,8 +1152,8 @@ pqWriteReady(PGconn *conn)
  * or both.  Returns >0 if one or more conditions are met, 0 if it timed
  * out, -1 if an error occurred.
  *
- * If SSL is in use, the SSL buffer is checked prior to checking the socket
- * for read data directly.
+ * If SSL or compression is in use, their buffers are checked prior to
+ * checking the socket for read data directly.
  */
 static int
 pqSocketCheck(PGconn *conn, int forRead, int forWrite, time_t end_time)
@@ -1064,6 +1178,10 @@ pqSocketCheck(PGconn *conn, int forRead, int forWrite, time_t end_time)
 	}
 #endif
 
+	/* Likewise for data held by the compression stream */
+	if (forRead && conn->zstream && zpq_buffered_rx(conn->zstream))
+		return 1;
+
 	/* We will retry as long as we get EINTR */
 	do
 		result = pqSocketPoll(conn->sock, forRead, forWrite, end_time);
@@ -0,0 +1,157 @@
+# Test protocol compression, which the client requests in the startup packet
+# and the server only switches to once the client is authenticated.  Some of
+# the tests talk to the server directly, to see the messages it sends.
+# This test cannot run on Windows as Postgres cannot be set up with Unix
+# sockets and needs to go through SSPI.
+
+use strict;
+use warnings;
+use IO::Socket::UNIX;
+use PostgresNode;
+use TestLib;
+use Test::More;
+if ($windows_os)
+{
+	plan skip_all => "authentication tests cannot run on Windows";
+}
+elsif (!check_pg_config("#define HAVE_LIBZ 1"))
+{
+	plan skip_all => "postgres was not built with zlib support";
+}
+else
+{
+	plan tests => 9;
+}
+
+# Read exactly the given number of bytes from a socket.
+sub read_exactly
+{
+	my ($sock, $len) = @_;
+	my $buf = '';
+
+	while (length($buf) < $len)
+	{
+		my $n = sysread($sock, $buf, $len - length($buf), length($buf));
+		die "could not read from server: $!" if !defined $n;
+		die "server closed the connection" if $n == 0;
+	}
+	return $buf;
+}
+
+# Send a startup packet asking for the given compression algorithms, and
+# return the first two messages of the reply, as a string like "R0,S".
+# Authentication requests show their code, CompressionAck the algorithm.
+sub startup_reply
+{
+	my ($node, $user, $algorithms) = @_;
+
+	my $sock = IO::Socket::UNIX->new(
+		Type => SOCK_STREAM(),
+		Peer => $node->host . '/.s.PGSQL.' . $node->port)
+	  or die "could not connect to server: $!";
+
+	my $params = join("\0",
+		'user', $user, 'database', 'postgres',
+		'_pq_.compression', $algorithms)
+	  . "\0\0";
+	syswrite($sock, pack('NN', 8 + length($params), 196608) . $params)
+	  or die "could not send startup packet: $!";
+
+	my @messages;
+	while (@messages < 2)
+	{
+		my ($type, $len) = unpack('aN', read_exactly($sock, 5));
+		my $body = read_exactly($sock, $len - 4);
+
+		if ($type eq 'R')
+		{
+			$type .= unpack('N', $body);
+		}
+		elsif ($type eq 'z')
+		{
+			$body =~ s/\0$//;
+			$type .= "($body)";
+		}
+		push @messages, $type;
+	}
+	close($sock);
+	return join(',', @messages);
+}
+
+# Run the given SQL with the given compression setting, returning its output
+# and whether the server logged that it compressed the connection.
+sub run_psql
+{
+	my ($node, $role, $compression, $sql) = @_;
+	my $logstart = -s $node->logfile;
+	my ($stdout, $stderr);
+
+	local $ENV{PGCOMPRESSION} = $compression;
+	$node->psql(
+		'postgres', $sql,
+		stdout       => \$stdout,
+		stderr       => \$stderr,
+		extra_params => [ '-U', $role ]);
+
+	my $log = substr(slurp_file($node->logfile), $logstart);
+	my $compressed = $log =~ /protocol compression enabled, using zlib/;
+	return ($stdout, $stderr, $compressed ? 1 : 0);
+}
+
+my $node = get_new_node('master');
+$node->init;
+$node->append_conf('postgresql.conf', "log_min_messages = debug1");
+$node->start;
+
+my $superuser = $node->safe_psql('postgres', 'SELECT current_user');
+$node->safe_psql('postgres',
+"SET password_encryption='scram-sha-256'; CREATE ROLE scram_role LOGIN PASSWORD 'pass';"
+);
+$ENV{"PGPASSWORD"} = 'pass';
+
+# The server only acknowledges algorithms it knows, right after
+# AuthenticationOk.  Otherwise the connection goes on uncompressed.
+is(startup_reply($node, $superuser, 'lz4'),
+	'R0,S', 'unknown compression algorithm is ignored');
+is(startup_reply($node, $superuser, 'lz4,zlib'),
+	'R0,z(zlib)', 'compression is acknowledged after authentication');
+
+# Compression with password authentication, and results large enough to
+# take many reads and writes on both ends
+unlink($node->data_dir . '/pg_hba.conf');
+$node->append_conf('pg_hba.conf', "local all all scram-sha-256");
+$node->reload;
+
+my $sql = q{
+SELECT string_agg(md5(i::text), '') FROM generate_series(1, 100000) i;
+SELECT i, repeat(md5(i::text), i % 10) FROM generate_series(1, 100000) i;
+};
+my ($expected) = run_psql($node, 'scram_role', 'off', $sql);
+
+my ($stdout, $stderr, $compressed) =
+  run_psql($node, 'scram_role', 'on', 'SELECT 1');
+is($stdout, '1', 'compressed connection with SCRAM authentication');
+is($compressed, 1, 'server compressed the connection');
+
+($stdout) = run_psql($node, 'scram_role', 'on', $sql);
+ok($stdout eq $expected, 'large results arrive intact over compression');
+
+# libpq refuses to ask for an algorithm it doesn't know
+($stdout, $stderr) = run_psql($node, 'scram_role', 'lz4', 'SELECT 1');
+like(
+	$stderr,
+	qr/invalid compression value: "lz4"/,
+	'client rejects unknown compression algorithm');
+
+# With compression disabled on the server, the client carries on without it
+$node->append_conf('postgresql.conf', "libpq_compression = off");
+unlink($node->data_dir . '/pg_hba.conf');
+$node->append_conf('pg_hba.conf', "local all all trust");
+$node->reload;
+is(startup_reply($node, $superuser, 'zlib'),
+	'R0,S', 'compression is not acknowledged when disabled');
+
+($stdout, $stderr, $compressed) = run_psql($node, 'scram_role', 'on', $sql);
+ok($stdout eq $expected && $compressed == 0,
+	'connection without compression when the server refuses it');
+is($stderr, '', 'no errors without compression');
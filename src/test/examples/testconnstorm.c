@@ -0,0 +1,248 @@
+/*
+ * src/test/examples/testconnstorm.c
+ *
+ *
+ * testconnstorm.c
+ *		Measure how many connections per second a server accepts when many
+ *		clients connect at once
+ *
+ * Usage: testconnstorm [clients [seconds [conninfo]]]
+ *
+ * The program keeps "clients" connection attempts in flight at all times
+ * (default 100) for "seconds" seconds (default 10), using libpq's
+ * nonblocking connection interface so that a single process can generate
+ * the storm.  As soon as an attempt completes, the connection is closed and
+ * a new attempt is started in its place.  At the end, the number of
+ * connections per second and the connection latencies are reported.
+ *
+ * For example, to compare against pgbench's per-transaction reconnection:
+ *
+ *	 testconnstorm 200 30 "dbname=postgres"
+ *
+ * Note that the server's max_connections must allow for "clients"
+ * connections, or most attempts will fail.  Since the client side waits
+ * with select(2), "clients" is limited by FD_SETSIZE.
+ */
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#ifdef HAVE_SYS_SELECT_H
+#include <sys/select.h>
+#endif
+
+#include "libpq-fe.h"
+
+typedef struct
+{
+	PGconn	   *conn;
+	PostgresPollingStatusType status;	/* last PQconnectPoll() result */
+	struct timeval start;		/* when the attempt was started */
+} Slot;
+
+static const char *conninfo;
+static double *latencies;
+static long nlatencies;
+static long maxlatencies;
+static long nfailed;
+
+static double
+elapsed_ms(const struct timeval *from, const struct timeval *to)
+{
+	return (to->tv_sec - from->tv_sec) * 1000.0 +
+		(to->tv_usec - from->tv_usec) / 1000.0;
+}
+
+static void
+start_attempt(Slot *slot)
+{
+	gettimeofday(&slot->start, NULL);
+	slot->conn = PQconnectStart(conninfo);
+	if (slot->conn == NULL)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	if (PQstatus(slot->conn) == CONNECTION_BAD)
+	{
+		fprintf(stderr, "could not start connection: %s",
+				PQerrorMessage(slot->conn));
+		exit(1);
+	}
+	/* behave as if PQconnectPoll() had returned this, per the docs */
+	slot->status = PGRES_POLLING_WRITING;
+}
+
+static void
+finish_attempt(Slot *slot)
+{
+	struct timeval now;
+
+	if (slot->status == PGRES_POLLING_OK)
+	{
+		gettimeofday(&now, NULL);
+		if (nlatencies == maxlatencies)
+		{
+			maxlatencies = maxlatencies * 2 + 1024;
+			latencies = realloc(latencies, maxlatencies * sizeof(double));
+			if (latencies == NULL)
+			{
+				fprintf(stderr, "out of memory\n");
+				exit(1);
+			}
+		}
+		latencies[nlatencies++] = elapsed_ms(&slot->start, &now);
+	}
+	else
+	{
+		/* report the first failure only, the rest are likely the same */
+		if (nfailed++ == 0)
+			fprintf(stderr, "connection failed: %s",
+					PQerrorMessage(slot->conn));
+	}
+	PQfinish(slot->conn);
+	slot->conn = NULL;
+}
+
+static int
+cmp_double(const void *a, const void *b)
+{
+	double		da = *(const double *) a;
+	double		db = *(const double *) b;
+
+	return (da > db) - (da < db);
+}
+
+int
+main(int argc, char **argv)
+{
+	int			nclients = 100;
+	int			duration = 10;
+	Slot	   *slots;
+	struct timeval begin,
+				now;
+	double		total_ms;
+	double		sum = 0;
+	long		i;
+
+	if (argc > 1)
+		nclients = atoi(argv[1]);
+	if (argc > 2)
+		duration = atoi(argv[2]);
+	if (argc > 3)
+		conninfo = argv[3];
+	else
+		conninfo = "dbname = postgres";
+
+	if (nclients < 1 || nclients > FD_SETSIZE - 16 || duration < 1)
+	{
+		fprintf(stderr, "usage: %s [clients [seconds [conninfo]]]\n"
+				"clients must be between 1 and %d, seconds at least 1\n",
+				argv[0], FD_SETSIZE - 16);
+		exit(1);
+	}
+
+	slots = calloc(nclients, sizeof(Slot));
+	if (slots == NULL)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	gettimeofday(&begin, NULL);
+	for (i = 0; i < nclients; i++)
+		start_attempt(&slots[i]);
+
+	for (;;)
+	{
+		fd_set		readmask;
+		fd_set		writemask;
+		int			maxsock = -1;
+		struct timeval timeout;
+
+		gettimeofday(&now, NULL);
+		if (elapsed_ms(&begin, &now) >= duration * 1000.0)
+			break;
+
+		FD_ZERO(&readmask);
+		FD_ZERO(&writemask);
+		for (i = 0; i < nclients; i++)
+		{
+			int			sock = PQsocket(slots[i].conn);
+
+			if (sock < 0)
+				continue;
+			if (slots[i].status == PGRES_POLLING_READING)
+				FD_SET(sock, &readmask);
+			else
+				FD_SET(sock, &writemask);
+			if (sock > maxsock)
+				maxsock = sock;
+		}
+
+		/* wake up now and then to check whether we're done */
+		timeout.tv_sec = 0;
+		timeout.tv_usec = 100000;
+		if (select(maxsock + 1, &readmask, &writemask, NULL, &timeout) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "select() failed: %s\n", strerror(errno));
+			exit(1);
+		}
+
+		for (i = 0; i < nclients; i++)
+		{
+			Slot	   *slot = &slots[i];
+			int			sock = PQsocket(slot->conn);
+
+			if (sock >= 0 &&
+				!FD_ISSET(sock, &readmask) && !FD_ISSET(sock, &writemask))
+				continue;
+
+			slot->status = PQconnectPoll(slot->conn);
+			if (slot->status == PGRES_POLLING_OK ||
+				slot->status == PGRES_POLLING_FAILED)
+			{
+				finish_attempt(slot);
+				start_attempt(slot);
+			}
+		}
+	}
+
+	gettimeofday(&now, NULL);
+	total_ms = elapsed_ms(&begin, &now);
+
+	/* attempts still in flight don't count */
+	for (i = 0; i < nclients; i++)
+		PQfinish(slots[i].conn);
+	free(slots);
+
+	printf("clients: %d\n", nclients);
+	printf("duration: %.3f s\n", total_ms / 1000.0);
+	printf("connections: %ld (%ld failed)\n", nlatencies, nfailed);
+	printf("connections per second: %.1f\n",
+		   nlatencies / (total_ms / 1000.0));
+
+	if (nlatencies > 0)
+	{
+		qsort(latencies, nlatencies, sizeof(double), cmp_double);
+		for (i = 0; i < nlatencies; i++)
+			sum += latencies[i];
+		printf("latency average: %.3f ms\n", sum / nlatencies);
+		printf("latency 50th percentile: %.3f ms\n",
+			   latencies[nlatencies / 2]);
+		printf("latency 99th percentile: %.3f ms\n",
+			   latencies[(long) (nlatencies * 0.99)]);
+		printf("latency maximum: %.3f ms\n", latencies[nlatencies - 1]);
+	}
+	free(latencies);
+
+	return 0;
+}
@@ -0,0 +1,53 @@
+# Rebuilding the relcache entry of a partitioned table while its partition
+# descriptor is in use.  The descriptor is built on first use, and must be
+# kept across a rebuild while someone may be using it.
+#
+# ATTACH and DETACH PARTITION have to wait for a cursor that has the parent
+# open, which must then still read the partitions it started with.  An
+# INSERT routing tuples through the parent keeps using the descriptor after
+# a concurrent GRANT has invalidated the parent's relcache entry; the
+# trigger on pd1 makes it take a lock, and so process the invalidation,
+# between the two rows.
+
+setup
+{
+  CREATE TABLE pd (a int, b text) PARTITION BY LIST (a);
+  CREATE TABLE pd1 PARTITION OF pd FOR VALUES IN (1);
+  CREATE TABLE pd2 PARTITION OF pd FOR VALUES IN (2);
+  CREATE TABLE pd3 (a int, b text);
+  INSERT INTO pd VALUES (1, 'one'), (2, 'two');
+  INSERT INTO pd3 VALUES (3, 'three');
+
+  CREATE FUNCTION pd_read_pd3() RETURNS trigger LANGUAGE plpgsql AS
+    $$ BEGIN PERFORM count(*) FROM pd3; RETURN NEW; END $$;
+  CREATE TRIGGER pd1_read_pd3 BEFORE INSERT ON pd1
+    FOR EACH ROW EXECUTE PROCEDURE pd_read_pd3();
+}
+
+teardown
+{
+  DROP TABLE pd, pd2, pd3;
+  DROP FUNCTION pd_read_pd3();
+}
+
+session "s1"
+step "s1b"		{ BEGIN; }
+step "s1decl"	{ DECLARE c CURSOR FOR SELECT * FROM pd; }
+step "s1f1"		{ FETCH 1 FROM c; }
+step "s1fall"	{ FETCH ALL FROM c; }
+step "s1c"		{ COMMIT; }
+step "s1ins"	{ INSERT INTO pd VALUES (1, 'eleven'), (2, 'twelve'); }
+step "s1sel"	{ SELECT * FROM pd ORDER BY a, b; }
+
+session "s2"
+step "s2b"		{ BEGIN; }
+step "s2lock"	{ LOCK TABLE pd3 IN ACCESS EXCLUSIVE MODE; }
+step "s2grant"	{ GRANT SELECT ON pd TO PUBLIC; }
+step "s2c"		{ COMMIT; }
+step "s2attach"	{ ALTER TABLE pd ATTACH PARTITION pd3 FOR VALUES IN (3); }
+step "s2detach"	{ ALTER TABLE pd DETACH PARTITION pd2; }
+
+permutation "s1sel" "s2attach" "s1sel"
+permutation "s1b" "s1decl" "s1f1" "s2attach" "s1fall" "s1c" "s1sel"
+permutation "s1b" "s1decl" "s1f1" "s2detach" "s1fall" "s1c" "s1sel"
+permutation "s2b" "s2lock" "s1ins" "s2grant" "s2c" "s1sel"
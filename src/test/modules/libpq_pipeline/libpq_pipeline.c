@@ -0,0 +1,430 @@
+/*-------------------------------------------------------------------------
+ *
+ * libpq_pipeline.c
+ *		Verify libpq pipeline execution functionality
+ *
+ * Each test sends a series of queries in pipeline mode, and checks that the
+ * results come back in order, each followed by a NULL from PQgetResult, and
+ * that the pipeline status changes as it should along the way.  A test that
+ * finds something amiss reports it and exits with status 1.
+ *
+ * Portions Copyright (c) 1996-2018, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *		src/test/modules/libpq_pipeline/libpq_pipeline.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres_fe.h"
+
+#include "libpq-fe.h"
+
+
+static const char *const progname = "libpq_pipeline";
+
+static void pg_fatal(const char *fmt,...) pg_attribute_printf(1, 2)
+			pg_attribute_noreturn();
+static void send_query(PGconn *conn, const char *query, const char *param);
+static PGresult *expect_result(PGconn *conn, ExecStatusType status,
+			  const char *what);
+static void expect_no_result(PGconn *conn, const char *what);
+static void expect_value(PGresult *res, int row, const char *value,
+			 const char *what);
+static void expect_pipeline_status(PGconn *conn, PGpipelineStatus status,
+					   const char *what);
+
+static void test_disallowed_in_pipeline(PGconn *conn);
+static void test_simple_pipeline(PGconn *conn);
+static void test_multi_pipelines(PGconn *conn);
+static void test_pipeline_abort(PGconn *conn);
+static void test_singlerow(PGconn *conn);
+
+typedef struct PipelineTest
+{
+	const char *name;
+	void		(*func) (PGconn *conn);
+} PipelineTest;
+
+static const PipelineTest tests[] = {
+	{"disallowed_in_pipeline", test_disallowed_in_pipeline},
+	{"simple_pipeline", test_simple_pipeline},
+	{"multi_pipelines", test_multi_pipelines},
+	{"pipeline_abort", test_pipeline_abort},
+	{"singlerow", test_singlerow},
+	{NULL, NULL}
+};
+
+
+/*
+ * Report a failed check, and exit.
+ */
+static void
+pg_fatal(const char *fmt,...)
+{
+	va_list		args;
+
+	fflush(stdout);
+	fprintf(stderr, "\n%s: ", progname);
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	fprintf(stderr, "\n");
+
+	exit(1);
+}
+
+/*
+ * Queue an extended-protocol query with at most one text parameter.
+ */
+static void
+send_query(PGconn *conn, const char *query, const char *param)
+{
+	if (PQsendQueryParams(conn, query, param != NULL ? 1 : 0, NULL,
+						  &param, NULL, NULL, 0) != 1)
+		pg_fatal("failed to send query \"%s\": %s",
+				 query, PQerrorMessage(conn));
+}
+
+/*
+ * Get the next result, which must have the given status.
+ */
+static PGresult *
+expect_result(PGconn *conn, ExecStatusType status, const char *what)
+{
+	PGresult   *res = PQgetResult(conn);
+
+	if (res == NULL)
+		pg_fatal("%s: expected %s, got no result: %s",
+				 what, PQresStatus(status), PQerrorMessage(conn));
+	if (PQresultStatus(res) != status)
+		pg_fatal("%s: expected %s, got %s: %s",
+				 what, PQresStatus(status),
+				 PQresStatus(PQresultStatus(res)),
+				 PQerrorMessage(conn));
+
+	return res;
+}
+
+/*
+ * Check that the results of a query are over.
+ */
+static void
+expect_no_result(PGconn *conn, const char *what)
+{
+	PGresult   *res = PQgetResult(conn);
+
+	if (res != NULL)
+		pg_fatal("%s: expected NULL after the results of a query, got %s",
+				 what, PQresStatus(PQresultStatus(res)));
+}
+
+static void
+expect_value(PGresult *res, int row, const char *value, const char *what)
+{
+	if (PQntuples(res) <= row)
+		pg_fatal("%s: expected at least %d rows, got %d",
+				 what, row + 1, PQntuples(res));
+	if (strcmp(PQgetvalue(res, row, 0), value) != 0)
+		pg_fatal("%s: expected \"%s\" in row %d, got \"%s\"",
+				 what, value, row, PQgetvalue(res, row, 0));
+}
+
+static void
+expect_pipeline_status(PGconn *conn, PGpipelineStatus status,
+					   const char *what)
+{
+	if (PQpipelineStatus(conn) != status)
+		pg_fatal("%s: expected pipeline status %d, got %d",
+				 what, (int) status, (int) PQpipelineStatus(conn));
+}
+
+/*
+ * The functions that wait for the result of a single command are refused in
+ * pipeline mode, and work again once it is left.
+ */
+static void
+test_disallowed_in_pipeline(PGconn *conn)
+{
+	PGresult   *res;
+
+	if (PQenterPipelineMode(conn) != 1)
+		pg_fatal("unable to enter pipeline mode: %s", PQerrorMessage(conn));
+
+	res = PQexec(conn, "SELECT 1");
+	if (PQresultStatus(res) != PGRES_FATAL_ERROR)
+		pg_fatal("PQexec should fail in pipeline mode but succeeded");
+	if (strcmp(PQerrorMessage(conn),
+			   "synchronous command execution functions are not allowed in pipeline mode\n") != 0)
+		pg_fatal("PQexec failed in pipeline mode with an unexpected error: %s",
+				 PQerrorMessage(conn));
+	PQclear(res);
+
+	if (PQexitPipelineMode(conn) != 1)
+		pg_fatal("unable to exit pipeline mode: %s", PQerrorMessage(conn));
+
+	res = PQexec(conn, "SELECT 1");
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		pg_fatal("PQexec failed after leaving pipeline mode: %s",
+				 PQerrorMessage(conn));
+	PQclear(res);
+}
+
+/*
+ * One query and a sync.  Pipeline mode can't be left while any of their
+ * results are still to be read, including that of the sync.
+ */
+static void
+test_simple_pipeline(PGconn *conn)
+{
+	PGresult   *res;
+
+	if (PQenterPipelineMode(conn) != 1)
+		pg_fatal("unable to enter pipeline mode: %s", PQerrorMessage(conn));
+	expect_pipeline_status(conn, PQ_PIPELINE_ON, "after entering");
+
+	send_query(conn, "SELECT $1", "1");
+	if (PQexitPipelineMode(conn) != 0)
+		pg_fatal("exiting pipeline mode with a query pending succeeded");
+	if (PQpipelineSync(conn) != 1)
+		pg_fatal("pipeline sync failed: %s", PQerrorMessage(conn));
+	if (PQexitPipelineMode(conn) != 0)
+		pg_fatal("exiting pipeline mode with a query and a sync pending succeeded");
+
+	res = expect_result(conn, PGRES_TUPLES_OK, "query");
+	expect_value(res, 0, "1", "query");
+	PQclear(res);
+	expect_no_result(conn, "query");
+
+	if (PQexitPipelineMode(conn) != 0)
+		pg_fatal("exiting pipeline mode with a sync pending succeeded");
+
+	res = expect_result(conn, PGRES_PIPELINE_SYNC, "sync");
+	PQclear(res);
+
+	if (PQexitPipelineMode(conn) != 1)
+		pg_fatal("unable to exit pipeline mode: %s", PQerrorMessage(conn));
+	expect_pipeline_status(conn, PQ_PIPELINE_OFF, "after exiting");
+}
+
+/*
+ * Queries can be sent after a sync without waiting for its result, and their
+ * results come after it.
+ */
+static void
+test_multi_pipelines(PGconn *conn)
+{
+	PGresult   *res;
+
+	if (PQenterPipelineMode(conn) != 1)
+		pg_fatal("unable to enter pipeline mode: %s", PQerrorMessage(conn));
+
+	send_query(conn, "SELECT $1", "1");
+	if (PQpipelineSync(conn) != 1)
+		pg_fatal("first pipeline sync failed: %s", PQerrorMessage(conn));
+	send_query(conn, "SELECT $1", "2");
+	if (PQpipelineSync(conn) != 1)
+		pg_fatal("second pipeline sync failed: %s", PQerrorMessage(conn));
+
+	res = expect_result(conn, PGRES_TUPLES_OK, "first query");
+	expect_value(res, 0, "1", "first query");
+	PQclear(res);
+	expect_no_result(conn, "first query");
+	res = expect_result(conn, PGRES_PIPELINE_SYNC, "first sync");
+	PQclear(res);
+
+	if (PQexitPipelineMode(conn) != 0)
+		pg_fatal("exiting pipeline mode with the second pipeline pending succeeded");
+
+	res = expect_result(conn, PGRES_TUPLES_OK, "second query");
+	expect_value(res, 0, "2", "second query");
+	PQclear(res);
+	expect_no_result(conn, "second query");
+	res = expect_result(conn, PGRES_PIPELINE_SYNC, "second sync");
+	PQclear(res);
+
+	if (PQexitPipelineMode(conn) != 1)
+		pg_fatal("unable to exit pipeline mode: %s", PQerrorMessage(conn));
+}
+
+/*
+ * After a query fails, the rest of the queries up to the next sync are not
+ * run, and report PGRES_PIPELINE_ABORTED.  The ones after the sync run as
+ * usual.
+ */
+static void
+test_pipeline_abort(PGconn *conn)
+{
+	PGresult   *res;
+
+	if (PQenterPipelineMode(conn) != 1)
+		pg_fatal("unable to enter pipeline mode: %s", PQerrorMessage(conn));
+
+	send_query(conn, "SELECT $1::int", "1");
+	send_query(conn, "SELECT no_such_function($1)", "2");
+	send_query(conn, "SELECT $1::int", "3");
+	if (PQpipelineSync(conn) != 1)
+		pg_fatal("first pipeline sync failed: %s", PQerrorMessage(conn));
+	send_query(conn, "SELECT $1::int", "4");
+	if (PQpipelineSync(conn) != 1)
+		pg_fatal("second pipeline sync failed: %s", PQerrorMessage(conn));
+
+	res = expect_result(conn, PGRES_TUPLES_OK, "query before the error");
+	expect_value(res, 0, "1", "query before the error");
+	PQclear(res);
+	expect_no_result(conn, "query before the error");
+
+	res = expect_result(conn, PGRES_FATAL_ERROR, "failing query");
+	PQclear(res);
+	expect_pipeline_status(conn, PQ_PIPELINE_ABORTED, "after the error");
+	expect_no_result(conn, "failing query");
+
+	res = expect_result(conn, PGRES_PIPELINE_ABORTED, "query after the error");
+	PQclear(res);
+	expect_no_result(conn, "query after the error");
+	expect_pipeline_status(conn, PQ_PIPELINE_ABORTED, "before the sync");
+
+	res = expect_result(conn, PGRES_PIPELINE_SYNC, "first sync");
+	PQclear(res);
+	expect_pipeline_status(conn, PQ_PIPELINE_ON, "after the sync");
+
+	res = expect_result(conn, PGRES_TUPLES_OK, "query after the sync");
+	expect_value(res, 0, "4", "query after the sync");
+	PQclear(res);
+	expect_no_result(conn, "query after the sync");
+	res = expect_result(conn, PGRES_PIPELINE_SYNC, "second sync");
+	PQclear(res);
+
+	if (PQexitPipelineMode(conn) != 1)
+		pg_fatal("unable to exit pipeline mode: %s", PQerrorMessage(conn));
+
+	/* The connection is good for normal use again */
+	res = PQexec(conn, "SELECT 1");
+	if (PQresultStatus(res) != PGRES_TUPLES_OK)
+		pg_fatal("query after the pipeline failed: %s", PQerrorMessage(conn));
+	PQclear(res);
+}
+
+/*
+ * Single-row mode can be chosen for each query of a pipeline in turn, as
+ * long as none of its results have been read yet.
+ */
+static void
+test_singlerow(PGconn *conn)
+{
+	PGresult   *res;
+	int			query;
+	int			row;
+
+	if (PQenterPipelineMode(conn) != 1)
+		pg_fatal("unable to enter pipeline mode: %s", PQerrorMessage(conn));
+
+	for (query = 0; query < 3; query++)
+		send_query(conn, "SELECT generate_series(42, $1)", "44");
+	if (PQpipelineSync(conn) != 1)
+		pg_fatal("pipeline sync failed: %s", PQerrorMessage(conn));
+
+	/* the first two queries in single-row mode */
+	for (query = 0; query < 2; query++)
+	{
+		if (PQsetSingleRowMode(conn) != 1)
+			pg_fatal("PQsetSingleRowMode() failed for query %d", query);
+
+		for (row = 0; row < 3; row++)
+		{
+			char		value[12];
+
+			snprintf(value, sizeof(value), "%d", 42 + row);
+			res = expect_result(conn, PGRES_SINGLE_TUPLE, "single row");
+			if (PQntuples(res) != 1)
+				pg_fatal("expected 1 row in single-row mode, got %d",
+						 PQntuples(res));
+			expect_value(res, 0, value, "single row");
+			PQclear(res);
+		}
+		res = expect_result(conn, PGRES_TUPLES_OK, "end of single rows");
+		if (PQntuples(res) != 0)
+			pg_fatal("expected no rows at the end of single-row mode, got %d",
+					 PQntuples(res));
+		PQclear(res);
+		expect_no_result(conn, "single-row query");
+	}
+
+	/* and the last one normally */
+	res = expect_result(conn, PGRES_TUPLES_OK, "query in normal mode");
+	if (PQntuples(res) != 3)
+		pg_fatal("expected 3 rows, got %d", PQntuples(res));
+	expect_value(res, 2, "44", "query in normal mode");
+	PQclear(res);
+	expect_no_result(conn, "query in normal mode");
+
+	/* it's too late to ask for single-row mode once the query is done */
+	if (PQsetSingleRowMode(conn) != 0)
+		pg_fatal("PQsetSingleRowMode() succeeded for a sync");
+
+	res = expect_result(conn, PGRES_PIPELINE_SYNC, "sync");
+	PQclear(res);
+
+	if (PQexitPipelineMode(conn) != 1)
+		pg_fatal("unable to exit pipeline mode: %s", PQerrorMessage(conn));
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "Usage: %s TESTNAME [CONNINFO]\n", progname);
+	fprintf(stderr, "       %s tests\n", progname);
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *conninfo = "";
+	const PipelineTest *test;
+	PGconn	   *conn;
+
+	if (argc < 2 || argc > 3)
+	{
+		usage();
+		exit(1);
+	}
+
+	if (strcmp(argv[1], "tests") == 0)
+	{
+		for (test = tests; test->name != NULL; test++)
+			printf("%s\n", test->name);
+		exit(0);
+	}
+
+	for (test = tests; test->name != NULL; test++)
+	{
+		if (strcmp(argv[1], test->name) == 0)
+			break;
+	}
+	if (test->name == NULL)
+	{
+		fprintf(stderr, "%s: \"%s\" is not a recognized test name\n",
+				progname, argv[1]);
+		usage();
+		exit(1);
+	}
+
+	if (argc > 2)
+		conninfo = argv[2];
+
+	conn = PQconnectdb(conninfo);
+	if (PQstatus(conn) != CONNECTION_OK)
+	{
+		fprintf(stderr, "%s: connection to database failed: %s",
+				progname, PQerrorMessage(conn));
+		PQfinish(conn);
+		exit(1);
+	}
+
+	test->func(conn);
+
+	PQfinish(conn);
+	return 0;
+}
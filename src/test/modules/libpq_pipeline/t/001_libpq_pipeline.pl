@@ -0,0 +1,22 @@
+use strict;
+use warnings;
+
+use PostgresNode;
+use TestLib;
+use Test::More tests => 5;
+
+my $node = get_new_node('main');
+$node->init;
+$node->start;
+
+foreach my $testname (
+	qw(disallowed_in_pipeline simple_pipeline multi_pipelines
+	pipeline_abort singlerow))
+{
+	command_ok(
+		[ "$ENV{TESTDIR}/libpq_pipeline", $testname,
+			$node->connstr('postgres') ],
+		"libpq_pipeline $testname");
+}
+
+$node->stop('fast');
@@ -907,3 +907,54 @@ EXPLAIN (COSTS OFF) SELECT balk(hundred) FROM tenk1;
 SELECT balk(hundred) FROM tenk1;
 
 ROLLBACK;
+
+-- batch-mode aggregation must give the same results as row mode
+create temp table batch_agg_tbl as
+select g as i4, g::int8 * 1000000 as i8, g / 7.0::float8 as f8,
+       nullif(g % 5, 0) as n4, date '2000-01-01' + g as d
+from generate_series(1, 3000) g;
+set executor_batch_size = 100;
+select count(*) as c, count(n4) as cn, sum(i4) as s4, sum(n4) as sn,
+       min(i8) as mn8, max(i8) as mx8, max(d) - min(d) as days,
+       count(*) filter (where i4 % 2 = 0) as even
+from batch_agg_tbl
+where i4 > 10 and (n4 is not null or i8 < 100000000);
+select sum(i4 * 1000000) from batch_agg_tbl;
+set executor_batch_size = 0;
+create temp table batch_agg_expected as
+select sum(f8) as s, min(f8 * 2 - 1) as mn, max(f8) filter (where n4 > 2) as mx,
+       avg(i8) as a, sum(i8 + i4) as s8
+from batch_agg_tbl where f8 >= 1.5 or not (n4 <> 3);
+set executor_batch_size = 100;
+select * from batch_agg_expected
+except
+select sum(f8), min(f8 * 2 - 1), max(f8) filter (where n4 > 2),
+       avg(i8), sum(i8 + i4)
+from batch_agg_tbl where f8 >= 1.5 or not (n4 <> 3);
+-- EXPLAIN ANALYZE shows that batch mode was used
+explain (analyze, costs off, summary off, timing off)
+select count(*), sum(i4) from batch_agg_tbl where i4 > 10;
+reset executor_batch_size;
+
+-- hash aggregation must give the same results when it spills to disk
+create temp table agg_spill_tbl as
+select g % 5000 as a, g as b, (g % 7)::text as t
+from generate_series(1, 20000) g;
+set work_mem = '64kB';
+set enable_sort = false;
+explain (costs off)
+select a, count(*), sum(b), max(t) from agg_spill_tbl group by a;
+create temp table agg_spill_hashed as
+select a, count(*) as c, sum(b) as s, max(t) as m
+from agg_spill_tbl group by a;
+reset enable_sort;
+set enable_hashagg = false;
+create temp table agg_spill_sorted as
+select a, count(*) as c, sum(b) as s, max(t) as m
+from agg_spill_tbl group by a;
+reset enable_hashagg;
+reset work_mem;
+select count(*) from agg_spill_hashed;
+(select * from agg_spill_hashed except select * from agg_spill_sorted)
+union all
+(select * from agg_spill_sorted except select * from agg_spill_hashed);
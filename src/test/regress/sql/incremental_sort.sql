@@ -0,0 +1,41 @@
+--
+-- INCREMENTAL SORT
+--
+
+-- One group of 50 tuples, more than a batch, then 100 groups of 10
+create temp table incr (a int, b int);
+insert into incr select 1, 51 - i from generate_series(1, 50) i;
+insert into incr select 2 + i / 10, (i * 7) % 10 from generate_series(0, 999) i;
+create index on incr (a);
+analyze incr;
+
+set enable_seqscan = off;
+set enable_bitmapscan = off;
+
+explain (costs off)
+select * from incr order by a, b;
+-- every tuple comes out, in order
+select count(*) as tuples,
+       count(*) filter (where (prev_a, prev_b) > (a, b)) as out_of_order
+from (select a, b, lag(a) over w as prev_a, lag(b) over w as prev_b
+      from (select * from incr order by a, b) s
+      window w as ()) ss;
+
+-- The first batch must take in the whole first group, not just the first
+-- tuples of it, even when the sort is bounded
+explain (costs off)
+select * from incr order by a, b limit 10 offset 25;
+select * from incr order by a, b limit 10 offset 25;
+-- and the next batch begins with the tuple that ended it
+select * from incr order by a, b limit 5 offset 48;
+
+-- A rescan starts over, with the new bound
+explain (costs off)
+select v.n, s.* from (values (2), (5)) v(n),
+  lateral (select * from incr order by a, b limit v.n) s;
+select v.n, s.* from (values (2), (5)) v(n),
+  lateral (select * from incr order by a, b limit v.n) s;
+
+reset enable_seqscan;
+reset enable_bitmapscan;
+drop table incr;
@@ -2394,6 +2394,122 @@ $$
 $$);
 rollback to settings;
 
+-- Hash tables with at least 65536 buckets are probed with outer tuples read
+-- ahead, so that their buckets can be prefetched.  Check the results of
+-- such joins, and that the hash tables are indeed that big.
+create or replace function hash_join_buckets(query text)
+returns table (batches int, buckets int) language plpgsql
+as
+$$
+declare
+  whole_plan json;
+  hash_node json;
+begin
+  for whole_plan in
+    execute 'explain (analyze, format ''json'') ' || query
+  loop
+    hash_node := find_hash(json_extract_path(whole_plan, '0', 'Plan'));
+    batches := hash_node->>'Hash Batches';
+    buckets := hash_node->>'Hash Buckets';
+    return next;
+  end loop;
+end;
+$$;
+create table big_simple as select generate_series(1, 200000) as id;
+alter table big_simple set (parallel_workers = 2);
+analyze big_simple;
+
+-- non-parallel, single-batch
+savepoint settings;
+set local max_parallel_workers_per_gather = 0;
+set local work_mem = '32MB';
+set local enable_mergejoin = off;
+select count(*) from big_simple r join big_simple s using (id);
+select batches > 1 as multibatch, buckets >= 65536 as read_ahead
+  from hash_join_buckets(
+$$
+  select count(*) from big_simple r join big_simple s using (id);
+$$);
+rollback to settings;
+
+-- non-parallel, multi-batch
+savepoint settings;
+set local max_parallel_workers_per_gather = 0;
+set local work_mem = '4MB';
+set local enable_mergejoin = off;
+select count(*) from big_simple r join big_simple s using (id);
+select batches > 1 as multibatch, buckets >= 65536 as read_ahead
+  from hash_join_buckets(
+$$
+  select count(*) from big_simple r join big_simple s using (id);
+$$);
+rollback to settings;
+
+-- parallel-aware, single-batch
+savepoint settings;
+set local max_parallel_workers_per_gather = 2;
+set local enable_parallel_hash = on;
+set local work_mem = '32MB';
+set local enable_mergejoin = off;
+select count(*) from big_simple r join big_simple s using (id);
+select batches > 1 as multibatch, buckets >= 65536 as read_ahead
+  from hash_join_buckets(
+$$
+  select count(*) from big_simple r join big_simple s using (id);
+$$);
+rollback to settings;
+
+-- parallel-aware, multi-batch
+savepoint settings;
+set local max_parallel_workers_per_gather = 2;
+set local enable_parallel_hash = on;
+set local work_mem = '2MB';
+set local enable_mergejoin = off;
+select count(*) from big_simple r join big_simple s using (id);
+select batches > 1 as multibatch, buckets >= 65536 as read_ahead
+  from hash_join_buckets(
+$$
+  select count(*) from big_simple r join big_simple s using (id);
+$$);
+rollback to settings;
+
+-- single-batch with rescan, non-parallel
+savepoint settings;
+set local max_parallel_workers_per_gather = 0;
+set local enable_material = off;
+set local work_mem = '32MB';
+set local enable_mergejoin = off;
+select count(*) from join_foo
+  left join (select b1.id from big_simple b1 join big_simple b2 using (id)) ss
+  on join_foo.id < ss.id + 1 and join_foo.id > ss.id - 1;
+select batches > 1 as multibatch, buckets >= 65536 as read_ahead
+  from hash_join_buckets(
+$$
+  select count(*) from join_foo
+    left join (select b1.id from big_simple b1 join big_simple b2 using (id)) ss
+    on join_foo.id < ss.id + 1 and join_foo.id > ss.id - 1;
+$$);
+rollback to settings;
+
+-- multi-batch with rescan, parallel-aware
+savepoint settings;
+set local max_parallel_workers_per_gather = 2;
+set local enable_parallel_hash = on;
+set local enable_material = off;
+set local work_mem = '2MB';
+set local enable_mergejoin = off;
+select count(*) from join_foo
+  left join (select b1.id from big_simple b1 join big_simple b2 using (id)) ss
+  on join_foo.id < ss.id + 1 and join_foo.id > ss.id - 1;
+select batches > 1 as multibatch, buckets >= 65536 as read_ahead
+  from hash_join_buckets(
+$$
+  select count(*) from join_foo
+    left join (select b1.id from big_simple b1 join big_simple b2 using (id)) ss
+    on join_foo.id < ss.id + 1 and join_foo.id > ss.id - 1;
+$$);
+rollback to settings;
+
 -- A full outer join where every record is matched.
 
 -- non-parallel
@@ -2404,8 +2520,18 @@ explain (costs off)
 select  count(*) from simple r full outer join simple s using (id);
 rollback to settings;
 
--- parallelism not possible with parallel-oblivious outer hash join
+-- parallelism not possible with parallel-oblivious full hash join
 savepoint settings;
+set local enable_parallel_hash = off;
+set local max_parallel_workers_per_gather = 2;
+explain (costs off)
+     select  count(*) from simple r full outer join simple s using (id);
+select  count(*) from simple r full outer join simple s using (id);
+rollback to settings;
+
+-- parallelism is possible with parallel-aware full hash join
+savepoint settings;
+set local enable_parallel_hash = on;
 set local max_parallel_workers_per_gather = 2;
 explain (costs off)
      select  count(*) from simple r full outer join simple s using (id);
@@ -2422,14 +2548,70 @@ explain (costs off)
 select  count(*) from simple r full outer join simple s on (r.id = 0 - s.id);
 rollback to settings;
 
--- parallelism not possible with parallel-oblivious outer hash join
+-- parallelism not possible with parallel-oblivious full hash join
+savepoint settings;
+set local enable_parallel_hash = off;
+set local max_parallel_workers_per_gather = 2;
+explain (costs off)
+     select  count(*) from simple r full outer join simple s on (r.id = 0 - s.id);
+select  count(*) from simple r full outer join simple s on (r.id = 0 - s.id);
+rollback to settings;
+
+-- parallelism is possible with parallel-aware full hash join
 savepoint settings;
+set local enable_parallel_hash = on;
 set local max_parallel_workers_per_gather = 2;
 explain (costs off)
      select  count(*) from simple r full outer join simple s on (r.id = 0 - s.id);
 select  count(*) from simple r full outer join simple s on (r.id = 0 - s.id);
 rollback to settings;
 
+-- Multi-batch parallel right and full joins.  Each batch is scanned for
+-- unmatched inner tuples by the last participant attached to it, while the
+-- others go on to other batches.
+savepoint settings;
+set local max_parallel_workers_per_gather = 1;
+set local work_mem = '128kB';
+set local enable_parallel_hash = on;
+set local enable_mergejoin = off;
+explain (costs off)
+  select count(*) from simple r right join extremely_skewed s using (id);
+select count(*) from simple r right join extremely_skewed s using (id);
+select final > 1 as multibatch
+  from hash_join_batches(
+$$
+  select count(*) from simple r right join extremely_skewed s using (id);
+$$);
+explain (costs off)
+  select count(*) from simple r full join extremely_skewed s using (id);
+select count(*) from simple r full join extremely_skewed s using (id);
+select final > 1 as multibatch
+  from hash_join_batches(
+$$
+  select count(*) from simple r full join extremely_skewed s using (id);
+$$);
+-- a participant that stops probing early, here because of the LIMIT, must
+-- leave the batch unscanned rather than emit unmatched tuples wrongly
+select count(*) from
+  (select r.id from simple r full join extremely_skewed s using (id) limit 10) ss;
+rollback to settings;
+
+-- the same with huge tuples
+savepoint settings;
+set local max_parallel_workers_per_gather = 2;
+set local work_mem = '128kB';
+set local enable_parallel_hash = on;
+set local enable_mergejoin = off;
+select length(max(s.t))
+from wide full join (select id, coalesce(t, '') || '' as t from wide) s using (id);
+select final > 1 as multibatch
+  from hash_join_batches(
+$$
+  select length(max(s.t))
+  from wide full join (select id, coalesce(t, '') || '' as t from wide) s using (id);
+$$);
+rollback to settings;
+
 -- exercise special code paths for huge tuples (note use of non-strict
 -- expression and left join required to get the detoasted tuple into
 -- the hash table)
@@ -2454,3 +2636,221 @@ $$);
 rollback to settings;
 
 rollback;
+
+--
+-- test result caching of parameterized nestloop inner sides
+--
+set enable_hashjoin = off;
+set enable_mergejoin = off;
+set enable_bitmapscan = off;
+
+explain (costs off)
+select count(*), avg(t1.unique1) from tenk1 t1
+inner join tenk1 t2 on t1.unique1 = t2.twenty
+where t2.unique1 < 1000;
+select count(*), avg(t1.unique1) from tenk1 t1
+inner join tenk1 t2 on t1.unique1 = t2.twenty
+where t2.unique1 < 1000;
+
+-- how well did the cache work?
+create function find_result_cache(node json)
+returns json language plpgsql
+as
+$$
+declare
+  x json;
+  child json;
+begin
+  if node->>'Node Type' = 'Result Cache' then
+    return node;
+  else
+    for child in select json_array_elements(node->'Plans')
+    loop
+      x := find_result_cache(child);
+      if x is not null then
+        return x;
+      end if;
+    end loop;
+    return null;
+  end if;
+end;
+$$;
+create function result_cache_stats(query text)
+returns table (hits int, misses int, evictions int) language plpgsql
+as
+$$
+declare
+  whole_plan json;
+  cache_node json;
+begin
+  for whole_plan in
+    execute 'explain (analyze, format ''json'') ' || query
+  loop
+    cache_node := find_result_cache(json_extract_path(whole_plan, '0', 'Plan'));
+    hits := cache_node->>'Cache Hits';
+    misses := cache_node->>'Cache Misses';
+    evictions := cache_node->>'Cache Evictions';
+    return next;
+  end loop;
+end;
+$$;
+
+-- each of the 20 keys misses once
+select * from result_cache_stats($$
+select count(*), avg(t1.unique1) from tenk1 t1
+inner join tenk1 t2 on t1.unique1 = t2.twenty
+where t2.unique1 < 1000
+$$);
+
+-- a lateral reference is a cache key too
+explain (costs off)
+select count(*), avg(t2.unique1) from tenk1 t1,
+lateral (select t2.unique1 from tenk1 t2 where t1.twenty = t2.unique1 offset 0) t2
+where t1.unique1 < 1000;
+select count(*), avg(t2.unique1) from tenk1 t1,
+lateral (select t2.unique1 from tenk1 t2 where t1.twenty = t2.unique1 offset 0) t2
+where t1.unique1 < 1000;
+select * from result_cache_stats($$
+select count(*), avg(t2.unique1) from tenk1 t1,
+lateral (select t2.unique1 from tenk1 t2 where t1.twenty = t2.unique1 offset 0) t2
+where t1.unique1 < 1000
+$$);
+
+-- 2000 keys don't all fit in 64kB, so entries must be evicted; how often
+-- depends on the order of the outer tuples and the size of an entry.  Plan
+-- it at the default work_mem, where the cache is worth having.
+prepare rc_evict as
+select count(*), avg(t1.unique1) from tenk1 t1
+inner join tenk1 t2 on t1.unique1 = t2.twothousand
+where t2.unique1 < 2400;
+explain (costs off) execute rc_evict;
+set work_mem = '64kB';
+execute rc_evict;
+select hits + misses as lookups, evictions > 0 as evicted
+from result_cache_stats('execute rc_evict');
+reset work_mem;
+deallocate rc_evict;
+
+drop function result_cache_stats(text);
+drop function find_result_cache(json);
+
+reset enable_hashjoin;
+reset enable_mergejoin;
+reset enable_bitmapscan;
+
+--
+-- test runtime filters pushed down from hash joins into outer scans
+--
+set enable_nestloop = off;
+set enable_mergejoin = off;
+
+explain (costs off)
+select count(*), sum(t1.unique1) from tenk1 t1
+inner join tenk2 t2 on t1.unique1 = t2.unique2
+where t2.thousand = 0;
+select count(*), sum(t1.unique1) from tenk1 t1
+inner join tenk2 t2 on t1.unique1 = t2.unique2
+where t2.thousand = 0;
+
+-- not for outer joins that must return the unmatched outer tuples
+explain (costs off)
+select count(*), sum(t1.unique1) from tenk1 t1
+left join tenk2 t2 on t1.unique1 = t2.unique2 and t2.thousand = 0;
+
+-- what the runtime filter did, and how many batches the hash join used
+create function plan_nodes(node json)
+returns setof json language plpgsql
+as
+$$
+declare
+  child json;
+begin
+  return next node;
+  for child in select json_array_elements(node->'Plans')
+  loop
+    return query select * from plan_nodes(child);
+  end loop;
+end;
+$$;
+create function runtime_filter_stats(query text)
+returns table (batches int, removed int) language plpgsql
+as
+$$
+declare
+  whole_plan json;
+begin
+  execute 'explain (analyze, format ''json'') ' || query into whole_plan;
+  select max((n->>'Hash Batches')::int),
+         sum((n->>'Rows Removed by Runtime Filter')::int)
+    into batches, removed
+    from plan_nodes(json_extract_path(whole_plan, '0', 'Plan')) n;
+  return next;
+end;
+$$;
+
+-- the filter covers the inner tuples of all batches, not just the first
+set work_mem = '64kB';
+explain (costs off)
+select count(*), sum(t1.unique1) from tenk1 t1
+inner join tenk2 t2 on t1.unique1 = t2.unique1
+where t2.thousand < 300;
+select count(*), sum(t1.unique1) from tenk1 t1
+inner join tenk2 t2 on t1.unique1 = t2.unique1
+where t2.thousand < 300;
+select batches > 1 as multibatch, removed > 0 as filtered
+from runtime_filter_stats($$
+select count(*), sum(t1.unique1) from tenk1 t1
+inner join tenk2 t2 on t1.unique1 = t2.unique1
+where t2.thousand < 300
+$$);
+reset work_mem;
+
+-- each worker builds a filter from its own copy of the hash table
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set min_parallel_table_scan_size = 0;
+set max_parallel_workers_per_gather = 2;
+set enable_parallel_hash = off;
+explain (costs off)
+select count(*), sum(t1.unique1) from tenk1 t1
+inner join tenk2 t2 on t1.unique1 = t2.unique2
+where t2.thousand = 0;
+select count(*), sum(t1.unique1) from tenk1 t1
+inner join tenk2 t2 on t1.unique1 = t2.unique2
+where t2.thousand = 0;
+select removed > 0 as filtered
+from runtime_filter_stats($$
+select count(*), sum(t1.unique1) from tenk1 t1
+inner join tenk2 t2 on t1.unique1 = t2.unique2
+where t2.thousand = 0
+$$);
+reset parallel_setup_cost;
+reset parallel_tuple_cost;
+reset min_parallel_table_scan_size;
+reset max_parallel_workers_per_gather;
+reset enable_parallel_hash;
+
+-- NULL keys never match, so the filter may drop outer tuples that have
+-- them; but a right join must still return the inner ones
+create temp table rf_outer as
+  select case when i % 10 = 0 then null else i end as k
+  from generate_series(1, 10000) i;
+create temp table rf_inner as
+  select case when i % 2 = 0 then null else i end as k
+  from generate_series(1, 200) i;
+analyze rf_outer;
+analyze rf_inner;
+explain (costs off)
+select count(*), sum(i.k) from rf_outer o inner join rf_inner i on o.k = i.k;
+select count(*), sum(i.k) from rf_outer o inner join rf_inner i on o.k = i.k;
+explain (costs off)
+select count(*), count(o.k) from rf_outer o right join rf_inner i on o.k = i.k;
+select count(*), count(o.k) from rf_outer o right join rf_inner i on o.k = i.k;
+drop table rf_outer;
+drop table rf_inner;
+
+drop function runtime_filter_stats(text);
+drop function plan_nodes(json);
+
+reset enable_nestloop;
+reset enable_mergejoin;
@@ -141,3 +141,9 @@ select sum(tenthous) as s1, sum(tenthous) + random()*0 as s2
 
 select sum(tenthous) as s1, sum(tenthous) + random()*0 as s2
   from tenk1 group by thousand order by thousand limit 3;
+
+-- incremental sort of input that is already sorted by a prefix of the keys
+explain (costs off)
+select hundred, unique1 from tenk1 order by hundred, unique1 limit 5;
+
+select hundred, unique1 from tenk1 order by hundred, unique1 limit 5;
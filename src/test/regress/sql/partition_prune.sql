@@ -378,6 +378,8 @@ create index ab_a3_b3_a_idx on ab_a3_b3 (a);
 
 set enable_hashjoin = 0;
 set enable_mergejoin = 0;
+-- A result cache above the Append would hide its loop counts
+set enable_resultcache = 0;
 
 prepare ab_q6 (int, int, int) as
 select avg(ab.a) from ab inner join lprt_a a on ab.a = a.a where a.a in($1,$2,$3);
@@ -400,6 +402,7 @@ explain (analyze, costs off, summary off, timing off) execute ab_q6 (1, 0, 0);
 
 reset enable_hashjoin;
 reset enable_mergejoin;
+reset enable_resultcache;
 reset parallel_setup_cost;
 reset parallel_tuple_cost;
 reset min_parallel_table_scan_size;
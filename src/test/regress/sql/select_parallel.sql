@@ -78,9 +78,12 @@ select sp_parallel_restricted(unique1) from tenk1
   where stringu1 = 'GRAAAA' order by 1;
 
 -- test parallel plan when group by expression is in target list.
+-- (partial aggregation; Parallel HashAggregate is tested below)
+set enable_parallel_hashagg to off;
 explain (costs off)
 	select length(stringu1) from tenk1 group by length(stringu1);
 select length(stringu1) from tenk1 group by length(stringu1);
+reset enable_parallel_hashagg;
 
 explain (costs off)
 	select stringu1, count(*) from tenk1 group by stringu1 order by stringu1;
@@ -91,6 +94,53 @@ explain (costs off)
 	select  sum(sp_parallel_restricted(unique1)) from tenk1
 	group by(sp_parallel_restricted(unique1));
 
+-- test Parallel HashAggregate, with all workers sharing one hash table
+explain (costs off)
+	select thousand, count(*), sum(unique1), max(hundred) from tenk1
+	group by thousand;
+select count(*), sum(c), sum(s), sum(m) from
+	(select thousand, count(*) c, sum(unique1) s, max(hundred) m from tenk1
+	 group by thousand) ss;
+-- FILTER clauses and arguments are evaluated before the group is locked
+select sum(c), sum(m) from
+	(select thousand, count(*) filter (where four = 0) c, min(unique1 + 1) m
+	 from tenk1 group by thousand) ss;
+-- aggregates whose transition functions might not be safe to call while the
+-- group is locked fall back to the other grouping paths
+create function uses_parallel_hashagg(query text) returns bool
+language plpgsql as
+$$
+declare
+  ln text;
+begin
+  for ln in execute 'explain (costs off) ' || query
+  loop
+    if ln like '%Parallel HashAggregate%' then
+      return true;
+    end if;
+  end loop;
+  return false;
+end;
+$$;
+create function sp_int4_larger(int, int) returns int as
+  'select greatest($1, $2)' language sql immutable strict parallel safe;
+create aggregate sp_max_sql(int) (sfunc = sp_int4_larger, stype = int,
+  combinefunc = sp_int4_larger, parallel = safe);
+create aggregate sp_max_builtin(int) (sfunc = int4larger, stype = int,
+  combinefunc = int4larger, parallel = safe);
+select uses_parallel_hashagg('select thousand, count(*), max(hundred) from tenk1 group by thousand');
+select uses_parallel_hashagg('select thousand, sp_max_builtin(hundred) from tenk1 group by thousand');
+select uses_parallel_hashagg('select thousand, sp_max_sql(hundred) from tenk1 group by thousand');
+select uses_parallel_hashagg('select thousand, count(distinct four) from tenk1 group by thousand');
+select uses_parallel_hashagg('select thousand, max(hundred order by hundred) from tenk1 group by thousand');
+select uses_parallel_hashagg('select thousand, sum(hundred::float8) from tenk1 group by thousand');
+select ten, sp_max_sql(hundred), sp_max_builtin(hundred) from tenk1
+	group by ten order by ten;
+drop aggregate sp_max_sql(int);
+drop aggregate sp_max_builtin(int);
+drop function sp_int4_larger(int, int);
+drop function uses_parallel_hashagg(text);
+
 -- test prepared statement
 prepare tenk1_count(integer) As select  count((unique1)) from tenk1 where hundred > $1;
 explain (costs off) execute tenk1_count(1);
@@ -309,6 +359,46 @@ select string4 from tenk1 order by string4 limit 5;
 reset parallel_leader_participation;
 reset max_parallel_workers;
 
+-- test Parallel Sort, with the leader merging the runs sorted by all
+-- participants; that only pays off if sending tuples to the leader costs
+-- something
+set parallel_tuple_cost=0.1;
+explain (costs off)
+  select string_agg(unique1::text, ',') from
+    (select twothousand, unique1 from tenk1 order by twothousand, unique1) ss;
+select string_agg(unique1::text, ',') =
+    (select string_agg(unique1::text, ',' order by twothousand, unique1) from tenk1)
+  from (select twothousand, unique1 from tenk1 order by twothousand, unique1) ss;
+
+-- several workers, each spilling its share to disk, and a rescan
+set work_mem = '64kB';
+set enable_material = false;
+create function explain_parallel_sort() returns setof text
+language plpgsql as
+$$
+declare ln text;
+begin
+    for ln in
+        explain (analyze, timing off, summary off, costs off)
+          select * from
+          (select twothousand, unique1 from tenk1 order by twothousand, unique1) ss
+          right join (values (1),(2)) v(x) on true
+    loop
+        -- the sort methods depend on how the input was divided
+        continue when ln like '%Sort Method:%';
+        return next ln;
+    end loop;
+end;
+$$;
+select * from explain_parallel_sort();
+drop function explain_parallel_sort();
+select string_agg(unique1::text, ',') =
+    (select string_agg(unique1::text, ',' order by twothousand, unique1) from tenk1)
+  from (select twothousand, unique1 from tenk1 order by twothousand, unique1) ss;
+reset enable_material;
+reset work_mem;
+set parallel_tuple_cost=0;
+
 SAVEPOINT settings;
 SET LOCAL force_parallel_mode = 1;
 explain (costs off)
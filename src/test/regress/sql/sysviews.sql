@@ -15,6 +15,22 @@ select count(*) >= 0 as ok from pg_available_extensions;
 -- At introduction, pg_config had 23 entries; it may grow
 select count(*) > 20 as ok from pg_config;
 
+-- There must be only one TopMemoryContext, at the root of the tree
+select name, ident, parent, level, total_bytes >= free_bytes
+  from pg_backend_memory_contexts where level = 0;
+
+-- A backend can be asked to log its memory contexts, but only by superusers
+select pg_log_backend_memory_contexts(pg_backend_pid());
+
+create role regress_log_memory;
+set role regress_log_memory;
+select pg_log_backend_memory_contexts(pg_backend_pid());
+reset role;
+drop role regress_log_memory;
+
+-- A pid that is no server process only gets a warning
+select pg_log_backend_memory_contexts(0);
+
 -- We expect no cursors in this test; see also portals.sql
 select count(*) = 0 as ok from pg_cursors;
 
@@ -32,6 +48,9 @@ select count(*) = 0 as ok from pg_prepared_statements;
 -- See also prepared_xacts.sql
 select count(*) >= 0 as ok from pg_prepared_xacts;
 
+-- One row per phase of connection startup
+select phase, array_length(histogram, 1) from pg_stat_connection_startup;
+
 -- This is to record the prevailing planner enable_foo settings during
 -- a regression test run.
 select name, setting from pg_settings where name like 'enable%';
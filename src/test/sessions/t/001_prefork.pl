@@ -0,0 +1,99 @@
+# Test preforked backends, in particular that the postmaster stops forking
+# them when there are no PGPROCs left for them.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 6;
+use Time::HiRes qw(usleep);
+
+my $psql_timeout = IPC::Run::timer(60);
+
+# With max_connections = 4 and one connection reserved for superusers, there
+# is room for at most three preforked or connected backends.
+my $node = get_new_node('prefork');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq{
+max_connections = 4
+superuser_reserved_connections = 1
+prefork_backends = 2
+log_min_messages = debug2
+});
+$node->start;
+
+# Number of preforked backends started so far
+sub forks_started
+{
+	my @forks = (slurp_file($node->logfile) =~
+		  /forked new preforked backend/g);
+	return scalar @forks;
+}
+
+# Wait until the given number of preforked backends has been started
+sub wait_for_forks
+{
+	my ($count) = @_;
+	my $attempts = 0;
+
+	while ($attempts < 180 * 10)
+	{
+		return 1 if forks_started() >= $count;
+		usleep(100_000);
+		$attempts++;
+	}
+	return 0;
+}
+
+# Open a session that stays connected until we finish it
+sub open_session
+{
+	my %session = (stdin => '', stdout => '', stderr => '');
+
+	$session{handle} = IPC::Run::start(
+		[   'psql', '-X', '-qAt', '-v', 'ON_ERROR_STOP=1', '-f', '-', '-d',
+			$node->connstr('postgres') ],
+		'<',
+		\$session{stdin},
+		'>',
+		\$session{stdout},
+		'2>',
+		\$session{stderr},
+		$psql_timeout);
+	$session{stdin} .= "SELECT 'connected';\n";
+	$session{handle}->pump until $session{stdout} =~ /connected/;
+	return \%session;
+}
+
+ok(wait_for_forks(2), 'backends preforked at startup');
+
+# Each session uses up a preforked backend, which is replaced only as long as
+# there's a PGPROC left for the replacement.
+my @sessions;
+push @sessions, open_session() for (1 .. 3);
+ok(wait_for_forks(3), 'used-up preforked backend replaced');
+
+# Give the postmaster a chance to overdo it
+sleep(2);
+is(forks_started(), 3, 'no backends preforked without a free PGPROC');
+unlike(
+	slurp_file($node->logfile),
+	qr/too many clients/,
+	'no preforked backend ran out of PGPROCs');
+
+# The reserved connection is still there for a superuser
+is($node->safe_psql('postgres', 'SELECT 1'), '1', 'superuser can connect');
+
+# Once a session has ended, its PGPROC goes to a new preforked backend
+my $session = pop @sessions;
+$session->{stdin} .= "\\q\n";
+$session->{handle}->finish;
+ok(wait_for_forks(4), 'preforked backend started after disconnection');
+
+foreach $session (@sessions)
+{
+	$session->{stdin} .= "\\q\n";
+	$session->{handle}->finish;
+}
+
+$node->stop;
@@ -0,0 +1,183 @@
+# Test pooled sessions sharing one backend: each keeps its own settings,
+# prepared statements, sequence state and cancel key, and a session's client
+# going away doesn't affect the others.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 16;
+use Time::HiRes qw(usleep);
+
+my $psql_timeout = IPC::Run::timer(60);
+
+my $node = get_new_node('session_pool');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq{
+session_pool_size = 1
+});
+$node->start;
+
+# Wait until the server log matches the given pattern
+sub wait_for_log
+{
+	my ($regexp) = @_;
+	my $attempts = 0;
+
+	while ($attempts < 180 * 10)
+	{
+		return 1 if slurp_file($node->logfile) =~ $regexp;
+		usleep(100_000);
+		$attempts++;
+	}
+	return 0;
+}
+
+# Open a session that stays connected until we finish it
+sub open_session
+{
+	my %session = (stdin => '', stdout => '', stderr => '');
+
+	$session{handle} = IPC::Run::start(
+		[   'psql', '-X', '-qAt', '-f', '-', '-d',
+			$node->connstr('postgres') ],
+		'<',
+		\$session{stdin},
+		'>',
+		\$session{stdout},
+		'2>',
+		\$session{stderr},
+		$psql_timeout);
+	return \%session;
+}
+
+# Send a command to a session without waiting for the result
+sub send_query
+{
+	my ($session, $sql) = @_;
+
+	$session->{stdout} = '';
+	$session->{stdin} .= "$sql;\n\\echo __done__\n";
+	$session->{handle}->pump while length $session->{stdin};
+}
+
+# Wait for the result of the command last sent to a session
+sub wait_result
+{
+	my ($session) = @_;
+
+	$session->{handle}->pump until $session->{stdout} =~ /__done__/;
+	$session->{stdout} =~ s/\n?__done__\n//;
+	return $session->{stdout};
+}
+
+# Run a command in a session, and return its output
+sub run_query
+{
+	my ($session, $sql) = @_;
+
+	send_query($session, $sql);
+	return wait_result($session);
+}
+
+# Wait until a session's backend is running the given query.  Other databases
+# have pools of their own, so this doesn't have to wait for the session.
+sub wait_for_active
+{
+	my ($query) = @_;
+
+	$node->poll_query_until('template1', qq{
+SELECT count(*) > 0 FROM pg_stat_activity
+WHERE state = 'active' AND query LIKE '$query%'
+}) or die "timed out waiting for \"$query\" to start";
+}
+
+my $s1 = open_session();
+my $s2 = open_session();
+
+is(run_query($s1, 'SELECT pg_backend_pid()'),
+	run_query($s2, 'SELECT pg_backend_pid()'),
+	'sessions served by the same backend');
+
+# Settings and prepared statements belong to the session
+run_query($s1, "SET work_mem = '1234kB'");
+is(run_query($s2, 'SHOW work_mem'), '4MB', 'setting not seen by other session');
+is(run_query($s1, 'SHOW work_mem'), '1234kB', 'setting kept by session');
+
+run_query($s1, "PREPARE p AS SELECT 'one'");
+run_query($s2, "PREPARE p AS SELECT 'two'");
+is(run_query($s1, 'EXECUTE p'), 'one', 'first session has its own statement');
+is(run_query($s2, 'EXECUTE p'), 'two',
+	'second session has its own statement');
+
+# So are currval() and lastval()
+run_query($s1, 'CREATE SEQUENCE seq');
+is(run_query($s1, "SELECT nextval('seq')"), '1', 'sequence used by session');
+run_query($s2, "SELECT currval('seq')");
+like(
+	$s2->{stderr},
+	qr/currval of sequence "seq" is not yet defined in this session/,
+	'sequence state not seen by other session');
+is(run_query($s1, "SELECT currval('seq'), lastval()"),
+	'1|1', 'sequence state kept by session');
+
+# While the backend runs the first session's query, a cancel request from
+# the second session's client must not cancel it.
+send_query($s1, 'SELECT pg_sleep(3)');
+wait_for_active('SELECT pg_sleep(3)');
+send_query($s2, "SELECT 'waited'");
+usleep(500_000);
+$s2->{handle}->signal('INT');
+wait_result($s1);
+unlike($s1->{stderr}, qr/canceling statement/,
+	'query not canceled by another session');
+is(wait_result($s2), 'waited', 'other session served afterwards');
+
+# A cancel request from the session's own client works as usual
+send_query($s1, 'SELECT pg_sleep(60)');
+wait_for_active('SELECT pg_sleep(60)');
+$s1->{handle}->signal('INT');
+wait_result($s1);
+like(
+	$s1->{stderr},
+	qr/canceling statement due to user request/,
+	'query canceled by its own session');
+is(run_query($s1, "SELECT 'still connected'"),
+	'still connected', 'session usable after cancel');
+
+# A client that goes away in the middle of a query's output only ends its
+# own session; the backend carries on serving the others.
+my $pid = run_query($s1, 'SELECT pg_backend_pid()');
+my $copy_stderr = '';
+my $copy = IPC::Run::start(
+	[   'psql', '-X', '-qAt', '-c',
+		"COPY (SELECT repeat('x', 1000) FROM generate_series(1, 10000000)) TO STDOUT",
+		'-d', $node->connstr('postgres') ],
+	'>', '/dev/null', '2>', \$copy_stderr, $psql_timeout);
+wait_for_active('COPY (SELECT repeat');
+$copy->kill_kill;
+ok(wait_for_log(qr/connection to client lost/),
+	'lost connection reported');
+is(run_query($s1, 'SELECT pg_backend_pid()'),
+	$pid, 'backend survives a client going away mid-output');
+
+# So does a session that exceeds idle_in_transaction_session_timeout.  The
+# other sessions wait for the transaction to end, since sessions are only
+# switched between transactions.
+my $s3 = open_session();
+run_query($s3, "SET idle_in_transaction_session_timeout = '500ms'");
+run_query($s3, 'BEGIN');
+ok( wait_for_log(
+		qr/terminating connection due to idle-in-transaction timeout/),
+	'idle-in-transaction timeout reported');
+is(run_query($s1, 'SELECT pg_backend_pid()'),
+	$pid, 'backend survives idle-in-transaction timeout of a session');
+$s3->{handle}->kill_kill;
+
+foreach my $session ($s1, $s2)
+{
+	$session->{stdin} .= "\\q\n";
+	$session->{handle}->finish;
+}
+
+$node->stop;
@@ -0,0 +1,139 @@
+# Test the return of idle pooled sessions to the postmaster, and that they
+# keep their state when they are served again.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 11;
+use Time::HiRes qw(usleep);
+
+my $psql_timeout = IPC::Run::timer(60);
+
+my $node = get_new_node('session_migration');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq{
+session_pool_size = 1
+session_pool_return_delay = 200
+log_min_messages = debug2
+});
+$node->start;
+
+# Number of sessions returned to the postmaster so far
+sub sessions_returned
+{
+	my @returned = (slurp_file($node->logfile) =~
+		  /returned idle session to postmaster/g);
+	return scalar @returned;
+}
+
+# Wait until the given number of sessions has been returned
+sub wait_for_returns
+{
+	my ($count) = @_;
+	my $attempts = 0;
+
+	while ($attempts < 180 * 10)
+	{
+		return 1 if sessions_returned() >= $count;
+		usleep(100_000);
+		$attempts++;
+	}
+	return 0;
+}
+
+# Wait until the server log matches the given pattern
+sub wait_for_log
+{
+	my ($regexp) = @_;
+	my $attempts = 0;
+
+	while ($attempts < 180 * 10)
+	{
+		return 1 if slurp_file($node->logfile) =~ $regexp;
+		usleep(100_000);
+		$attempts++;
+	}
+	return 0;
+}
+
+# Open a session that stays connected until we finish it
+sub open_session
+{
+	my %session = (stdin => '', stdout => '', stderr => '');
+
+	$session{handle} = IPC::Run::start(
+		[   'psql', '-X', '-qAt', '-v', 'ON_ERROR_STOP=1', '-f', '-', '-d',
+			$node->connstr('postgres') ],
+		'<',
+		\$session{stdin},
+		'>',
+		\$session{stdout},
+		'2>',
+		\$session{stderr},
+		$psql_timeout);
+	return \%session;
+}
+
+# Run a command in a session, and return its output
+sub run_query
+{
+	my ($session, $sql) = @_;
+
+	$session->{stdout} = '';
+	$session->{stdin} .= "$sql;\n\\echo __done__\n";
+	$session->{handle}->pump until $session->{stdout} =~ /__done__/;
+	$session->{stdout} =~ s/\n?__done__\n//;
+	return $session->{stdout};
+}
+
+my $session = open_session();
+
+my $returned = sessions_returned();
+run_query($session, "SET work_mem = '1234kB'");
+ok(wait_for_returns($returned + 1), 'idle session returned');
+
+# The next command brings the session back, with its settings
+$returned = sessions_returned();
+is(run_query($session, 'SHOW work_mem'), '1234kB',
+	'setting kept by returned session');
+
+# Each time it goes idle again, it is returned again
+ok(wait_for_returns($returned + 1), 'session returned again');
+is(run_query($session, "SELECT 'still connected'"),
+	'still connected', 'session usable after being returned twice');
+
+# Prepared statements move with the session, and are prepared again by the
+# backend that serves it next
+$returned = sessions_returned();
+run_query($session, "PREPARE q AS SELECT 'prepared'");
+ok(wait_for_returns($returned + 1), 'session with prepared statement returned');
+is(run_query($session, 'EXECUTE q'), 'prepared',
+	'prepared statement kept by returned session');
+
+# So do currval() and lastval()
+$returned = sessions_returned();
+run_query($session, "CREATE SEQUENCE seq; SELECT nextval('seq')");
+ok(wait_for_returns($returned + 1), 'session with sequence state returned');
+is(run_query($session, "SELECT currval('seq'), lastval()"),
+	'1|1', 'sequence state kept by returned session');
+
+# A temporary table stays with the backend, so no session may be returned
+# while it exists.
+$returned = sessions_returned();
+run_query($session, 'CREATE TEMP TABLE tmp (a int)');
+ok(wait_for_log(qr/The server process has temporary objects/),
+	'temporary table reported as blocking the return of sessions');
+sleep(1);
+is(sessions_returned(), $returned,
+	'no session returned while temporary table exists');
+
+# Once the table is dropped, sessions are returned again
+run_query($session, 'DROP TABLE tmp');
+ok(wait_for_returns($returned + 1),
+	'session returned after temporary table dropped');
+
+$session->{stdin} .= "\\q\n";
+$session->{handle}->finish;
+
+$node->stop;
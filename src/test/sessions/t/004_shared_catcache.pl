@@ -0,0 +1,108 @@
+# Test that backends use tuples from the shared catalog cache without
+# copying them, and that catalog changes invalidate the shared entries, so
+# that backends loading them from there never see stale tuples.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 8;
+
+my $psql_timeout = IPC::Run::timer(60);
+
+my $node = get_new_node('shared_catcache');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq{
+shared_catcache_size = 8MB
+});
+$node->start;
+
+# Open a session that stays connected until we finish it
+sub open_session
+{
+	my %session = (stdin => '', stdout => '', stderr => '');
+
+	$session{handle} = IPC::Run::start(
+		[   'psql', '-X', '-qAt', '-v', 'ON_ERROR_STOP=1', '-f', '-', '-d',
+			$node->connstr('postgres') ],
+		'<',
+		\$session{stdin},
+		'>',
+		\$session{stdout},
+		'2>',
+		\$session{stderr},
+		$psql_timeout);
+	return \%session;
+}
+
+# Run a command in a session, and return its output
+sub run_query
+{
+	my ($session, $sql) = @_;
+
+	$session->{stdout} = '';
+	$session->{stdin} .= "$sql;\n\\echo __done__\n";
+	$session->{handle}->pump until $session->{stdout} =~ /__done__/;
+	$session->{stdout} =~ s/\n?__done__\n//;
+	return $session->{stdout};
+}
+
+# Each safe_psql call runs in a new backend, which finds its catalog tuples
+# in the shared cache once some other backend has loaded them.
+$node->safe_psql('postgres', q{
+CREATE FUNCTION f() RETURNS int LANGUAGE sql AS 'SELECT 1';
+CREATE TABLE t (a int);
+INSERT INTO t VALUES (42);
+});
+is($node->safe_psql('postgres', 'SELECT f()'), '1', 'function loaded');
+is($node->safe_psql('postgres', 'SELECT a FROM t'), '42', 'table loaded');
+
+$node->safe_psql('postgres',
+	q{CREATE OR REPLACE FUNCTION f() RETURNS int LANGUAGE sql AS 'SELECT 2'});
+is($node->safe_psql('postgres', 'SELECT f()'),
+	'2', 'new backend sees replaced function');
+
+$node->safe_psql('postgres', 'ALTER TABLE t RENAME COLUMN a TO b');
+is($node->safe_psql('postgres', 'SELECT b FROM t'),
+	'42', 'new backend sees renamed column');
+
+# A backend that has the entry in its own cache is invalidated as usual
+my $session = open_session();
+is(run_query($session, 'SELECT f()'), '2', 'function loaded by session');
+$node->safe_psql('postgres',
+	q{CREATE OR REPLACE FUNCTION f() RETURNS int LANGUAGE sql AS 'SELECT 3'});
+is(run_query($session, 'SELECT f()'), '3',
+	'session sees function replaced by another backend');
+
+# Tuples loaded by a transaction that has changed the catalogs itself must
+# not be shared, or other backends would see them even after a rollback.
+run_query(
+	$session, q{BEGIN;
+CREATE OR REPLACE FUNCTION f() RETURNS int LANGUAGE sql AS 'SELECT 4';
+SELECT f();
+ROLLBACK});
+is($node->safe_psql('postgres', 'SELECT f()'),
+	'3', 'rolled back change not seen by new backend');
+
+# The first backend to call a set of functions with long bodies copies
+# their pg_proc tuples into its own cache; the next one only refers to the
+# shared copies, which should save it most of their size.
+my $nfuncs = 100;
+my $body = 'SELECT 1 -- ' . ('x' x 1000);
+$node->safe_psql(
+	'postgres',
+	join('',
+		map { "CREATE FUNCTION g$_() RETURNS int LANGUAGE sql AS '$body';\n" }
+		  (1 .. $nfuncs)));
+my $call_all = 'SELECT ' . join(' + ', map { "g$_()" } (1 .. $nfuncs)) . ';
+SELECT used_bytes FROM pg_backend_memory_contexts
+WHERE name = \'CacheMemoryContext\'';
+my (undef, $loader_bytes) = split /\n/, $node->safe_psql('postgres', $call_all);
+my (undef, $sharer_bytes) = split /\n/, $node->safe_psql('postgres', $call_all);
+cmp_ok($sharer_bytes, '<', $loader_bytes - $nfuncs * 800,
+	'backend using shared tuples keeps no copies of them');
+
+$session->{stdin} .= "\\q\n";
+$session->{handle}->finish;
+
+$node->stop;
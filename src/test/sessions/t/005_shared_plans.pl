@@ -0,0 +1,100 @@
+# Test the sharing of generic plans between backends, and that shared plans
+# are invalidated by DDL on the relations they use.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 8;
+
+my $psql_timeout = IPC::Run::timer(60);
+
+my $node = get_new_node('shared_plans');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq{
+shared_plan_cache_size = 8MB
+enable_seqscan = off
+log_min_messages = debug2
+});
+$node->start;
+
+# Number of times a backend has used a generic plan from the shared cache
+sub plans_shared
+{
+	my @shared = (slurp_file($node->logfile) =~
+		  /using generic plan from shared plan cache/g);
+	return scalar @shared;
+}
+
+# Open a session that stays connected until we finish it
+sub open_session
+{
+	my %session = (stdin => '', stdout => '', stderr => '');
+
+	$session{handle} = IPC::Run::start(
+		[   'psql', '-X', '-qAt', '-v', 'ON_ERROR_STOP=1', '-f', '-', '-d',
+			$node->connstr('postgres') ],
+		'<',
+		\$session{stdin},
+		'>',
+		\$session{stdout},
+		'2>',
+		\$session{stderr},
+		$psql_timeout);
+	return \%session;
+}
+
+# Run a command in a session, and return its output
+sub run_query
+{
+	my ($session, $sql) = @_;
+
+	$session->{stdout} = '';
+	$session->{stdin} .= "$sql;\n\\echo __done__\n";
+	$session->{handle}->pump until $session->{stdout} =~ /__done__/;
+	$session->{stdout} =~ s/\n?__done__\n//;
+	return $session->{stdout};
+}
+
+my $prepare = 'PREPARE q AS SELECT count(*) FROM sp WHERE a = 42';
+
+$node->safe_psql('postgres', q{
+CREATE TABLE sp (a int);
+INSERT INTO sp SELECT g FROM generate_series(1, 1000) g;
+ANALYZE sp;
+});
+
+# Each safe_psql call runs in a new backend.  The first one to execute the
+# statement plans it; the others take the plan from the shared cache.
+my $shared = plans_shared();
+is($node->safe_psql('postgres', "$prepare; EXECUTE q;"),
+	'1', 'statement planned by first backend');
+is(plans_shared(), $shared, 'first backend made its own plan');
+
+is($node->safe_psql('postgres', "$prepare; EXECUTE q;"),
+	'1', 'statement run by second backend');
+is(plans_shared(), $shared + 1, 'second backend used the shared plan');
+
+# A session holding the shared plan sees it invalidated like its own
+my $session = open_session();
+run_query($session, $prepare);
+like(run_query($session, 'EXPLAIN (COSTS OFF) EXECUTE q'),
+	qr/Seq Scan/, 'session uses the shared plan');
+
+$node->safe_psql('postgres', 'CREATE INDEX sp_a ON sp (a)');
+
+like(run_query($session, 'EXPLAIN (COSTS OFF) EXECUTE q'),
+	qr/Index/, 'session replans after index creation');
+
+# The shared plan is gone too, so a new backend plans the statement again
+$shared = plans_shared();
+like(
+	$node->safe_psql('postgres', "$prepare; EXPLAIN (COSTS OFF) EXECUTE q;"),
+	qr/Index/,
+	'new backend replans after index creation');
+is(plans_shared(), $shared, 'stale shared plan not used');
+
+$session->{stdin} .= "\\q\n";
+$session->{handle}->finish;
+
+$node->stop;
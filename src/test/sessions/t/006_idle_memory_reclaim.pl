@@ -0,0 +1,104 @@
+# Test that an idle session gives back the generic plans it has stopped
+# using, and builds them again when they are needed.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 7;
+use Time::HiRes qw(usleep);
+
+my $psql_timeout = IPC::Run::timer(60);
+
+my $node = get_new_node('idle_memory_reclaim');
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq{
+log_min_messages = debug2
+});
+$node->start;
+
+# Number of times idle sessions have reclaimed memory so far
+sub reclaims
+{
+	my @reclaims = (slurp_file($node->logfile) =~
+		  /reclaiming memory of idle session/g);
+	return scalar @reclaims;
+}
+
+# Wait until the given number of reclaim passes has been made
+sub wait_for_reclaims
+{
+	my ($count) = @_;
+	my $attempts = 0;
+
+	while ($attempts < 180 * 10)
+	{
+		return 1 if reclaims() >= $count;
+		usleep(100_000);
+		$attempts++;
+	}
+	return 0;
+}
+
+# Open a session that stays connected until we finish it
+sub open_session
+{
+	my %session = (stdin => '', stdout => '', stderr => '');
+
+	$session{handle} = IPC::Run::start(
+		[   'psql', '-X', '-qAt', '-v', 'ON_ERROR_STOP=1', '-f', '-', '-d',
+			$node->connstr('postgres') ],
+		'<',
+		\$session{stdin},
+		'>',
+		\$session{stdout},
+		'2>',
+		\$session{stderr},
+		$psql_timeout);
+	return \%session;
+}
+
+# Run a command in a session, and return its output
+sub run_query
+{
+	my ($session, $sql) = @_;
+
+	$session->{stdout} = '';
+	$session->{stdin} .= "$sql;\n\\echo __done__\n";
+	$session->{handle}->pump until $session->{stdout} =~ /__done__/;
+	$session->{stdout} =~ s/\n?__done__\n//;
+	return $session->{stdout};
+}
+
+my $count_plans = q{SELECT count(*) FROM pg_backend_memory_contexts
+WHERE name = 'CachedPlan' AND ident LIKE '%reclaim me%'};
+
+# Only this session reclaims memory, so all passes logged are its own
+my $session = open_session();
+run_query($session, 'SET idle_memory_reclaim_delay = 200');
+
+# The first pass after the statement was used keeps its plan; the next one
+# releases it, since it hasn't been used in between.
+my $reclaims = reclaims();
+run_query($session, "PREPARE q AS SELECT 'reclaim me'; EXECUTE q");
+ok(wait_for_reclaims($reclaims + 1), 'idle session reclaimed memory');
+is(run_query($session, $count_plans), '1', 'recently used plan kept');
+ok(wait_for_reclaims($reclaims + 2), 'idle session reclaimed memory again');
+is(run_query($session, $count_plans), '0', 'unused plan released');
+
+# The statement is planned again on its next use
+is(run_query($session, 'EXECUTE q'), 'reclaim me',
+	'statement runs after its plan was released');
+is(run_query($session, $count_plans), '1', 'plan built again');
+
+# Nothing is reclaimed in the middle of a transaction
+run_query($session, 'BEGIN');
+$reclaims = reclaims();
+sleep(1);
+is(reclaims(), $reclaims, 'no memory reclaimed inside a transaction');
+run_query($session, 'COMMIT');
+
+$session->{stdin} .= "\\q\n";
+$session->{handle}->finish;
+
+$node->stop;
@@ -5,10 +5,11 @@ use TestLib;
 use Test::More;
 use ServerSetup;
 use File::Copy;
+use IPC::Run;
 
 if ($ENV{with_openssl} eq 'yes')
 {
-	plan tests => 64;
+	plan tests => 66;
 }
 else
 {
@@ -310,6 +311,37 @@ test_connect_fails($common_connstr, "sslmode=require sslcert=ssl/client.crt",
 				   qr/SSL error/,
 				   "intermediate client certificate is missing");
 
+# Messages larger than the send buffer are written without copying them into
+# it first, and SSL records are then made from the caller's memory.  Check
+# that wide rows and a large COPY TO STDOUT arrive intact.
+note "sending large messages over SSL";
+
+my $ssl_connstr = "$common_connstr sslmode=require sslcert=ssl/client+client_ca.crt";
+
+sub psql_output
+{
+	my ($connstr, $sql) = @_;
+	my ($stdout, $stderr);
+
+	my $result = IPC::Run::run [ 'psql', '-X', '-A', '-t', '-d', $connstr,
+		'-c', $sql ], '>', \$stdout, '2>', \$stderr;
+	return $result ? $stdout : undef;
+}
+
+my $wide_rows = psql_output($ssl_connstr,
+	"SELECT (SELECT string_agg(i::text, ',') FROM generate_series(1, 1 << g) i) "
+	  . "FROM generate_series(0, 16) g ORDER BY g");
+ok( defined($wide_rows)
+	  && $wide_rows eq join('', map { join(',', 1 .. (1 << $_)) . "\n" } 0 .. 16),
+	"wide rows arrive intact over SSL");
+
+my $copy_out = psql_output($ssl_connstr,
+	"COPY (SELECT g, repeat('x', g % 100) FROM generate_series(1, 100000) g) TO STDOUT");
+ok( defined($copy_out)
+	  && $copy_out eq
+	  join('', map { "$_\t" . ('x' x ($_ % 100)) . "\n" } 1 .. 100000),
+	"large COPY TO STDOUT arrives intact over SSL");
+
 # clean up
 unlink("ssl/client_tmp.key",
 	   "ssl/client_wrongperms_tmp.key",
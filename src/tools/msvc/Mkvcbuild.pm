@@ -114,7 +114,7 @@ sub mkvcbuild
 	  base64.c config_info.c controldata_utils.c exec.c file_perm.c ip.c
 	  keywords.c md5.c pg_lzcompress.c pgfnames.c psprintf.c relpath.c rmtree.c
 	  saslprep.c scram-common.c string.c unicode_norm.c username.c
-	  wait_error.c);
+	  wait_error.c zpq_stream.c);
 
 	if ($solution->{options}->{openssl})
 	{